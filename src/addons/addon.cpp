@@ -110,6 +110,19 @@ Addon::Addon(const XMLNode &xml)
 
 };   // Addon(const XML&)
 
+// ----------------------------------------------------------------------------
+/** Returns the id an addon created from the given xml node would have,
+ *  without reading all of its data.
+ */
+std::string Addon::getIdFromXML(const XMLNode &xml)
+{
+    std::string name;
+    xml.get("name", &name);
+    std::string dir_name = StringUtils::toLowerCase(name);
+    xml.get("id", &dir_name);
+    return createAddonId(dir_name);
+}   // getIdFromXML
+
 // ----------------------------------------------------------------------------
 /** Copies the installation data (like description, revision, icon) from the
  *  downloaded online list to this entry.
@@ -67,6 +67,8 @@ public:
         return "addon_"+id;
     }   // createAddonId
     // ------------------------------------------------------------------------
+    static std::string getIdFromXML(const XMLNode &xml);
+    // ------------------------------------------------------------------------
 
 private:
     /** The name to be displayed. */
@@ -193,6 +195,9 @@ public:
     /** Marks that this addon still exists on the server. */
     void setStillExists() { m_still_exists = true; }
     // ------------------------------------------------------------------------
+    /** Marks that this addon was not (yet) found on the server. */
+    void clearStillExists() { m_still_exists = false; }
+    // ------------------------------------------------------------------------
     /** True if this addon needs to be updated. */
     bool needsUpdate() const
     {
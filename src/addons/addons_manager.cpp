@@ -71,6 +71,7 @@ AddonsManager::AddonsManager() : m_addons_list(std::vector<Addon>() ),
     m_addons_list.lock();
     // Clear the list in case that a reinit is being done.
     m_addons_list.getData().clear();
+    m_addon_index.clear();
     loadInstalledAddons();
     m_addons_list.unlock();
 }   // AddonsManager
@@ -168,12 +169,17 @@ void AddonsManager::init(const XMLNode *xml,
  */
 void AddonsManager::initAddons(const XMLNode *xml)
 {
+    // The list is kept from the last refresh (or from loading the installed
+    // addons), so only addons that changed on the server need to be updated.
     m_addons_list.lock();
-    // Clear the list in case that a reinit is being done.
-    m_addons_list.getData().clear();
-    loadInstalledAddons();
+    for (Addon& addon : m_addons_list.getData())
+        addon.clearStillExists();
     m_addons_list.unlock();
 
+    // The result of merging a node depends on the artist debug mode, so a
+    // change of it must not use the hashes from the last refresh
+    const uint64_t debug_mode = UserConfigParams::m_artist_debug_mode ? 1 : 0;
+    std::unordered_map<std::string, uint64_t> server_hashes;
     for(unsigned int i=0; i<xml->getNumNodes(); i++)
     {
         const XMLNode *node = xml->getNode(i);
@@ -184,6 +190,25 @@ void AddonsManager::initAddons(const XMLNode *xml)
         if(node->getName()=="track" || node->getName()=="kart" ||
             node->getName()=="arena"                                 )
         {
+            const std::string id = Addon::getIdFromXML(*node);
+            const uint64_t hash = node->getAttributesHash() ^ debug_mode;
+            auto old = m_server_hashes.find(id);
+            if (old != m_server_hashes.end() && old->second == hash)
+            {
+                // Unchanged since the last refresh (including rating, status
+                // and icon revision), so it was already checked and merged
+                m_addons_list.lock();
+                int index = getAddonIndex(id);
+                if (index >= 0)
+                {
+                    m_addons_list.getData()[index].setStillExists();
+                    server_hashes[id] = hash;
+                    m_addons_list.unlock();
+                    continue;
+                }
+                m_addons_list.unlock();
+            }
+
             Addon addon(*node);
             int index = getAddonIndex(addon.getId());
 
@@ -224,13 +249,21 @@ void AddonsManager::initAddons(const XMLNode *xml)
             }
 
             m_addons_list.lock();
-            if(index>=0)
+            if(index>=0 && !m_addons_list.getData()[index].isInstalled())
+            {
+                // Not installed, so this entry only contains the data of the
+                // last refresh: replace it with the current data
+                m_addons_list.getData()[index] = addon;
+            }
+            else if(index>=0)
             {
                 Addon& tmplist_addon = m_addons_list.getData()[index];
 
                 // Only copy the data if a newer revision is found (ignore unapproved
-                // revisions unless player is in the mode to see them)
-                if (tmplist_addon.getRevision() < addon.getRevision() &&
+                // revisions unless player is in the mode to see them). The
+                // same revision is copied again, since e.g. the rating or
+                // status can change without a new revision.
+                if (tmplist_addon.getRevision() <= addon.getRevision() &&
                     (addon.testStatus(Addon::AS_APPROVED) || UserConfigParams::m_artist_debug_mode))
                 {
                     m_addons_list.getData()[index].copyInstallData(addon);
@@ -238,12 +271,13 @@ void AddonsManager::initAddons(const XMLNode *xml)
             }
             else
             {
-                m_addons_list.getData().push_back(addon);
+                addAddon(addon);
                 index = (int) m_addons_list.getData().size()-1;
             }
             // Mark that this addon still exists on the server
             m_addons_list.getData()[index].setStillExists();
             m_addons_list.unlock();
+            server_hashes[addon.getId()] = hash;
         }
         else
         {
@@ -253,6 +287,7 @@ void AddonsManager::initAddons(const XMLNode *xml)
         }
     }   // for i<xml->getNumNodes
     delete xml;
+    m_server_hashes.swap(server_hashes);
 
     // Now remove all items from the addons-installed list, that are not
     // on the server anymore (i.e. not in the addons.xml file), and not
@@ -284,8 +319,7 @@ void AddonsManager::initAddons(const XMLNode *xml)
             file_manager->removeFile(icon_file);
             // Ignore errors silently.
         }
-        m_addons_list.getData()[i] = m_addons_list.getData()[count-1];
-        m_addons_list.getData().pop_back();
+        removeAddon(i);
         count--;
     }
     m_addons_list.unlock();
@@ -446,13 +480,48 @@ void AddonsManager::loadInstalledAddons()
             node->getName()=="track"    )
         {
             Addon addon(*node);
-            m_addons_list.getData().push_back(addon);
+            addAddon(addon);
         }
     }   // for i <= xml->getNumNodes()
 
     delete xml;
 }   // loadInstalledAddons
 
+// ----------------------------------------------------------------------------
+/** Appends an addon to the list of addons. The list must be locked.
+ *  \param addon The addon to add.
+ */
+void AddonsManager::addAddon(const Addon &addon)
+{
+    // If an id appears twice, the first entry is found (as it was with a
+    // linear search)
+    m_addon_index.emplace(addon.getId(),
+                          (unsigned)m_addons_list.getData().size());
+    m_addons_list.getData().push_back(addon);
+}   // addAddon
+
+// ----------------------------------------------------------------------------
+/** Removes an addon from the list of addons by replacing it with the last
+ *  addon. The list must be locked.
+ *  \param index Index of the addon to remove.
+ */
+void AddonsManager::removeAddon(unsigned int index)
+{
+    std::vector<Addon>& list = m_addons_list.getData();
+    const unsigned int last = (unsigned int)list.size() - 1;
+    auto it = m_addon_index.find(list[index].getId());
+    if (it != m_addon_index.end() && it->second == index)
+        m_addon_index.erase(it);
+    if (index != last)
+    {
+        list[index] = list[last];
+        it = m_addon_index.find(list[index].getId());
+        if (it != m_addon_index.end() && it->second == last)
+            it->second = index;
+    }
+    list.pop_back();
+}   // removeAddon
+
 // ----------------------------------------------------------------------------
 /** Returns an addon with a given id. Raises an assertion if the id is not
  *  found!
@@ -471,14 +540,8 @@ Addon* AddonsManager::getAddon(const std::string &id)
  */
 int AddonsManager::getAddonIndex(const std::string &id) const
 {
-    for(unsigned int i = 0; i < m_addons_list.getData().size(); i++)
-    {
-        if(m_addons_list.getData()[i].getId()== id)
-        {
-            return i;
-        }
-    }
-    return -1;
+    auto it = m_addon_index.find(id);
+    return it == m_addon_index.end() ? -1 : (int)it->second;
 }   // getAddonIndex
 // ----------------------------------------------------------------------------
 bool AddonsManager::anyAddonsInstalled() const
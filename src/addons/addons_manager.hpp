@@ -24,6 +24,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "addons/addon.hpp"
@@ -40,6 +41,14 @@ private:
      *  combined from the addons_installed.xml file first, then information
      *  from the downloaded list of items is merged/added to that. */
     Synchronised<std::vector<Addon> >  m_addons_list;
+    /** Maps the id of an addon to its index in m_addons_list. It must only
+     *  be used while m_addons_list is locked. */
+    std::unordered_map<std::string, unsigned> m_addon_index;
+    /** A hash of the xml node of each addon in the last online list that
+     *  was applied (see XMLNode::getAttributesHash()). Unchanged nodes are
+     *  not parsed again when the list is refreshed. Only used by
+     *  initAddons(). */
+    std::unordered_map<std::string, uint64_t> m_server_hashes;
     /** Full filename of the addons_installed.xml file. */
     std::string                        m_file_installed;
 
@@ -61,6 +70,8 @@ private:
     bool m_downloaded_icons;
 
     void  loadInstalledAddons();
+    void  addAddon(const Addon &addon);
+    void  removeAddon(unsigned int index);
 
 public:
                  AddonsManager();
@@ -15,16 +15,29 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
-#include <string.h>
-#include <iostream>
-#include <fstream>
+#include "addons/zip.hpp"
 
 #include "graphics/irr_driver.hpp"
 #include "io/file_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
 
 #include <IWriteFile.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
 using namespace irr;
 using namespace io;
 s32 IFileSystem_copyFileToFile(IWriteFile* dst, IReadFile* src)
@@ -50,12 +63,15 @@ s32 IFileSystem_copyFileToFile(IWriteFile* dst, IReadFile* src)
 }   // IFileSystem_copyFileToFile
 
 // ----------------------------------------------------------------------------
-/** Extracts all files from the zip archive 'from' to the directory 'to'.
+/** Extracts all files from the zip archive 'from' to the directory 'to'
+ *  using irrlicht's archive loader. This is used for archives which are not
+ *  supported by the faster extractor below (e.g. encrypted or zip64).
  *  \param from A zip archive.
  *  \param to The destination directory.
  *  \return True if successful.
  */
-bool extract_zip(const std::string &from, const std::string &to, bool recursive)
+static bool extractWithIrrlicht(const std::string &from,
+                                const std::string &to, bool recursive)
 {
     //Add the zip to the file system
     IFileSystem *file_system = irr_driver->getDevice()->getFileSystem();
@@ -125,4 +141,330 @@ bool extract_zip(const std::string &from, const std::string &to, bool recursive)
     file_system->removeFileArchive(file_system->getAbsolutePath(from.c_str()));
 
     return !error;
+}   // extractWithIrrlicht
+
+// ============================================================================
+/** Data of a file in a zip archive, read from the central directory. */
+struct ZipEntry
+{
+    /** Name of the file relative to the destination directory. */
+    std::string m_name;
+    uint32_t    m_local_header;
+    uint32_t    m_compressed_size;
+    uint32_t    m_size;
+    uint32_t    m_crc;
+    uint16_t    m_method;
+};   // ZipEntry
+
+// ----------------------------------------------------------------------------
+static uint16_t getLE16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}   // getLE16
+
+// ----------------------------------------------------------------------------
+static uint32_t getLE32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}   // getLE32
+
+// ----------------------------------------------------------------------------
+/** Reads the central directory of a zip archive.
+ *  \param zip The opened zip archive.
+ *  \param recursive If false, all files are extracted without their path.
+ *  \param entries On return the files to extract.
+ *  \param error Set if a file can not be extracted because of its name.
+ *  \return False if the archive can not be read, or uses features (like
+ *          encryption, zip64 or other compression methods) which are not
+ *          supported.
+ */
+static bool readZipDirectory(FILE *zip, bool recursive,
+                             std::vector<ZipEntry> *entries, bool *error)
+{
+    // The end of central directory record is at the end of the file,
+    // followed by a comment of at most 65535 bytes
+    if (fseek(zip, 0, SEEK_END) != 0)
+        return false;
+    const long size = ftell(zip);
+    if (size < 22 || (uint64_t)size > 0xffffffffull)
+        return false;
+    std::vector<uint8_t> tail((size_t)std::min<long>(size, 22 + 65535));
+    if (fseek(zip, size - (long)tail.size(), SEEK_SET) != 0 ||
+        fread(tail.data(), 1, tail.size(), zip) != tail.size())
+        return false;
+    int eocd = (int)tail.size() - 22;
+    while (eocd >= 0 && getLE32(&tail[eocd]) != 0x06054b50)
+        eocd--;
+    if (eocd < 0)
+        return false;
+    const uint8_t *p = &tail[eocd];
+    const unsigned num_entries = getLE16(p + 10);
+    const uint32_t dir_size    = getLE32(p + 12);
+    const uint32_t dir_offset  = getLE32(p + 16);
+    if (getLE16(p + 4) != 0 || getLE16(p + 6) != 0 ||
+        num_entries == 0xffff || dir_offset == 0xffffffff ||
+        (uint64_t)dir_offset + dir_size > (uint64_t)size)
+        return false;
+
+    std::vector<uint8_t> dir(dir_size);
+    if (fseek(zip, (long)dir_offset, SEEK_SET) != 0 ||
+        fread(dir.data(), 1, dir.size(), zip) != dir.size())
+        return false;
+
+    std::set<std::string> names;
+    size_t pos = 0;
+    for (unsigned i = 0; i < num_entries; i++)
+    {
+        if (pos + 46 > dir.size() || getLE32(&dir[pos]) != 0x02014b50)
+            return false;
+        p = &dir[pos];
+        const unsigned name_length = getLE16(p + 28);
+        const size_t next = pos + 46 + name_length + getLE16(p + 30) +
+                            getLE16(p + 32);
+        if (next > dir.size())
+            return false;
+        ZipEntry entry;
+        entry.m_method          = getLE16(p + 10);
+        entry.m_crc             = getLE32(p + 16);
+        entry.m_compressed_size = getLE32(p + 20);
+        entry.m_size            = getLE32(p + 24);
+        entry.m_local_header    = getLE32(p + 42);
+        entry.m_name.assign((const char*)p + 46, name_length);
+        pos = next;
+        // Encrypted files and zip64 are left to irrlicht
+        if ((getLE16(p + 8) & 1) != 0 ||
+            (entry.m_method != 0 && entry.m_method != 8) ||
+            entry.m_compressed_size == 0xffffffff ||
+            entry.m_size == 0xffffffff ||
+            entry.m_local_header == 0xffffffff)
+            return false;
+
+        std::replace(entry.m_name.begin(), entry.m_name.end(), '\\', '/');
+        const std::string base = StringUtils::getBasename(entry.m_name);
+        // Skip directories and hidden files
+        if (base.empty() || base[0] == '.')
+            continue;
+        if (!recursive)
+            entry.m_name = base;
+        else if (entry.m_name[0] == '/' ||
+                 ("/" + entry.m_name + "/").find("/../") != std::string::npos)
+        {
+            Log::warn("addons", "Ignoring file '%s' outside of the "
+                      "destination directory.", entry.m_name.c_str());
+            *error = true;
+            continue;
+        }
+        // Without path two files can have the same name, only extract the
+        // first one
+        if (names.insert(entry.m_name).second)
+            entries->push_back(entry);
+    }
+    return true;
+}   // readZipDirectory
+
+// ----------------------------------------------------------------------------
+/** Extracts one file from a zip archive, and checks its size and crc.
+ *  \param zip The opened zip archive.
+ *  \param entry The file to extract.
+ *  \param to The destination directory.
+ *  \param in_buffer, out_buffer Buffers used for reading and writing.
+ *  \param done_bytes Number of compressed bytes read, for progress.
+ *  \return True if successful.
+ */
+static bool extractEntry(FILE *zip, const ZipEntry &entry,
+                         const std::string &to,
+                         std::vector<uint8_t> *in_buffer,
+                         std::vector<uint8_t> *out_buffer,
+                         std::atomic<uint64_t> *done_bytes)
+{
+    uint8_t header[30];
+    if (fseek(zip, (long)entry.m_local_header, SEEK_SET) != 0 ||
+        fread(header, 1, 30, zip) != 30 || getLE32(header) != 0x04034b50 ||
+        fseek(zip, (long)entry.m_local_header + 30 + getLE16(header + 26) +
+              getLE16(header + 28), SEEK_SET) != 0)
+    {
+        Log::warn("addons", "Can't read file '%s'. This is ignored, but the "
+                  "addon might not work", entry.m_name.c_str());
+        return false;
+    }
+
+    const std::string file_location = to + "/" + entry.m_name;
+    FILE *out = FileUtils::fopenU8Path(file_location, "wb");
+    if (!out)
+    {
+        Log::warn("addons", "Couldn't create the file '%s'. This is "
+                  "ignored, but the addon might not work.",
+                  file_location.c_str());
+        return false;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    bool ok = entry.m_method == 0 ||
+              inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+    int z_result = Z_OK;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    uint64_t written = 0;
+    uint32_t remaining = entry.m_compressed_size;
+    while (ok && remaining > 0 && z_result != Z_STREAM_END)
+    {
+        const size_t n = fread(in_buffer->data(), 1,
+            std::min<size_t>(remaining, in_buffer->size()), zip);
+        if (n == 0)
+        {
+            ok = false;
+            break;
+        }
+        remaining -= (uint32_t)n;
+        done_bytes->fetch_add(n);
+        if (entry.m_method == 0)
+        {
+            crc = crc32(crc, in_buffer->data(), (uInt)n);
+            ok = fwrite(in_buffer->data(), 1, n, out) == n;
+            written += n;
+            continue;
+        }
+        stream.next_in  = in_buffer->data();
+        stream.avail_in = (uInt)n;
+        do
+        {
+            stream.next_out  = out_buffer->data();
+            stream.avail_out = (uInt)out_buffer->size();
+            z_result = inflate(&stream, Z_NO_FLUSH);
+            // Z_BUF_ERROR only means that no progress was possible
+            if (z_result != Z_OK && z_result != Z_STREAM_END &&
+                z_result != Z_BUF_ERROR)
+            {
+                ok = false;
+                break;
+            }
+            const size_t produced = out_buffer->size() - stream.avail_out;
+            crc = crc32(crc, out_buffer->data(), (uInt)produced);
+            ok = fwrite(out_buffer->data(), 1, produced, out) == produced;
+            written += produced;
+        } while (ok && z_result != Z_STREAM_END &&
+                 (stream.avail_in > 0 || stream.avail_out == 0));
+    }
+    if (entry.m_method != 0)
+    {
+        ok = ok && z_result == Z_STREAM_END;
+        inflateEnd(&stream);
+    }
+    if (fclose(out) != 0)
+        ok = false;
+    if (!ok || written != entry.m_size || crc != entry.m_crc)
+    {
+        Log::warn("addons", "Could not extract '%s', the archive might be "
+                  "damaged. This is ignored, but the addon might not work.",
+                  entry.m_name.c_str());
+        return false;
+    }
+    return true;
+}   // extractEntry
+
+// ----------------------------------------------------------------------------
+/** Extracts all files from the zip archive 'from' to the directory 'to'.
+ *  The central directory is read first, then the files are inflated in
+ *  parallel by a few worker threads, each with its own file handle of the
+ *  archive. The crc and size of each file is checked. Archives which can
+ *  not be handled this way are extracted using irrlicht.
+ *  \param from A zip archive.
+ *  \param to The destination directory.
+ *  \param recursive If false, all files are extracted without their path.
+ *  \param progress If set, called with the fraction of the archive that
+ *         was extracted so far, from the calling thread.
+ *  \return True if successful.
+ */
+bool extract_zip(const std::string &from, const std::string &to,
+                 bool recursive, std::function<void(float)> progress)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<ZipEntry> entries;
+    bool error = false;
+    FILE *zip = FileUtils::fopenU8Path(from, "rb");
+    const bool supported = zip &&
+        readZipDirectory(zip, recursive, &entries, &error);
+    if (zip)
+        fclose(zip);
+    if (!supported)
+    {
+        bool success = extractWithIrrlicht(from, to, recursive);
+        if (progress)
+            progress(1.0f);
+        return success;
+    }
+
+    uint64_t total_bytes = 0;
+    std::set<std::string> dirs;
+    for (const ZipEntry &entry : entries)
+    {
+        total_bytes += entry.m_compressed_size;
+        if (recursive)
+            dirs.insert(StringUtils::getPath(to + "/" + entry.m_name));
+    }
+    // Create all directories before starting the threads
+    for (const std::string &dir : dirs)
+        file_manager->checkAndCreateDirectoryP(dir);
+
+    const unsigned num_threads = std::max(1u, std::min(
+        std::min(std::thread::hardware_concurrency(), 8u),
+        (unsigned)entries.size()));
+    std::atomic<unsigned> next_entry(0);
+    std::atomic<uint64_t> done_bytes(0);
+    std::atomic<bool> extract_error(false);
+    std::mutex finished_mutex;
+    std::condition_variable finished_cv;
+    unsigned finished = 0;
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < num_threads; i++)
+    {
+        threads.emplace_back([&]()
+        {
+            VS::setThreadName("extract_zip");
+            FILE *archive = FileUtils::fopenU8Path(from, "rb");
+            std::vector<uint8_t> in_buffer(256 * 1024);
+            std::vector<uint8_t> out_buffer(1024 * 1024);
+            while (true)
+            {
+                const unsigned n = next_entry.fetch_add(1);
+                if (n >= entries.size())
+                    break;
+                if (!archive || !extractEntry(archive, entries[n], to,
+                                              &in_buffer, &out_buffer,
+                                              &done_bytes))
+                    extract_error = true;
+            }
+            if (archive)
+                fclose(archive);
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            finished++;
+            finished_cv.notify_one();
+        });
+    }
+
+    bool all_finished = false;
+    while (!all_finished)
+    {
+        std::unique_lock<std::mutex> ul(finished_mutex);
+        finished_cv.wait_for(ul, std::chrono::milliseconds(100),
+            [&finished, num_threads] { return finished == num_threads; });
+        all_finished = finished == num_threads;
+        ul.unlock();
+        if (progress)
+        {
+            progress(total_bytes == 0 ? 1.0f :
+                     (float)((double)done_bytes.load() / total_bytes));
+        }
+    }
+    for (std::thread &t : threads)
+        t.join();
+
+    Log::info("addons", "Extracted %d files (%.1f MB) from '%s' in %f "
+              "seconds using %d threads.", (int)entries.size(),
+              total_bytes / (1024.0 * 1024.0), from.c_str(),
+              std::chrono::duration<double>
+              (std::chrono::steady_clock::now() - start).count(),
+              num_threads);
+    return !error && !extract_error;
 }   // extract_zip
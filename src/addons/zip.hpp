@@ -18,10 +18,15 @@
 #ifndef HEADER_ZIP_HPP
 #define HEADER_ZIP_HPP
 
+#include <functional>
+#include <string>
+
 /**
   * Extract a zip.
   * \ingroup addonsgroup
   */
-bool extract_zip(const std::string &from, const std::string &to, bool recursive = false);
+bool extract_zip(const std::string &from, const std::string &to,
+                 bool recursive = false,
+                 std::function<void(float)> progress = nullptr);
 
 #endif
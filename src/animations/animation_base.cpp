@@ -79,6 +79,32 @@ void AnimationBase::calculateAnimationDuration()
     }
 }   // calculateAnimationDuration
 
+// ----------------------------------------------------------------------------
+/** Returns the time after which the animation repeats itself once all
+ *  IPOs are past their end time: 0 if no IPO is cyclic (i.e. the animation
+ *  stops), and a negative value if the cyclic IPOs have different cycles,
+ *  in which case the combined animation might not repeat at all.
+ */
+float AnimationBase::getRepeatPeriod() const
+{
+    float period = 0.0f;
+    const Ipo* first_cyclic = NULL;
+    for (const Ipo* curr : m_all_ipos)
+    {
+        if (!curr->isCyclic())
+            continue;
+        if (!first_cyclic)
+        {
+            first_cyclic = curr;
+            period = curr->getEndTime() - curr->getStartTime();
+        }
+        else if (curr->getStartTime() != first_cyclic->getStartTime() ||
+                 curr->getEndTime()   != first_cyclic->getEndTime()     )
+            return -1.0f;
+    }
+    return period;
+}   // getRepeatPeriod
+
 // ----------------------------------------------------------------------------
 /** Stores the initial transform (in the IPOs actually). This is necessary
  *  for relative IPOs.
@@ -87,6 +87,8 @@ public:
 
     // ------------------------------------------------------------------------
     float getAnimationDuration() const         { return m_animation_duration; }
+    // ------------------------------------------------------------------------
+    float getRepeatPeriod() const;
 
 };   // AnimationBase
 
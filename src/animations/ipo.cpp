@@ -88,6 +88,7 @@ Ipo::IpoData::IpoData(const XMLNode &curve, float fps, bool reverse)
     else
         readIPO(curve, fps, reverse);
 
+    computeSegments();
 }   // IpoData
 
 // ----------------------------------------------------------------------------
@@ -319,33 +320,52 @@ float Ipo::IpoData::adjustTime(float time)
 }   // adjustTime
 
 // ----------------------------------------------------------------------------
-float Ipo::IpoData::get(float time, unsigned int index, unsigned int n)
+/** Precomputes the polynomial of each segment between two control points.
+ *  Constant and linear interpolations are just special cases of the cubic
+ *  polynomial of a bezier curve.
+ */
+void Ipo::IpoData::computeSegments()
 {
-    switch(m_interpolation)
+    m_segments.clear();
+    for (unsigned int n = 0; n + 1 < m_points.size(); n++)
     {
-    case IP_CONST  : return m_points[n][index];
-    case IP_LINEAR : {
-                        float t = time-m_points[n].getW();
-                        return m_points[n][index]
-                             + t*(m_points[n+1][index]-m_points[n][index]) /
-                                 (m_points[n+1].getW()-m_points[n].getW());
-                     }
-    case IP_BEZIER:  {  if(n==m_points.size()-1)
-                        {
-                            // FIXME: only const implemented atm.
-                            return m_points[n][index];
-                        }
-                        float t = (time-m_points[n].getW())
-                                / (m_points[n+1].getW()-m_points[n].getW());
-                        return getCubicBezier(t,
-                                              m_points [n  ][index],
-                                              m_handle2[n  ][index],
-                                              m_handle1[n+1][index],
-                                              m_points [n+1][index]);
-                    }
-    }   // switch
-    // Keep the compiler happy:
-    return 0;
+        Segment segment;
+        const Vec3 &p0 = m_points[n];
+        const Vec3 &p1 = m_points[n + 1];
+        const float duration = p1.getW() - p0.getW();
+        segment.m_inv_duration = duration > 0.0f ? 1.0f / duration : 0.0f;
+        segment.m_a = segment.m_b = segment.m_c = Vec3(0, 0, 0);
+        segment.m_d = Vec3(p0.getX(), p0.getY(), p0.getZ());
+        switch (m_interpolation)
+        {
+        case IP_CONST:
+            break;
+        case IP_LINEAR:
+            segment.m_c = p1 - p0;
+            break;
+        case IP_BEZIER:
+            // See getCubicBezier()
+            segment.m_c = (m_handle2[n] - p0) * 3.0f;
+            segment.m_b = (m_handle1[n + 1] - m_handle2[n]) * 3.0f
+                        - segment.m_c;
+            segment.m_a = p1 - p0 - segment.m_c - segment.m_b;
+            break;
+        }
+        m_segments.push_back(segment);
+    }
+}   // computeSegments
+
+// ----------------------------------------------------------------------------
+/** Returns the interpolated value of all three components.
+ *  \param time The time, which must be within the segment.
+ *  \param n Index of the segment.
+ */
+Vec3 Ipo::IpoData::get(float time, unsigned int n) const
+{
+    const Segment &segment = m_segments[n];
+    const float s = (time - m_points[n].getW()) * segment.m_inv_duration;
+    return ((segment.m_a * s + segment.m_b) * s + segment.m_c) * s
+           + segment.m_d;
 }   // IpoData::get
 
 // ----------------------------------------------------------------------------
@@ -516,10 +536,11 @@ void Ipo::update(float time, Vec3 *xyz, Vec3 *hpr,Vec3 *scale)
     case Ipo::IPO_SCALEZ : if(scale) scale->setZ(get(time, 0)); break;
     case Ipo::IPO_LOCXYZ :
         {
+            // Only look up the segment once for all three components
             if(xyz)
             {
-                for(unsigned int j=0; j<3; j++)
-                    (*xyz)[j] = get(time, j);
+                const Vec3 v = get(time);
+                xyz->setValue(v.getX(), v.getY(), v.getZ());
             }
             break;
         }
@@ -538,10 +559,25 @@ void Ipo::updateNextN(float *time) const
 {
     *time = m_ipo_data->adjustTime(*time);
 
-    // Time was reset since the last cached value for n,
-    // reset n to start from the beginning again.
-    if (*time < m_ipo_data->m_points[m_next_n - 1].getW())
-        m_next_n = 1;
+    // Time was reset since the last cached value for n (e.g. a cyclic
+    // animation started again): search the segment, which is the first
+    // point (excluding the first and last) with a time greater than time.
+    const std::vector<Vec3> &points = m_ipo_data->m_points;
+    if (*time < points[m_next_n - 1].getW())
+    {
+        if (points.size() < 2)
+            m_next_n = 1;
+        else
+        {
+            std::vector<Vec3>::const_iterator it =
+                std::upper_bound(points.begin() + 1, points.end() - 1, *time,
+                                 [](float t, const Vec3 &p)
+                                 {
+                                     return t < p.getW();
+                                 });
+            m_next_n = (unsigned int)(it - points.begin());
+        }
+    }
     // Search for the first point in the (sorted) array which is greater or equal
     // to the current time.
     while (m_next_n < m_ipo_data->m_points.size() - 1 &&
@@ -557,17 +593,27 @@ void Ipo::updateNextN(float *time) const
  *  \param time The time for which the interpolated value should be computed.
  */
 float Ipo::get(float time, unsigned int index) const
+{
+    return get(time)[index];
+}   // get
+
+// ----------------------------------------------------------------------------
+/** Returns all three interpolated components at the specified time. Only
+ *  the x component is used by IPOs for a single channel.
+ *  \param time The time for which the interpolated value should be computed.
+ */
+Vec3 Ipo::get(float time) const
 {
     assert(!std::isnan(time));
 
     // Avoid crash in case that only one point is given for this IPO.
-    if(m_next_n==0)
-        return m_ipo_data->m_points[0][index];
+    if (m_ipo_data->m_segments.empty())
+        return m_ipo_data->m_points[0];
 
     updateNextN(&time);
 
-    float rval = m_ipo_data->get(time, index, m_next_n-1);
-    assert(!std::isnan(rval));
+    Vec3 rval = m_ipo_data->get(time, m_next_n-1);
+    assert(!std::isnan(rval.getX()));
     return rval;
 }   // get
 
@@ -78,6 +78,19 @@ private:
 
         /** Stores the inital rotation of the object. */
         Vec3 m_initial_hpr;
+
+        /** The cubic polynomial of one segment, i.e. between m_points[n] and
+         *  m_points[n+1], so that the value is ((a*s+b)*s+c)*s+d, with s the
+         *  time relative to the segment scaled to [0,1]. All three
+         *  components are computed at the same time. */
+        struct Segment
+        {
+            Vec3  m_a, m_b, m_c, m_d;
+            float m_inv_duration;
+        };
+        /** The precomputed segments, so that no coefficients need to be
+         *  computed each time the IPO is evaluated. */
+        std::vector<Segment> m_segments;
     private:
         float  getCubicBezier(float t, float p0, float p1,
                               float p2, float p3) const;
@@ -87,6 +100,7 @@ private:
                                const Vec3 &p0, const Vec3 &p1,
                                const Vec3 &h0, const Vec3 &h2,
                                unsigned int rec_level = 0);
+        void computeSegments();
     public:
                IpoData(const XMLNode &curve, float fps, bool reverse);
         void   readCurve(const XMLNode &node, bool reverse);
@@ -95,7 +109,7 @@ private:
                                  const Vec3 &p0, const Vec3 &p1,
                                  const Vec3 &h1, const Vec3 &h2);
         float  adjustTime(float time);
-        float  get(float time, unsigned int index, unsigned int n);
+        Vec3   get(float time, unsigned int n) const;
         float  getDerivative(float time, unsigned int index, unsigned int n);
 
     };   // IpoData
@@ -127,6 +141,7 @@ public:
                                 Vec3 *scale=NULL);
     void     getDerivative(float time, Vec3 *xyz);
     float    get(float time, unsigned int index) const;
+    Vec3     get(float time) const;
     void     setInitialTransform(const Vec3 &xyz, const Vec3 &hpr);
     void     reset();
     // ------------------------------------------------------------------------
@@ -136,6 +151,13 @@ public:
     /** Returns the last specified time (i.e. not considering any extend
      *  types). */
     float getEndTime() const { return m_ipo_data->m_end_time; }
+    // ------------------------------------------------------------------------
+    /** Returns the first specified time. */
+    float getStartTime() const { return m_ipo_data->m_start_time; }
+    // ------------------------------------------------------------------------
+    /** Returns true if this IPO repeats after its end time (otherwise the
+     *  value at the end time is kept). */
+    bool isCyclic() const { return m_ipo_data->m_extend == IpoData::ET_CYCLIC; }
 };   // Ipo
 
 #endif
@@ -22,6 +22,7 @@
 
 #include "audio/sfx_base.hpp"
 #include "animations/ipo.hpp"
+#include "config/stk_config.hpp"
 #include "graphics/material.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/mesh_tools.hpp"
@@ -80,14 +81,22 @@ void ThreeDAnimation::updateWithWorldTicks(bool has_physics)
         (!has_physics && track_object_with_physics))
         return;
 
-    Vec3 xyz   = m_object->getPosition();
-    Vec3 scale = m_object->getScale();
-
     if (!m_is_paused)
     {
         int cur_ticks = World::getWorld()->getTicksSinceStart();
         m_current_time = stk_config->ticks2Time(cur_ticks);
     }
+    updateTransform();
+}   // updateWithWorldTicks
+
+// ----------------------------------------------------------------------------
+/** Moves the object to the position and rotation of the animation at
+ *  m_current_time.
+ */
+void ThreeDAnimation::updateTransform()
+{
+    Vec3 xyz   = m_object->getPosition();
+    Vec3 scale = m_object->getScale();
 
     AnimationBase::getAt(m_current_time, &xyz, &m_hpr, &scale);     //updates all IPOs
     //m_node->setPosition(xyz.toIrrVector());
@@ -118,7 +127,54 @@ void ThreeDAnimation::updateWithWorldTicks(bool has_physics)
     {
         m_object->move(xyz.toIrrVector(), hpr, scale.toIrrVector(), true, false);
     }
-}   // update
+}   // updateTransform
+
+// ----------------------------------------------------------------------------
+/** Computes the axis aligned box which contains the physical object of this
+ *  animation at any time, by sampling the animation once per time step until
+ *  it repeats itself (or stops). The current position of the object is
+ *  restored afterwards.
+ *  \param min On return the minimum corner of the box.
+ *  \param max On return the maximum corner of the box.
+ *  \return False if no box can be computed, e.g. if the IPOs of this
+ *          animation do not share the same cycle.
+ */
+bool ThreeDAnimation::getSweptAabb(Vec3 *min, Vec3 *max)
+{
+    PhysicalObject* po = m_object->getPhysicalObject();
+    const float period = getRepeatPeriod();
+    if (!po || !m_playing || period < 0.0f)
+        return false;
+
+    // After the animation duration only the cyclic IPOs change, so one
+    // more cycle covers all combinations of cyclic and constant IPOs.
+    const float saved_time = m_current_time;
+    const int end_ticks =
+        stk_config->time2Ticks(m_animation_duration + period);
+    const btCollisionShape* shape = po->getBody()->getCollisionShape();
+    for (int ticks = 0; ticks <= end_ticks; ticks++)
+    {
+        m_current_time = stk_config->ticks2Time(ticks);
+        updateTransform();
+        btTransform trans;
+        po->getMotionState()->getWorldTransform(trans);
+        btVector3 aabb_min, aabb_max;
+        shape->getAabb(trans, aabb_min, aabb_max);
+        if (ticks == 0)
+        {
+            *min = aabb_min;
+            *max = aabb_max;
+        }
+        else
+        {
+            min->setMin(aabb_min);
+            max->setMax(aabb_max);
+        }
+    }
+    m_current_time = saved_time;
+    updateTransform();
+    return true;
+}   // getSweptAabb
 
 // ----------------------------------------------------------------------------
 /** Copying to child process of track object.
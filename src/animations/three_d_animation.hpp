@@ -68,6 +68,8 @@ private:
       */
     bool                  m_important_animation;
 
+    void updateTransform();
+
 public:
                  ThreeDAnimation(const XMLNode &node, TrackObject* object);
     virtual     ~ThreeDAnimation();
@@ -75,6 +77,8 @@ public:
     // ------------------------------------------------------------------------
     void updateWithWorldTicks(bool with_physics);
     // ------------------------------------------------------------------------
+    bool getSweptAabb(Vec3 *min, Vec3 *max);
+    // ------------------------------------------------------------------------
     /** Returns true if a collision with this object should
      * trigger a rescue. */
     bool isCrashReset() const { return m_crash_reset; }
@@ -24,18 +24,26 @@
 
 #include "audio/music_manager.hpp"
 #include "audio/sfx_manager.hpp"
+#include "config/user_config.hpp"
 #include "utils/constants.hpp"
 #include "utils/file_utils.hpp"
 #include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+#include <algorithm>
+#include <chrono>
 
 MusicOggStream::MusicOggStream(float loop_start)
 {
     //m_oggStream= NULL;
-    m_soundBuffers[0] = m_soundBuffers[1]= 0;
     m_soundSource     = -1;
     m_pausedMusic     = true;
     m_playing.store(false);
     m_loop_start      = loop_start;
+    m_ring_read       = 0;
+    m_ring_count      = 0;
+    m_decode_quit     = false;
+    m_decode_failed   = false;
 }   // MusicOggStream
 
 //-----------------------------------------------------------------------------
@@ -48,7 +56,9 @@ MusicOggStream::~MusicOggStream()
 //-----------------------------------------------------------------------------
 bool MusicOggStream::load(const std::string& filename)
 {
-    if (isPlaying()) stopMusic();
+    // Also releases a stream that was loaded but never played, so that its
+    // decoder thread is stopped before a new one is started.
+    stopMusic();
 
     m_error = true;
     m_fileName = filename;
@@ -108,8 +118,16 @@ bool MusicOggStream::load(const std::string& filename)
     if (m_vorbisInfo->channels == 1) nb_channels = AL_FORMAT_MONO16;
     else                             nb_channels = AL_FORMAT_STEREO16;
 
-    alGenBuffers(2, m_soundBuffers);
-    if (check("alGenBuffers") == false) return false;
+    const int buffer_count =
+        std::min(std::max((int)UserConfigParams::m_music_stream_buffers, 2), 16);
+    m_soundBuffers.resize(buffer_count, 0);
+    alGenBuffers(buffer_count, m_soundBuffers.data());
+    if (check("alGenBuffers") == false)
+    {
+        m_soundBuffers.clear();
+        return false;
+    }
+    m_free_buffers = m_soundBuffers;
 
     alGenSources(1, &m_soundSource);
     if (check("alGenSources") == false) return false;
@@ -122,9 +140,121 @@ bool MusicOggStream::load(const std::string& filename)
     alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_TRUE      );
 
     m_error=false;
+    startDecoder();
     return true;
 }   // load
 
+//-----------------------------------------------------------------------------
+/** Starts the background decoder, which immediately begins to fill the PCM
+ *  ring. This way music is ready to be played without any delay once
+ *  playMusic() is called.
+ */
+void MusicOggStream::startDecoder()
+{
+    const unsigned chunks =
+        std::min(std::max((int)UserConfigParams::m_music_read_ahead, 2), 64);
+    m_pcm_chunks.assign(chunks, std::vector<char>(m_buffer_size));
+    m_pcm_sizes.assign(chunks, 0);
+    m_ring_read     = 0;
+    m_ring_count    = 0;
+    m_decode_quit   = false;
+    m_decode_failed = false;
+    m_decode_thread = std::thread(&MusicOggStream::decoderLoop, this);
+}   // startDecoder
+
+//-----------------------------------------------------------------------------
+/** Stops and joins the decoder thread. After this m_oggStream is only
+ *  accessed by the calling thread again.
+ */
+void MusicOggStream::stopDecoder()
+{
+    if (!m_decode_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_decode_mutex);
+        m_decode_quit = true;
+    }
+    m_decode_cv.notify_all();
+    m_decode_thread.join();
+    m_pcm_chunks.clear();
+    m_pcm_sizes.clear();
+    m_ring_read  = 0;
+    m_ring_count = 0;
+}   // stopDecoder
+
+//-----------------------------------------------------------------------------
+/** The decoder thread: decodes chunks of m_buffer_size bytes into the free
+ *  slots of the PCM ring, and waits whenever the ring is full. At the end of
+ *  the file it seeks back to the loop start, so the music loops forever.
+ */
+void MusicOggStream::decoderLoop()
+{
+    VS::setThreadName("MusicDecoder");
+    const int is_big_endian = (IS_LITTLE_ENDIAN ? 0 : 1);
+
+    std::unique_lock<std::mutex> lock(m_decode_mutex);
+    while (true)
+    {
+        m_decode_cv.wait(lock, [this]()
+            {
+                return m_decode_quit || m_ring_count < m_pcm_chunks.size();
+            });
+        if (m_decode_quit)
+            break;
+
+        // The consumer only touches the m_ring_count oldest slots, so the
+        // next free slot can be written without holding the lock.
+        const unsigned slot = (m_ring_read + m_ring_count) %
+                              (unsigned)m_pcm_chunks.size();
+        lock.unlock();
+
+        char* pcm = m_pcm_chunks[slot].data();
+        int size = 0;
+        int portion;
+        bool failed = false;
+        bool seeked = false;
+        while (size < m_buffer_size)
+        {
+            int result = ov_read(&m_oggStream, pcm + size,
+                                 m_buffer_size - size, is_big_endian, 2, 1,
+                                 &portion);
+            if (result > 0)
+            {
+                size += result;
+                seeked = false;
+            }
+            else if (result < 0)
+            {
+                Log::error("MusicOgg", "Decoding music %s failed: %s",
+                           m_fileName.c_str(), errorString(result).c_str());
+                failed = true;
+                break;
+            }
+            else
+            {
+                // No more data. Seek to loop start (causes the sound to
+                // loop), but don't spin if the stream contains no data.
+                if (seeked)
+                    break;
+                ov_time_seek(&m_oggStream, m_loop_start);
+                seeked = true;
+            }
+        }
+
+        lock.lock();
+        if (size > 0)
+        {
+            m_pcm_sizes[slot] = size;
+            m_ring_count++;
+        }
+        if (failed || size == 0)
+            m_decode_failed = true;
+        m_decode_cv.notify_all();
+        if (m_decode_failed)
+            break;
+    }
+}   // decoderLoop
+
 //-----------------------------------------------------------------------------
 bool MusicOggStream::empty()
 {
@@ -152,13 +282,19 @@ bool MusicOggStream::release()
     }
 
     pauseMusic();
+    stopDecoder();
     m_fileName= "";
 
     empty();
     alDeleteSources(1, &m_soundSource);
     check("alDeleteSources");
-    alDeleteBuffers(2, m_soundBuffers);
-    check("alDeleteBuffers");
+    if (!m_soundBuffers.empty())
+    {
+        alDeleteBuffers((ALsizei)m_soundBuffers.size(), m_soundBuffers.data());
+        check("alDeleteBuffers");
+    }
+    m_soundBuffers.clear();
+    m_free_buffers.clear();
 
     // Handle error correctly
     if(!m_error) ov_clear(&m_oggStream);
@@ -175,13 +311,32 @@ bool MusicOggStream::playMusic()
     if(isPlaying())
         return true;
 
-    if(!streamIntoBuffer(m_soundBuffers[0]))
+    if (m_error || m_soundBuffers.empty())
         return false;
 
-    if(!streamIntoBuffer(m_soundBuffers[1]))
-        return false;
+    {
+        // Normally the decoder has filled the ring long before this is
+        // called, but if the music was just loaded wait for the first chunk
+        std::unique_lock<std::mutex> lock(m_decode_mutex);
+        m_decode_cv.wait_for(lock, std::chrono::seconds(1), [this]()
+            {
+                return m_ring_count > 0 || m_decode_failed;
+            });
+    }
 
-    alSourceQueueBuffers(m_soundSource, 2, m_soundBuffers);
+    int processed = 0;
+    alGetSourcei(m_soundSource, AL_BUFFERS_PROCESSED, &processed);
+    while (processed-- > 0)
+    {
+        ALuint buffer = 0;
+        alSourceUnqueueBuffers(m_soundSource, 1, &buffer);
+        if (!check("alSourceUnqueueBuffers")) return false;
+        m_free_buffers.push_back(buffer);
+    }
+
+    queueFreeBuffers();
+    if (m_free_buffers.size() == m_soundBuffers.size())
+        return false;
 
     alSourcePlay(m_soundSource);
     m_pausedMusic = false;
@@ -272,7 +427,6 @@ void MusicOggStream::update()
     }
 
     int processed= 0;
-    bool active= true;
 
     alGetSourcei(m_soundSource, AL_BUFFERS_PROCESSED, &processed);
 
@@ -282,19 +436,14 @@ void MusicOggStream::update()
 
         alSourceUnqueueBuffers(m_soundSource, 1, &buffer);
         if(!check("alSourceUnqueueBuffers")) return;
-
-        active = streamIntoBuffer(buffer);
-        if(!active)
-        {
-            // no more data. Seek to loop start (causes the sound to loop)
-            ov_time_seek(&m_oggStream, m_loop_start);
-            active = streamIntoBuffer(buffer);//now there really should be data
-        }
-
-        alSourceQueueBuffers(m_soundSource, 1, &buffer);
-        if (!check("alSourceQueueBuffers")) return;
+        m_free_buffers.push_back(buffer);
     }
 
+    // Refill with already decoded data only, decoding itself happens in
+    // the decoder thread.
+    queueFreeBuffers();
+    const bool active = m_free_buffers.size() < m_soundBuffers.size();
+
     if (active)
     {
         // For debugging
@@ -316,39 +465,58 @@ void MusicOggStream::update()
     }
     else
     {
-        Log::warn("MusicOgg", "Attempt to stream music into buffer failed "
-                              "twice in a row.");
+        // Prevent flooding
+        static int count = 0;
+        count++;
+        if (count < 10)
+            Log::warn("MusicOgg", "Music decoder could not keep up, no data "
+                                  "to stream into buffers.");
     }
 }   // update
 
 //-----------------------------------------------------------------------------
-bool MusicOggStream::streamIntoBuffer(ALuint buffer)
+/** Fills all currently unqueued buffers with decoded data (as far as data
+ *  is available) and queues them on the source.
+ */
+void MusicOggStream::queueFreeBuffers()
 {
-    char pcm[m_buffer_size];
-    const int isBigEndian = (IS_LITTLE_ENDIAN ? 0 : 1);
-
-    int  size = 0;
-    int  portion;
-
-    while(size < m_buffer_size)
+    while (!m_free_buffers.empty())
     {
-        int result = ov_read(&m_oggStream, pcm + size, m_buffer_size - size,
-                         isBigEndian, 2, 1, &portion);
-
-        if(result > 0)
-            size += result;
-        else
-            if(result < 0)
-                throw errorString(result);
-            else
-                break;
+        ALuint buffer = m_free_buffers.back();
+        if (!streamIntoBuffer(buffer))
+            break;
+        m_free_buffers.pop_back();
+        alSourceQueueBuffers(m_soundSource, 1, &buffer);
+        if (!check("alSourceQueueBuffers")) return;
     }
+}   // queueFreeBuffers
 
-    if(size == 0) return false;
+//-----------------------------------------------------------------------------
+/** Copies the oldest decoded chunk into the given OpenAL buffer. This never
+ *  decodes, so it returns false if the decoder has no data ready.
+ */
+bool MusicOggStream::streamIntoBuffer(ALuint buffer)
+{
+    unsigned slot;
+    {
+        std::lock_guard<std::mutex> lock(m_decode_mutex);
+        if (m_ring_count == 0) return false;
+        slot = m_ring_read;
+    }
 
-    alBufferData(buffer, nb_channels, pcm, size, m_vorbisInfo->rate);
+    // The decoder never writes into a slot that is still in use, so the
+    // data can be uploaded without holding the lock.
+    alBufferData(buffer, nb_channels, m_pcm_chunks[slot].data(),
+                 m_pcm_sizes[slot], m_vorbisInfo->rate);
     check("alBufferData");
 
+    {
+        std::lock_guard<std::mutex> lock(m_decode_mutex);
+        m_ring_read = (m_ring_read + 1) % (unsigned)m_pcm_chunks.size();
+        m_ring_count--;
+    }
+    m_decode_cv.notify_all();
+
     return true;
 }   // streamIntoBuffer
 
@@ -42,9 +42,18 @@
 #include "audio/music.hpp"
 
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 /**
   * \brief ogg files based implementation of the Music interface
+  *  Decoding is done by a dedicated thread which keeps a ring of decoded
+  *  PCM chunks ahead of playback, so update() only has to hand already
+  *  decoded data to OpenAL. Decoding starts as soon as a file is loaded,
+  *  which means a track that is loaded but not yet played (e.g. the fast
+  *  music used for the last lap) can start without any decoding delay.
   * \ingroup audio
   */
 class MusicOggStream : public Music
@@ -73,6 +82,10 @@ protected:
 private:
     bool release();
     bool streamIntoBuffer(ALuint buffer);
+    void queueFreeBuffers();
+    void startDecoder();
+    void stopDecoder();
+    void decoderLoop();
 
     float           m_loop_start;
     std::string     m_fileName;
@@ -83,13 +96,37 @@ private:
 
     std::atomic_bool m_playing;
 
-    ALuint m_soundBuffers[2];
+    /** All OpenAL buffers used by this stream. */
+    std::vector<ALuint> m_soundBuffers;
+    /** Buffers which are currently not queued on the source, because no
+     *  decoded data was available when they were processed. */
+    std::vector<ALuint> m_free_buffers;
     ALuint m_soundSource;
     ALenum nb_channels;
 
     bool m_pausedMusic;
 
-    //one full second of audio at 44100 samples per second
+    /** The background decoder thread. */
+    std::thread m_decode_thread;
+    /** Protects the PCM ring and the decoder state below. */
+    std::mutex m_decode_mutex;
+    /** Signals the decoder that a chunk was consumed (or it should quit),
+     *  and the consumer that a new chunk was decoded. */
+    std::condition_variable m_decode_cv;
+    /** Ring of decoded PCM chunks. */
+    std::vector<std::vector<char> > m_pcm_chunks;
+    /** Number of valid bytes in each chunk. */
+    std::vector<int> m_pcm_sizes;
+    /** Index of the oldest decoded chunk in the ring. */
+    unsigned m_ring_read;
+    /** Number of decoded chunks in the ring. */
+    unsigned m_ring_count;
+    /** Set to ask the decoder thread to exit. */
+    bool m_decode_quit;
+    /** Set by the decoder if decoding failed and it has stopped. */
+    bool m_decode_failed;
+
+    //a quarter second of 16 bit stereo audio at 44100 samples per second
     static const int m_buffer_size = 11025*4;
 };
 
@@ -85,6 +85,24 @@ public:
     virtual const SFXBuffer* getBuffer() const              = 0;
     virtual SFXStatus  getStatus()                          = 0;
 
+    // ------------------------------------------------------------------------
+    /** Returns if this sfx currently owns one of the voices (sound sources)
+     *  of the sfx manager. A playing sfx without a voice is virtual: it
+     *  keeps its state, but is not heard. */
+    virtual bool       hasVoice() const { return false; }
+    // ------------------------------------------------------------------------
+    /** Returns an estimate of the gain of this sfx at the given listener
+     *  position, 0 if it can not be heard. */
+    virtual float      getAudibility(const Vec3 &listener) const { return 0; }
+    // ------------------------------------------------------------------------
+    /** Tries to get a voice from the sfx manager, and if this sfx is
+     *  playing, starts it at its current play position. */
+    virtual bool       acquireVoice() { return false; }
+    // ------------------------------------------------------------------------
+    /** Stops this sfx on its voice and returns the voice to the sfx
+     *  manager. The sfx itself keeps its state (e.g. keeps playing). */
+    virtual void       releaseVoice() {}
+
 };   // SFXBase
 
 
@@ -76,6 +76,10 @@ private:
     /** Duration of the sfx. */
     float    m_duration;
 
+    /** Priority when the sfx manager has to decide which sfx get one of
+     *  the limited number of voices. Higher values win. */
+    int      m_priority;
+
     bool loadVorbisBuffer(const std::string &name, ALuint buffer);
 
 public:
@@ -123,6 +127,12 @@ public:
     // ------------------------------------------------------------------------
     /** Returns how long this buffer will play. */
     float getDuration() const { return m_duration; }
+    // ------------------------------------------------------------------------
+    /** Returns the voice priority of this sfx. */
+    int   getPriority() const { return m_priority; }
+    // ------------------------------------------------------------------------
+    /** Sets the voice priority of this sfx. */
+    void  setPriority(int priority) { m_priority = priority; }
 
 };   // class SFXBuffer
 
@@ -87,6 +87,14 @@ SFXManager::SFXManager()
     m_listener_front              = Vec3(0, 0, 1);
     m_listener_up                 = Vec3(0, 1, 0);
 
+    m_command_ring = new CommandSlot[COMMAND_RING_SIZE];
+    for (size_t i = 0; i < COMMAND_RING_SIZE; i++)
+        m_command_ring[i].m_sequence.store(i, std::memory_order_relaxed);
+    m_command_write.store(0);
+    m_command_read.store(0);
+    m_voices_created    = false;
+    m_last_voice_update = 0;
+
     loadSfx();
 
 #ifdef ENABLE_SOUND
@@ -96,9 +104,6 @@ SFXManager::SFXManager()
         // (since the user might enable it later).
         m_thread = std::thread(std::bind(mainLoop, this));
         setMasterSFXVolume( UserConfigParams::m_sfx_volume );
-        m_sfx_commands.lock();
-        m_sfx_commands.getData().clear();
-        m_sfx_commands.unlock();
     }
 #endif
 }  // SoundManager
@@ -152,6 +157,18 @@ SFXManager::~SFXManager()
     }
     m_all_sfx_types.clear();
 
+#ifdef ENABLE_SOUND
+    // All sfx have returned their voices at this stage
+    if (!m_all_voices.empty())
+    {
+        alDeleteSources((ALsizei)m_all_voices.size(), m_all_voices.data());
+        checkError("deleting voices");
+    }
+#endif
+    m_all_voices.clear();
+    m_free_voices.clear();
+
+    delete [] m_command_ring;
 }   // ~SFXManager
 
 //----------------------------------------------------------------------------
@@ -167,8 +184,7 @@ void SFXManager::queue(SFXCommands command,  SFXBase *sfx)
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, sfx);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx));
 #endif
 }   // queue
 
@@ -186,8 +202,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, float f)
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, sfx, f);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx, f));
 #endif
 }   // queue(float)
 
@@ -205,8 +220,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, const Vec3 &p)
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, sfx, p);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx, p));
 #endif
 }   // queue (Vec3)
 
@@ -218,8 +232,8 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, const Vec3 &p, SFXBuff
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, sfx, p);
-    sfx_command->m_buffer = buffer;
+    SFXCommand sfx_command(command, sfx, p);
+    sfx_command.m_buffer = buffer;
     queueCommand(sfx_command);
 #endif
 }   // queue (Vec3)
@@ -240,8 +254,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, float f,
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, sfx, f, p);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx, f, p));
 #endif
 }   // queue(float, Vec3)
 
@@ -255,8 +268,7 @@ void SFXManager::queue(SFXCommands command, MusicInformation *mi)
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, mi);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, mi));
 #endif
 }   // queue(MusicInformation)
 //----------------------------------------------------------------------------
@@ -271,48 +283,128 @@ void SFXManager::queue(SFXCommands command, MusicInformation *mi, float f)
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
 
-    SFXCommand *sfx_command = new SFXCommand(command, mi, f);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, mi, f));
 #endif
 }   // queue(MusicInformation)
 
 //----------------------------------------------------------------------------
 /** Enqueues a command to the sfx queue threadsafe. Then signal the
  *  sfx manager to wake up.
- *  \param command Pointer to the command to queue up.
+ *  \param command The command to queue up.
  */
-void SFXManager::queueCommand(SFXCommand *command)
+void SFXManager::queueCommand(const SFXCommand &command)
 {
 #ifdef ENABLE_SOUND
     if (!UserConfigParams::m_enable_sound || STKProcess::getType() != PT_MAIN)
         return;
-        
-    m_sfx_commands.lock();
-    if(World::getWorld() && 
-        m_sfx_commands.getData().size() > 20*RaceManager::get()->getNumberOfKarts()+20 &&
+
+    // The size is only approximate, since other threads can modify the
+    // queue concurrently, which is good enough for throttling
+    const size_t size = m_command_write.load(std::memory_order_relaxed) -
+                        m_command_read.load(std::memory_order_relaxed);
+    const bool can_be_throttled =
+        command.m_command==SFX_POSITION || command.m_command==SFX_LOOP ||
+        command.m_command==SFX_SPEED    ||
+        command.m_command==SFX_SPEED_POSITION;
+    if(World::getWorld() && can_be_throttled &&
+        size > 20*RaceManager::get()->getNumberOfKarts()+20 &&
         RaceManager::get()->getMinorMode() != RaceManager::MINOR_MODE_CUTSCENE)
     {
-        if(command->m_command==SFX_POSITION || command->m_command==SFX_LOOP ||
-           command->m_command==SFX_SPEED    || 
-           command->m_command==SFX_SPEED_POSITION                               )
+        static int count_messages = 0;
+        if(count_messages < 5)
+        {
+            Log::warn("SFXManager", "Throttling sfx - queue size %d",
+                      (int)size);
+            count_messages++;
+        }
+        return;
+    }   // if throttling
+
+    while (!pushCommand(command))
+    {
+        // The ring is full. Commands that only update a sfx can be dropped,
+        // and the sfx thread itself must never wait for itself.
+        if (can_be_throttled || command.m_command == SFX_UPDATE ||
+            std::this_thread::get_id() == m_thread.get_id())
         {
-            delete command;
-            static int count_messages = 0;
-            if(count_messages < 5)
+            static int count_full_messages = 0;
+            if (count_full_messages < 5)
             {
-                Log::warn("SFXManager", "Throttling sfx - queue size %d",
-                         m_sfx_commands.getData().size());
-                count_messages++;
+                Log::warn("SFXManager", "Command queue full, dropping "
+                          "command %d", command.m_command);
+                count_full_messages++;
             }
-            m_sfx_commands.unlock();
             return;
-        }   // if throttling
+        }
+        m_condition_variable.notify_one();
+        std::this_thread::yield();
     }
-    m_sfx_commands.getData().push_back(command);
-    m_sfx_commands.unlock();
 #endif
 }   // queueCommand
 
+//----------------------------------------------------------------------------
+/** Adds a command to the command ring without locking. This can be called
+ *  from any thread.
+ *  \param command The command to add.
+ *  \return False if the ring is full.
+ */
+bool SFXManager::pushCommand(const SFXCommand &command)
+{
+    size_t pos = m_command_write.load(std::memory_order_relaxed);
+    CommandSlot *slot;
+    while (true)
+    {
+        slot = &m_command_ring[pos & (COMMAND_RING_SIZE - 1)];
+        const size_t seq = slot->m_sequence.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (m_command_write.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_command_write.load(std::memory_order_relaxed);
+        }
+    }
+    slot->m_command = command;
+    slot->m_sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}   // pushCommand
+
+//----------------------------------------------------------------------------
+/** Removes the oldest command from the command ring. Must only be called
+ *  from the sfx thread.
+ *  \param command On return contains the command.
+ *  \return False if there was no command.
+ */
+bool SFXManager::popCommand(SFXCommand *command)
+{
+    const size_t pos = m_command_read.load(std::memory_order_relaxed);
+    CommandSlot &slot = m_command_ring[pos & (COMMAND_RING_SIZE - 1)];
+    if (slot.m_sequence.load(std::memory_order_acquire) != pos + 1)
+        return false;
+    *command = slot.m_command;
+    slot.m_sequence.store(pos + COMMAND_RING_SIZE, std::memory_order_release);
+    m_command_read.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}   // popCommand
+
+//----------------------------------------------------------------------------
+/** Returns if there is a command ready to be executed by the sfx thread.
+ */
+bool SFXManager::hasCommands() const
+{
+    const size_t pos = m_command_read.load(std::memory_order_relaxed);
+    const CommandSlot &slot = m_command_ring[pos & (COMMAND_RING_SIZE - 1)];
+    return slot.m_sequence.load(std::memory_order_acquire) == pos + 1;
+}   // hasCommands
+
 //----------------------------------------------------------------------------
 /** Puts a NULL request into the queue, which will trigger the thread to
  *  exit.
@@ -323,7 +415,9 @@ void SFXManager::stopThread()
     if (UserConfigParams::m_enable_sound)
     {
         queue(SFX_EXIT);
-        // Make sure the thread wakes up.
+        // Make sure the thread wakes up. Taking the lock avoids a lost
+        // wakeup if the thread is just about to wait.
+        { std::lock_guard<std::mutex> lock(m_wait_mutex); }
         m_condition_variable.notify_one();
     }
     else
@@ -348,101 +442,86 @@ void SFXManager::mainLoop(void *obj)
     VS::setThreadName("SFXManager");
     SFXManager *me = (SFXManager*)obj;
 
-    std::unique_lock<std::mutex> ul = me->m_sfx_commands.acquireMutex();
-
-    // Wait till we have an empty sfx in the queue
-    while (me->m_sfx_commands.getData().empty() ||
-           me->m_sfx_commands.getData().front()->m_command!=SFX_EXIT)
+    SFXCommand current;
+    while (true)
     {
         PROFILER_PUSH_CPU_MARKER("Wait", 255, 0, 0);
-        bool empty = me->m_sfx_commands.getData().empty();
-
-        // Wait in cond_wait for a request to arrive. The 'while' is necessary
-        // since "spurious wakeups from the pthread_cond_wait ... may occur"
-        // (pthread_cond_wait man page)!
-        while (empty)
+        // Wait for a request to arrive. The emptiness is tested while
+        // holding the wait mutex, so a notify can not get lost.
+        while (!me->popCommand(&current))
         {
-            me->m_condition_variable.wait(ul);
-            empty = me->m_sfx_commands.getData().empty();
+            std::unique_lock<std::mutex> ul(me->m_wait_mutex);
+            me->m_condition_variable.wait(ul,
+                                          [me]() { return me->hasCommands(); });
         }
-        SFXCommand *current = me->m_sfx_commands.getData().front();
-        me->m_sfx_commands.getData().erase(me->m_sfx_commands.getData().begin());
 
-        if (current->m_command == SFX_EXIT)
-        {
-            delete current;
+        if (current.m_command == SFX_EXIT)
             break;
-        }
-        ul.unlock();
         PROFILER_POP_CPU_MARKER();
         PROFILER_PUSH_CPU_MARKER("Execute", 0, 255, 0);
-        switch (current->m_command)
+        switch (current.m_command)
         {
-        case SFX_PLAY:     current->m_sfx->reallyPlayNow();       break;
+        case SFX_PLAY:     current.m_sfx->reallyPlayNow();        break;
         case SFX_PLAY_POSITION:
-            current->m_sfx->reallyPlayNow(current->m_parameter, current->m_buffer);  break;
-        case SFX_STOP:     current->m_sfx->reallyStopNow();       break;
-        case SFX_PAUSE:    current->m_sfx->reallyPauseNow();      break;
-        case SFX_RESUME:   current->m_sfx->reallyResumeNow();     break;
-        case SFX_SPEED:    current->m_sfx->reallySetSpeed(
-                                  current->m_parameter.getX());   break;
-        case SFX_POSITION: current->m_sfx->reallySetPosition(
-                                         current->m_parameter);   break;
-        case SFX_SPEED_POSITION: current->m_sfx->reallySetSpeedPosition(
+            current.m_sfx->reallyPlayNow(current.m_parameter, current.m_buffer);  break;
+        case SFX_STOP:     current.m_sfx->reallyStopNow();        break;
+        case SFX_PAUSE:    current.m_sfx->reallyPauseNow();       break;
+        case SFX_RESUME:   current.m_sfx->reallyResumeNow();      break;
+        case SFX_SPEED:    current.m_sfx->reallySetSpeed(
+                                  current.m_parameter.getX());    break;
+        case SFX_POSITION: current.m_sfx->reallySetPosition(
+                                         current.m_parameter);    break;
+        case SFX_SPEED_POSITION: current.m_sfx->reallySetSpeedPosition(
                                          // Extract float from W component
-                                         current->m_parameter.getW(),
-                                         current->m_parameter);   break;
-        case SFX_VOLUME:   current->m_sfx->reallySetVolume(
-                                  current->m_parameter.getX());   break;
+                                         current.m_parameter.getW(),
+                                         current.m_parameter);    break;
+        case SFX_VOLUME:   current.m_sfx->reallySetVolume(
+                                  current.m_parameter.getX());    break;
         case SFX_MASTER_VOLUME:
-            current->m_sfx->reallySetMasterVolumeNow(
-                                  current->m_parameter.getX());   break;
-        case SFX_LOOP:     current->m_sfx->reallySetLoop(
-                             current->m_parameter.getX() != 0);   break;
-        case SFX_DELETE:     me->deleteSFX(current->m_sfx);       break;
+            current.m_sfx->reallySetMasterVolumeNow(
+                                  current.m_parameter.getX());    break;
+        case SFX_LOOP:     current.m_sfx->reallySetLoop(
+                             current.m_parameter.getX() != 0);    break;
+        case SFX_DELETE:     me->deleteSFX(current.m_sfx);        break;
         case SFX_PAUSE_ALL:  me->reallyPauseAllNow();             break;
         case SFX_RESUME_ALL: me->reallyResumeAllNow();            break;
         case SFX_LISTENER:   me->reallyPositionListenerNow();     break;
-        case SFX_UPDATE:     me->reallyUpdateNow(current);        break;
+        case SFX_UPDATE:     me->reallyUpdateNow(&current);       break;
         case SFX_MUSIC_START:
         {
-            current->m_music_information->setDefaultVolume();
-            current->m_music_information->startMusic();           break;
+            current.m_music_information->setDefaultVolume();
+            current.m_music_information->startMusic();            break;
         }
         case SFX_MUSIC_STOP:
-            current->m_music_information->stopMusic();            break;
+            current.m_music_information->stopMusic();             break;
         case SFX_MUSIC_PAUSE:
-            current->m_music_information->pauseMusic();           break;
+            current.m_music_information->pauseMusic();            break;
         case SFX_MUSIC_RESUME:
-            current->m_music_information->resumeMusic();
+            current.m_music_information->resumeMusic();
             // This might be necessasary if the volume was changed
             // in the in-game menu
-            current->m_music_information->setDefaultVolume();     break;
+            current.m_music_information->setDefaultVolume();      break;
         case SFX_MUSIC_SWITCH_FAST:
-            current->m_music_information->switchToFastMusic();    break;
+            current.m_music_information->switchToFastMusic();     break;
         case SFX_MUSIC_SET_TMP_VOLUME:
         {
-            MusicInformation *mi = current->m_music_information;
-            mi->setTemporaryVolume(current->m_parameter.getX());  break;
+            MusicInformation *mi = current.m_music_information;
+            mi->setTemporaryVolume(current.m_parameter.getX());   break;
         }
         case SFX_MUSIC_WAITING:
-               current->m_music_information->setMusicWaiting();   break;
+               current.m_music_information->setMusicWaiting();    break;
         case SFX_MUSIC_DEFAULT_VOLUME:
         {
-            current->m_music_information->setDefaultVolume();
+            current.m_music_information->setDefaultVolume();
             break;
         }
         case SFX_CREATE_SOURCE:
-            current->m_sfx->init(); break;
+            current.m_sfx->init(); break;
         default: assert("Not yet supported.");
         }
-        delete current;
-        current = NULL;
         PROFILER_POP_CPU_MARKER();
         PROFILER_PUSH_CPU_MARKER("yield", 0, 0, 255);
-        // We access the size without lock, doesn't matter if we
-        // should get an incorrect value because of concurrent read/writes
-        if (me->m_sfx_commands.getData().size() == 0 && me->sfxAllowed())
+        if (!me->hasCommands() && me->sfxAllowed())
         {
             // Wait some time to let other threads run, then queue an
             // update event to keep music playing.
@@ -451,7 +530,6 @@ void SFXManager::mainLoop(void *obj)
             t = StkTime::getMonoTimeMs() - t;
             me->queue(SFX_UPDATE, (SFXBase*)NULL, float(t / 1000.0));
         }
-        ul = me->m_sfx_commands.acquireMutex();
         PROFILER_POP_CPU_MARKER();
     }   // while
 
@@ -459,13 +537,6 @@ void SFXManager::mainLoop(void *obj)
     // We signal this even before cleaning up memory, since there is no
     // need to keep the user waiting for STK to exit.
     me->setCanBeDeleted();
-
-    // Clean up memory to avoid leak detection
-    while(!me->m_sfx_commands.getData().empty())
-    {
-        delete me->m_sfx_commands.getData().front();
-        me->m_sfx_commands.getData().erase(me->m_sfx_commands.getData().begin());
-    }
 #endif
     return;
 }   // mainLoop
@@ -788,7 +859,9 @@ void SFXManager::update()
         return;
 
     queue(SFX_UPDATE, (SFXBase*)NULL);
-    // Wake up the sfx thread to handle all queued up audio commands.
+    // Wake up the sfx thread to handle all queued up audio commands. Taking
+    // the lock avoids a lost wakeup if the thread is just about to wait.
+    { std::lock_guard<std::mutex> lock(m_wait_mutex); }
     m_condition_variable.notify_one();
 #endif
 }   // update
@@ -836,9 +909,151 @@ void SFXManager::reallyUpdateNow(SFXCommand *current)
             i->second->updatePlayingSFX(dt);
     }   // for i in m_all_sfx
     m_quick_sounds.unlock();
+
+    // Reassigning voices is not necessary every update (which can happen
+    // every millisecond), sfx that just started get a free voice directly
+    if (m_last_update_time - m_last_voice_update >= 50)
+    {
+        m_last_voice_update = m_last_update_time;
+        updateVoices();
+    }
 #endif
 }   // reallyUpdateNow
 
+//----------------------------------------------------------------------------
+/** Creates the voice pool. The number of voices is limited by the user
+ *  config, and by the number of sources the OpenAL implementation supports.
+ *  Must be called with m_voices_mutex locked.
+ */
+void SFXManager::createVoices()
+{
+#ifdef ENABLE_SOUND
+    m_voices_created = true;
+    const int requested =
+        std::min(std::max((int)UserConfigParams::m_sfx_max_voices, 8), 128);
+    for (int i = 0; i < requested; i++)
+    {
+        ALuint voice = 0;
+        alGenSources(1, &voice);
+        if (alGetError() != AL_NO_ERROR || voice == 0)
+            break;
+        m_all_voices.push_back(voice);
+    }
+    m_free_voices = m_all_voices;
+    if ((int)m_all_voices.size() < requested)
+    {
+        Log::warn("SFXManager", "Only %d of %d requested sfx voices could "
+                  "be created.", (int)m_all_voices.size(), requested);
+    }
+#endif
+}   // createVoices
+
+//----------------------------------------------------------------------------
+/** Takes a voice (OpenAL source) from the voice pool.
+ *  \return The voice, or 0 if no voice is available.
+ */
+ALuint SFXManager::allocateVoice()
+{
+    std::lock_guard<std::mutex> lock(m_voices_mutex);
+    if (!m_voices_created)
+        createVoices();
+    if (m_free_voices.empty())
+        return 0;
+    ALuint voice = m_free_voices.back();
+    m_free_voices.pop_back();
+    return voice;
+}   // allocateVoice
+
+//----------------------------------------------------------------------------
+/** Returns a voice to the voice pool.
+ *  \param voice The voice to return.
+ */
+void SFXManager::freeVoice(ALuint voice)
+{
+    std::lock_guard<std::mutex> lock(m_voices_mutex);
+    m_free_voices.push_back(voice);
+}   // freeVoice
+
+//----------------------------------------------------------------------------
+/** Decides which of the playing sfx get one of the limited number of voices.
+ *  Sfx which can not be heard (e.g. too far away) never get a voice. The
+ *  remaining sfx are sorted by priority (from sfx.xml) and then by how loud
+ *  they are at the listener position, and only the first sfx get a voice.
+ *  All other sfx become virtual: they keep playing (so a looped sfx
+ *  continues at the right position once it gets a voice back), but do not
+ *  use any OpenAL resources. Paused sfx keep their voice unless it is
+ *  needed for a playing sfx. This is executed by the sfx thread.
+ */
+void SFXManager::updateVoices()
+{
+#ifdef ENABLE_SOUND
+    const Vec3 listener = getListenerPos();
+
+    // Sfx are only deleted by the sfx thread (which executes this function),
+    // so the pointers stay valid after the lists are unlocked.
+    std::vector<std::pair<float, SFXBase*> > candidates;
+    std::vector<SFXBase*> paused;
+    auto add = [&](SFXBase *sfx)
+    {
+        SFXBase::SFXStatus status = sfx->getStatus();
+        if (status == SFXBase::SFX_PLAYING)
+        {
+            const float audibility = sfx->getAudibility(listener);
+            if (audibility > 0)
+                candidates.emplace_back(audibility, sfx);
+            else
+                sfx->releaseVoice();
+        }
+        else if (status == SFXBase::SFX_PAUSED && sfx->hasVoice())
+            paused.push_back(sfx);
+    };
+    m_all_sfx.lock();
+    for (SFXBase *sfx : m_all_sfx.getData())
+        add(sfx);
+    m_all_sfx.unlock();
+    m_quick_sounds.lock();
+    for (auto &quick : m_quick_sounds.getData())
+        add(quick.second);
+    m_quick_sounds.unlock();
+
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<float, SFXBase*> &a,
+           const std::pair<float, SFXBase*> &b)
+        {
+            const int pa = a.second->getBuffer()->getPriority();
+            const int pb = b.second->getBuffer()->getPriority();
+            if (pa != pb)
+                return pa > pb;
+            return a.first > b.first;
+        });
+
+    size_t num_voices;
+    {
+        std::lock_guard<std::mutex> lock(m_voices_mutex);
+        if (!m_voices_created)
+            createVoices();
+        num_voices = m_all_voices.size();
+    }
+
+    // First free the voices of the less important sfx, then give voices
+    // to the most important ones.
+    for (size_t i = num_voices; i < candidates.size(); i++)
+        candidates[i].second->releaseVoice();
+    const size_t n = std::min(num_voices, candidates.size());
+    for (size_t i = 0; i < n; i++)
+    {
+        SFXBase *sfx = candidates[i].second;
+        if (sfx->hasVoice() || sfx->acquireVoice())
+            continue;
+        if (paused.empty())
+            break;
+        paused.back()->releaseVoice();
+        paused.pop_back();
+        sfx->acquireVoice();
+    }
+#endif
+}   // updateVoices
+
 //----------------------------------------------------------------------------
 /** Delete a sound effect object, and removes it from the internal list of
  *  all SFXs. This call deletes the object, and removes it from the list of
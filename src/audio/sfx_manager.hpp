@@ -25,8 +25,10 @@
 #include "utils/synchronised.hpp"
 #include "utils/vec3.hpp"
 
+#include <atomic>
 #include <condition_variable>
 #include <map>
+#include <mutex>
 #include <string>
 #include <thread>
 
@@ -119,27 +121,28 @@ public:
 private:
 
     /** Data structure for the queue, which stores a sfx and the command to 
-     *  execute for it. */
-    class SFXCommand : public NoCopy
+     *  execute for it. Commands are copied into the preallocated slots of
+     *  the command ring, so no memory is allocated when queueing them. */
+    class SFXCommand
     {
-    private:
-        LEAK_CHECK()
     public:
         /** The sound effect for which the command should be executed. */
-        SFXBase *m_sfx;
+        SFXBase *m_sfx = NULL;
 
         /** The sound buffer to play (null = no change) */
         SFXBuffer *m_buffer = NULL;
 
         /** Stores music information for music commands. */
-        MusicInformation *m_music_information;
+        MusicInformation *m_music_information = NULL;
 
         /** The command to execute. */
-        SFXCommands m_command;
+        SFXCommands m_command = SFX_UPDATE;
         /** Optional parameter for commands that need more input. Single
          *  floating point values are stored in the X component. */
         Vec3        m_parameter;
         // --------------------------------------------------------------------
+        SFXCommand() {}
+        // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base)
         {
             m_command   = command;
@@ -189,6 +192,19 @@ private:
         }   // SFXCommand(Vec3)
     };   // SFXCommand
     // ========================================================================
+    /** One slot of the command ring. The sequence number implements a
+     *  bounded multi-producer queue without locks: a producer may write
+     *  into a slot when its sequence equals the write position, and the
+     *  consumer may read it when it equals the write position + 1. */
+    struct CommandSlot
+    {
+        std::atomic<size_t> m_sequence;
+        SFXCommand          m_command;
+    };   // CommandSlot
+
+    /** Size of the command ring, must be a power of 2. */
+    static const size_t COMMAND_RING_SIZE = 4096;
+    // ========================================================================
 
     /** The position of the listener. Its lock will be used to
      *  access m_listener_{position,front, up}. */
@@ -208,8 +224,32 @@ private:
     /** The actual instances (sound sources) */
     Synchronised<std::vector<SFXBase*> > m_all_sfx;
 
-    /** The list of sound effects to be played in the next update. */
-    Synchronised< std::vector<SFXCommand*> > m_sfx_commands;
+    /** The ring of commands to be executed in the next update. */
+    CommandSlot              *m_command_ring;
+
+    /** Next position to be written by a producer. */
+    std::atomic<size_t>       m_command_write;
+
+    /** Next position to be read by the sfx thread. */
+    std::atomic<size_t>       m_command_read;
+
+    /** Only used to let the sfx thread sleep while there are no commands. */
+    std::mutex                m_wait_mutex;
+
+    /** All voices (OpenAL sources) available for sound effects. */
+    std::vector<ALuint>       m_all_voices;
+
+    /** The voices that are currently not used by any sfx. */
+    std::vector<ALuint>       m_free_voices;
+
+    /** Protects the voice pool. */
+    std::mutex                m_voices_mutex;
+
+    /** If the voice pool was created. */
+    bool                      m_voices_created;
+
+    /** Time of the last voice assignment. */
+    uint64_t                  m_last_voice_update;
 
     /** To play non-positional sounds without having to create a
      *  new object for each. */
@@ -235,8 +275,13 @@ private:
 
     static void mainLoop(void *obj);
     void deleteSFX(SFXBase *sfx);
-    void queueCommand(SFXCommand *command);
+    void queueCommand(const SFXCommand &command);
+    bool pushCommand(const SFXCommand &command);
+    bool popCommand(SFXCommand *command);
+    bool hasCommands() const;
     void reallyPositionListenerNow();
+    void createVoices();
+    void updateVoices();
 
 public:
     static void create();
@@ -283,6 +328,8 @@ public:
     void                     reallyResumeAllNow();
     void                     update();
     void                     reallyUpdateNow(SFXCommand *current);
+    ALuint                   allocateVoice();
+    void                     freeVoice(ALuint voice);
     bool                     soundExist(const std::string &name);
     void                     setMasterSFXVolume(float gain);
     float                    getMasterSFXVolume() const { return m_master_gain; }
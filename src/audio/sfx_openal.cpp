@@ -46,6 +46,9 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
     m_master_gain  = 1.0f;
     m_owns_buffer  = owns_buffer;
     m_play_time    = 0.0f;
+    m_position     = Vec3(0, 0, 0);
+    m_speed        = 1.0f;
+    m_rolloff      = buffer->getRolloff();
 
     // Don't initialise anything else if the sfx manager was not correctly
     // initialised. First of all the initialisation will not work, and it
@@ -57,15 +60,11 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
 }   // SFXOpenAL
 
 //-----------------------------------------------------------------------------
-/** Deletes the sfx source, and if it owns the buffer, also deletes the sound
- *  buffer. */
+/** Returns the voice (if any) to the sfx manager, and if it owns the buffer,
+ *  also deletes the sound buffer. */
 SFXOpenAL::~SFXOpenAL()
 {
-    if (m_status!=SFX_UNKNOWN && m_status!=SFX_NOT_INITIALISED)
-    {
-        alDeleteSources(1, &m_sound_source);
-        SFXManager::checkError("deleting a source");
-    }
+    releaseVoice();
 
     if (m_owns_buffer && m_sound_buffer)
     {
@@ -75,51 +74,133 @@ SFXOpenAL::~SFXOpenAL()
 }   // ~SFXOpenAL
 
 //-----------------------------------------------------------------------------
-/** Initialises the sfx. 
+/** Initialises the sfx. The OpenAL source is only taken from the voice pool
+ *  of the sfx manager once the sfx is played (see acquireVoice()).
  */
 bool SFXOpenAL::init()
 {
-    m_status = SFX_UNKNOWN;
-
-    alGenSources(1, &m_sound_source );
-    if (!SFXManager::checkError("generating a source"))
-        return false;
+    m_status = SFX_STOPPED;
+    return true;
+}   // init
 
-    assert( alIsBuffer(m_sound_buffer->getBufferID()) );
-    assert( alIsSource(m_sound_source) );
+//-----------------------------------------------------------------------------
+/** Returns the gain to use for the voice, which is 0 if a positional sfx is
+ *  too far away from the listener.
+ */
+float SFXOpenAL::getVoiceGain() const
+{
+    if (m_positional &&
+        SFXManager::get()->getListenerPos().distance(m_position)
+                                             > m_sound_buffer->getMaxDist())
+        return 0.0f;
+    return (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain;
+}   // getVoiceGain
 
+//-----------------------------------------------------------------------------
+/** Copies all cached parameters of this sfx to its (just acquired) voice.
+ */
+void SFXOpenAL::setupVoice()
+{
     alSourcei (m_sound_source, AL_BUFFER, m_sound_buffer->getBufferID());
 
-    if (!SFXManager::checkError("attaching the buffer to the source"))
-        return false;
-
-    alSource3f(m_sound_source, AL_POSITION,       0.0, 0.0, 0.0);
+    if (m_positional)
+    {
+        alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_FALSE);
+        alSource3f(m_sound_source, AL_POSITION, m_position.getX(),
+                   m_position.getY(), -m_position.getZ());
+    }
+    else
+    {
+        alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_TRUE);
+        alSource3f(m_sound_source, AL_POSITION, 0.0, 0.0, 0.0);
+    }
     alSource3f(m_sound_source, AL_VELOCITY,       0.0, 0.0, 0.0);
     alSource3f(m_sound_source, AL_DIRECTION,      0.0, 0.0, 0.0);
 
-    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR, m_sound_buffer->getRolloff());
+    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR, m_rolloff);
     alSourcef (m_sound_source, AL_MAX_DISTANCE,   m_sound_buffer->getMaxDist());
+    alSourcef (m_sound_source, AL_GAIN,           getVoiceGain());
+    alSourcef (m_sound_source, AL_PITCH,          m_speed);
+    alSourcei (m_sound_source, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
+}   // setupVoice
 
-    if (m_gain < 0.0f)
+//-----------------------------------------------------------------------------
+/** Tries to get a voice from the sfx manager. If this sfx is playing, the
+ *  voice is started at the current play position, so a looped sfx that
+ *  was virtual for a while continues as if it had been played all along.
+ *  \return True if this sfx has a voice now.
+ */
+bool SFXOpenAL::acquireVoice()
+{
+    if (m_sound_source != 0)
+        return true;
+    if (m_status == SFX_UNKNOWN || m_status == SFX_NOT_INITIALISED)
+        return false;
+
+    m_sound_source = SFXManager::get()->allocateVoice();
+    if (m_sound_source == 0)
+        return false;
+
+    setupVoice();
+    if (!SFXManager::checkError("setting up a voice"))
     {
-        alSourcef (m_sound_source, AL_GAIN, m_default_gain * m_master_gain);
+        releaseVoice();
+        return false;
     }
-    else
+
+    if (m_status == SFX_PLAYING)
     {
-        alSourcef (m_sound_source, AL_GAIN, m_gain * m_master_gain);
+        const float duration = m_sound_buffer->getDuration();
+        float offset = m_play_time;
+        if (m_loop && duration > 0)
+            offset = fmodf(offset, duration);
+        else if (duration > 0 && offset >= duration)
+            return true;   // Finished, updatePlayingSFX will stop it
+        if (offset > 0)
+            alSourcef(m_sound_source, AL_SEC_OFFSET, offset);
+        alSourcePlay(m_sound_source);
+        SFXManager::checkError("starting a voice");
     }
+    return true;
+}   // acquireVoice
 
-    if (m_positional) alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_FALSE);
-    else              alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_TRUE);
+//-----------------------------------------------------------------------------
+/** Stops the voice of this sfx and returns it to the sfx manager. The
+ *  status of this sfx is not changed.
+ */
+void SFXOpenAL::releaseVoice()
+{
+    if (m_sound_source == 0)
+        return;
 
-    alSourcei(m_sound_source, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
+    alSourceStop(m_sound_source);
+    alSourcei(m_sound_source, AL_BUFFER, 0);
+    SFXManager::checkError("releasing a voice");
+    SFXManager::get()->freeVoice(m_sound_source);
+    m_sound_source = 0;
+}   // releaseVoice
 
-    if(!SFXManager::checkError("setting up the source"))
-        return false;
+//-----------------------------------------------------------------------------
+/** Returns an estimate of the gain of this sfx at the listener position,
+ *  using OpenAL's default inverse distance clamped model. This is used by
+ *  the sfx manager to decide which sfx should get a voice.
+ *  \param listener Position of the listener.
+ */
+float SFXOpenAL::getAudibility(const Vec3 &listener) const
+{
+    const float gain = (m_gain < 0.0f ? m_default_gain : m_gain)
+                     * m_master_gain;
+    if (!m_positional)
+        return gain;
 
-    m_status = SFX_STOPPED;
-    return true;
-}   // init
+    float distance = listener.distance(m_position);
+    if (distance > m_sound_buffer->getMaxDist())
+        return 0.0f;
+    // AL_REFERENCE_DISTANCE is 1
+    if (distance < 1.0f)
+        distance = 1.0f;
+    return gain / (1.0f + m_rolloff * (distance - 1.0f));
+}   // getAudibility
 
 // ------------------------------------------------------------------------
 /** Updates the status of a playing sfx. If the sound has been played long
@@ -132,7 +213,10 @@ void SFXOpenAL::updatePlayingSFX(float dt)
     assert(m_status==SFX_PLAYING);
     m_play_time += dt;
     if(!m_loop && m_play_time > m_sound_buffer->getDuration())
+    {
         m_status = SFX_STOPPED;
+        releaseVoice();
+    }
 }   // updatePlayingSFX
 
 //-----------------------------------------------------------------------------
@@ -154,13 +238,6 @@ void SFXOpenAL::reallySetSpeed(float factor)
 {
     if (m_status != SFX_PLAYING || !SFXManager::get()->sfxAllowed()) return;
 
-    if(m_status==SFX_NOT_INITIALISED)
-    {
-        init();
-        if(m_status==SFX_UNKNOWN)
-            return;
-    }
-
     //OpenAL only accepts pitches in the range of 0.5 to 2.0
     if(factor > 2.0f)
     {
@@ -170,6 +247,9 @@ void SFXOpenAL::reallySetSpeed(float factor)
     {
         factor = 0.5f;
     }
+    m_speed = factor;
+    if (m_sound_source == 0) return;
+
     alSourcef(m_sound_source,AL_PITCH,factor);
     SFXManager::checkError("setting speed");
 }   // reallySetSpeed
@@ -202,7 +282,8 @@ void SFXOpenAL::reallySetVolume(float volume)
             return;
     }
 
-    alSourcef(m_sound_source, AL_GAIN, m_gain * m_master_gain);
+    if (m_sound_source == 0) return;
+    alSourcef(m_sound_source, AL_GAIN, getVoiceGain());
 }   // reallySetVolume
 
 //-----------------------------------------------------------------------------
@@ -225,10 +306,9 @@ void SFXOpenAL::reallySetMasterVolumeNow(float volume)
 {
     m_master_gain = volume;
     
-    if(m_status==SFX_UNKNOWN || m_status == SFX_NOT_INITIALISED) return;
+    if(m_status==SFX_UNKNOWN || m_sound_source == 0) return;
 
-    alSourcef(m_sound_source, AL_GAIN, 
-               (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
+    alSourcef(m_sound_source, AL_GAIN, getVoiceGain());
     SFXManager::checkError("setting volume");
 }   // reallySetMasterVolumeNow
 
@@ -256,6 +336,7 @@ void SFXOpenAL::reallySetLoop(bool status)
             return;
     }
 
+    if (m_sound_source == 0) return;
     alSourcei(m_sound_source, AL_LOOPING, status ? AL_TRUE : AL_FALSE);
     SFXManager::checkError("looping");
 }   // reallySetLoop
@@ -270,7 +351,8 @@ void SFXOpenAL::stop()
 }   // stop
 
 //-----------------------------------------------------------------------------
-/** The sfx manager thread executes a stop for this sfx.
+/** The sfx manager thread executes a stop for this sfx. This also returns
+ *  the voice of this sfx to the sfx manager.
  */
 void SFXOpenAL::reallyStopNow()
 {
@@ -278,9 +360,7 @@ void SFXOpenAL::reallyStopNow()
     {
         m_status = SFX_STOPPED;
         m_loop = false;
-        alSourcei(m_sound_source, AL_LOOPING, AL_FALSE);
-        alSourceStop(m_sound_source);
-        SFXManager::checkError("stopping");
+        releaseVoice();
     }
 }   // reallyStopNow
 
@@ -294,7 +374,8 @@ void SFXOpenAL::pause()
 
 //-----------------------------------------------------------------------------
 /** Pauses a SFX that's currently played. Nothing happens it the effect is
- *  currently not being played.
+ *  currently not being played. The voice is kept, but the sfx manager can
+ *  take it away if it is needed for a playing sfx.
  */
 void SFXOpenAL::reallyPauseNow()
 {
@@ -302,6 +383,7 @@ void SFXOpenAL::reallyPauseNow()
     // from pauseAll, and we have to make sure to only pause playing sfx.
     if (m_status != SFX_PLAYING || !SFXManager::get()->sfxAllowed()) return;
     m_status = SFX_PAUSED;
+    if (m_sound_source == 0) return;
     alSourcePause(m_sound_source);
     SFXManager::checkError("pausing");
 }   // reallyPauseNow
@@ -330,9 +412,16 @@ void SFXOpenAL::reallyResumeNow()
 
     if(m_status==SFX_PAUSED)
     {
-        alSourcePlay(m_sound_source);
-        SFXManager::checkError("resuming");
         m_status = SFX_PLAYING;
+        if (m_sound_source != 0)
+        {
+            alSourcePlay(m_sound_source);
+            SFXManager::checkError("resuming");
+        }
+        else if (getAudibility(SFXManager::get()->getListenerPos()) > 0)
+        {
+            acquireVoice();
+        }
     }
 }   // reallyResumeNow
 
@@ -357,17 +446,19 @@ void SFXOpenAL::play()
 }   // play
 
 //-----------------------------------------------------------------------------
-/** Plays this sound effect.
+/** Plays this sound effect. If no voice is available (or the sfx can not be
+ *  heard) the sfx is played virtually, and the sfx manager will give it a
+ *  voice once it is important enough.
  */
 void SFXOpenAL::reallyPlayNow(SFXBuffer* buffer)
 {
     if (!SFXManager::get()->sfxAllowed()) return;
     if (m_status==SFX_NOT_INITIALISED)
     {
-        // lazily create OpenAL source when needed
+        // lazily initialise the sfx when needed
         init();
 
-        // creation of OpenAL source failed, giving up
+        // initialisation failed, giving up
         if (m_status==SFX_UNKNOWN) return;
     }
 
@@ -377,14 +468,16 @@ void SFXOpenAL::reallyPlayNow(SFXBuffer* buffer)
             reallyStopNow();
 
         m_sound_buffer = buffer;
-        alSourcei(m_sound_source, AL_BUFFER, m_sound_buffer->getBufferID());
+        if (m_sound_source != 0)
+        {
+            alSourcei(m_sound_source, AL_BUFFER,
+                      m_sound_buffer->getBufferID());
 
-        if (!SFXManager::checkError("attaching the buffer to the source"))
-            return;
+            if (!SFXManager::checkError("attaching the buffer to the source"))
+                return;
+        }
     }
 
-    alSourcePlay(m_sound_source);
-    SFXManager::checkError("playing");
     // Esp. with terrain sounds it can (very likely) happen that the status
     // got overwritten: a sound is created and an init event is queued. Then
     // a play event is queued, and the status is immediately changed to
@@ -392,6 +485,16 @@ void SFXOpenAL::reallyPlayNow(SFXBuffer* buffer)
     // to stopped again. So for this case we have to set the status to
     // playing again.
     m_status = SFX_PLAYING;
+
+    if (m_sound_source != 0)
+    {
+        alSourcePlay(m_sound_source);
+        SFXManager::checkError("playing");
+    }
+    else if (getAudibility(SFXManager::get()->getListenerPos()) > 0)
+    {
+        acquireVoice();
+    }
 }   // reallyPlayNow
 
 //-----------------------------------------------------------------------------
@@ -463,19 +566,13 @@ void SFXOpenAL::reallySetPosition(const Vec3 &position)
         return;
     }
 
+    m_position = position;
+    // A virtual sfx only needs to remember the position
+    if (m_sound_source == 0) return;
+
     alSource3f(m_sound_source, AL_POSITION, position.getX(),
                position.getY(), -position.getZ());
-
-    if (SFXManager::get()->getListenerPos().distance(position)
-        > m_sound_buffer->getMaxDist())
-    {
-        alSourcef(m_sound_source, AL_GAIN, 0);
-    }
-    else
-    {
-        alSourcef(m_sound_source, AL_GAIN, 
-                  (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
-    }
+    alSourcef(m_sound_source, AL_GAIN, getVoiceGain());
 
     SFXManager::checkError("positioning");
 }   // reallySetPosition
@@ -520,11 +617,11 @@ void SFXOpenAL::onSoundEnabledBack()
         if (m_status==SFX_NOT_INITIALISED) init();
         if (m_status!=SFX_UNKNOWN)
         {
-            alSourcef(m_sound_source, AL_GAIN, 0);
+            // Both commands are executed by the sfx thread in the same
+            // update, so the sfx only gets (and keeps) a voice once it is
+            // resumed.
             play();
             pause();
-            alSourcef(m_sound_source, AL_GAIN,
-                     (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
         }
     }
 }   // onSoundEnabledBack
@@ -533,7 +630,9 @@ void SFXOpenAL::onSoundEnabledBack()
 
 void SFXOpenAL::setRolloff(float rolloff)
 {
-    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR,  rolloff);
+    m_rolloff = rolloff;
+    if (m_sound_source != 0)
+        alSourcef (m_sound_source, AL_ROLLOFF_FACTOR,  rolloff);
 }
 
 //-----------------------------------------------------------------------------
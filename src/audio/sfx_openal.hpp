@@ -32,9 +32,14 @@
 #include "audio/sfx_base.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/vec3.hpp"
 
 /**
   * \brief OpenAL implementation of the abstract SFXBase interface
+  *  The OpenAL source (voice) is not owned by the sfx, it is taken from the
+  *  voice pool of the SFXManager while the sfx is audible. All source
+  *  parameters are cached, so that a voice can be set up again when the
+  *  sfx gets a voice back.
   * \ingroup audio
   */
 class SFXOpenAL : public SFXBase
@@ -45,7 +50,7 @@ private:
     /** Buffers hold sound data. */
     SFXBuffer*   m_sound_buffer;
 
-    /** Sources are points emitting sound. */
+    /** Sources are points emitting sound. 0 if this sfx has no voice. */
     ALuint       m_sound_source;
 
     /** The status of this SFX. */
@@ -78,6 +83,19 @@ private:
     /** How long the sfx has been playing. */
     float m_play_time;
 
+    /** The last position set, used when a voice is (re)acquired and to
+     *  estimate how well this sfx can be heard. */
+    Vec3 m_position;
+
+    /** The last pitch set. */
+    float m_speed;
+
+    /** The roll-off factor of this sfx. */
+    float m_rolloff;
+
+    float getVoiceGain() const;
+    void  setupVoice();
+
 public:
               SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
                         bool owns_buffer = false);
@@ -110,6 +128,12 @@ public:
     virtual void      reallySetMasterVolumeNow(float volue) OVERRIDE;
     virtual void      onSoundEnabledBack() OVERRIDE;
     virtual void      setRolloff(float rolloff) OVERRIDE;
+    virtual float     getAudibility(const Vec3 &listener) const OVERRIDE;
+    virtual bool      acquireVoice() OVERRIDE;
+    virtual void      releaseVoice() OVERRIDE;
+    // ------------------------------------------------------------------------
+    /** Returns if this sfx currently has a voice. */
+    virtual bool      hasVoice() const OVERRIDE { return m_sound_source != 0; }
     // ------------------------------------------------------------------------
     /** Returns if this sfx is looped or not. */
     virtual bool      isLooped()  OVERRIDE { return m_loop; }
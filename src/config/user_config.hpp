@@ -419,6 +419,19 @@ namespace UserConfigParams
     PARAM_PREFIX FloatUserConfigParam       m_music_volume
             PARAM_DEFAULT(  FloatUserConfigParam(0.5f, "music_volume",
             &m_audio_group, "Music volume from 0.0 to 1.0") );
+    PARAM_PREFIX IntUserConfigParam         m_sfx_max_voices
+            PARAM_DEFAULT(  IntUserConfigParam(48, "sfx_max_voices",
+            &m_audio_group, "Maximum number of sound effects heard at the "
+                            "same time (8 to 128). Less important sound "
+                            "effects are culled first.") );
+    PARAM_PREFIX IntUserConfigParam         m_music_stream_buffers
+            PARAM_DEFAULT(  IntUserConfigParam(4, "music_stream_buffers",
+            &m_audio_group, "Number of OpenAL buffers queued for streamed "
+                            "music (2 to 16), each about a quarter second.") );
+    PARAM_PREFIX IntUserConfigParam         m_music_read_ahead
+            PARAM_DEFAULT(  IntUserConfigParam(8, "music_read_ahead",
+            &m_audio_group, "Number of music chunks decoded ahead of playback "
+                            "by the background decoder (2 to 64).") );
 
     // ---- Race setup
     PARAM_PREFIX GroupUserConfigParam        m_race_setup_group
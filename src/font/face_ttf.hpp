@@ -22,8 +22,8 @@
 #include "utils/no_copy.hpp"
 
 #include <cassert>
-#include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -59,7 +59,8 @@ class FaceTTF : public NoCopy
 private:
     /** Contains all FT_Face with a list of loaded glyph index with the
      *  \ref FontArea. */
-    std::vector<std::pair<FT_Face, std::map<unsigned, FontArea> > > m_ft_faces;
+    std::vector<std::pair<FT_Face, std::unordered_map<unsigned, FontArea> > >
+        m_ft_faces;
 #endif
 public:
     LEAK_CHECK()
@@ -80,7 +81,10 @@ public:
     void loadTTF(std::vector<FT_Face> faces)
     {
         for (unsigned int i = 0; i < faces.size(); i++)
-            m_ft_faces.emplace_back(faces[i], std::map<unsigned, FontArea>());
+        {
+            m_ft_faces.emplace_back(faces[i],
+                std::unordered_map<unsigned, FontArea>());
+        }
     }
     // ------------------------------------------------------------------------
     /** Return a TTF in \ref m_ft_faces.
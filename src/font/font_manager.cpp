@@ -25,7 +25,6 @@
 #include "font/regular_face.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/skin.hpp"
-#include "states_screens/state_manager.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
@@ -98,6 +97,8 @@ std::vector<FT_Face>
         FT_Face face = NULL;
         font_manager->checkFTError(FT_New_Face(
             m_ft_library, font.c_str(), 0, &face), font + " is loaded");
+        if (face)
+            m_ft_face_files[face] = font;
         ret.push_back(face);
     }
     return ret;
@@ -569,20 +570,35 @@ void FontManager::shape(const std::u32string& text,
 }   // shape
 
 // ----------------------------------------------------------------------------
-/* Return the cached glyph layouts for writing, it will clear all layouts if
- * not in-game and when the cached sized exceed a certain number. */
+size_t FontManager::StringwHash::operator()(const core::stringw& str) const
+{
+    return (size_t)StringUtils::fnv1a64(str.c_str(),
+        str.size() * sizeof(wchar_t));
+}   // StringwHash::operator()
+
+// ----------------------------------------------------------------------------
+/* Return the cached glyph layouts for writing, which are empty if the text
+ * is not cached. If too many layouts are cached, the least recently used
+ * one is removed. The returned layouts stay valid until the next call. */
 std::vector<irr::gui::GlyphLayout>&
                    FontManager::getCachedLayouts(const irr::core::stringw& str)
 {
     const size_t MAX_LAYOUTS = 600;
-    if (StateManager::get()->getGameState() != GUIEngine::GAME &&
-        m_cached_gls.size() > MAX_LAYOUTS)
+    auto it = m_cached_gls_index.find(str);
+    if (it != m_cached_gls_index.end())
+    {
+        m_cached_gls.splice(m_cached_gls.begin(), m_cached_gls, it->second);
+        return it->second->second;
+    }
+
+    if (m_cached_gls.size() >= MAX_LAYOUTS)
     {
-        Log::debug("FontManager",
-            "Clearing cached glyph layouts because too many.");
-        clearCachedLayouts();
+        m_cached_gls_index.erase(m_cached_gls.back().first);
+        m_cached_gls.pop_back();
     }
-    return m_cached_gls[str];
+    m_cached_gls.emplace_front(str, std::vector<irr::gui::GlyphLayout>());
+    m_cached_gls_index[str] = m_cached_gls.begin();
+    return m_cached_gls.front().second;
 }   // getCachedLayouts
 
 // ----------------------------------------------------------------------------
@@ -676,6 +692,7 @@ FT_Face FontManager::loadColorEmoji()
     }
 
     m_has_color_emoji = true;
+    m_ft_face_files[face] = GUIEngine::getSkin()->getColorEmojiTTF();
     return face;
 }   // loadColorEmoji
 
@@ -27,6 +27,7 @@
 #include "utils/log.hpp"
 #include "utils/no_copy.hpp"
 
+#include <list>
 #include <string>
 #include <map>
 #include <typeindex>
@@ -71,9 +72,24 @@ private:
     /** Map FT_Face to index for quicker layout. */
     std::map<FT_Face, uint16_t> m_ft_faces_to_index;
 
-    /** Text drawn to glyph layouts cache. */
-    std::map<irr::core::stringw,
-        std::vector<irr::gui::GlyphLayout> > m_cached_gls;
+    /** The file each FT_Face was loaded from. */
+    std::map<FT_Face, std::string> m_ft_face_files;
+
+    /** Hashes a text for \ref m_cached_gls_index. */
+    struct StringwHash
+    {
+        size_t operator()(const irr::core::stringw& str) const;
+    };
+
+    /** Text drawn to glyph layouts cache, the most recently used first.
+     *  Layouts don't depend on the font, as all faces are shaped with
+     *  \ref m_shaping_dpi. */
+    std::list<std::pair<irr::core::stringw,
+        std::vector<irr::gui::GlyphLayout> > > m_cached_gls;
+
+    /** Position of each text in \ref m_cached_gls. */
+    std::unordered_map<irr::core::stringw,
+        decltype(m_cached_gls)::iterator, StringwHash> m_cached_gls_index;
 
     bool m_has_color_emoji;
     // ------------------------------------------------------------------------
@@ -131,6 +147,13 @@ public:
     // ------------------------------------------------------------------------
     unsigned getShapingDPI() const                    { return m_shaping_dpi; }
     // ------------------------------------------------------------------------
+    /** Return the file a face was loaded from, or an empty string. */
+    std::string getFaceFile(FT_Face face) const
+    {
+        auto it = m_ft_face_files.find(face);
+        return it == m_ft_face_files.end() ? "" : it->second;
+    }
+    // ------------------------------------------------------------------------
     void shape(const std::u32string& text,
                std::vector<irr::gui::GlyphLayout>& gls,
                std::vector<std::u32string>* line_data = NULL);
@@ -138,7 +161,11 @@ public:
     std::vector<irr::gui::GlyphLayout>& getCachedLayouts
                   (const irr::core::stringw& str);
     // ------------------------------------------------------------------------
-    void clearCachedLayouts()                         { m_cached_gls.clear(); }
+    void clearCachedLayouts()
+    {
+        m_cached_gls.clear();
+        m_cached_gls_index.clear();
+    }
     // ------------------------------------------------------------------------
     void initGlyphLayouts(const irr::core::stringw& text,
                           std::vector<irr::gui::GlyphLayout>& gls,
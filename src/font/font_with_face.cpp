@@ -30,11 +30,18 @@
 #include "graphics/stk_tex_manager.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/skin.hpp"
+#include "io/file_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/utf8.h"
 
 #include "GlyphLayout.h"
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
 
 #include "../lib/irrlicht/source/Irrlicht/CGUISpriteBank.h"
 
@@ -53,6 +60,7 @@ extern "C"
  */
 FontWithFace::FontWithFace(const std::string& name)
 {
+    m_name = name;
     m_spritebank = new irr::gui::CGUISpriteBank(irr_driver->getGUI());
     m_fallback_font = NULL;
     m_fallback_font_scale = 1.0f;
@@ -74,6 +82,7 @@ FontWithFace::~FontWithFace()
     }
     m_spritebank->drop();
 
+    m_glyph_cache.save();
     delete m_face_ttf;
 }   // ~FontWithFace
 
@@ -129,6 +138,8 @@ void FontWithFace::reset()
     m_spritebank->clear();
     m_face_ttf->reset();
     createNewGlyphPage();
+    if (!GUIEngine::isNoGraphics())
+        loadGlyphCache();
 }   // reset
 
 // ----------------------------------------------------------------------------
@@ -181,36 +192,35 @@ void FontWithFace::createNewGlyphPage()
 }   // createNewGlyphPage
 
 // ----------------------------------------------------------------------------
-/** Render a glyph for a character into bitmap and save it into the glyph page.
- *  \param font_number Font number in \ref FaceTTF ttf list
- *  \param glyph_index Glyph index in ttf
+#ifndef SERVER_ONLY
+/** Render a glyph into a bitmap with FreeType. It only uses the given face,
+ *  so it can be called from several threads as long as each uses its own
+ *  FT_Face (and FT_Library).
+ *  \param face The face to render with.
+ *  \param glyph_index Glyph index in the face.
+ *  \param bitmap On return the rendered glyph.
  */
-void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
+void FontWithFace::rasterizeGlyph(FT_Face face, unsigned glyph_index,
+                                  GlyphBitmap* bitmap) const
 {
-#ifndef SERVER_ONLY
-    if (GUIEngine::isNoGraphics())
-        return;
-
     assert(glyph_index > 0);
-    assert(font_number < m_face_ttf->getTotalFaces());
-    FT_Face cur_face = m_face_ttf->getFace(font_number);
-    FT_GlyphSlot slot = cur_face->glyph;
+    FT_GlyphSlot slot = face->glyph;
 
-    if (FT_HAS_COLOR(cur_face) && cur_face->num_fixed_sizes != 0)
+    if (FT_HAS_COLOR(face) && face->num_fixed_sizes != 0)
     {
-        font_manager->checkFTError(FT_Load_Glyph(cur_face, glyph_index,
+        font_manager->checkFTError(FT_Load_Glyph(face, glyph_index,
             FT_LOAD_DEFAULT | FT_LOAD_COLOR), "loading a glyph");
     }
     else
     {
         // Same face may be shared across the different FontWithFace,
         // so reset dpi each time
-        font_manager->checkFTError(FT_Set_Pixel_Sizes(cur_face, 0, getDPI()),
+        font_manager->checkFTError(FT_Set_Pixel_Sizes(face, 0, getDPI()),
             "setting DPI");
 
-        unsigned flag = FT_HAS_COLOR(cur_face) ?
+        unsigned flag = FT_HAS_COLOR(face) ?
             (FT_LOAD_DEFAULT | FT_LOAD_COLOR) : FT_LOAD_DEFAULT;
-        font_manager->checkFTError(FT_Load_Glyph(cur_face, glyph_index,
+        font_manager->checkFTError(FT_Load_Glyph(face, glyph_index,
             flag), "loading a glyph");
 
         font_manager->checkFTError(shapeOutline(&(slot->outline)),
@@ -232,53 +242,26 @@ void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
         cur_glyph_width = (unsigned)(bits->width * scale_ratio);
         cur_glyph_height = (unsigned)(bits->rows * scale_ratio);
     }
-    core::dimension2du texture_size(cur_glyph_width + 1, cur_glyph_height + 1);
-    if ((m_used_width + texture_size.Width > getGlyphPageSize() &&
-        m_used_height + m_current_height + texture_size.Height >
-        getGlyphPageSize())                                     ||
-        m_used_height + texture_size.Height > getGlyphPageSize())
-    {
-        // Add a new glyph page if current one is full
-        createNewGlyphPage();
-    }
-
-    // Determine the linebreak location
-    if (m_used_width + texture_size.Width > getGlyphPageSize())
-    {
-        m_used_width  = 0;
-        m_used_height += m_current_height;
-        m_current_height = 0;
-    }
+    bitmap->m_width = cur_glyph_width;
+    bitmap->m_height = cur_glyph_height;
+    bitmap->m_bytes_per_pixel =
+        bits->pixel_mode == FT_PIXEL_MODE_BGRA ? 4 : 1;
+    bitmap->m_pixels.clear();
 
-    const unsigned int cur_tex = m_spritebank->getTextureCount() - 1;
-    if (bits->buffer != NULL && !GUIEngine::isNoGraphics())
+    if (bits->buffer != NULL)
     {
-        video::ITexture* tex = m_spritebank->getTexture(cur_tex);
-        glBindTexture(GL_TEXTURE_2D, tex->getOpenGLTextureName());
         if (bits->pixel_mode == FT_PIXEL_MODE_GRAY)
         {
-            if (CVS->isARBTextureSwizzleUsable() && !useColorGlyphPage())
+            bitmap->m_pixels.resize(bits->width * bits->rows);
+            const int pitch = bits->pitch < 0 ? -bits->pitch : bits->pitch;
+            for (unsigned int y = 0; y < bits->rows; y++)
             {
-                glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
-                    bits->width, bits->rows, GL_RED, GL_UNSIGNED_BYTE,
-                    bits->buffer);
-            }
-            else
-            {
-                const unsigned int size = bits->width * bits->rows;
-                uint8_t* image_data = new uint8_t[size * 4];
-                memset(image_data, 255, size * 4);
-                for (unsigned int i = 0; i < size; i++)
-                    image_data[4 * i + 3] = bits->buffer[i];
-                glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
-                    bits->width, bits->rows, GL_RGBA, GL_UNSIGNED_BYTE,
-                    image_data);
-                delete[] image_data;
+                memcpy(&bitmap->m_pixels[y * bits->width],
+                    bits->buffer + y * pitch, bits->width);
             }
         }
         else if (bits->pixel_mode == FT_PIXEL_MODE_BGRA)
         {
-            assert(useColorGlyphPage());
             // Scale it to normal font dpi
             video::IImage* unscaled = irr_driver->getVideoDriver()
                 ->createImageFromData(video::ECF_A8R8G8B8,
@@ -315,17 +298,15 @@ void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
                         "Error reduce bitmap font size.");
                 }
             }
-            uint8_t* scaled_data = (uint8_t*)scaled->lock();
+            const uint8_t* scaled_data = (uint8_t*)scaled->lock();
+            bitmap->m_pixels.assign(scaled_data,
+                scaled_data + cur_glyph_width * cur_glyph_height * 4);
             for (unsigned int i = 0; i < cur_glyph_width * cur_glyph_height;
                  i++)
             {
-                uint8_t tmp_val = scaled_data[i * 4];
-                scaled_data[i * 4] = scaled_data[i * 4 + 2];
-                scaled_data[i * 4 + 2] = tmp_val;
+                std::swap(bitmap->m_pixels[i * 4],
+                          bitmap->m_pixels[i * 4 + 2]);
             }
-            glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
-                cur_glyph_width, cur_glyph_height, GL_RGBA, GL_UNSIGNED_BYTE,
-                scaled_data);
             unscaled->drop();
             scaled->drop();
         }
@@ -333,6 +314,177 @@ void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
         {
             assert(false && "Invalid pixel mode");
         }
+    }
+
+    // Save glyph metrics
+    bitmap->m_advance_x = (int)
+        (slot->advance.x / BEARING * scale_ratio);
+    bitmap->m_bearing_x = (int)
+        (slot->metrics.horiBearingX / BEARING * scale_ratio);
+    bitmap->m_glyph_height =
+        (int)(slot->metrics.height / BEARING * scale_ratio);
+    bitmap->m_offset_y = bitmap->m_glyph_height -
+        (int)(slot->metrics.horiBearingY / BEARING * scale_ratio);
+}   // rasterizeGlyph
+#endif
+
+// ----------------------------------------------------------------------------
+/** Render glyphs into bitmaps. Larger batches are rendered in parallel, each
+ *  thread with its own FreeType library and faces loaded from the same
+ *  files, since FreeType faces must not be used by several threads at once.
+ *  \param glyphs The font number and glyph index of each glyph.
+ *  \param bitmaps On return the rendered glyphs.
+ *  \param min_parallel Minimum number of glyphs to use threads.
+ */
+void FontWithFace::rasterizeGlyphs(
+                     const std::vector<std::pair<unsigned, unsigned> >& glyphs,
+                     std::vector<GlyphBitmap>* bitmaps, unsigned min_parallel)
+{
+#ifndef SERVER_ONLY
+    bitmaps->clear();
+    bitmaps->resize(glyphs.size());
+    std::vector<uint8_t> done(glyphs.size(), 0);
+    const unsigned num_threads = glyphs.size() < min_parallel ? 1 :
+        std::min(std::max(std::thread::hardware_concurrency(), 1u), 4u);
+    if (num_threads > 1)
+    {
+        std::atomic<unsigned> next_glyph(0);
+        auto job = [this, &glyphs, bitmaps, &done, &next_glyph]()
+        {
+            FT_Library library = NULL;
+            if (FT_Init_FreeType(&library) != 0)
+                return;
+            std::vector<FT_Face> faces(m_face_ttf->getTotalFaces(), NULL);
+            std::vector<bool> tried(faces.size(), false);
+            unsigned i;
+            while ((i = next_glyph.fetch_add(1)) < glyphs.size())
+            {
+                const unsigned font_number = glyphs[i].first;
+                if (!tried[font_number])
+                {
+                    tried[font_number] = true;
+                    faces[font_number] = openFaceCopy(library, font_number);
+                }
+                // Glyphs without a face are rendered later by the main thread
+                if (!faces[font_number])
+                    continue;
+                rasterizeGlyph(faces[font_number], glyphs[i].second,
+                               &(*bitmaps)[i]);
+                done[i] = 1;
+            }
+            for (FT_Face face : faces)
+            {
+                if (face)
+                    FT_Done_Face(face);
+            }
+            FT_Done_FreeType(library);
+        };
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < num_threads; i++)
+            threads.emplace_back(job);
+        job();
+        for (std::thread& t : threads)
+            t.join();
+    }
+    for (unsigned i = 0; i < glyphs.size(); i++)
+    {
+        if (!done[i])
+        {
+            rasterizeGlyph(m_face_ttf->getFace(glyphs[i].first),
+                           glyphs[i].second, &(*bitmaps)[i]);
+        }
+    }
+#endif
+}   // rasterizeGlyphs
+
+// ----------------------------------------------------------------------------
+#ifndef SERVER_ONLY
+/** Loads the file of a face of \ref m_face_ttf again into another FreeType
+ *  library, with the same size selected for color emoji.
+ *  \return The new face, or NULL if it can't be loaded.
+ */
+FT_Face FontWithFace::openFaceCopy(FT_Library library,
+                                   unsigned font_number) const
+{
+    FT_Face shared = m_face_ttf->getFace(font_number);
+    const std::string file = font_manager->getFaceFile(shared);
+    FT_Face face = NULL;
+    if (file.empty() ||
+        FT_New_Face(library, file.c_str(), 0, &face) != 0)
+        return NULL;
+    if (FT_HAS_COLOR(face) && face->num_fixed_sizes != 0 &&
+        FT_Select_Size(face, face->num_fixed_sizes - 1) != 0)
+    {
+        FT_Done_Face(face);
+        return NULL;
+    }
+    return face;
+}   // openFaceCopy
+#endif
+
+// ----------------------------------------------------------------------------
+/** Copy a rendered glyph into the glyph page and store its \ref FontArea.
+ *  \param bitmap The rendered glyph.
+ *  \param font_number Font number in \ref FaceTTF ttf list
+ *  \param glyph_index Glyph index in ttf
+ */
+void FontWithFace::uploadGlyph(const GlyphBitmap& bitmap,
+                               unsigned font_number, unsigned glyph_index)
+{
+#ifndef SERVER_ONLY
+    const unsigned cur_glyph_width = bitmap.m_width;
+    const unsigned cur_glyph_height = bitmap.m_height;
+    core::dimension2du texture_size(cur_glyph_width + 1, cur_glyph_height + 1);
+    if ((m_used_width + texture_size.Width > getGlyphPageSize() &&
+        m_used_height + m_current_height + texture_size.Height >
+        getGlyphPageSize())                                     ||
+        m_used_height + texture_size.Height > getGlyphPageSize())
+    {
+        // Add a new glyph page if current one is full
+        createNewGlyphPage();
+    }
+
+    // Determine the linebreak location
+    if (m_used_width + texture_size.Width > getGlyphPageSize())
+    {
+        m_used_width  = 0;
+        m_used_height += m_current_height;
+        m_current_height = 0;
+    }
+
+    const unsigned int cur_tex = m_spritebank->getTextureCount() - 1;
+    if (!bitmap.m_pixels.empty() && !GUIEngine::isNoGraphics())
+    {
+        video::ITexture* tex = m_spritebank->getTexture(cur_tex);
+        glBindTexture(GL_TEXTURE_2D, tex->getOpenGLTextureName());
+        if (bitmap.m_bytes_per_pixel == 1)
+        {
+            if (CVS->isARBTextureSwizzleUsable() && !useColorGlyphPage())
+            {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
+                    cur_glyph_width, cur_glyph_height, GL_RED,
+                    GL_UNSIGNED_BYTE, bitmap.m_pixels.data());
+            }
+            else
+            {
+                const unsigned int size = cur_glyph_width * cur_glyph_height;
+                uint8_t* image_data = new uint8_t[size * 4];
+                memset(image_data, 255, size * 4);
+                for (unsigned int i = 0; i < size; i++)
+                    image_data[4 * i + 3] = bitmap.m_pixels[i];
+                glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
+                    cur_glyph_width, cur_glyph_height, GL_RGBA,
+                    GL_UNSIGNED_BYTE, image_data);
+                delete[] image_data;
+            }
+        }
+        else
+        {
+            assert(useColorGlyphPage());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
+                cur_glyph_width, cur_glyph_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                bitmap.m_pixels.data());
+        }
         if (tex->hasMipMaps())
             glGenerateMipmap(GL_TEXTURE_2D);
         glBindTexture(GL_TEXTURE_2D, 0);
@@ -354,16 +506,11 @@ void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
 
     // Save glyph metrics
     FontArea a;
-    a.advance_x = (int)
-        (cur_face->glyph->advance.x / BEARING * scale_ratio);
-    a.bearing_x = (int)
-        (cur_face->glyph->metrics.horiBearingX / BEARING * scale_ratio);
-    const int cur_height =
-        (int)(cur_face->glyph->metrics.height / BEARING * scale_ratio);
-    const int cur_offset_y = cur_height -
-        (int)(cur_face->glyph->metrics.horiBearingY / BEARING * scale_ratio);
-    a.offset_y = m_glyph_max_height - cur_height + cur_offset_y;
-    a.offset_y_bt = -cur_offset_y;
+    a.advance_x = bitmap.m_advance_x;
+    a.bearing_x = bitmap.m_bearing_x;
+    a.offset_y = m_glyph_max_height - bitmap.m_glyph_height +
+        bitmap.m_offset_y;
+    a.offset_y_bt = -bitmap.m_offset_y;
     a.spriteno = f.rectNumber;
     m_face_ttf->insertFontArea(a, font_number, glyph_index);
 
@@ -372,8 +519,207 @@ void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
     if (m_current_height < texture_size.Height)
         m_current_height = texture_size.Height;
 #endif
+}   // uploadGlyph
+
+// ----------------------------------------------------------------------------
+/** Render a glyph for a character into bitmap and save it into the glyph page.
+ *  \param font_number Font number in \ref FaceTTF ttf list
+ *  \param glyph_index Glyph index in ttf
+ */
+void FontWithFace::insertGlyph(unsigned font_number, unsigned glyph_index)
+{
+    insertGlyphs(std::vector<std::pair<unsigned, unsigned> >
+        { std::make_pair(font_number, glyph_index) });
 }   // insertGlyph
 
+// ----------------------------------------------------------------------------
+/** Render glyphs into bitmaps and save them into the glyph page. Glyphs
+ *  which are already in the glyph page are skipped, and the bitmaps of
+ *  glyphs in the \ref m_glyph_cache are used instead of rendering them
+ *  again. The others are rendered together, see \ref rasterizeGlyphs.
+ *  \param glyphs The font number and glyph index of each glyph.
+ */
+void FontWithFace::insertGlyphs(
+                      const std::vector<std::pair<unsigned, unsigned> >& glyphs)
+{
+#ifndef SERVER_ONLY
+    if (GUIEngine::isNoGraphics())
+        return;
+
+    std::vector<std::pair<unsigned, unsigned> > new_glyphs;
+    std::vector<std::pair<unsigned, unsigned> > to_render;
+    std::set<std::pair<unsigned, unsigned> > seen;
+    for (const auto& glyph : glyphs)
+    {
+        assert(glyph.second > 0);
+        assert(glyph.first < m_face_ttf->getTotalFaces());
+        if (m_face_ttf->getFontArea(glyph.first, glyph.second) ||
+            !seen.insert(glyph).second)
+            continue;
+        new_glyphs.push_back(glyph);
+        if (!m_glyph_cache.get(glyph.first, glyph.second))
+            to_render.push_back(glyph);
+    }
+
+    std::vector<GlyphBitmap> bitmaps;
+    rasterizeGlyphs(to_render, &bitmaps);
+    for (unsigned i = 0; i < to_render.size(); i++)
+    {
+        m_glyph_cache.add(to_render[i].first, to_render[i].second,
+                          bitmaps[i]);
+    }
+
+    unsigned rendered = 0;
+    for (const auto& glyph : new_glyphs)
+    {
+        const GlyphBitmap* bitmap =
+            m_glyph_cache.get(glyph.first, glyph.second);
+        // The cache can be full, then the bitmap rendered above is used
+        if (rendered < to_render.size() && to_render[rendered] == glyph)
+            bitmap = &bitmaps[rendered++];
+        uploadGlyph(*bitmap, glyph.first, glyph.second);
+    }
+#endif
+}   // insertGlyphs
+
+// ----------------------------------------------------------------------------
+/** Computes the key of the glyph cache, which changes if anything that
+ *  affects the rendered glyphs changes: the font files, dpi, the render
+ *  settings of this face and the FreeType version.
+ */
+uint64_t FontWithFace::getGlyphCacheKey() const
+{
+    std::ostringstream key;
+    key << m_name << " " << getDPI() << " " << isBold() << " "
+        << useColorGlyphPage() << " " << disableTextShaping();
+#ifndef SERVER_ONLY
+    key << " " << font_manager->getShapingDPI() << " " << FREETYPE_MAJOR
+        << "." << FREETYPE_MINOR << "." << FREETYPE_PATCH;
+    for (unsigned i = 0; i < m_face_ttf->getTotalFaces(); i++)
+    {
+        const std::string file =
+            font_manager->getFaceFile(m_face_ttf->getFace(i));
+        struct stat info;
+        if (file.empty() || FileUtils::statU8Path(file, &info) != 0)
+        {
+            key << " -";
+            continue;
+        }
+        key << " " << file << " " << (uint64_t)info.st_size << " "
+            << (uint64_t)info.st_mtime;
+    }
+#endif
+    return StringUtils::fnv1a64(key.str());
+}   // getGlyphCacheKey
+
+// ----------------------------------------------------------------------------
+/** Loads the glyph cache for the current settings, and puts all glyphs of it
+ *  into the glyph pages, so that glyphs used in earlier runs don't need to
+ *  be rendered again.
+ */
+void FontWithFace::loadGlyphCache()
+{
+#ifndef SERVER_ONLY
+    const uint64_t key = getGlyphCacheKey();
+    if (key != m_glyph_cache.getKey())
+    {
+        m_glyph_cache.save();
+        m_glyph_cache.load(file_manager->getCachedTexturesDir() + "glyphs_" +
+                           m_name + ".bin", key);
+    }
+    const unsigned total_faces = m_face_ttf->getTotalFaces();
+    m_glyph_cache.forEach([this, total_faces](unsigned font_number,
+                                              unsigned glyph_index,
+                                              const GlyphBitmap& bitmap)
+        {
+            if (font_number < total_faces && glyph_index > 0 &&
+                !m_face_ttf->getFontArea(font_number, glyph_index))
+                uploadGlyph(bitmap, font_number, glyph_index);
+        });
+#endif
+}   // loadGlyphCache
+
+// ----------------------------------------------------------------------------
+/** Measures how fast glyphs of this font are rendered with one thread, with
+ *  several threads, and how fast they are written to and read from a glyph
+ *  cache. Nothing is drawn and the glyph pages are not changed, the results
+ *  are only logged.
+ *  \param count Number of glyphs to render, latin and CJK characters are
+ *         used if the font supports them.
+ */
+void FontWithFace::benchmarkGlyphs(unsigned count)
+{
+#ifndef SERVER_ONLY
+    if (GUIEngine::isNoGraphics())
+        return;
+
+    std::vector<std::pair<unsigned, unsigned> > glyphs;
+    std::set<std::pair<unsigned, unsigned> > seen;
+    const std::pair<wchar_t, wchar_t> ranges[] =
+        { { 0x21, 0x7f }, { 0xa1, 0x250 }, { 0x4e00, 0x9fff } };
+    for (const auto& range : ranges)
+    {
+        for (wchar_t c = range.first; c < range.second &&
+             glyphs.size() < count; c++)
+        {
+            unsigned font_number = 0;
+            unsigned glyph_index = 0;
+            m_face_ttf->getFontAndGlyphFromChar(c, &font_number, &glyph_index);
+            if (glyph_index > 0 &&
+                seen.insert(std::make_pair(font_number, glyph_index)).second)
+                glyphs.emplace_back(font_number, glyph_index);
+        }
+    }
+    if (glyphs.empty())
+    {
+        Log::warn("FontWithFace", "No glyphs to benchmark in %s.",
+                  m_name.c_str());
+        return;
+    }
+
+    auto ms_since = [](std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>
+                (std::chrono::steady_clock::now() - start).count();
+        };
+    auto glyphs_per_second = [&glyphs](double ms)
+        {
+            return ms > 0.0 ? glyphs.size() * 1000.0 / ms : 0.0;
+        };
+
+    std::vector<GlyphBitmap> bitmaps;
+    auto start = std::chrono::steady_clock::now();
+    rasterizeGlyphs(glyphs, &bitmaps, /*min_parallel*/(unsigned)-1);
+    const double serial_ms = ms_since(start);
+
+    start = std::chrono::steady_clock::now();
+    rasterizeGlyphs(glyphs, &bitmaps, /*min_parallel*/0);
+    const double parallel_ms = ms_since(start);
+
+    const std::string file = file_manager->getCachedTexturesDir() +
+        "glyphs_benchmark.bin";
+    GlyphCache cache;
+    cache.load(file, getGlyphCacheKey());
+    cache.clear();
+    for (unsigned i = 0; i < glyphs.size(); i++)
+        cache.add(glyphs[i].first, glyphs[i].second, bitmaps[i]);
+    start = std::chrono::steady_clock::now();
+    cache.save();
+    const double save_ms = ms_since(start);
+    start = std::chrono::steady_clock::now();
+    cache.load(file, getGlyphCacheKey());
+    const double load_ms = ms_since(start);
+    const unsigned loaded = cache.getNumGlyphs();
+    remove(FileUtils::getPortableWritingPath(file).c_str());
+
+    Log::info("FontWithFace", "%s: %d glyphs, 1 thread %.1f ms (%.0f/s), "
+        "threads %.1f ms (%.0f/s), cache save %.1f ms, cache load %.1f ms "
+        "(%d glyphs).", m_name.c_str(), (int)glyphs.size(), serial_ms,
+        glyphs_per_second(serial_ms), parallel_ms,
+        glyphs_per_second(parallel_ms), save_ms, load_ms, loaded);
+#endif
+}   // benchmarkGlyphs
+
 // ----------------------------------------------------------------------------
 /** Update the supported characters for this font if required.
  */
@@ -383,11 +729,13 @@ void FontWithFace::updateCharactersList()
         m_fallback_font->updateCharactersList();
 
     if (m_new_char_holder.empty()) return;
+    std::vector<std::pair<unsigned, unsigned> > glyphs;
     for (const wchar_t& c : m_new_char_holder)
     {
         const GlyphInfo& gi = getGlyphInfo(c);
-        insertGlyph(gi.font_number, gi.glyph_index);
+        glyphs.emplace_back(gi.font_number, gi.glyph_index);
     }
+    insertGlyphs(glyphs);
     m_new_char_holder.clear();
 
 }   // updateCharactersList
@@ -467,7 +815,7 @@ const FontArea* FontWithFace::getUnknownFontArea() const
     static FontArea area;
     return &area;
 #else
-    std::map<wchar_t, GlyphInfo>::const_iterator n =
+    std::unordered_map<wchar_t, GlyphInfo>::const_iterator n =
         m_character_glyph_info_map.find(L'?');
     assert(n != m_character_glyph_info_map.end());
     const FontArea* area = m_face_ttf->getFontArea(n->second.font_number,
@@ -485,7 +833,7 @@ const FontArea* FontWithFace::getUnknownFontArea() const
 const FontArea& FontWithFace::getAreaFromCharacter(const wchar_t c,
                                                    bool* fallback_font) const
 {
-    std::map<wchar_t, GlyphInfo>::const_iterator n =
+    std::unordered_map<wchar_t, GlyphInfo>::const_iterator n =
         m_character_glyph_info_map.find(c);
     // Not found, return the first font area, which is a white-space
     if (n == m_character_glyph_info_map.end())
@@ -674,6 +1022,37 @@ void FontWithFace::render(const std::vector<gui::GlyphLayout>& gl,
         }
     }
 
+    // Render all glyphs of this text which are not in a glyph page yet
+    // together, so that they can be rendered in parallel
+    std::vector<std::pair<unsigned, unsigned> > new_glyphs, new_fallback_glyphs;
+    for (const gui::GlyphLayout& glyph_layout : gl)
+    {
+        if (glyph_layout.index == 0 ||
+            (glyph_layout.flags & gui::GLF_NEWLINE) != 0)
+            continue;
+        if (m_face_ttf->enabledForFont(glyph_layout.face_idx))
+        {
+            if (!m_face_ttf->getFontArea(glyph_layout.face_idx,
+                glyph_layout.index))
+            {
+                new_glyphs.emplace_back(glyph_layout.face_idx,
+                    glyph_layout.index);
+            }
+        }
+        else if (m_fallback_font && m_fallback_font
+            ->m_face_ttf->enabledForFont(glyph_layout.face_idx) &&
+            !m_fallback_font->m_face_ttf->getFontArea(glyph_layout.face_idx,
+            glyph_layout.index))
+        {
+            new_fallback_glyphs.emplace_back(glyph_layout.face_idx,
+                glyph_layout.index);
+        }
+    }
+    if (!new_glyphs.empty())
+        insertGlyphs(new_glyphs);
+    if (!new_fallback_glyphs.empty())
+        m_fallback_font->insertGlyphs(new_fallback_glyphs);
+
     // Collect character locations
     const unsigned int text_size = gl.size();
     std::vector<std::pair<s32, bool> > indices;
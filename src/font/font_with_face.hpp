@@ -19,6 +19,7 @@
 #ifndef HEADER_FONT_WITH_FACE_HPP
 #define HEADER_FONT_WITH_FACE_HPP
 
+#include "font/glyph_cache.hpp"
 #include "utils/cpp2011.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
@@ -28,6 +29,9 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #ifndef SERVER_ONLY
 #include <ft2build.h>
@@ -133,9 +137,15 @@ private:
         unsigned int glyph_index;
     };
 
+    /** Name of this font, used for the glyph cache file. */
+    std::string                  m_name;
+
     /** \ref FaceTTF to load glyph from. */
     FaceTTF*                     m_face_ttf;
 
+    /** Bitmaps of the glyphs rendered for this font, kept on disk. */
+    GlyphCache                   m_glyph_cache;
+
     /** Fallback font to use if some character isn't supported by this font. */
     FontWithFace*                m_fallback_font;
 
@@ -164,7 +174,7 @@ private:
      *  width. */
     float                        m_inverse_shaping;
     /** Store a list of loaded and tested character to a \ref GlyphInfo. */
-    std::map<wchar_t, GlyphInfo> m_character_glyph_info_map;
+    std::unordered_map<wchar_t, GlyphInfo> m_character_glyph_info_map;
 
     // ------------------------------------------------------------------------
     float getCharWidth(const FontArea& area, bool fallback, float scale) const;
@@ -174,7 +184,7 @@ private:
      *  \return True if tested. */
     bool loadedChar(wchar_t c) const
     {
-        std::map<wchar_t, GlyphInfo>::const_iterator n =
+        std::unordered_map<wchar_t, GlyphInfo>::const_iterator n =
             m_character_glyph_info_map.find(c);
         if (n != m_character_glyph_info_map.end())
             return true;
@@ -187,7 +197,7 @@ private:
      *  \return \ref GlyphInfo of this character. */
     const GlyphInfo& getGlyphInfo(wchar_t c) const
     {
-        std::map<wchar_t, GlyphInfo>::const_iterator n =
+        std::unordered_map<wchar_t, GlyphInfo>::const_iterator n =
             m_character_glyph_info_map.find(c);
         // Make sure we always find GlyphInfo
         assert(n != m_character_glyph_info_map.end());
@@ -200,7 +210,7 @@ private:
      *  \return True if it's supported. */
     bool supportChar(wchar_t c)
     {
-        std::map<wchar_t, GlyphInfo>::const_iterator n =
+        std::unordered_map<wchar_t, GlyphInfo>::const_iterator n =
             m_character_glyph_info_map.find(c);
         if (n != m_character_glyph_info_map.end())
         {
@@ -242,7 +252,24 @@ private:
      *  rendering the glyph into bitmap.
      *  \return A FT_Error value if needed. */
     virtual int shapeOutline(FT_Outline* outline) const           { return 0; }
+    // ------------------------------------------------------------------------
+    void rasterizeGlyph(FT_Face face, unsigned glyph_index,
+                        GlyphBitmap* bitmap) const;
+    // ------------------------------------------------------------------------
+    FT_Face openFaceCopy(FT_Library library, unsigned font_number) const;
 #endif
+    // ------------------------------------------------------------------------
+    void rasterizeGlyphs(
+                     const std::vector<std::pair<unsigned, unsigned> >& glyphs,
+                     std::vector<GlyphBitmap>* bitmaps,
+                     unsigned min_parallel = 32);
+    // ------------------------------------------------------------------------
+    void uploadGlyph(const GlyphBitmap& bitmap, unsigned font_number,
+                     unsigned glyph_index);
+    // ------------------------------------------------------------------------
+    uint64_t getGlyphCacheKey() const;
+    // ------------------------------------------------------------------------
+    void loadGlyphCache();
 
 public:
     LEAK_CHECK()
@@ -298,6 +325,11 @@ public:
     // ------------------------------------------------------------------------
     void insertGlyph(unsigned font_number, unsigned glyph_index);
     // ------------------------------------------------------------------------
+    void insertGlyphs(
+                    const std::vector<std::pair<unsigned, unsigned> >& glyphs);
+    // ------------------------------------------------------------------------
+    void benchmarkGlyphs(unsigned count);
+    // ------------------------------------------------------------------------
     int getFontMaxHeight() const                  { return m_font_max_height; }
     // ------------------------------------------------------------------------
     virtual bool disableTextShaping() const                   { return false; }
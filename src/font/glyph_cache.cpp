@@ -0,0 +1,184 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "font/glyph_cache.hpp"
+
+#include "utils/file_utils.hpp"
+#include "utils/log.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+/** Identifies a glyph cache file, the last character is the version. */
+static const char GLYPH_CACHE_MAGIC[8] = { 'S', 'T', 'K', 'G', 'L', 'Y', 'P',
+                                           '1' };
+
+// ----------------------------------------------------------------------------
+/** Writes a value in the native byte order, the cache is only used on the
+ *  machine which wrote it. */
+template<typename T> static bool writeValue(FILE *fp, T value)
+{
+    return fwrite(&value, sizeof(T), 1, fp) == 1;
+}   // writeValue
+
+// ----------------------------------------------------------------------------
+template<typename T> static bool readValue(FILE *fp, T *value)
+{
+    return fread(value, sizeof(T), 1, fp) == 1;
+}   // readValue
+
+// ----------------------------------------------------------------------------
+void GlyphCache::clear()
+{
+    m_glyphs.clear();
+    m_index.clear();
+    m_dirty = false;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Replaces the cached glyphs with the ones in a file. If the file does not
+ *  exist, is damaged or was written with a different key, the cache is
+ *  empty afterwards.
+ *  \param file The cache file, which is also used by save().
+ *  \param key Identifies the font, dpi and settings the glyphs are for.
+ */
+void GlyphCache::load(const std::string &file, uint64_t key)
+{
+    clear();
+    m_file = file;
+    m_key  = key;
+    FILE *fp = FileUtils::fopenU8Path(file, "rb");
+    if (!fp)
+        return;
+
+    char magic[8];
+    uint64_t file_key = 0;
+    uint32_t count = 0;
+    if (fread(magic, 1, 8, fp) != 8 ||
+        memcmp(magic, GLYPH_CACHE_MAGIC, 8) != 0 ||
+        !readValue(fp, &file_key) || file_key != key ||
+        !readValue(fp, &count) || count > MAX_GLYPHS)
+    {
+        fclose(fp);
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t id = 0;
+        uint16_t width = 0, height = 0;
+        uint8_t bytes_per_pixel = 0, has_pixels = 0;
+        int32_t metrics[4];
+        if (!readValue(fp, &id) || !readValue(fp, &width) ||
+            !readValue(fp, &height) || !readValue(fp, &bytes_per_pixel) ||
+            !readValue(fp, &has_pixels) ||
+            fread(metrics, sizeof(int32_t), 4, fp) != 4 ||
+            (bytes_per_pixel != 1 && bytes_per_pixel != 4))
+        {
+            Log::warn("GlyphCache", "Ignoring damaged cache '%s'.",
+                      file.c_str());
+            clear();
+            break;
+        }
+        GlyphBitmap bitmap;
+        bitmap.m_width           = width;
+        bitmap.m_height          = height;
+        bitmap.m_bytes_per_pixel = bytes_per_pixel;
+        bitmap.m_advance_x       = metrics[0];
+        bitmap.m_bearing_x       = metrics[1];
+        bitmap.m_glyph_height    = metrics[2];
+        bitmap.m_offset_y        = metrics[3];
+        if (has_pixels)
+        {
+            bitmap.m_pixels.resize(width * height * bytes_per_pixel);
+            if (fread(bitmap.m_pixels.data(), 1, bitmap.m_pixels.size(), fp)
+                != bitmap.m_pixels.size())
+            {
+                Log::warn("GlyphCache", "Ignoring damaged cache '%s'.",
+                          file.c_str());
+                clear();
+                break;
+            }
+        }
+        m_index[id] = (unsigned)m_glyphs.size();
+        m_glyphs.emplace_back(id, std::move(bitmap));
+    }
+    fclose(fp);
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Writes the cache to its file if glyphs were added. A temporary file is
+ *  written first, so that a crash can not leave a partial cache behind.
+ */
+void GlyphCache::save()
+{
+    if (!m_dirty || m_file.empty())
+        return;
+    m_dirty = false;
+
+    const std::string tmp = m_file + ".part";
+    FILE *fp = FileUtils::fopenU8Path(tmp, "wb");
+    if (!fp)
+    {
+        Log::warn("GlyphCache", "Can't write '%s'.", tmp.c_str());
+        return;
+    }
+    bool ok = fwrite(GLYPH_CACHE_MAGIC, 1, 8, fp) == 8 &&
+              writeValue(fp, m_key) &&
+              writeValue(fp, (uint32_t)m_glyphs.size());
+    for (unsigned i = 0; ok && i < m_glyphs.size(); i++)
+    {
+        const GlyphBitmap &bitmap = m_glyphs[i].second;
+        const int32_t metrics[4] = { bitmap.m_advance_x, bitmap.m_bearing_x,
+                                     bitmap.m_glyph_height,
+                                     bitmap.m_offset_y };
+        ok = writeValue(fp, m_glyphs[i].first) &&
+             writeValue(fp, (uint16_t)bitmap.m_width) &&
+             writeValue(fp, (uint16_t)bitmap.m_height) &&
+             writeValue(fp, (uint8_t)bitmap.m_bytes_per_pixel) &&
+             writeValue(fp, (uint8_t)!bitmap.m_pixels.empty()) &&
+             fwrite(metrics, sizeof(int32_t), 4, fp) == 4 &&
+             fwrite(bitmap.m_pixels.data(), 1, bitmap.m_pixels.size(), fp)
+             == bitmap.m_pixels.size();
+    }
+    if (fclose(fp) != 0)
+        ok = false;
+    // Rename doesn't replace an existing file on all systems
+    remove(FileUtils::getPortableWritingPath(m_file).c_str());
+    if (!ok || FileUtils::renameU8Path(tmp, m_file) != 0)
+    {
+        Log::warn("GlyphCache", "Can't write '%s'.", m_file.c_str());
+        remove(FileUtils::getPortableWritingPath(tmp).c_str());
+    }
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Adds the bitmap of a glyph, unless the cache is full or the glyph is
+ *  too large to be stored.
+ */
+void GlyphCache::add(unsigned font_number, unsigned glyph_index,
+                     const GlyphBitmap &bitmap)
+{
+    const uint64_t id = getId(font_number, glyph_index);
+    if (m_glyphs.size() >= MAX_GLYPHS || bitmap.m_width > 65535 ||
+        bitmap.m_height > 65535 || m_index.find(id) != m_index.end())
+        return;
+    m_index[id] = (unsigned)m_glyphs.size();
+    m_glyphs.emplace_back(id, bitmap);
+    m_dirty = true;
+}   // add
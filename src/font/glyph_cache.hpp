@@ -0,0 +1,119 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_GLYPH_CACHE_HPP
+#define HEADER_GLYPH_CACHE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** A glyph rendered by FreeType, ready to be copied into a glyph page.
+ *  \ingroup font
+ */
+struct GlyphBitmap
+{
+    /** Size of the bitmap in pixels. */
+    unsigned m_width, m_height;
+    /** 1 for an 8 bit coverage bitmap, 4 for a RGBA bitmap (color emoji). */
+    unsigned m_bytes_per_pixel;
+    /** Advance width and left side bearing in pixels. */
+    int m_advance_x, m_bearing_x;
+    /** Height of the glyph and its offset from the baseline in pixels. */
+    int m_glyph_height, m_offset_y;
+    /** The pixels, empty if the glyph has no bitmap (e.g. space). */
+    std::vector<uint8_t> m_pixels;
+    // ------------------------------------------------------------------------
+    GlyphBitmap() : m_width(0), m_height(0), m_bytes_per_pixel(1),
+                    m_advance_x(0), m_bearing_x(0), m_glyph_height(0),
+                    m_offset_y(0) {}
+};   // GlyphBitmap
+
+/**
+ * \brief Stores the bitmaps of the glyphs rendered for a font, so that they
+ *  can be written to disk and used in the next run instead of rendering them
+ *  with FreeType again. A cache file is only used if its key matches, which
+ *  is computed from the font files, dpi and render settings.
+ * \ingroup font
+ */
+class GlyphCache : public NoCopy
+{
+public:
+    /** Maximum number of glyphs stored, so that a cache loaded at startup
+     *  only fills a few glyph pages. */
+    static const unsigned MAX_GLYPHS = 2048;
+
+private:
+    /** Glyphs in the order they were added, so that a loaded cache fills
+     *  the glyph pages in the same way. */
+    std::vector<std::pair<uint64_t, GlyphBitmap> > m_glyphs;
+
+    /** Index in m_glyphs of each glyph. */
+    std::unordered_map<uint64_t, unsigned> m_index;
+
+    /** File the cache is written to. */
+    std::string m_file;
+
+    uint64_t m_key;
+
+    /** True if glyphs were added since the cache was loaded or saved. */
+    bool m_dirty;
+
+    // ------------------------------------------------------------------------
+    static uint64_t getId(unsigned font_number, unsigned glyph_index)
+                   { return ((uint64_t)font_number << 32) | glyph_index; }
+
+public:
+    // ------------------------------------------------------------------------
+    GlyphCache() : m_key(0), m_dirty(false) {}
+    // ------------------------------------------------------------------------
+    void load(const std::string &file, uint64_t key);
+    void save();
+    void clear();
+    void add(unsigned font_number, unsigned glyph_index,
+             const GlyphBitmap &bitmap);
+    // ------------------------------------------------------------------------
+    /** Returns the bitmap of a glyph, or NULL if it is not cached. */
+    const GlyphBitmap* get(unsigned font_number, unsigned glyph_index) const
+    {
+        auto it = m_index.find(getId(font_number, glyph_index));
+        return it == m_index.end() ? NULL : &m_glyphs[it->second].second;
+    }   // get
+    // ------------------------------------------------------------------------
+    /** Calls f(font_number, glyph_index, bitmap) for each cached glyph in
+     *  the order they were added. */
+    template<typename F> void forEach(F f) const
+    {
+        for (const auto &glyph : m_glyphs)
+        {
+            f((unsigned)(glyph.first >> 32),
+              (unsigned)(glyph.first & 0xffffffff), glyph.second);
+        }
+    }   // forEach
+    // ------------------------------------------------------------------------
+    unsigned getNumGlyphs() const        { return (unsigned)m_glyphs.size(); }
+    // ------------------------------------------------------------------------
+    uint64_t getKey() const                                  { return m_key; }
+};   // GlyphCache
+
+#endif
+/* EOF */
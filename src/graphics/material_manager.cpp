@@ -66,6 +66,8 @@ MaterialManager::~MaterialManager()
         delete m_materials[i];
     }
     m_materials.clear();
+    m_full_path_index.clear();
+    m_fname_index.clear();
 
     for (std::map<std::string, Material*> ::iterator it =
          m_default_sp_materials.begin(); it != m_default_sp_materials.end();
@@ -84,6 +86,30 @@ Material* MaterialManager::getMaterialFor(video::ITexture* t,
     return getMaterialFor(t, mb->getMaterial().MaterialType);
 }
 
+//-----------------------------------------------------------------------------
+/** Returns the last added material with the given key in an index, which
+ *  also has the given second layer texture (or neither has one).
+ */
+Material* MaterialManager::findMaterial(
+               const std::unordered_map<std::string, std::vector<int> >& index,
+               const std::string& key, const std::string& lay_two_tex_lc) const
+{
+    auto it = index.find(key);
+    if (it == index.end())
+        return NULL;
+    // Search backward so that temporary (track) textures are found first
+    for (int i = (int)it->second.size() - 1; i >= 0; i--)
+    {
+        Material* m = m_materials[it->second[i]];
+        const std::string& mat_lay_two = m->getUVTwoTexture();
+        if (mat_lay_two.empty() && lay_two_tex_lc.empty())
+            return m;
+        else if (!mat_lay_two.empty() && mat_lay_two == lay_two_tex_lc)
+            return m;
+    }
+    return NULL;
+}   // findMaterial
+
 //-----------------------------------------------------------------------------
 Material* MaterialManager::getMaterialSPM(std::string lay_one_tex_lc,
                                           std::string lay_two_tex_lc,
@@ -99,48 +125,13 @@ Material* MaterialManager::getMaterialSPM(std::string lay_one_tex_lc,
     const bool is_full_path = !lay_one_tex_lc.empty() &&
         (lay_one_tex_lc.find('/') != std::string::npos ||
         lay_one_tex_lc.find('\\') != std::string::npos);
-    if (is_full_path)
+    if (!lay_one_tex_lc.empty())
     {
-        // Search backward so that temporary (track) textures are found first
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFullPath() == lay_one_tex_lc)
-            {
-                const std::string& mat_lay_two = m_materials[i]->getUVTwoTexture();
-                if (mat_lay_two.empty() && lay_two_tex_lc.empty())
-                {
-                    return m_materials[i];
-                }
-                else if (!mat_lay_two.empty() && !lay_two_tex_lc.empty())
-                {
-                    if (mat_lay_two == lay_two_tex_lc)
-                    {
-                        return m_materials[i];
-                    }
-                }
-            }
-        }
-    }
-    else if (!lay_one_tex_lc.empty())
-    {
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFname() == lay_one_tex_lc)
-            {
-                const std::string& mat_lay_two = m_materials[i]->getUVTwoTexture();
-                if (mat_lay_two.empty() && lay_two_tex_lc.empty())
-                {
-                    return m_materials[i];
-                }
-                else if (!mat_lay_two.empty() && !lay_two_tex_lc.empty())
-                {
-                    if (mat_lay_two == lay_two_tex_lc)
-                    {
-                        return m_materials[i];
-                    }
-                }
-            }
-        }   // for i
+        Material* m = findMaterial(is_full_path ? m_full_path_index
+                                                : m_fname_index,
+                                   lay_one_tex_lc, lay_two_tex_lc);
+        if (m)
+            return m;
     }
     return getDefaultSPMaterial(def_shader_name,
         is_full_path ?
@@ -155,27 +146,18 @@ Material* MaterialManager::getMaterialFor(video::ITexture* t)
 
     if (!img_path.empty() && (img_path.findFirst('/') != -1 || img_path.findFirst('\\') != -1))
     {
-        // Search backward so that temporary (track) textures are found first
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFullPath() == img_path.c_str())
-            {
-                return m_materials[i];
-            }
-        }
+        auto it = m_full_path_index.find(img_path.c_str());
+        if (it != m_full_path_index.end())
+            return m_materials[it->second.back()];
     }
     else
     {
         core::stringc image(StringUtils::getBasename(img_path.c_str()).c_str());
         image.make_lower();
 
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFname() == image.c_str())
-            {
-                return m_materials[i];
-            }
-        }   // for i
+        auto it = m_fname_index.find(image.c_str());
+        if (it != m_fname_index.end())
+            return m_materials[it->second.back()];
     }
     return NULL;
 }
@@ -250,10 +232,44 @@ void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb)
 //-----------------------------------------------------------------------------
 int MaterialManager::addEntity(Material *m)
 {
-    m_materials.push_back(m);
+    addMaterial(m);
     return (int)m_materials.size()-1;
 }
 
+//-----------------------------------------------------------------------------
+/** Adds a material to the list of materials and to the lookup indices.
+ */
+void MaterialManager::addMaterial(Material* m)
+{
+    const int index = (int)m_materials.size();
+    m_materials.push_back(m);
+    m_full_path_index[m->getTexFullPath()].push_back(index);
+    // Material::install() reduces the name to its basename, so use that
+    // already now to keep the index valid
+    m_fname_index[StringUtils::getBasename(m->getTexFname())]
+        .push_back(index);
+}   // addMaterial
+
+//-----------------------------------------------------------------------------
+/** Removes the last material from the list and the lookup indices, and
+ *  frees it. Since it has the largest index, it is the last entry in the
+ *  indices.
+ */
+void MaterialManager::removeLastMaterial()
+{
+    Material* m = m_materials.back();
+    auto it = m_full_path_index.find(m->getTexFullPath());
+    it->second.pop_back();
+    if (it->second.empty())
+        m_full_path_index.erase(it);
+    it = m_fname_index.find(StringUtils::getBasename(m->getTexFname()));
+    it->second.pop_back();
+    if (it->second.empty())
+        m_fname_index.erase(it);
+    m_materials.pop_back();
+    delete m;
+}   // removeLastMaterial
+
 //-----------------------------------------------------------------------------
 void MaterialManager::loadMaterial()
 {
@@ -321,7 +337,7 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
         }
         try
         {
-            m_materials.push_back(new Material(node, deprecated));
+            addMaterial(new Material(node, deprecated));
         }
         catch(std::exception& e)
         {
@@ -338,8 +354,7 @@ void MaterialManager::popTempMaterial()
 {
     for(int i=(int)m_materials.size()-1; i>=this->m_shared_material_index; i--)
     {
-        delete m_materials[i];
-        m_materials.pop_back();
+        removeLastMaterial();
     }   // for i6
 }   // popTempMaterial
 
@@ -384,16 +399,15 @@ Material *MaterialManager::getMaterial(const std::string& fname,
     core::stringc basename_lower(basename.c_str());
     basename_lower.make_lower();
 
-    // Search backward so that temporary (track) textures are found first
-    for (int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname() == basename_lower.c_str())
-            return m_materials[i];
-    }
+    // The last material with that name is a temporary (track) texture if
+    // there is one
+    auto it = m_fname_index.find(basename_lower.c_str());
+    if (it != m_fname_index.end())
+        return m_materials[it->second.back()];
 
     // Add the new material
     Material* m = new Material(fname, is_full_path, complain_if_not_found, install);
-    m_materials.push_back(m);
+    addMaterial(m);
     if(make_permanent)
     {
         assert(m_shared_material_index==(int)m_materials.size()-1);
@@ -439,11 +453,5 @@ void MaterialManager::unloadAllTextures()
 bool MaterialManager::hasMaterial(const std::string& fname)
 {
     std::string basename=StringUtils::getBasename(fname);
-
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return true;
-    }
-    return false;
+    return m_fname_index.find(basename) != m_fname_index.end();
 }
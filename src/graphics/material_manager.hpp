@@ -31,6 +31,7 @@ using namespace irr;
 
 #include <irrlicht.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 
@@ -50,8 +51,21 @@ private:
 
     std::vector<Material*> m_materials;
 
+    /** Indices in m_materials of all materials with a given texture full
+     *  path, and with a given (lower case) texture file name. The indices
+     *  are in increasing order, so temporary (track) materials, which are
+     *  added last, are at the end and take precedence. */
+    std::unordered_map<std::string, std::vector<int> > m_full_path_index,
+                                                       m_fname_index;
+
     std::map<std::string, Material*> m_default_sp_materials;
 
+    void      addMaterial(Material* m);
+    void      removeLastMaterial();
+    Material* findMaterial(
+              const std::unordered_map<std::string, std::vector<int> >& index,
+              const std::string& key, const std::string& lay_two_tex_lc) const;
+
 public:
               MaterialManager();
              ~MaterialManager();
@@ -34,6 +34,7 @@
 #include "graphics/skybox.hpp"
 #include "graphics/spherical_harmonics.hpp"
 #include "graphics/sp/sp_base.hpp"
+#include "graphics/sp/sp_mesh_node.hpp"
 #include "graphics/sp/sp_shader.hpp"
 #include "graphics/texture_shader.hpp"
 #include "graphics/text_billboard_drawer.hpp"
@@ -721,8 +722,10 @@ void ShaderBasedRenderer::render(float dt, bool is_loading)
 
     {
         PROFILER_PUSH_CPU_MARKER("Update scene", 0x0, 0xFF, 0x0);
+        const u32 time_ms = os::Timer::getTime();
+        SP::SPMeshNode::prepareSkinning(time_ms);
         static_cast<scene::CSceneManager *>(irr_driver->getSceneManager())
-            ->OnAnimate(os::Timer::getTime());
+            ->OnAnimate(time_ms);
         PROFILER_POP_CPU_MARKER();
     }
 
@@ -736,8 +739,8 @@ void ShaderBasedRenderer::render(float dt, bool is_loading)
 
         std::ostringstream oss;
         oss << "drawAll() for kart " << cam;
-        PROFILER_PUSH_CPU_MARKER(oss.str().c_str(), (cam+1)*60,
-                                 0x00, 0x00);
+        PROFILER_PUSH_DYNAMIC_CPU_MARKER(oss.str().c_str(), (cam+1)*60,
+                                         0x00, 0x00);
         camera->activate(!CVS->isDeferredEnabled());
         rg->preRenderCallback(camera);   // adjusts start referee
         irr_driver->getSceneManager()->setActiveCamera(camnode);
@@ -793,7 +796,7 @@ void ShaderBasedRenderer::render(float dt, bool is_loading)
         std::ostringstream oss;
         oss << "renderPlayerView() for kart " << i;
 
-        PROFILER_PUSH_CPU_MARKER(oss.str().c_str(), 0x00, 0x00, (i+1)*60);
+        PROFILER_PUSH_DYNAMIC_CPU_MARKER(oss.str().c_str(), 0x00, 0x00, (i+1)*60);
         rg->renderPlayerView(camera, dt);
 
         PROFILER_POP_CPU_MARKER();
@@ -25,15 +25,52 @@
 #include <matrix4.h>
 #include <quaternion.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <vector>
 #include <string>
 
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SP_ANIMATION_SSE
+#endif
+
 using namespace irr;
 
 namespace SP
 {
+// ----------------------------------------------------------------------------
+/** out = a * b for column-major 4x4 matrices (same as core::matrix4
+ *  operator*), out must not overlap with a or b. */
+inline void multiplyMatrix4(const float* a, const float* b, float* out)
+{
+#ifdef SP_ANIMATION_SSE
+    const __m128 a0 = _mm_loadu_ps(a);
+    const __m128 a1 = _mm_loadu_ps(a + 4);
+    const __m128 a2 = _mm_loadu_ps(a + 8);
+    const __m128 a3 = _mm_loadu_ps(a + 12);
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 col = _mm_mul_ps(a0, _mm_set1_ps(b[i]));
+        col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(b[i + 1])));
+        col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(b[i + 2])));
+        col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(b[i + 3])));
+        _mm_storeu_ps(out + i, col);
+    }
+#else
+    for (int i = 0; i < 16; i += 4)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            out[i + j] = a[j] * b[i] + a[4 + j] * b[i + 1] +
+                a[8 + j] * b[i + 2] + a[12 + j] * b[i + 3];
+        }
+    }
+#endif
+}   // multiplyMatrix4
 
 struct LocRotScale
 {
@@ -45,11 +82,26 @@ struct LocRotScale
     // ------------------------------------------------------------------------
     inline core::matrix4 toMatrix() const
     {
-        core::matrix4 lm, sm, rm;
-        lm.setTranslation(m_loc);
-        sm.setScale(m_scale);
-        m_rot.getMatrix(rm);
-        return lm * rm * sm;
+        core::matrix4 m;
+        toMatrix(&m);
+        return m;
+    }
+    // ------------------------------------------------------------------------
+    /** Same as translation * rotation * scale, without the two matrix
+     *  multiplications. */
+    inline void toMatrix(core::matrix4* out) const
+    {
+        m_rot.getMatrix(*out);
+        float* m = out->pointer();
+        for (int i = 0; i < 3; i++)
+        {
+            m[i] *= m_scale.X;
+            m[4 + i] *= m_scale.Y;
+            m[8 + i] *= m_scale.Z;
+        }
+        m[12] = m_loc.X;
+        m[13] = m_loc.Y;
+        m[14] = m_loc.Z;
     }
     // ------------------------------------------------------------------------
     void read(irr::io::IReadFile* spm)
@@ -169,54 +221,99 @@ struct Armature
         }
     }
     // ------------------------------------------------------------------------
+    /** Thread-safe version of getPose, which uses caller provided buffers
+     *  instead of the armature members, so the same armature can be posed
+     *  at different frames in parallel. All buffers need space for
+     *  m_joint_names.size() elements, world will contain the world matrix
+     *  of each joint afterwards.
+     */
+    void getPose(float frame, std::array<float, 16>* dest,
+                 core::matrix4* interpolated, core::matrix4* world,
+                 char* world_done) const
+    {
+        getInterpolatedMatrices(frame, interpolated);
+        const unsigned all_joints_size = (unsigned)m_joint_names.size();
+        memset(world_done, 0, all_joints_size);
+        for (unsigned i = 0; i < all_joints_size; i++)
+        {
+            getWorldMatrix(interpolated, world, world_done, i);
+        }
+        for (unsigned i = 0; i < m_joint_used; i++)
+        {
+            multiplyMatrix4(world[i].pointer(), m_joint_matrices[i].pointer(),
+                dest[i].data());
+        }
+    }
+    // ------------------------------------------------------------------------
     void getInterpolatedMatrices(float frame)
     {
+        getInterpolatedMatrices(frame, m_interpolated_matrices.data());
+    }
+    // ------------------------------------------------------------------------
+    void getInterpolatedMatrices(float frame, core::matrix4* out) const
+    {
+        const unsigned all_joints_size = (unsigned)m_joint_names.size();
         if (frame < float(m_frame_pose_matrices.front().first) ||
             frame >= float(m_frame_pose_matrices.back().first))
         {
-            for (unsigned i = 0; i < m_interpolated_matrices.size(); i++)
+            const std::vector<LocRotScale>& pose =
+                frame >= float(m_frame_pose_matrices.back().first) ?
+                m_frame_pose_matrices.back().second :
+                m_frame_pose_matrices.front().second;
+            for (unsigned i = 0; i < all_joints_size; i++)
             {
-                m_interpolated_matrices[i] =
-                    frame >= float(m_frame_pose_matrices.back().first) ?
-                    m_frame_pose_matrices.back().second[i].toMatrix() :
-                    m_frame_pose_matrices.front().second[i].toMatrix();
+                pose[i].toMatrix(&out[i]);
             }
             return;
         }
-        int frame_1 = -1;
-        int frame_2 = -1;
-        float interpolation = 0.0f;
-        for (unsigned i = 0; i < m_frame_pose_matrices.size(); i++)
-        {
-            assert(i + 1 < m_frame_pose_matrices.size());
-            if (frame >= float(m_frame_pose_matrices[i].first) &&
-                frame < float(m_frame_pose_matrices[i + 1].first))
+        // Find the first key frame after frame, there is always one before
+        auto it = std::upper_bound(m_frame_pose_matrices.begin(),
+            m_frame_pose_matrices.end(), frame,
+            [](float f, const std::pair<int, std::vector<LocRotScale> >& p)
             {
-                frame_1 = i;
-                frame_2 = i + 1;
-                interpolation =
-                    (frame - float(m_frame_pose_matrices[i].first)) /
-                    float(m_frame_pose_matrices[i + 1].first -
-                    m_frame_pose_matrices[i].first);
-                break;
-            }
-        }
-        assert(frame_1 != -1);
-        assert(frame_2 != -1);
-        for (unsigned i = 0; i < m_interpolated_matrices.size(); i++)
+                return f < float(p.first);
+            });
+        assert(it != m_frame_pose_matrices.begin() &&
+            it != m_frame_pose_matrices.end());
+        const auto& frame_1 = *(it - 1);
+        const auto& frame_2 = *it;
+        const float interpolation = (frame - float(frame_1.first)) /
+            float(frame_2.first - frame_1.first);
+        for (unsigned i = 0; i < all_joints_size; i++)
         {
             LocRotScale interpolated;
-            interpolated.m_loc =
-                m_frame_pose_matrices[frame_2].second[i].m_loc.getInterpolated
-                (m_frame_pose_matrices[frame_1].second[i].m_loc, interpolation);
-            interpolated.m_rot.slerp
-                (m_frame_pose_matrices[frame_1].second[i].m_rot,
-                m_frame_pose_matrices[frame_2].second[i].m_rot, interpolation);
-            interpolated.m_scale =
-                m_frame_pose_matrices[frame_2].second[i].m_scale.getInterpolated
-                (m_frame_pose_matrices[frame_1].second[i].m_scale, interpolation);
-            m_interpolated_matrices[i] = interpolated.toMatrix();
+            interpolated.m_loc = frame_2.second[i].m_loc.getInterpolated
+                (frame_1.second[i].m_loc, interpolation);
+            interpolated.m_rot.slerp(frame_1.second[i].m_rot,
+                frame_2.second[i].m_rot, interpolation);
+            interpolated.m_scale = frame_2.second[i].m_scale.getInterpolated
+                (frame_1.second[i].m_scale, interpolation);
+            interpolated.toMatrix(&out[i]);
+        }
+    }
+    // ------------------------------------------------------------------------
+    const core::matrix4& getWorldMatrix(const core::matrix4* interpolated,
+                                        core::matrix4* world, char* done,
+                                        unsigned id) const
+    {
+        if (done[id])
+        {
+            return world[id];
+        }
+        const int parent_id = m_parent_infos[id];
+        if (parent_id == -1)
+        {
+            world[id] = interpolated[id];
+        }
+        else
+        {
+            const core::matrix4& parent =
+                getWorldMatrix(interpolated, world, done, parent_id);
+            multiplyMatrix4(parent.pointer(), interpolated[id].pointer(),
+                world[id].pointer());
         }
+        done[id] = 1;
+        return world[id];
     }
     // ------------------------------------------------------------------------
     core::matrix4 getWorldMatrix(const std::vector<core::matrix4>& matrix,
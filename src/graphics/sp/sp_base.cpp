@@ -592,6 +592,7 @@ void init()
 void destroy()
 {
     g_dy_dc.clear();
+    SPMeshNode::destroySkinningThreads();
     SPTextureManager::get()->stopThreads();
     SPShaderManager::destroy();
     g_glow_shader = NULL;
@@ -1315,7 +1316,7 @@ void draw(RenderPass rp, DrawCallType dct)
 {
     std::stringstream profiler_name;
     profiler_name << "SP::Draw " << dct << " with " << rp;
-    PROFILER_PUSH_CPU_MARKER(profiler_name.str().c_str(),
+    PROFILER_PUSH_DYNAMIC_CPU_MARKER(profiler_name.str().c_str(),
         (uint8_t)(float(dct + rp + 2) / float(DCT_FOR_VAO + RP_COUNT) * 255.0f),
         (uint8_t)(float(dct + 1) / (float)DCT_FOR_VAO * 255.0f) ,
         (uint8_t)(float(rp + 1) / (float)RP_COUNT * 255.0f));
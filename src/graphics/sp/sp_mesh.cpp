@@ -130,6 +130,28 @@ void SPMesh::getSkinningMatrices(f32 frame, std::array<float, 16>* dest)
 
 }   // getSkinningMatrices
 
+// ----------------------------------------------------------------------------
+/** Thread-safe version of getSkinningMatrices, see Armature::getPose. All
+ *  buffers except dest need space for getTotalJoints() elements.
+ */
+void SPMesh::getSkinningMatrices(f32 frame, std::array<float, 16>* dest,
+                                 core::matrix4* world_matrices,
+                                 core::matrix4* interpolated,
+                                 char* world_done) const
+{
+    unsigned accumulated_joints = 0;
+    unsigned accumulated_all_joints = 0;
+    for (const Armature& arm : m_all_armatures)
+    {
+        arm.getPose(frame, &dest[accumulated_joints],
+            &interpolated[accumulated_all_joints],
+            &world_matrices[accumulated_all_joints],
+            &world_done[accumulated_all_joints]);
+        accumulated_joints += arm.m_joint_used;
+        accumulated_all_joints += (unsigned)arm.m_joint_names.size();
+    }
+}   // getSkinningMatrices
+
 // ----------------------------------------------------------------------------
 void SPMesh::updateBoundingBox()
 {
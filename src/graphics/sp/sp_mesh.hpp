@@ -154,6 +154,15 @@ public:
     // ------------------------------------------------------------------------
     void getSkinningMatrices(f32 frame, std::array<float, 16>* dest);
     // ------------------------------------------------------------------------
+    void getSkinningMatrices(f32 frame, std::array<float, 16>* dest,
+                             core::matrix4* world_matrices,
+                             core::matrix4* interpolated,
+                             char* world_done) const;
+    // ------------------------------------------------------------------------
+    /** Returns the number of joints in all armatures, including the ones not
+     *  used for skinning (which can still have joint nodes attached). */
+    unsigned getTotalJoints() const                 { return m_total_joints; }
+    // ------------------------------------------------------------------------
     s32 getJointIDWithArm(const c8* name, unsigned* arm_id) const;
     // ------------------------------------------------------------------------
     void addSPMeshBuffer(SPMeshBuffer* spmb)      { m_buffer.push_back(spmb); }
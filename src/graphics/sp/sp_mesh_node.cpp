@@ -26,12 +26,131 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/material.hpp"
 #include "graphics/render_info.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
 
 #include "../../../lib/irrlicht/source/Irrlicht/CBoneSceneNode.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace SP
 {
+namespace
+{
+// ----------------------------------------------------------------------------
+/** Small pool of threads which evaluates the skinning jobs of a frame
+ *  together with the main thread. */
+class SkinningThreads
+{
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+
+    std::condition_variable m_start_cv, m_done_cv;
+
+    std::function<void(unsigned)> m_job;
+
+    std::atomic_uint m_next_job;
+
+    unsigned m_job_count, m_busy_threads, m_generation;
+
+    bool m_quit;
+
+    // ------------------------------------------------------------------------
+    void runJobs()
+    {
+        unsigned i;
+        while ((i = m_next_job.fetch_add(1)) < m_job_count)
+        {
+            m_job(i);
+        }
+    }
+
+public:
+    // ------------------------------------------------------------------------
+    SkinningThreads()
+        : m_next_job(0), m_job_count(0), m_busy_threads(0), m_generation(0),
+          m_quit(false)
+    {
+        unsigned count = std::thread::hardware_concurrency();
+        count = count < 2 ? 0 : std::min(count - 1, 3u);
+        for (unsigned i = 0; i < count; i++)
+        {
+            m_threads.emplace_back([this, i]()->void
+            {
+                VS::setThreadName((StringUtils::toString(i) + "SPSkin")
+                    .c_str());
+                unsigned generation = 0;
+                while (true)
+                {
+                    std::unique_lock<std::mutex> ul(m_mutex);
+                    m_start_cv.wait(ul, [this, &generation]
+                        {
+                            return m_quit || m_generation != generation;
+                        });
+                    if (m_quit)
+                    {
+                        return;
+                    }
+                    generation = m_generation;
+                    ul.unlock();
+                    runJobs();
+                    ul.lock();
+                    if (--m_busy_threads == 0)
+                    {
+                        m_done_cv.notify_one();
+                    }
+                }
+            });
+        }
+    }
+    // ------------------------------------------------------------------------
+    ~SkinningThreads()
+    {
+        std::unique_lock<std::mutex> ul(m_mutex);
+        m_quit = true;
+        m_start_cv.notify_all();
+        ul.unlock();
+        for (std::thread& t : m_threads)
+        {
+            t.join();
+        }
+    }
+    // ------------------------------------------------------------------------
+    /** Calls job(i) for i in [0, job_count) and returns when all are done. */
+    void run(unsigned job_count, const std::function<void(unsigned)>& job)
+    {
+        m_job = job;
+        m_job_count = job_count;
+        m_next_job.store(0);
+        if (m_threads.empty() || job_count < 2)
+        {
+            runJobs();
+            return;
+        }
+        std::unique_lock<std::mutex> ul(m_mutex);
+        m_busy_threads = (unsigned)m_threads.size();
+        m_generation++;
+        m_start_cv.notify_all();
+        ul.unlock();
+        runJobs();
+        ul.lock();
+        m_done_cv.wait(ul, [this] { return m_busy_threads == 0; });
+    }
+};   // SkinningThreads
+
+SkinningThreads* g_skinning_threads = NULL;
+
+// Animated nodes which called OnAnimate in the current frame
+std::vector<SPMeshNode*> g_animated_nodes;
+}
+
 // ----------------------------------------------------------------------------
 SPMeshNode::SPMeshNode(IAnimatedMesh* mesh, ISceneNode* parent,
                        ISceneManager* mgr, s32 id,
@@ -49,11 +168,18 @@ SPMeshNode::SPMeshNode(IAnimatedMesh* mesh, ISceneNode* parent,
     m_animated = false;
     m_skinning_offset = -32768;
     m_is_in_shadowpass = true;
+    m_skinning_prepared_time = 0;
+    m_in_animated_list = false;
 }   // SPMeshNode
 
 // ----------------------------------------------------------------------------
 SPMeshNode::~SPMeshNode()
 {
+    if (m_in_animated_list)
+    {
+        g_animated_nodes.erase(std::remove(g_animated_nodes.begin(),
+            g_animated_nodes.end(), this), g_animated_nodes.end());
+    }
     cleanJoints();
     cleanRenderInfo();
 }   // ~SPMeshNode
@@ -101,6 +227,9 @@ void SPMeshNode::setMesh(irr::scene::IAnimatedMesh* mesh)
 #endif
             unsigned bone_idx = 0;
             m_skinning_matrices.resize(m_mesh->getJointCount());
+            m_joint_world_matrices.resize(m_mesh->getTotalJoints());
+            m_interpolated_matrices.resize(m_mesh->getTotalJoints());
+            m_world_done.resize(m_mesh->getTotalJoints());
             for (Armature& arm : m_mesh->getArmatures())
             {
                 for (const std::string& bone_name : arm.m_joint_names)
@@ -112,6 +241,14 @@ void SPMeshNode::setMesh(irr::scene::IAnimatedMesh* mesh)
                     m_joint_nodes.at(bone_name)->setSkinningSpace(EBSS_GLOBAL);
                 }
             }
+            for (Armature& arm : m_mesh->getArmatures())
+            {
+                for (const std::string& bone_name : arm.m_joint_names)
+                {
+                    m_ordered_joint_nodes.push_back
+                        (m_joint_nodes.at(bone_name));
+                }
+            }
         }
         if (m_first_render_info)
         {
@@ -157,27 +294,115 @@ void SPMeshNode::OnAnimate(u32 time_ms)
         IAnimatedMeshSceneNode::OnAnimate(time_ms);
         return;
     }
-    CAnimatedMeshSceneNode::OnAnimate(time_ms);
+    if (!m_in_animated_list)
+    {
+        m_in_animated_list = true;
+        g_animated_nodes.push_back(this);
+    }
+    if (m_skinning_prepared_time == 0 || m_skinning_prepared_time != time_ms)
+    {
+        m_skinning_prepared_time = 0;
+        CAnimatedMeshSceneNode::OnAnimate(time_ms);
+        return;
+    }
+
+    // The frame number and skinning matrices were already computed in
+    // prepareSkinning, do the rest of CAnimatedMeshSceneNode::OnAnimate
+    m_skinning_prepared_time = 0;
+    updateJointNodes();
+    Box = m_mesh->getBoundingBox();
+    IAnimatedMeshSceneNode::OnAnimate(time_ms);
+    for (u32 n = 0; n < JointChildSceneNodes.size(); ++n)
+        JointChildSceneNodes[n]->recursiveUpdateAbsolutePosition();
 }   // OnAnimate
 
 // ----------------------------------------------------------------------------
-IMesh* SPMeshNode::getMeshForCurrentFrame()
+/** Advances the animation of all nodes animated in the last frame and
+ *  computes their skinning matrices in parallel, before the scene is
+ *  animated. Nodes using the same mesh at the same frame (like idle karts)
+ *  are only computed once. Nodes which were not animated in the last frame
+ *  are skinned as usual in OnAnimate.
+ *  \param time_ms Time which will be passed to OnAnimate in this frame.
+ */
+void SPMeshNode::prepareSkinning(u32 time_ms)
 {
-    if (m_mesh->isStatic() || !m_animated)
+    std::vector<SPMeshNode*> nodes;
+    std::swap(nodes, g_animated_nodes);
+    std::vector<SPMeshNode*> jobs;
+    std::vector<std::pair<SPMeshNode*, SPMeshNode*> > copies;
+    std::map<std::pair<SPMesh*, float>, SPMeshNode*> unique_states;
+    for (SPMeshNode* node : nodes)
     {
-        return m_mesh;
+        node->m_in_animated_list = false;
+        if (time_ms == 0 || !node->m_mesh || node->m_mesh->isStatic() ||
+            !node->m_animated || node->LastTimeMs == 0)
+        {
+            continue;
+        }
+        node->buildFrameNr(time_ms - node->LastTimeMs);
+        node->LastTimeMs = time_ms;
+        node->m_skinning_prepared_time = time_ms;
+        auto ret = unique_states.emplace(
+            std::make_pair(node->m_mesh, node->getFrameNr()), node);
+        if (ret.second)
+            jobs.push_back(node);
+        else
+            copies.emplace_back(node, ret.first->second);
+    }
+    if (jobs.empty())
+    {
+        return;
+    }
+
+    if (g_skinning_threads == NULL)
+    {
+        g_skinning_threads = new SkinningThreads();
+    }
+    g_skinning_threads->run((unsigned)jobs.size(),
+        [&jobs](unsigned i) { jobs[i]->computeSkinning(); });
+
+    for (auto& p : copies)
+    {
+        p.first->m_skinning_matrices = p.second->m_skinning_matrices;
+        p.first->m_joint_world_matrices = p.second->m_joint_world_matrices;
     }
-    m_mesh->getSkinningMatrices(getFrameNr(), m_skinning_matrices.data());
+}   // prepareSkinning
+
+// ----------------------------------------------------------------------------
+void SPMeshNode::destroySkinningThreads()
+{
+    delete g_skinning_threads;
+    g_skinning_threads = NULL;
+}   // destroySkinningThreads
+
+// ----------------------------------------------------------------------------
+void SPMeshNode::computeSkinning()
+{
+    m_mesh->getSkinningMatrices(getFrameNr(), m_skinning_matrices.data(),
+        m_joint_world_matrices.data(), m_interpolated_matrices.data(),
+        m_world_done.data());
+}   // computeSkinning
+
+// ----------------------------------------------------------------------------
+void SPMeshNode::updateJointNodes()
+{
     updateAbsolutePosition();
+    for (unsigned i = 0; i < m_ordered_joint_nodes.size(); i++)
+    {
+        m_ordered_joint_nodes[i]->setAbsoluteTransformation
+            (AbsoluteTransformation * m_joint_world_matrices[i]);
+    }
+}   // updateJointNodes
 
-    for (Armature& arm : m_mesh->getArmatures())
+// ----------------------------------------------------------------------------
+IMesh* SPMeshNode::getMeshForCurrentFrame()
+{
+    if (m_mesh->isStatic() || !m_animated)
     {
-        for (unsigned i = 0; i < arm.m_joint_names.size(); i++)
-        {
-            m_joint_nodes.at(arm.m_joint_names[i])->setAbsoluteTransformation
-                (AbsoluteTransformation * arm.m_world_matrices[i].first);
-        }
+        return m_mesh;
     }
+    computeSkinning();
+    updateJointNodes();
     return m_mesh;
 }   // getMeshForCurrentFrame
 
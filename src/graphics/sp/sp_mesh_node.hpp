@@ -44,6 +44,9 @@ private:
 
     std::unordered_map<std::string, IBoneSceneNode*> m_joint_nodes;
 
+    /** Joint nodes in the order of the joints in all armatures. */
+    std::vector<IBoneSceneNode*> m_ordered_joint_nodes;
+
     SPMesh* m_mesh;
 
     int m_skinning_offset;
@@ -54,6 +57,21 @@ private:
 
     std::vector<std::array<float, 16> > m_skinning_matrices;
 
+    /** World matrix of each joint (used for joint nodes) and scratch buffers
+     *  for skinning, so that nodes can be skinned in parallel. */
+    std::vector<core::matrix4> m_joint_world_matrices;
+
+    std::vector<core::matrix4> m_interpolated_matrices;
+
+    std::vector<char> m_world_done;
+
+    /** Time of the frame for which prepareSkinning already computed the
+     *  animation frame and skinning matrices, 0 if none. */
+    u32 m_skinning_prepared_time;
+
+    /** True if this node is in the list of nodes animated in this frame. */
+    bool m_in_animated_list;
+
     video::SColorf m_glow_color;
 
     std::vector<std::array<float, 2> > m_texture_matrices;
@@ -68,8 +86,17 @@ private:
             removeChild(p.second);
         }
         m_joint_nodes.clear();
+        m_ordered_joint_nodes.clear();
         m_skinning_matrices.clear();
+        m_joint_world_matrices.clear();
+        m_interpolated_matrices.clear();
+        m_world_done.clear();
+        m_skinning_prepared_time = 0;
     }
+    // ------------------------------------------------------------------------
+    void computeSkinning();
+    // ------------------------------------------------------------------------
+    void updateJointNodes();
 
 public:
     // ------------------------------------------------------------------------
@@ -82,6 +109,10 @@ public:
     // ------------------------------------------------------------------------
     ~SPMeshNode();
     // ------------------------------------------------------------------------
+    static void prepareSkinning(u32 time_ms);
+    // ------------------------------------------------------------------------
+    static void destroySkinningThreads();
+    // ------------------------------------------------------------------------
     virtual void render() {}
     // ------------------------------------------------------------------------
     virtual void setMesh(irr::scene::IAnimatedMesh* mesh);
@@ -26,6 +26,7 @@
 #include "graphics/central_settings.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
@@ -44,10 +45,13 @@ extern "C"
 }
 #endif
 
+#include <algorithm>
 #include <numeric>
+#include <sstream>
+#include <thread>
 
 #if !defined(MOBILE_STK)
-static const uint8_t CACHE_VERSION = 1;
+static const uint8_t CACHE_VERSION = 2;
 #endif
 
 namespace SP
@@ -86,8 +90,9 @@ SPTexture::SPTexture(const std::string& path, Material* m, bool undo_srgb,
     }
 #endif
 
-    m_cache_directory = file_manager->getCachedTexturesDir() +
-        cache_subdir + "/" + container_id;
+    // Cached textures are keyed by content hash, so identical textures used
+    // by different karts or tracks share one cache file
+    m_cache_directory = file_manager->getCachedTexturesDir() + cache_subdir;
     file_manager->checkAndCreateDirectoryP(m_cache_directory);
 
 #endif
@@ -329,20 +334,26 @@ bool SPTexture::texImage2d(std::shared_ptr<video::IImage> texture,
 bool SPTexture::saveCompressedTexture(std::shared_ptr<video::IImage> texture,
                                       const std::vector<std::pair
                                       <core::dimension2du, unsigned> >& sizes,
-                                      const std::string& cache_location)
+                                      const std::string& cache_location,
+                                      uint64_t cache_key)
 {
 #if !defined(SERVER_ONLY) && !defined(MOBILE_STK)
     const unsigned total_size = std::accumulate(sizes.begin(), sizes.end(), 0,
         [] (const unsigned int previous, const std::pair
         <core::dimension2du, unsigned>& cur_sizes)
        { return previous + cur_sizes.second; });
-    io::IWriteFile* file = irr::io::createWriteFile(cache_location.c_str(),
-        false);
+    // The same texture can be compressed by two threads at the same time,
+    // so write to a temporary file first and rename it when complete
+    std::ostringstream tmp_location;
+    tmp_location << cache_location << "." << std::this_thread::get_id();
+    io::IWriteFile* file = irr::io::createWriteFile(
+        tmp_location.str().c_str(), false);
     if (file == NULL)
     {
         return true;
     }
     file->write(&CACHE_VERSION, 1);
+    file->write(&cache_key, 8);
     const unsigned mm_sizes = (unsigned)sizes.size();
     file->write(&mm_sizes, 4);
     for (auto& p : sizes)
@@ -353,13 +364,54 @@ bool SPTexture::saveCompressedTexture(std::shared_ptr<video::IImage> texture,
     }
     file->write(texture->lock(), total_size);
     file->drop();
+    if (FileUtils::renameU8Path(tmp_location.str(), cache_location) != 0)
+    {
+        file_manager->removeFile(tmp_location.str());
+    }
 #endif
     return true;
 }   // saveCompressedTexture
 
 // ----------------------------------------------------------------------------
-bool SPTexture::useTextureCache(const std::string& full_path,
-                                std::string* cache_loc)
+/** Returns a hash of everything which affects the compressed texture: the
+ *  content of the image and its masks, and the compression settings.
+ */
+uint64_t SPTexture::getCacheKey() const
+{
+    uint64_t key = 0;
+#ifndef SERVER_ONLY
+    SPTextureManager* sptm = SPTextureManager::get();
+    key = StringUtils::fnv1a64(&CACHE_VERSION, 1);
+    uint64_t file_hash = sptm->getFileContentHash(m_path);
+    key = StringUtils::fnv1a64(&file_hash, 8, key);
+    key = StringUtils::fnv1a64(&stk_config->m_tc_quality,
+        sizeof(stk_config->m_tc_quality), key);
+    const uint8_t undo_srgb = m_undo_srgb &&
+        !CVS->isEXTTextureCompressionS3TCSRGBUsable() ? 1 : 0;
+    key = StringUtils::fnv1a64(&undo_srgb, 1, key);
+    if (m_material)
+    {
+        key = StringUtils::fnv1a64(m_material->getShaderName(), key);
+        const float factor = m_material->getColorizationFactor();
+        key = StringUtils::fnv1a64(&factor, sizeof(factor), key);
+        const uint8_t colorizable = m_material->isColorizable() ? 1 : 0;
+        key = StringUtils::fnv1a64(&colorizable, 1, key);
+        const std::string dir = StringUtils::getPath(m_path) + "/";
+        for (const std::string& mask : { m_material->getColorizationMask(),
+            m_material->getAlphaMask() })
+        {
+            if (mask.empty())
+                continue;
+            file_hash = sptm->getFileContentHash(dir + mask);
+            key = StringUtils::fnv1a64(&file_hash, 8, key);
+        }
+    }
+#endif
+    return key;
+}   // getCacheKey
+
+// ----------------------------------------------------------------------------
+bool SPTexture::useTextureCache(uint64_t* cache_key, std::string* cache_loc)
 {
 #ifndef SERVER_ONLY
     if (!CVS->isTextureCompressionEnabled() || m_cache_directory.empty())
@@ -367,32 +419,21 @@ bool SPTexture::useTextureCache(const std::string& full_path,
         return false;
     }
 
-    std::string basename = StringUtils::getBasename(m_path);
-    *cache_loc = m_cache_directory + "/" + basename + ".sptz";
-
-    if (file_manager->fileExists(*cache_loc) &&
-        file_manager->fileIsNewer(*cache_loc, m_path))
-    {
-        if (m_material && (!m_material->getColorizationMask().empty() ||
-            m_material->getAlphaMask().empty()))
-        {
-            std::string mask_path = StringUtils::getPath(m_path) + "/" +
-                (!m_material->getColorizationMask().empty() ?
-                m_material->getColorizationMask() :
-                m_material->getAlphaMask());
-            if (!file_manager->fileIsNewer(*cache_loc, mask_path))
-            {
-                return false;
-            }
-        }
-        return true;
-    }
+    *cache_key = getCacheKey();
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.sptz",
+        (unsigned long long)*cache_key);
+    *cache_loc = m_cache_directory + name;
+    SPTextureManager::get()->setCacheFile(m_path, m_cache_directory.substr(
+        file_manager->getCachedTexturesDir().size()) + name);
+    return file_manager->fileExists(*cache_loc);
 #endif
     return false;
 }   // useTextureCache
 
 // ----------------------------------------------------------------------------
 std::shared_ptr<video::IImage> SPTexture::getTextureCache(const std::string& p,
+    uint64_t cache_key,
     std::vector<std::pair<core::dimension2du, unsigned> >* sizes)
 {
     std::shared_ptr<video::IImage> cache;
@@ -404,9 +445,11 @@ std::shared_ptr<video::IImage> SPTexture::getTextureCache(const std::string& p,
     }
 
     uint8_t cache_version;
-    file->read(&cache_version, 1);
-    if (cache_version != CACHE_VERSION)
+    uint64_t stored_key = 0;
+    if (file->read(&cache_version, 1) != 1 || cache_version != CACHE_VERSION ||
+        file->read(&stored_key, 8) != 8 || stored_key != cache_key)
     {
+        file->drop();
         return cache;
     }
 
@@ -438,11 +481,12 @@ bool SPTexture::threadedLoad()
 {
 #ifndef SERVER_ONLY
     std::string cache_loc;
-    if (useTextureCache(m_path, &cache_loc))
+    uint64_t cache_key = 0;
+    if (useTextureCache(&cache_key, &cache_loc))
     {
         std::vector<std::pair<core::dimension2du, unsigned> > sizes;
         std::shared_ptr<video::IImage> cache = getTextureCache(cache_loc,
-            &sizes);
+            cache_key, &sizes);
         if (cache)
         {
             SPTextureManager::get()->increaseGLCommandFunctionCount(1);
@@ -478,9 +522,10 @@ bool SPTexture::threadedLoad()
         if (!cache_loc.empty())
         {
             SPTextureManager::get()->addThreadedFunction(
-                [this, image, r, cache_loc]()->bool
+                [image, r, cache_loc, cache_key]()->bool
                 {
-                    return saveCompressedTexture(image, r, cache_loc);
+                    return saveCompressedTexture(image, r, cache_loc,
+                        cache_key);
                 });
         }
     }
@@ -713,14 +758,15 @@ void SPTexture::generateHQMipmap(void* in,
 }   // generateHQMipmap
 
 // ----------------------------------------------------------------------------
-void SPTexture::squishCompressImage(uint8_t* rgba, int width, int height,
-                                    int pitch, void* blocks, unsigned flags)
+void SPTexture::squishCompressBlockRows(uint8_t* rgba, int width, int height,
+                                        int pitch, void* blocks,
+                                        unsigned flags, int y_start, int y_end)
 {
 #if !(defined(SERVER_ONLY) || defined(MOBILE_STK))
     // This function is copied from CompressImage in libsquish to avoid omp
     // if enabled by shared libsquish, because we are already using
     // multiple thread
-    for (int y = 0; y < height; y += 4)
+    for (int y = y_start; y < y_end; y += 4)
     {
         // initialise the block output
         uint8_t* target_block = reinterpret_cast<uint8_t*>(blocks);
@@ -758,6 +804,69 @@ void SPTexture::squishCompressImage(uint8_t* rgba, int width, int height,
         }
     }
 #endif
+}   // squishCompressBlockRows
+
+// ----------------------------------------------------------------------------
+/** Compresses an image with libsquish. Large images are split into stripes
+ *  of block rows. Helper jobs for the stripes are queued in the texture
+ *  loading threads, so idle loading threads can help with a big texture
+ *  without creating more threads than cores. The calling thread compresses
+ *  stripes too and only waits for the ones which a helper already started,
+ *  so this can't deadlock if all loading threads are busy.
+ */
+void SPTexture::squishCompressImage(uint8_t* rgba, int width, int height,
+                                    int pitch, void* blocks, unsigned flags)
+{
+#if !(defined(SERVER_ONLY) || defined(MOBILE_STK))
+    const int block_rows = (height + 3) / 4;
+    int stripes = 1;
+    if (width * height >= 512 * 512)
+    {
+        stripes = std::min(std::max((int)std::thread::hardware_concurrency(),
+            1), 4);
+        stripes = std::min(stripes, block_rows);
+    }
+    if (stripes == 1)
+    {
+        squishCompressBlockRows(rgba, width, height, pitch, blocks, flags, 0,
+            height);
+        return;
+    }
+
+    // Shared with the helper jobs, which can run after this function
+    // returned if the loading threads are busy; they will find no stripe
+    // left then
+    struct StripeState
+    {
+        std::atomic_int m_next;
+        std::atomic_int m_done;
+    };
+    std::shared_ptr<StripeState> state = std::make_shared<StripeState>();
+    state->m_next.store(0);
+    state->m_done.store(0);
+    const int rows_per_stripe = (block_rows + stripes - 1) / stripes;
+    std::function<bool()> compress_stripes =
+        [state, stripes, rows_per_stripe, rgba, width, height, pitch, blocks,
+        flags]()->bool
+        {
+            int i;
+            while ((i = state->m_next.fetch_add(1)) < stripes)
+            {
+                const int y_start = std::min(i * rows_per_stripe * 4, height);
+                const int y_end =
+                    std::min((i + 1) * rows_per_stripe * 4, height);
+                squishCompressBlockRows(rgba, width, height, pitch, blocks,
+                    flags, y_start, y_end);
+                state->m_done.fetch_add(1);
+            }
+            return true;
+        };
+    for (int i = 1; i < stripes; i++)
+        SPTextureManager::get()->addThreadedFunction(compress_stripes);
+    compress_stripes();
+    while (state->m_done.load() != stripes)
+        std::this_thread::yield();
+#endif
 }   // squishCompressImage
 
 // ----------------------------------------------------------------------------
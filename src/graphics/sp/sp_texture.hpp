@@ -59,8 +59,13 @@ private:
     const bool m_undo_srgb;
 
     // ------------------------------------------------------------------------
-    void squishCompressImage(uint8_t* rgba, int width, int height, int pitch,
-                             void* blocks, unsigned flags);
+    static void squishCompressImage(uint8_t* rgba, int width, int height,
+                                    int pitch, void* blocks, unsigned flags);
+    // ------------------------------------------------------------------------
+    static void squishCompressBlockRows(uint8_t* rgba, int width, int height,
+                                        int pitch, void* blocks,
+                                        unsigned flags, int y_start,
+                                        int y_end);
     // ------------------------------------------------------------------------
     void generateHQMipmap(void* in,
                           const std::vector<std::pair<core::dimension2du,
@@ -144,17 +149,21 @@ private:
                               const std::vector<std::pair<core::dimension2du,
                               unsigned> >& mipmap_sizes);
     // ------------------------------------------------------------------------
-    bool saveCompressedTexture(std::shared_ptr<video::IImage> texture,
-                              const std::vector<std::pair<core::dimension2du,
-                              unsigned> >& sizes,
-                              const std::string& cache_location);
+    static bool saveCompressedTexture(std::shared_ptr<video::IImage> texture,
+                                      const std::vector<std::pair
+                                      <core::dimension2du, unsigned> >& sizes,
+                                      const std::string& cache_location,
+                                      uint64_t cache_key);
     // ------------------------------------------------------------------------
     std::vector<std::pair<core::dimension2du, unsigned> >
                        compressTexture(std::shared_ptr<video::IImage> texture);
     // ------------------------------------------------------------------------
-    bool useTextureCache(const std::string& full_path, std::string* cache_loc);
+    uint64_t getCacheKey() const;
+    // ------------------------------------------------------------------------
+    bool useTextureCache(uint64_t* cache_key, std::string* cache_loc);
     // ------------------------------------------------------------------------
     std::shared_ptr<video::IImage> getTextureCache(const std::string& path,
+        uint64_t cache_key,
         std::vector<std::pair<core::dimension2du, unsigned> >* sizes);
 
 public:
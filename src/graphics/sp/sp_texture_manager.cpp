@@ -19,12 +19,26 @@
 
 #include "graphics/sp/sp_texture_manager.hpp"
 #include "graphics/sp/sp_base.hpp"
+#include "graphics/sp/sp_shader.hpp"
+#include "graphics/sp/sp_shader_manager.hpp"
 #include "graphics/sp/sp_texture.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/material.hpp"
+#include "graphics/material_manager.hpp"
+#include "io/file_manager.hpp"
+#include "karts/kart_properties.hpp"
+#include "karts/kart_properties_manager.hpp"
+#include "tracks/track.hpp"
+#include "tracks/track_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/vs.hpp"
 
+#include <cinttypes>
+#include <cstring>
+#include <set>
 #include <string>
 
 namespace SP
@@ -34,7 +48,8 @@ SPTextureManager* SPTextureManager::m_sptm = NULL;
 SPTextureManager::SPTextureManager()
                 : m_max_threaded_load_obj
                   ((unsigned)std::thread::hardware_concurrency()),
-                  m_gl_cmd_function_count(0)
+                  m_gl_cmd_function_count(0), m_threaded_function_count(0),
+                  m_cache_manifest_changed(false)
 {
     if (m_max_threaded_load_obj.load() == 0)
     {
@@ -68,17 +83,20 @@ SPTextureManager::SPTextureManager()
                     {
                         addThreadedFunction(copied);
                     }
+                    m_threaded_function_count.fetch_sub(1);
                 }
             });
     }
     m_textures["unicolor_white"] = SPTexture::getWhiteTexture();
     m_textures[""] = SPTexture::getTransparentTexture();
+    loadCacheManifest();
 }   // SPTextureManager
 
 // ----------------------------------------------------------------------------
 SPTextureManager::~SPTextureManager()
 {
     assert(m_threaded_load_obj.empty());
+    saveCacheManifest();
     removeUnusedTextures();
 #ifdef DEBUG
     for (auto p : m_textures)
@@ -166,6 +184,225 @@ void SPTextureManager::removeUnusedTextures()
     }
 }   // removeUnusedTextures
 
+// ----------------------------------------------------------------------------
+/** Loads the texture cache manifest, which stores one line per source
+ *  texture: content hash, modification time, file size, compressed texture
+ *  file ("-" if none) and full path.
+ */
+void SPTextureManager::loadCacheManifest()
+{
+    const std::string manifest =
+        file_manager->getCachedTexturesDir() + "manifest.txt";
+    FILE* fp = FileUtils::fopenU8Path(manifest, "rb");
+    if (!fp)
+        return;
+
+    char line[2048];
+    while (fgets(line, sizeof(line), fp))
+    {
+        CacheManifestEntry entry;
+        char cache_file[256];
+        int path_start = 0;
+        if (sscanf(line, "%" SCNx64 " %" SCNd64 " %" SCNu64 " %255s %n",
+            &entry.m_hash, &entry.m_mtime, &entry.m_size, cache_file,
+            &path_start) != 4 || path_start == 0)
+        {
+            continue;
+        }
+        if (strcmp(cache_file, "-") != 0)
+            entry.m_cache_file = cache_file;
+        std::string path = line + path_start;
+        while (!path.empty() && (path.back() == '\n' || path.back() == '\r'))
+            path.pop_back();
+        if (!path.empty())
+            m_cache_manifest[path] = entry;
+    }
+    fclose(fp);
+}   // loadCacheManifest
+
+// ----------------------------------------------------------------------------
+void SPTextureManager::saveCacheManifest()
+{
+    std::lock_guard<std::mutex> lock(m_cache_manifest_mutex);
+    if (!m_cache_manifest_changed)
+        return;
+
+    const std::string manifest =
+        file_manager->getCachedTexturesDir() + "manifest.txt";
+    FILE* fp = FileUtils::fopenU8Path(manifest, "wb");
+    if (!fp)
+    {
+        Log::warn("SPTextureManager", "Can't write texture cache manifest %s.",
+            manifest.c_str());
+        return;
+    }
+    for (auto& p : m_cache_manifest)
+    {
+        fprintf(fp, "%016" PRIx64 " %" PRId64 " %" PRIu64 " %s %s\n",
+            p.second.m_hash, p.second.m_mtime, p.second.m_size,
+            p.second.m_cache_file.empty() ?
+            "-" : p.second.m_cache_file.c_str(), p.first.c_str());
+    }
+    fclose(fp);
+    m_cache_manifest_changed = false;
+}   // saveCacheManifest
+
+// ----------------------------------------------------------------------------
+/** Returns the content hash of a file, reading the file only if it changed
+ *  since the hash was last computed. Called from texture loading threads.
+ *  \return 0 if the file can not be read.
+ */
+uint64_t SPTextureManager::getFileContentHash(const std::string& path)
+{
+    struct stat st;
+    if (path.empty() || FileUtils::statU8Path(path, &st) != 0)
+        return 0;
+
+    std::unique_lock<std::mutex> ul(m_cache_manifest_mutex);
+    auto it = m_cache_manifest.find(path);
+    if (it != m_cache_manifest.end() &&
+        it->second.m_mtime == (int64_t)st.st_mtime &&
+        it->second.m_size == (uint64_t)st.st_size)
+    {
+        return it->second.m_hash;
+    }
+    ul.unlock();
+
+    FILE* fp = FileUtils::fopenU8Path(path, "rb");
+    if (!fp)
+        return 0;
+    uint64_t hash = StringUtils::fnv1a64(NULL, 0);
+    std::vector<uint8_t> buf(65536);
+    size_t read = 0;
+    while ((read = fread(buf.data(), 1, buf.size(), fp)) > 0)
+        hash = StringUtils::fnv1a64(buf.data(), read, hash);
+    fclose(fp);
+
+    ul.lock();
+    CacheManifestEntry& entry = m_cache_manifest[path];
+    entry.m_mtime = (int64_t)st.st_mtime;
+    entry.m_size = (uint64_t)st.st_size;
+    entry.m_hash = hash;
+    m_cache_manifest_changed = true;
+    return hash;
+}   // getFileContentHash
+
+// ----------------------------------------------------------------------------
+/** Remembers the compressed texture file used for a source texture. If the
+ *  texture was stored under a different key before (because the image, its
+ *  masks or the compression settings changed), the old file is deleted,
+ *  unless another texture with the same content still uses it. Called from
+ *  texture loading threads.
+ *  \param path Full path of the source texture.
+ *  \param cache_file Compressed texture, relative to the cached textures
+ *         directory.
+ */
+void SPTextureManager::setCacheFile(const std::string& path,
+                                    const std::string& cache_file)
+{
+    std::unique_lock<std::mutex> ul(m_cache_manifest_mutex);
+    auto it = m_cache_manifest.find(path);
+    if (it == m_cache_manifest.end() || it->second.m_cache_file == cache_file)
+        return;
+
+    const std::string old_file = it->second.m_cache_file;
+    it->second.m_cache_file = cache_file;
+    m_cache_manifest_changed = true;
+    if (old_file.empty())
+        return;
+    for (auto& p : m_cache_manifest)
+    {
+        if (p.second.m_cache_file == old_file)
+            return;
+    }
+    ul.unlock();
+    file_manager->removeFile(file_manager->getCachedTexturesDir() + old_file);
+}   // setCacheFile
+
+// ----------------------------------------------------------------------------
+/** Compresses all textures in a kart or track directory into the texture
+ *  cache, using the same materials and shaders as the kart or track would.
+ */
+void SPTextureManager::prewarmTextureCache(const std::string& dir,
+                                           const std::string& container_id)
+{
+    file_manager->pushTextureSearchPath(dir, container_id);
+    SPShaderManager::get()->loadSPShaders(dir);
+    bool temp_material = false;
+    if (file_manager->fileExists(dir + "materials.xml"))
+    {
+        temp_material =
+            material_manager->pushTempMaterial(dir + "materials.xml");
+    }
+
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir);
+    for (const std::string& f : files)
+    {
+        const std::string ext =
+            StringUtils::toLowerCase(StringUtils::getExtension(f));
+        if (ext != "png" && ext != "jpg" && ext != "jpeg")
+            continue;
+        Material* m = material_manager->getMaterialSPM(f, "");
+        std::shared_ptr<SPShader> sps =
+            SPShaderManager::get()->getSPShader(m->getShaderName());
+        if (!sps)
+            continue;
+        for (unsigned i = 0; i < 6; i++)
+        {
+            if (!sps->hasTextureLayer(i))
+                continue;
+            getTexture(m->getSamplerPath(i), i == 0 ? m : NULL,
+                sps->isSrgbForTextureLayer(i), m->getContainerId());
+        }
+    }
+
+    // Wait for all uploads and cache writes of this directory
+    checkForGLCommand(true/*before_scene*/);
+    while (m_threaded_function_count.load() != 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    removeUnusedTextures();
+    if (temp_material)
+        material_manager->popTempMaterial();
+    SPShaderManager::get()->removeUnusedShaders();
+    file_manager->popTextureSearchPath();
+}   // prewarmTextureCache
+
+// ----------------------------------------------------------------------------
+/** Offline mode (--prewarm-texture-cache) to compress the textures of all
+ *  installed karts and tracks, so the first race doesn't have to.
+ */
+void SPTextureManager::prewarmTextureCache()
+{
+    if (!CVS->isTextureCompressionEnabled())
+    {
+        Log::warn("SPTextureManager", "Texture compression is disabled, "
+            "nothing to prewarm.");
+        return;
+    }
+    const uint64_t start = StkTime::getMonoTimeMs();
+    for (unsigned i = 0; i < kart_properties_manager->getNumberOfKarts(); i++)
+    {
+        const KartProperties* kp = kart_properties_manager->getKartById(i);
+        Log::info("SPTextureManager", "Prewarming textures of kart %s.",
+            kp->getIdent().c_str());
+        prewarmTextureCache(kp->getKartDir(),
+            StringUtils::insertValues("karts/%s", kp->getIdent().c_str()));
+    }
+    for (unsigned i = 0; i < track_manager->getNumberOfTracks(); i++)
+    {
+        const Track* track = track_manager->getTrack(i);
+        Log::info("SPTextureManager", "Prewarming textures of track %s.",
+            track->getIdent().c_str());
+        prewarmTextureCache(StringUtils::getPath(track->getFilename()) + "/",
+            StringUtils::insertValues("tracks/%s", track->getIdent().c_str()));
+    }
+    saveCacheManifest();
+    Log::info("SPTextureManager", "Texture cache prewarmed in %fs.",
+        (StkTime::getMonoTimeMs() - start) / 1000.0f);
+}   // prewarmTextureCache
+
 // ----------------------------------------------------------------------------
 void SPTextureManager::dumpAllTextures()
 {
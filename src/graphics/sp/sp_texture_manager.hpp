@@ -54,6 +54,8 @@ private:
 
     std::atomic_int m_gl_cmd_function_count;
 
+    std::atomic_int m_threaded_function_count;
+
     std::list<std::function<bool()> > m_threaded_functions;
 
     std::list<std::function<bool()> > m_gl_cmd_functions;
@@ -64,6 +66,34 @@ private:
 
     std::list<std::thread> m_threaded_load_obj;
 
+    /** Content hash of a source texture file, together with the size and
+     *  modification time it was computed for, and the compressed texture
+     *  (relative to the cached textures directory) it was last stored in. */
+    struct CacheManifestEntry
+    {
+        int64_t m_mtime;
+        uint64_t m_size;
+        uint64_t m_hash;
+        std::string m_cache_file;
+    };
+
+    /** Maps the full path of each texture ever compressed to its content
+     *  hash, so unchanged files don't need to be read again to validate the
+     *  texture cache. */
+    std::map<std::string, CacheManifestEntry> m_cache_manifest;
+
+    std::mutex m_cache_manifest_mutex;
+
+    bool m_cache_manifest_changed;
+
+    // ------------------------------------------------------------------------
+    void loadCacheManifest();
+    // ------------------------------------------------------------------------
+    void saveCacheManifest();
+    // ------------------------------------------------------------------------
+    void prewarmTextureCache(const std::string& dir,
+                             const std::string& container_id);
+
 public:
     // ------------------------------------------------------------------------
     static SPTextureManager* get()
@@ -103,6 +133,7 @@ public:
     // ------------------------------------------------------------------------
     void addThreadedFunction(std::function<bool()> threaded_function)
     {
+        m_threaded_function_count.fetch_add(1);
         std::lock_guard<std::mutex> lock(m_thread_obj_mutex);
         m_threaded_functions.push_back(threaded_function);
         m_thread_obj_cv.notify_one();
@@ -123,6 +154,12 @@ public:
                                           Material* m, bool undo_srgb,
                                           const std::string& container_id);
     // ------------------------------------------------------------------------
+    uint64_t getFileContentHash(const std::string& path);
+    // ------------------------------------------------------------------------
+    void setCacheFile(const std::string& path, const std::string& cache_file);
+    // ------------------------------------------------------------------------
+    void prewarmTextureCache();
+    // ------------------------------------------------------------------------
     void dumpAllTextures();
     // ------------------------------------------------------------------------
     irr::core::stringw reloadTexture(const irr::core::stringw& name);
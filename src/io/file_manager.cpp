@@ -254,6 +254,7 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
     checkAndCreateReplayDir();
     checkAndCreateCachedTexturesDir();
+    checkAndCreateCachedScriptsDir();
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -839,6 +840,14 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which compiled scripts are cached.
+ */
+std::string FileManager::getCachedScriptsDir() const
+{
+    return m_cached_scripts_dir;
+}   // getCachedScriptsDir
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -1181,6 +1190,31 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directory for compiled script byte code. This will set
+ *  m_cached_scripts_dir with the appropriate path.
+ */
+void FileManager::checkAndCreateCachedScriptsDir()
+{
+#if defined(WIN32)
+    m_cached_scripts_dir = m_user_config_dir + "cached-scripts/";
+#elif defined(__APPLE__)
+    m_cached_scripts_dir = getenv("HOME");
+    m_cached_scripts_dir += "/Library/Application Support/SuperTuxKart/CachedScripts/";
+#else
+    m_cached_scripts_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cached_scripts_dir += "cached-scripts/";
+#endif
+
+    if (!checkAndCreateDirectory(m_cached_scripts_dir))
+    {
+        Log::error("FileManager", "Can not create cached scripts directory '%s', "
+            "falling back to '.'.", m_cached_scripts_dir.c_str());
+        m_cached_scripts_dir = ".";
+    }
+
+}   // checkAndCreateCachedScriptsDir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
@@ -664,3 +664,26 @@ bool XMLNode::hasChildNamed(const char* name) const
     }
     return false;
 }
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of the name and of all attributes (names and values) of
+ *  this node, which can be used to detect if a node changed. Sub nodes are
+ *  not included.
+ */
+uint64_t XMLNode::getAttributesHash() const
+{
+    uint64_t hash = StringUtils::fnv1a64(m_name);
+    for (auto& attribute : m_attributes)
+    {
+        // Include the lengths, so that e.g. the values "ab" and "c" are not
+        // the same as "a" and "bc"
+        const uint32_t sizes[2] = { (uint32_t)attribute.first.size(),
+                                    (uint32_t)attribute.second.size() };
+        hash = StringUtils::fnv1a64(sizes, sizeof(sizes), hash);
+        hash = StringUtils::fnv1a64(attribute.first, hash);
+        hash = StringUtils::fnv1a64(attribute.second.c_str(),
+                                    attribute.second.size() * sizeof(wchar_t),
+                                    hash);
+    }
+    return hash;
+}   // getAttributesHash
@@ -402,6 +402,27 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
     }   // for m_all_items
 }   // checkItemHit
 
+//-----------------------------------------------------------------------------
+/** Returns true if an item that is not used up is closer to the given
+ *  position than the given radius. Items which are not available at the
+ *  moment are included, since they might return soon.
+ *  \param xyz The position to test.
+ *  \param radius The distance to test.
+ */
+bool ItemManager::itemIsClose(const Vec3 &xyz, float radius) const
+{
+    const float r2 = radius * radius;
+    for (AllItemTypes::const_iterator i  = m_all_items.begin();
+                                      i != m_all_items.end(); i++)
+    {
+        if (!*i || (*i)->isUsedUp())
+            continue;
+        if ((*i)->getXYZ().distance2(xyz) < r2)
+            return true;
+    }
+    return false;
+}   // itemIsClose
+
 //-----------------------------------------------------------------------------
 /** Resets all items and removes bubble gum that is stuck on the track.
  *  This is done when a race is (re)started.
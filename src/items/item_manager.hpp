@@ -136,6 +136,7 @@ public:
     void           update          (int ticks);
     void           updateGraphics  (float dt);
     void           checkItemHit    (AbstractKart* kart);
+    bool           itemIsClose     (const Vec3 &xyz, float radius) const;
     void           reset           ();
     virtual void   collectedItem   (ItemState *item, AbstractKart *kart);
     virtual void   switchItems     ();
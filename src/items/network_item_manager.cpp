@@ -27,6 +27,9 @@
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 
+#include <algorithm>
+#include <limits>
+
 bool NetworkItemManager::m_network_item_debugging = false;
 // ============================================================================
 /** Creates a new instance of the item manager. This is done at startup
@@ -70,12 +73,21 @@ NetworkItemManager::~NetworkItemManager()
     {
         delete is;
     }
+    for (ItemState* is : m_live_join_state)
+    {
+        delete is;
+    }
 }   // ~NetworkItemManager
 
 //-----------------------------------------------------------------------------
 void NetworkItemManager::reset()
 {
     m_confirmed_switch_ticks = -1;
+    for (ItemState* is : m_live_join_state)
+    {
+        delete is;
+    }
+    m_live_join_state.clear();
     ItemManager::reset();
 }   // reset
 
@@ -521,9 +533,8 @@ void NetworkItemManager::restoreState(BareNetworkString *buffer, int count)
  */
 void NetworkItemManager::saveCompleteState(BareNetworkString* buffer) const
 {
+    saveCompleteStateHeader(buffer);
     const uint32_t all_items = (uint32_t)m_all_items.size();
-    buffer->addUInt32(World::getWorld()->getTicksSinceStart())
-        .addUInt32(m_switch_ticks).addUInt32(all_items);
     for (unsigned i = 0; i < all_items; i++)
     {
         if (m_all_items[i])
@@ -562,3 +573,108 @@ void NetworkItemManager::restoreCompleteState(const BareNetworkString& buffer)
             m_confirmed_state.push_back(NULL);
     }
 }   // restoreCompleteState
+
+//-----------------------------------------------------------------------------
+/** Save the time, switch ticks and number of items of the complete state,
+ *  used when the item states are sent in chunks to a live joining client
+ *  with saveCompleteItemState.
+ */
+void NetworkItemManager::saveCompleteStateHeader(BareNetworkString* buffer)
+                                                                         const
+{
+    buffer->addUInt32(World::getWorld()->getTicksSinceStart())
+        .addUInt32(m_switch_ticks).addUInt32((uint32_t)m_all_items.size());
+}   // saveCompleteStateHeader
+
+//-----------------------------------------------------------------------------
+/** Restore the header written by saveCompleteStateHeader in client, the
+ *  item states received before by restoreCompleteItemStates become the
+ *  confirmed state.
+ */
+void NetworkItemManager::restoreCompleteStateHeader(
+                                              const BareNetworkString& buffer)
+{
+    m_confirmed_state_time = buffer.getUInt32();
+    m_confirmed_switch_ticks = buffer.getUInt32();
+    const uint32_t all_items = buffer.getUInt32();
+    for (ItemState* is : m_confirmed_state)
+    {
+        delete is;
+    }
+    m_confirmed_state.clear();
+    std::swap(m_confirmed_state, m_live_join_state);
+    for (unsigned i = all_items; i < m_confirmed_state.size(); i++)
+    {
+        delete m_confirmed_state[i];
+    }
+    m_confirmed_state.resize(all_items, NULL);
+}   // restoreCompleteStateHeader
+
+//-----------------------------------------------------------------------------
+/** Save the state of one item with its index in server for live join.
+ */
+void NetworkItemManager::saveCompleteItemState(BareNetworkString* buffer,
+                                               unsigned index) const
+{
+    buffer->addUInt32(index);
+    if (m_all_items[index])
+    {
+        buffer->addUInt8(1);
+        m_all_items[index]->saveCompleteState(buffer);
+    }
+    else
+        buffer->addUInt8(0);
+}   // saveCompleteItemState
+
+//-----------------------------------------------------------------------------
+/** Restore item states written by saveCompleteItemState in client, they are
+ *  kept until restoreCompleteStateHeader is called.
+ *  \param count Number of item states in the buffer.
+ */
+void NetworkItemManager::restoreCompleteItemStates(
+                                const BareNetworkString& buffer, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        const uint32_t index = buffer.getUInt32();
+        const bool has_item = buffer.getUInt8() == 1;
+        ItemState* is = has_item ? new ItemState(buffer) : NULL;
+        // Items are only added by the server on the fly, so the index is
+        // never far past the items of the track
+        if (index > m_all_items.size() + 1024)
+        {
+            Log::warn("NetworkItemManager", "Invalid item index %d.", index);
+            delete is;
+            continue;
+        }
+        if (index >= m_live_join_state.size())
+            m_live_join_state.resize(index + 1, NULL);
+        delete m_live_join_state[index];
+        m_live_join_state[index] = is;
+    }
+}   // restoreCompleteItemStates
+
+//-----------------------------------------------------------------------------
+/** Returns the indices of all items (including removed ones) in server,
+ *  sorted by their distance to a location, so that the items close to a
+ *  live joining kart can be sent first.
+ */
+std::vector<unsigned> NetworkItemManager::getItemsByDistance(const Vec3& xyz)
+                                                                         const
+{
+    std::vector<std::pair<float, unsigned> > distances;
+    distances.reserve(m_all_items.size());
+    for (unsigned i = 0; i < m_all_items.size(); i++)
+    {
+        // Removed items are sent last
+        distances.emplace_back(m_all_items[i] ?
+            (m_all_items[i]->getXYZ() - xyz).length2() :
+            std::numeric_limits<float>::max(), i);
+    }
+    std::sort(distances.begin(), distances.end());
+    std::vector<unsigned> result;
+    result.reserve(distances.size());
+    for (auto& d : distances)
+        result.push_back(d.second);
+    return result;
+}   // getItemsByDistance
@@ -55,6 +55,10 @@ private:
     /** Time at which m_confirmed_state was taken. */
     int m_confirmed_state_time;
 
+    /** Item states received in chunks by a live joining client, they
+     *  become the confirmed state once the live join ack arrives. */
+    std::vector<ItemState*> m_live_join_state;
+
     /** Allow remove or add peer live. */
     std::mutex m_live_players_mutex;
 
@@ -111,6 +115,18 @@ public:
     // ------------------------------------------------------------------------
     void restoreCompleteState(const BareNetworkString& buffer);
     // ------------------------------------------------------------------------
+    void saveCompleteStateHeader(BareNetworkString* buffer) const;
+    // ------------------------------------------------------------------------
+    void restoreCompleteStateHeader(const BareNetworkString& buffer);
+    // ------------------------------------------------------------------------
+    void saveCompleteItemState(BareNetworkString* buffer,
+                               unsigned index) const;
+    // ------------------------------------------------------------------------
+    void restoreCompleteItemStates(const BareNetworkString& buffer,
+                                   unsigned count);
+    // ------------------------------------------------------------------------
+    std::vector<unsigned> getItemsByDistance(const Vec3& xyz) const;
+    // ------------------------------------------------------------------------
     void initServer();
 
 };   // NetworkItemManager
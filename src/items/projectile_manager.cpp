@@ -230,6 +230,24 @@ bool ProjectileManager::projectileIsClose(const AbstractKart * const kart,
     return false;
 }   // projectileIsClose
 
+// -----------------------------------------------------------------------------
+/** Returns true if any projectile is inside the specified axis aligned box.
+ *  \param min Minimum corner of the box.
+ *  \param max Maximum corner of the box.
+ */
+bool ProjectileManager::projectileInBox(const Vec3 &min, const Vec3 &max) const
+{
+    for (auto i = m_active_projectiles.begin(); i != m_active_projectiles.end(); i++)
+    {
+        const Vec3 &xyz = i->second->getXYZ();
+        if (xyz.getX() >= min.getX() && xyz.getX() <= max.getX() &&
+            xyz.getY() >= min.getY() && xyz.getY() <= max.getY() &&
+            xyz.getZ() >= min.getZ() && xyz.getZ() <= max.getZ())
+            return true;
+    }
+    return false;
+}   // projectileInBox
+
 // -----------------------------------------------------------------------------
 /** Returns an int containing the numbers of a given flyable in a given radius
  *  around the kart
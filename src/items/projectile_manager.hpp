@@ -75,9 +75,17 @@ public:
     void             update           (int ticks);
     void             updateGraphics   (float dt);
     void             removeTextures   ();
+    // ------------------------------------------------------------------------
+    /** Returns true if there is at least one projectile moving on the
+     *  track. */
+    bool             hasActiveProjectiles() const
+                                       { return !m_active_projectiles.empty(); }
+    // ------------------------------------------------------------------------
     bool             projectileIsClose(const AbstractKart * const kart,
                                        float radius);
-
+    // ------------------------------------------------------------------------
+    bool             projectileInBox(const Vec3 &min, const Vec3 &max) const;
+    // ------------------------------------------------------------------------
     int              getNearbyProjectileCount(const AbstractKart * const kart,
                                        float radius, PowerupManager::PowerupType type,
                                        bool exclude_owned=false);
@@ -145,6 +145,11 @@ public:
     virtual void changeKart(const std::string& new_ident,
                             HandicapLevel handicap,
                             std::shared_ptr<RenderInfo> ri);
+    // ------------------------------------------------------------------------
+    /** Returns the transform the kart is reset to, which is also where a live
+     *  joining kart enters the game. */
+    const btTransform& getStartingTransform() const
+                                              { return m_starting_transform; }
     // ========================================================================
     // Access to the handicap.
     // ------------------------------------------------------------------------
@@ -1922,14 +1922,11 @@ void SkiddingAI::computeNearestKarts()
     // Sort the list in descending order
     std::sort(overall_distance.begin(), overall_distance.end(), std::greater<float>());
    
-    // Get the AI's position (the position update may not be done, leading to crashes)
-    int curr_position = 1;
-    for(unsigned int i=0; i<m_world->getNumKarts(); i++)
-    {
-        if(   m_world->getOverallDistance(i) > own_overall_distance
-           && !m_world->getKart(i)->isEliminated())
-            curr_position++;
-    }
+    // Get the AI's position (the position update may not be done, leading
+    // to crashes). The kart index contains the sorted overall distances of
+    // all karts that are not eliminated.
+    int curr_position = 1 +
+        m_world->getKartIndex().getNumKartsAhead(own_overall_distance);
 
     for(unsigned int i=0; i<n; i++)
     {
@@ -2500,6 +2497,28 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
                   steps, m_kart_length, m_kart->getVelocityLC().getZ());
         steps=1000;
     }
+
+    // Only karts that can get within m_kart_length of the sight line during
+    // the tested time can cause a crash, so get the candidates from the
+    // kart index: all steps are on the segment between the first and last
+    // step, and no kart can move more than max_speed * time.
+    m_crash_candidates.clear();
+    if (m_crashes.m_kart == -1 && steps > 1)
+    {
+        const KartSpatialIndex &index = m_world->getKartIndex();
+        const Vec3 first = pos + vel_normal * m_kart_length;
+        const Vec3 last  = pos + vel_normal * m_kart_length * float(steps-1);
+        // Add one kart length as safety margin in case that a velocity was
+        // changed after the index was built.
+        const float radius = 2.0f * m_kart_length
+                           + index.getMaxSpeed() * float(steps-1) * dt;
+        Vec3 box_min = first, box_max = first;
+        box_min.min(last);
+        box_max.max(last);
+        index.getKartsInBox(box_min - Vec3(radius), box_max + Vec3(radius),
+                            &m_crash_candidates);
+    }
+
     for(int i = 1; steps > i; ++i)
     {
         Vec3 step_coord = pos + vel_normal* m_kart_length * float(i);
@@ -2509,8 +2528,9 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
          */
         if( m_crashes.m_kart == -1 )
         {
-            for( unsigned int j = 0; j < NUM_KARTS; ++j )
+            for (unsigned int j : m_crash_candidates)
             {
+                if (j >= NUM_KARTS) continue;
                 const AbstractKart* kart = m_world->getKart(j);
                 // Ignore eliminated karts
                 if(kart==m_kart||kart->isEliminated()||kart->isGhostKart()) continue;
@@ -127,6 +127,10 @@ private:
         void clear() {m_road = false; m_kart = -1;}
     } m_crashes;
 
+    /** Karts close enough to the sight line to cause a crash, taken from the
+     *  kart index of the world. Member to avoid allocations each frame. */
+    std::vector<unsigned int> m_crash_candidates;
+
     RaceManager::AISuperPower m_superpower;
 
     /*General purpose variables*/
@@ -65,6 +65,7 @@
 #include "modes/capture_the_flag.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/overworld.hpp"
+#include "modes/profile_world.hpp"
 #include "modes/soccer_world.hpp"
 #include "network/compress_network_body.hpp"
 #include "network/network_config.hpp"
@@ -1433,7 +1434,10 @@ void Kart::update(int ticks)
     // based on the collision speed.
     m_body->setRestitution(m_kart_properties->getRestitution(fabsf(m_speed)));
 
-    m_controller->update(ticks);
+    {
+        ProfileWorld::BenchmarkScope bs(ProfileWorld::BT_AI);
+        m_controller->update(ticks);
+    }
 
 #ifndef SERVER_ONLY
 #undef DEBUG_CAMERA_SHAKE
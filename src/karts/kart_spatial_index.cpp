@@ -0,0 +1,183 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/kart_spatial_index.hpp"
+
+#include "karts/abstract_kart.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const float KartSpatialIndex::CELL_SIZE = 20.0f;
+
+// ----------------------------------------------------------------------------
+KartSpatialIndex::KartSpatialIndex()
+{
+    m_num_karts = 0;
+    m_max_speed = 0.0f;
+}   // KartSpatialIndex
+
+// ----------------------------------------------------------------------------
+/** Converts a world coordinate into a grid cell coordinate. The value is
+ *  clamped so that even karts that fell off the track can be stored.
+ */
+int KartSpatialIndex::toCell(float f)
+{
+    float c = std::floor(f / CELL_SIZE);
+    if (!(c > -1.0e6f)) return -1000000;
+    if (c > 1.0e6f) return 1000000;
+    return (int)c;
+}   // toCell
+
+// ----------------------------------------------------------------------------
+/** Rebuilds the index from the current position and velocity of all karts.
+ *  \param karts The karts of the world, the index in this vector is used as
+ *         world kart id.
+ */
+void KartSpatialIndex::build(
+                      const std::vector<std::shared_ptr<AbstractKart> > &karts)
+{
+    std::vector<Vec3> xyz;
+    xyz.reserve(karts.size());
+    float max_speed = 0.0f;
+    for (unsigned int i = 0; i < karts.size(); i++)
+    {
+        xyz.push_back(karts[i]->getXYZ());
+        max_speed = std::max(max_speed, karts[i]->getVelocity().length());
+    }
+    build(xyz, max_speed);
+}   // build
+
+// ----------------------------------------------------------------------------
+/** Rebuilds the index from a list of positions.
+ *  \param xyz Position of each kart, indexed by world kart id.
+ *  \param max_speed The largest speed of all karts.
+ */
+void KartSpatialIndex::build(const std::vector<Vec3> &xyz, float max_speed)
+{
+    m_num_karts = (unsigned int)xyz.size();
+    m_max_speed = max_speed;
+    m_cells.clear();
+    for (unsigned int i = 0; i < xyz.size(); i++)
+    {
+        m_cells.emplace_back(getKey(toCell(xyz[i].getX()),
+                                    toCell(xyz[i].getZ())), i);
+    }
+    std::sort(m_cells.begin(), m_cells.end());
+}   // build
+
+// ----------------------------------------------------------------------------
+/** Stores the progress values (e.g. overall distance) of all karts that
+ *  should be considered by getNumKartsAhead(). The content of the vector is
+ *  swapped into the index to avoid a copy each frame.
+ */
+void KartSpatialIndex::setProgress(std::vector<float> &progress)
+{
+    m_progress.swap(progress);
+    std::sort(m_progress.begin(), m_progress.end());
+}   // setProgress
+
+// ----------------------------------------------------------------------------
+/** Returns the ids of all karts whose position is inside the given axis
+ *  aligned box in the XZ plane (the Y coordinate is ignored). The result
+ *  can contain additional karts close to the box, so callers still need to
+ *  do an exact test. The ids are sorted in increasing order.
+ *  \param min Minimum corner of the box.
+ *  \param max Maximum corner of the box.
+ *  \param result Vector to which the kart ids are written (it is cleared
+ *         first).
+ */
+void KartSpatialIndex::getKartsInBox(const Vec3 &min, const Vec3 &max,
+                                     std::vector<unsigned int> *result) const
+{
+    result->clear();
+    const int min_x = toCell(min.getX()), max_x = toCell(max.getX());
+    const int min_z = toCell(min.getZ()), max_z = toCell(max.getZ());
+
+    // If the box covers more cells than there are karts, testing all karts
+    // is cheaper than looking up each cell.
+    const int64_t num_cells = int64_t(max_x - min_x + 1)
+                            * int64_t(max_z - min_z + 1);
+    if (num_cells > (int64_t)m_cells.size())
+    {
+        for (unsigned int i = 0; i < m_num_karts; i++)
+            result->push_back(i);
+        return;
+    }
+
+    for (int x = min_x; x <= max_x; x++)
+    {
+        for (int z = min_z; z <= max_z; z++)
+        {
+            const int64_t key = getKey(x, z);
+            auto it = std::lower_bound(m_cells.begin(), m_cells.end(),
+                                       std::make_pair(key, 0u));
+            for (; it != m_cells.end() && it->first == key; it++)
+                result->push_back(it->second);
+        }
+    }
+    std::sort(result->begin(), result->end());
+}   // getKartsInBox
+
+// ----------------------------------------------------------------------------
+/** Returns the number of karts with a progress value strictly larger than
+ *  the given value.
+ */
+unsigned int KartSpatialIndex::getNumKartsAhead(float progress) const
+{
+    auto it = std::upper_bound(m_progress.begin(), m_progress.end(),
+                               progress);
+    return (unsigned int)(m_progress.end() - it);
+}   // getNumKartsAhead
+
+// ----------------------------------------------------------------------------
+/** Compares the grid query and the progress count with a brute force
+ *  computation.
+ */
+void KartSpatialIndex::unitTesting()
+{
+    KartSpatialIndex index;
+    std::vector<Vec3> xyz;
+    for (int i = 0; i < 50; i++)
+        xyz.push_back(Vec3(i * 7.3f - 150.0f, 0.0f, (i % 7) * 13.1f - 40.0f));
+    index.build(xyz, 30.0f);
+
+    std::vector<unsigned int> result;
+    const Vec3 min(-60.0f, 0.0f, -20.0f), max(10.0f, 0.0f, 15.0f);
+    index.getKartsInBox(min, max, &result);
+    for (unsigned int i = 0; i < xyz.size(); i++)
+    {
+        const bool inside = xyz[i].getX() >= min.getX() &&
+                            xyz[i].getX() <= max.getX() &&
+                            xyz[i].getZ() >= min.getZ() &&
+                            xyz[i].getZ() <= max.getZ();
+        const bool found = std::find(result.begin(), result.end(), i)
+                         != result.end();
+        // All karts in the box must be found
+        assert(!inside || found);
+        (void)inside; (void)found;
+    }
+    assert(std::is_sorted(result.begin(), result.end()));
+
+    std::vector<float> progress = { 3.0f, 1.0f, 2.0f, 2.0f, 5.0f };
+    index.setProgress(progress);
+    assert(index.getNumKartsAhead(2.0f) == 2);
+    assert(index.getNumKartsAhead(0.0f) == 5);
+    assert(index.getNumKartsAhead(5.0f) == 0);
+}   // unitTesting
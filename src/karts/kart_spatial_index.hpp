@@ -0,0 +1,89 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_KART_SPATIAL_INDEX_HPP
+#define HEADER_KART_SPATIAL_INDEX_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
+
+#include <memory>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class AbstractKart;
+
+/**
+ * \brief A per-tick snapshot of all kart positions, shared by all AI
+ *  controllers of a world.
+ *  The karts are sorted into a uniform grid in the XZ plane, so that an AI
+ *  only needs to test karts close to its predicted path instead of all
+ *  karts. Additionally a sorted list of a per-kart progress value (e.g. the
+ *  overall distance in linear races) can be stored to answer 'how many karts
+ *  are ahead' queries with a binary search.
+ *  The index is rebuilt by the world once per update, before the karts (and
+ *  therefore the AI controllers) are updated.
+ * \ingroup karts
+ */
+class KartSpatialIndex : public NoCopy
+{
+private:
+    /** Size of one grid cell in the XZ plane. */
+    static const float CELL_SIZE;
+
+    /** (cell key, world kart id) for each kart, sorted by cell key. */
+    std::vector<std::pair<int64_t, unsigned int> > m_cells;
+
+    /** Sorted (ascending) progress values of all non-eliminated karts. */
+    std::vector<float> m_progress;
+
+    /** Number of karts in the index. */
+    unsigned int m_num_karts;
+
+    /** Largest speed of all karts when the index was built. */
+    float m_max_speed;
+
+    // ------------------------------------------------------------------------
+    static int toCell(float f);
+    // ------------------------------------------------------------------------
+    static int64_t getKey(int x, int z)
+    {
+        return (int64_t)(((uint64_t)(uint32_t)x << 32) | (uint32_t)z);
+    }   // getKey
+
+public:
+             KartSpatialIndex();
+    void     build(const std::vector<std::shared_ptr<AbstractKart> > &karts);
+    void     build(const std::vector<Vec3> &xyz, float max_speed);
+    void     setProgress(std::vector<float> &progress);
+    void     getKartsInBox(const Vec3 &min, const Vec3 &max,
+                           std::vector<unsigned int> *result) const;
+    unsigned int getNumKartsAhead(float progress) const;
+    // ------------------------------------------------------------------------
+    /** Returns the largest speed of any kart at the time the index was
+     *  built. */
+    float    getMaxSpeed() const { return m_max_speed; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of karts in this index. */
+    unsigned int getNumKarts() const { return m_num_karts; }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+};   // KartSpatialIndex
+
+#endif
@@ -190,6 +190,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "font/font_manager.hpp"
+#include "font/regular_face.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/camera_debug.hpp"
 #include "graphics/central_settings.hpp"
@@ -200,6 +201,7 @@
 #include "graphics/referee.hpp"
 #include "graphics/sp/sp_base.hpp"
 #include "graphics/sp/sp_shader.hpp"
+#include "graphics/sp/sp_texture_manager.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/dialog_queue.hpp"
@@ -220,12 +222,15 @@
 #include "karts/kart_model.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "modes/cutscene_world.hpp"
 #include "modes/demo_world.hpp"
+#include "network/crypto_workers.hpp"
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "network/network.hpp"
+#include "network/network_bots.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
 #include "network/protocols/connect_to_server.hpp"
@@ -242,6 +247,7 @@
 #include "network/stk_peer.hpp"
 #include "online/profile_manager.hpp"
 #include "online/request_manager.hpp"
+#include "physics/physics.hpp"
 #include "race/grand_prix_manager.hpp"
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
@@ -565,6 +571,26 @@ void cmdLineHelp()
                               "laps.\n"
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
+    "       --profiler-trace=FILE Record profiler markers of all threads and "
+                              "write them\n"
+    "                          as Chrome trace (JSON) to FILE on exit.\n"
+    "       --benchmark=FILE   In profile mode, measure the time of each "
+                              "subsystem and write\n"
+    "                          it with ticks/s and peak memory to FILE (XML).\n"
+    "       --benchmark-baseline=FILE Compare the benchmark results with an "
+                              "earlier result\n"
+    "                          file, exit with 1 if they are worse.\n"
+    "       --benchmark-tolerance=n Accepted slowdown in percent compared with "
+                              "the baseline\n"
+    "                          (default 10).\n"
+    "       --physics-threads=n Solve the physics with n threads (1 to 8), "
+                              "also if not a server.\n"
+    "       --physics-hashes=FILE Write a hash of the physics state after "
+                              "each step to FILE.\n"
+    "       --physics-hashes-baseline=FILE Compare the physics hashes with "
+                              "those of an earlier\n"
+    "                          run of the same replay, exit with 1 if they "
+                              "differ.\n"
     "       --unlock-all       Permanently unlock all karts and tracks for testing.\n"
     "       --no-unlock-all    Disable unlock-all (i.e. base unlocking on player achievement).\n"
     "       --no-graphics      Do not display the actual race.\n"
@@ -595,6 +621,9 @@ void cmdLineHelp()
     "       --server-id=n      Server id in stk addons for --connect-now.\n"
     "       --network-ai=n     Numbers of AI for connecting to linear race server, used\n"
     "                          together with --connect-now.\n"
+    "       --network-bots=n   Connect n lightweight bots to a LAN server for load\n"
+    "                          testing, used together with --connect-now.\n"
+    "       --network-bots-time=s  Disconnect the network bots after s seconds.\n"
     "       --login=s          Automatically log in (set the login).\n"
     "       --password=s       Automatically log in (set the password).\n"
     "       --init-user        Save the above login and password (if set) in config.\n"
@@ -620,6 +649,9 @@ void cmdLineHelp()
     "       --firewalled-server Turn on all stun related code in server.\n"
     "       --no-firewalled-server Turn off all stun related code in server.\n"
     "       --connection-debug Print verbose info for sending or receiving packets.\n"
+    "       --benchmark-crypto=n Encrypt and decrypt n packets with different\n"
+    "                          numbers of threads and log the packets per\n"
+    "                          second, then exit.\n"
     "       --no-console-log   Does not write messages in the console but to\n"
     "                          stdout.log.\n"
     "  -h,  --help             Show this help.\n"
@@ -649,6 +681,10 @@ void cmdLineHelp()
     "       --disable-mlaa     Disable anti-aliasing.\n"
     "       --enable-texture-compression Enable texture compression.\n"
     "       --disable-texture-compression Disable texture compression.\n"
+    "       --prewarm-texture-cache Compress the textures of all installed karts\n"
+    "                          and tracks into the texture cache, then exit.\n"
+    "       --benchmark-glyphs=n Render n glyphs of the regular font and log\n"
+    "                          the glyphs per second, then exit.\n"
     "       --enable-ssao      Enable screen space ambient occlusion.\n"
     "       --disable-ssao     Disable screen space ambient occlusion.\n"
     "       --enable-ibl       Enable image based lighting.\n"
@@ -1332,6 +1368,25 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
 
     std::string addr;
     bool has_addr = CommandLine::has("--connect-now", &addr);
+    if (has_addr && CommandLine::has("--network-bots", &n))
+    {
+        SocketAddress server_addr(addr);
+        if (server_addr.getIP() == 0 || server_addr.isIPv6())
+        {
+            Log::error("Main", "Network bots need an IPv4 server address, "
+                "got: %s", addr.c_str());
+            cleanSuperTuxKart();
+            return false;
+        }
+        float duration = 0.0f;
+        CommandLine::has("--network-bots-time", &duration);
+        {
+            NetworkBots bots(server_addr.toENetAddress(), n);
+            bots.run(duration);
+        }
+        cleanSuperTuxKart();
+        return false;
+    }
     if (has_addr)
     {
         NetworkConfig::get()->setIsServer(false);
@@ -1597,6 +1652,14 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         }
     }   // --profile-laps
     
+    if(CommandLine::has("--profiler-trace", &s))
+    {
+        // Also works with --no-graphics, e.g. to profile servers
+        profiler.init();
+        profiler.setTraceFile(s);
+        UserConfigParams::m_profiler_enabled = true;
+    }   // --profiler-trace
+
     if(CommandLine::has("--unlock-all"))
     {
         UserConfigParams::m_unlock_everything = 2;
@@ -1615,6 +1678,37 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         RaceManager::get()->setNumLaps(999999); // profile end depends on time
     }   // --profile-time
 
+    if(CommandLine::has("--benchmark", &s))
+    {
+        if (!ProfileWorld::isProfileMode())
+        {
+            Log::error("main", "--benchmark requires --profile-laps or "
+                               "--profile-time.");
+            return 0;
+        }
+        std::string baseline;
+        CommandLine::has("--benchmark-baseline", &baseline);
+        int tolerance = 10;
+        CommandLine::has("--benchmark-tolerance", &tolerance);
+        ProfileWorld::setBenchmark(s, baseline, tolerance * 0.01f);
+    }   // --benchmark
+
+    if(CommandLine::has("--physics-threads", &n))
+    {
+        if (n < 1 || n > 8)
+        {
+            Log::error("main", "Invalid number of physics-threads: %i.", n);
+            return 0;
+        }
+        Physics::setNumThreads(n);
+    }   // --physics-threads
+
+    std::string physics_hashes, physics_baseline;
+    CommandLine::has("--physics-hashes", &physics_hashes);
+    CommandLine::has("--physics-hashes-baseline", &physics_baseline);
+    if (!physics_hashes.empty() || !physics_baseline.empty())
+        Physics::setHashFiles(physics_hashes, physics_baseline);
+
     if(CommandLine::has("--history"))
     {
         history->setReplayHistory(true);
@@ -2016,6 +2110,12 @@ int main(int argc, char *argv[])
         NetworkConfig::initSystemIP();
         // Client port depends on user config file and stk_config
         NetworkConfig::get()->initClientPort();
+        int crypto_packets = 0;
+        if (CommandLine::has("--benchmark-crypto", &crypto_packets))
+        {
+            CryptoWorkers::benchmark(std::max(crypto_packets, 1));
+            exit(0);
+        }
         bool no_graphics = !CommandLine::has("--graphical-server");
 
 #ifndef SERVER_ONLY
@@ -2180,6 +2280,24 @@ int main(int argc, char *argv[])
             exit(0);
         }
 
+#ifndef SERVER_ONLY
+        if (CommandLine::has("--prewarm-texture-cache"))
+        {
+            if (!GUIEngine::isNoGraphics() && CVS->isGLSL())
+                SP::SPTextureManager::get()->prewarmTextureCache();
+            else
+                Log::warn("main", "Texture cache needs the GLSL renderer.");
+            exit(0);
+        }
+        int glyph_count = 0;
+        if (CommandLine::has("--benchmark-glyphs", &glyph_count))
+        {
+            font_manager->getFont<RegularFace>()
+                ->benchmarkGlyphs(std::max(glyph_count, 1));
+            exit(0);
+        }
+#endif
+
 #ifndef SERVER_ONLY
         if (!GUIEngine::isNoGraphics())
         {
@@ -2401,6 +2519,7 @@ int main(int argc, char *argv[])
     if (STKHost::existHost())
         STKHost::get()->shutdown();
 
+    profiler.writeTraceOnExit();
     cleanSuperTuxKart();
     NetworkConfig::destroy();
 
@@ -2430,7 +2549,8 @@ int main(int argc, char *argv[])
     exit(0);
     return 0;
 #else
-    return 0 ;
+    return ProfileWorld::hasBenchmarkRegression() ||
+           Physics::hasHashMismatch() ? 1 : 0;
 #endif
 }   // main
 
@@ -2622,6 +2742,9 @@ void runUnitTests()
     Log::info("UnitTest", "Kart characteristics");
     CombinedCharacteristic::unitTesting();
 
+    Log::info("UnitTest", "Kart spatial index");
+    KartSpatialIndex::unitTesting();
+
     Log::info("UnitTest", "Arena Graph");
     ArenaGraph::unitTesting();
 
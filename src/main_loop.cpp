@@ -45,6 +45,7 @@
 #include "network/race_event_manager.hpp"
 #include "network/rewind_manager.hpp"
 #include "network/server.hpp"
+#include "network/server_metrics.hpp"
 #include "network/stk_host.hpp"
 #include "online/request_manager.hpp"
 #include "race/history.hpp"
@@ -609,8 +610,11 @@ void MainLoop::run()
             bool fast_forward = NetworkConfig::get()->isNetworking() &&
                 NetworkConfig::get()->isClient() &&
                 num_steps > stk_config->time2Ticks(1.0f);
+            ServerMetrics* metrics = NetworkConfig::get()->isServer() ?
+                ServerMetrics::get() : NULL;
             for (int i = 0; i < num_steps; i++)
             {
+                const auto tick_start = std::chrono::steady_clock::now();
                 if (World::getWorld() && history->replayHistory())
                 {
                     history->updateReplay(
@@ -658,6 +662,13 @@ void MainLoop::run()
                         break;
                     }
                     World::getWorld()->updateTime(1);
+                    if (metrics)
+                    {
+                        metrics->addTick(std::chrono::duration_cast<
+                            std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - tick_start)
+                            .count());
+                    }
                 }
             }   // for i < num_steps
 
@@ -51,6 +51,7 @@
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
+#include <algorithm>
 #include <climits>
 #include <iostream>
 
@@ -142,6 +143,7 @@ void LinearWorld::reset(bool restart)
     // recomputed, since otherwise 'new' (initialised) valued will be compared
     // with old values.
     updateRacePosition();
+    updateKartIndex();
 
 #ifdef DEBUG
     //FIXME: this could be defined somewhere in a central header so it can
@@ -166,6 +168,23 @@ void LinearWorld::reset(bool restart)
 
 }   // reset
 
+//-----------------------------------------------------------------------------
+/** Rebuilds the kart index, and adds the overall distance of all karts that
+ *  are still in the race, so that the AI can determine the number of karts
+ *  ahead without testing all karts.
+ */
+void LinearWorld::updateKartIndex()
+{
+    WorldWithRank::updateKartIndex();
+    m_kart_progress.clear();
+    for (unsigned int i = 0; i < m_kart_info.size(); i++)
+    {
+        if (!m_karts[i]->isEliminated())
+            m_kart_progress.push_back(m_kart_info[i].m_overall_distance);
+    }
+    m_kart_index.setProgress(m_kart_progress);
+}   // updateKartIndex
+
 //-----------------------------------------------------------------------------
 /** General update function called once per frame. This updates the kart
  *  sectors, which are then used to determine the kart positions.
@@ -849,9 +868,27 @@ btTransform LinearWorld::getRescueTransform(unsigned int index) const
 }   // getRescueTransform
 
 //-----------------------------------------------------------------------------
-/** Find the position (rank) of every kart. ATM it uses a stable O(n^2)
- *  algorithm by counting for each kart how many other karts are ahead of
- *  it.
+/** Returns true if kart a is ahead of kart b, assuming that both karts are
+ *  still racing (i.e. are neither eliminated nor have finished the race).
+ *  If the distance is the same (very unlikely), the kart that started
+ *  earlier is ahead.
+ */
+bool LinearWorld::isAhead(unsigned int a, unsigned int b) const
+{
+    const float distance_a = m_kart_info[a].m_overall_distance;
+    const float distance_b = m_kart_info[b].m_overall_distance;
+    return distance_a > distance_b ||
+           (distance_a == distance_b &&
+            m_karts[a]->getInitialPosition() < m_karts[b]->getInitialPosition());
+}   // isAhead
+
+//-----------------------------------------------------------------------------
+/** Find the position (rank) of every kart. All karts that have finished the
+ *  race (and are not eliminated) are ahead of all karts that are still
+ *  racing, so only the karts still racing need to be sorted. Their order is
+ *  kept in m_race_order between updates, and since the order changes only
+ *  rarely from one update to the next an insertion sort is used, which only
+ *  has to fix the few karts that overtook another kart.
  */
 void LinearWorld::updateRacePosition()
 {
@@ -863,9 +900,7 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
-    // NOTE: if you do any changes to this loop, the next loop (see
-    // DEBUG_KART_RANK below) needs to have the same changes applied
-    // so that debug output is still correct!!!!!!!!!!!
+    unsigned int num_finished = 0, num_racing = 0;
     for (unsigned int i=0; i<kart_amount; i++)
     {
         AbstractKart* kart = m_karts[i].get();
@@ -876,44 +911,64 @@ void LinearWorld::updateRacePosition()
         // crossing the finishing line and become second!
         if(kart->isEliminated() || kart->hasFinishedRace())
         {
+            if (!kart->isEliminated())
+                num_finished++;
             // This is only necessary to support debugging inconsistencies
             // in kart position parameters.
             setKartPosition(i, kart->getPosition());
             continue;
         }
-        KartInfo& kart_info = m_kart_info[i];
-
-        int p = 1 ;
+        num_racing++;
+    }
 
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
+    // Remove karts that finished or were eliminated since the last update.
+    // If the karts still racing do not match anymore (e.g. after a reset
+    // or rewind), start again with all karts still racing.
+    auto not_racing = [this](unsigned int id)
+    {
+        return m_karts[id]->isEliminated() || m_karts[id]->hasFinishedRace();
+    };
+    m_race_order.erase(std::remove_if(m_race_order.begin(), m_race_order.end(),
+                                      not_racing),
+                       m_race_order.end());
+    if (m_race_order.size() != num_racing)
+    {
+        m_race_order.clear();
+        for (unsigned int i=0; i<kart_amount; i++)
+        {
+            if (!not_racing(i))
+                m_race_order.push_back(i);
+        }
+    }
 
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
+    for (unsigned int k=1; k<m_race_order.size(); k++)
+    {
+        const unsigned int id = m_race_order[k];
+        unsigned int j = k;
+        while (j > 0 && isAhead(id, m_race_order[j-1]))
         {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
+            m_race_order[j] = m_race_order[j-1];
+            j--;
+        }
+        m_race_order[j] = id;
+    }
 
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
+    // NOTE: if you do any changes to the ranking, the next loop (see
+    // DEBUG_KART_RANK below) needs to have the same changes applied
+    // so that debug output is still correct!!!!!!!!!!!
+    for (unsigned int k=0; k<m_race_order.size(); k++)
+    {
+        const unsigned int i = m_race_order[k];
+        KartInfo& kart_info = m_kart_info[i];
 
-        } //next kart
+        // All karts that have finished the race, and all karts before this
+        // kart in the race order are ahead of this kart.
+        int p = num_finished + k + 1;
 
 #ifndef DEBUG
         setKartPosition(i, p);
 #else
+        AbstractKart* kart = m_karts[i].get();
         rank_changed |= kart->getPosition()!=p;
         if (!setKartPosition(i,p))
         {
@@ -932,10 +987,11 @@ void LinearWorld::updateRacePosition()
             }
 
             Log::debug("[LinearWorld]", "Who has each ranking so far :");
-            for (unsigned int d=0; d<i; d++)
+            for (unsigned int d=0; d<k; d++)
             {
-                Log::debug("[LinearWorld]", "%s has rank %d", m_karts[d]->getIdent().c_str(),
-                            m_karts[d]->getPosition());
+                Log::debug("[LinearWorld]", "%s has rank %d",
+                           m_karts[m_race_order[d]]->getIdent().c_str(),
+                           m_karts[m_race_order[d]]->getPosition());
             }
 
             Log::debug("[LinearWorld]", "    --> And %s is being set at rank %d",
@@ -955,7 +1011,7 @@ void LinearWorld::updateRacePosition()
             music_manager->switchToFastMusic();
             m_faster_music_active=true;
         }
-    }   // for i<kart_amount
+    }   // for k<m_race_order.size()
 
     // Define this to get a detailled analyses each time a race position
     // changes.
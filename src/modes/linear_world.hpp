@@ -132,7 +132,17 @@ protected:
       */
     std::vector<KartInfo> m_kart_info;
 
+    /** Scratch buffer for the overall distances passed to the kart index. */
+    std::vector<float>    m_kart_progress;
+
+    /** World ids of all karts still racing, sorted by race position. Kept
+     *  between updates, so that only the changes need to be sorted. */
+    std::vector<unsigned int> m_race_order;
+
+    bool          isAhead(unsigned int a, unsigned int b) const;
+
     virtual void  checkForWrongDirection(unsigned int i, float dt);
+    virtual void  updateKartIndex() OVERRIDE;
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
 public:
@@ -21,6 +21,9 @@
 #include "main_loop.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
+#include "io/utf_writer.hpp"
+#include "io/xml_node.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
 #include "tracks/track.hpp"
@@ -31,10 +34,22 @@
 #include <iostream>
 #include <sstream>
 
+#ifndef WIN32
+#  include <sys/resource.h>
+#endif
+
 ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 
+bool        ProfileWorld::m_benchmark            = false;
+std::string ProfileWorld::m_benchmark_file;
+std::string ProfileWorld::m_benchmark_baseline;
+float       ProfileWorld::m_benchmark_tolerance  = 0.1f;
+bool        ProfileWorld::m_benchmark_regression = false;
+uint64_t    ProfileWorld::m_benchmark_ns[BT_COUNT];
+ProfileWorld::BenchmarkScope* ProfileWorld::BenchmarkScope::m_current = NULL;
+
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
  *  karts are used.
@@ -56,8 +71,25 @@ ProfileWorld::ProfileWorld()
     m_num_transparent  = 0;
     m_num_trans_effect = 0;
     m_num_calls        = 0;
+    for (unsigned int i = 0; i < BT_COUNT; i++)
+        m_benchmark_ns[i] = 0;
+    m_benchmark_start  = std::chrono::steady_clock::now();
+    m_load_ms          = 0;
 }   // ProfileWorld
 
+//-----------------------------------------------------------------------------
+/** Loads the track and karts. In benchmark mode the loading time is measured
+ *  separately, and the race timing only starts afterwards.
+ */
+void ProfileWorld::init()
+{
+    const auto start = std::chrono::steady_clock::now();
+    StandardRace::init();
+    m_benchmark_start = std::chrono::steady_clock::now();
+    m_load_ms = std::chrono::duration<double, std::milli>
+                (m_benchmark_start - start).count();
+}   // init
+
 //-----------------------------------------------------------------------------
 /** Sets profile mode off again.
  *  Needed because demo mode's closing allows the player to continue playing
@@ -92,6 +124,42 @@ void ProfileWorld::setProfileModeLaps(int laps)
     m_num_laps     = laps;
 }   // setProfileModeLaps
 
+//-----------------------------------------------------------------------------
+/** Enables benchmark mode: the time spent in the various subsystems is
+ *  measured, and written together with ticks per second and peak memory
+ *  usage to a file at the end of the race.
+ *  \param file Name of the XML file to write the results to.
+ *  \param baseline Name of the results of an earlier run to compare with,
+ *         or an empty string.
+ *  \param tolerance Accepted relative slowdown compared with the baseline,
+ *         e.g. 0.1 for 10%.
+ */
+void ProfileWorld::setBenchmark(const std::string &file,
+                                const std::string &baseline, float tolerance)
+{
+    m_benchmark           = true;
+    m_benchmark_file      = file;
+    m_benchmark_baseline  = baseline;
+    m_benchmark_tolerance = tolerance;
+}   // setBenchmark
+
+//-----------------------------------------------------------------------------
+/** Returns the name of a benchmark timer as used in the result file. */
+const char* ProfileWorld::getBenchmarkTimerName(BenchmarkTimer timer)
+{
+    switch (timer)
+    {
+    case BT_WORLD:   return "world";
+    case BT_KARTS:   return "karts";
+    case BT_AI:      return "ai";
+    case BT_PHYSICS: return "physics";
+    case BT_ITEMS:   return "items";
+    case BT_REWIND:  return "rewind";
+    default:         break;
+    }
+    return "unknown";
+}   // getBenchmarkTimerName
+
 //-----------------------------------------------------------------------------
 /** Creates a kart, having a certain position, starting location, and local
  *  and global player id (if applicable).
@@ -205,6 +273,13 @@ void ProfileWorld::enterRaceOverState()
     Log::verbose("profile", "Number of frames: %d time %f, Average FPS: %f",
                  m_frame_count, runtime, (float)m_frame_count/runtime);
 
+    if (m_benchmark)
+    {
+        writeBenchmark(std::chrono::duration<double>
+                       (std::chrono::steady_clock::now() - m_benchmark_start)
+                       .count());
+    }
+
     // Print geometry statistics if we're not in no-graphics mode
     if(!GUIEngine::isNoGraphics())
     {
@@ -349,3 +424,166 @@ void ProfileWorld::enterRaceOverState()
     delete this;
     main_loop->abort();
 }   // enterRaceOverState
+
+//-----------------------------------------------------------------------------
+/** Returns the peak resident memory of this process in KB, or 0 if this is
+ *  not supported on this platform.
+ */
+static long getPeakRSS()
+{
+#ifdef WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#  ifdef __APPLE__
+    // macOS reports bytes, Linux KB
+    return (long)(usage.ru_maxrss / 1024);
+#  else
+    return (long)usage.ru_maxrss;
+#  endif
+#endif
+}   // getPeakRSS
+
+//-----------------------------------------------------------------------------
+/** Writes the benchmark results (as XML) to the benchmark file, and compares
+ *  them with the baseline if one was specified.
+ *  \param runtime Real time in seconds since the start of the race.
+ */
+void ProfileWorld::writeBenchmark(double runtime)
+{
+    const int ticks = std::max(m_frame_count, 1);
+    const double ticks_per_second = runtime > 0 ? ticks / runtime : 0;
+    const long peak_rss = getPeakRSS();
+    double per_tick_us[BT_COUNT];
+
+    std::ostringstream ss;
+    ss << "<?xml version=\"1.0\"?>\n";
+    ss << "<benchmark track=\"" << Track::getCurrentTrack()->getIdent()
+       << "\" mode=\"" << RaceManager::get()->getMinorModeName()
+       << "\" karts=\"" << getNumKarts()
+       << "\" laps=\"" << RaceManager::get()->getNumLaps()
+       << "\" ticks=\"" << ticks
+       << "\" runtime=\"" << runtime
+       << "\" ticks-per-second=\"" << ticks_per_second
+       << "\" peak-rss-kb=\"" << peak_rss
+       << "\" load-ms=\"" << m_load_ms << "\">\n";
+    ss << "  <!-- Exclusive timings: world doesn't include the other timings, "
+       << "karts doesn't include ai. -->\n";
+    Log::info("benchmark", "Exclusive timings (world doesn't include the "
+              "other timings, karts doesn't include ai):");
+    for (unsigned int i = 0; i < BT_COUNT; i++)
+    {
+        per_tick_us[i] = m_benchmark_ns[i] * 0.001 / ticks;
+        ss << "  <timing name=\""
+           << getBenchmarkTimerName((BenchmarkTimer)i)
+           << "\" total-ms=\"" << m_benchmark_ns[i] * 0.000001
+           << "\" per-tick-us=\"" << per_tick_us[i] << "\"/>\n";
+        Log::info("benchmark", "%-8s %10.3f us/tick",
+                  getBenchmarkTimerName((BenchmarkTimer)i), per_tick_us[i]);
+    }
+    ss << "</benchmark>\n";
+    Log::info("benchmark", "%d ticks in %f s: %f ticks/s, peak RSS %ld KB, "
+              "loaded in %f ms", ticks, runtime, ticks_per_second, peak_rss,
+              m_load_ms);
+
+    if (!m_benchmark_file.empty())
+    {
+        try
+        {
+            UTFWriter file(m_benchmark_file.c_str(), false);
+            file << ss.str();
+            file.close();
+        }
+        catch (std::exception &e)
+        {
+            Log::error("benchmark", "Can't write '%s': %s.",
+                       m_benchmark_file.c_str(), e.what());
+        }
+    }
+
+    if (!m_benchmark_baseline.empty())
+        compareWithBaseline(ticks_per_second, peak_rss, per_tick_us);
+}   // writeBenchmark
+
+//-----------------------------------------------------------------------------
+/** Compares the results of this run with the baseline file (which is the
+ *  result file of an earlier run), and sets m_benchmark_regression if any
+ *  value is worse than the baseline plus the tolerance.
+ */
+void ProfileWorld::compareWithBaseline(double ticks_per_second,
+                                       long peak_rss,
+                                       const double *per_tick_us)
+{
+    XMLNode *root = file_manager->createXMLTree(m_benchmark_baseline);
+    if (!root || root->getName() != "benchmark")
+    {
+        Log::error("benchmark", "Can't read baseline '%s'.",
+                   m_benchmark_baseline.c_str());
+        delete root;
+        m_benchmark_regression = true;
+        return;
+    }
+
+    const double limit = 1.0 + m_benchmark_tolerance;
+    float base_tps = 0;
+    root->get("ticks-per-second", &base_tps);
+    if (base_tps > 0 && ticks_per_second * limit < base_tps)
+    {
+        Log::warn("benchmark", "ticks/s regressed: %f, baseline %f.",
+                  ticks_per_second, base_tps);
+        m_benchmark_regression = true;
+    }
+
+    int base_rss = 0;
+    root->get("peak-rss-kb", &base_rss);
+    if (base_rss > 0 && peak_rss > base_rss * limit)
+    {
+        Log::warn("benchmark", "Peak RSS regressed: %ld KB, baseline %d KB.",
+                  peak_rss, base_rss);
+        m_benchmark_regression = true;
+    }
+
+    float base_load_ms = 0;
+    root->get("load-ms", &base_load_ms);
+    if (base_load_ms > 0 && m_load_ms > base_load_ms * limit)
+    {
+        Log::warn("benchmark", "Loading time regressed: %f ms, "
+                  "baseline %f ms.", m_load_ms, base_load_ms);
+        m_benchmark_regression = true;
+    }
+
+    for (unsigned int i = 0; i < root->getNumNodes(); i++)
+    {
+        const XMLNode *node = root->getNode(i);
+        std::string name;
+        float base_us = 0;
+        if (node->getName() != "timing" || !node->get("name", &name) ||
+            !node->get("per-tick-us", &base_us))
+            continue;
+        for (unsigned int j = 0; j < BT_COUNT; j++)
+        {
+            if (name != getBenchmarkTimerName((BenchmarkTimer)j))
+                continue;
+            // Ignore very small differences, which are just noise for
+            // subsystems that take almost no time.
+            if (per_tick_us[j] > base_us * limit &&
+                per_tick_us[j] - base_us > 1.0)
+            {
+                Log::warn("benchmark", "%s regressed: %f us/tick, "
+                          "baseline %f us/tick.", name.c_str(),
+                          per_tick_us[j], base_us);
+                m_benchmark_regression = true;
+            }
+        }
+    }
+    delete root;
+
+    if (m_benchmark_regression)
+        Log::error("benchmark", "Results are worse than the baseline '%s'.",
+                   m_benchmark_baseline.c_str());
+    else
+        Log::info("benchmark", "Results are within %.0f%% of the baseline.",
+                  m_benchmark_tolerance * 100.0f);
+}   // compareWithBaseline
@@ -21,6 +21,10 @@
 
 #include "modes/standard_race.hpp"
 
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
 class Kart;
 
 /**
@@ -29,6 +33,57 @@ class Kart;
  */
 class ProfileWorld : public StandardRace
 {
+public:
+    /** The subsystems whose update time is measured in benchmark mode. */
+    enum BenchmarkTimer {BT_WORLD, BT_KARTS, BT_AI, BT_PHYSICS, BT_ITEMS,
+                         BT_REWIND, BT_COUNT};
+
+    /** Adds the time spent in its scope to a benchmark timer. Does nothing
+     *  if benchmark mode is not enabled. Scopes can be nested (e.g. ai is
+     *  measured inside of karts, which is inside of world): the enclosing
+     *  scope is paused while a nested scope runs, so each timer only
+     *  contains its own time, and all timers add up to the update time. */
+    class BenchmarkScope
+    {
+    private:
+        BenchmarkTimer m_timer;
+        BenchmarkScope* m_parent;
+        std::chrono::steady_clock::time_point m_start;
+
+        /** The innermost scope, only used by the main thread. */
+        static BenchmarkScope* m_current;
+        // --------------------------------------------------------------------
+        void addTime(const std::chrono::steady_clock::time_point& now)
+        {
+            m_benchmark_ns[m_timer] += (uint64_t)
+                std::chrono::duration_cast<std::chrono::nanoseconds>
+                (now - m_start).count();
+        }   // addTime
+    public:
+        BenchmarkScope(BenchmarkTimer timer) : m_timer(timer), m_parent(NULL)
+        {
+            if (!m_benchmark)
+                return;
+            m_start = std::chrono::steady_clock::now();
+            m_parent = m_current;
+            if (m_parent)
+                m_parent->addTime(m_start);
+            m_current = this;
+        }   // BenchmarkScope
+        // --------------------------------------------------------------------
+        ~BenchmarkScope()
+        {
+            if (!m_benchmark)
+                return;
+            const std::chrono::steady_clock::time_point now =
+                std::chrono::steady_clock::now();
+            addTime(now);
+            m_current = m_parent;
+            if (m_parent)
+                m_parent->m_start = now;
+        }   // ~BenchmarkScope
+    };   // BenchmarkScope
+
 private:
     /** Profiling modes. */
     enum        ProfileType {PROFILE_NONE, PROFILE_TIME, PROFILE_LAPS};
@@ -63,6 +118,34 @@ private:
     /** Number of calls to draw. */
     long long    m_num_calls;
 
+    /** True if benchmark results should be written at the end. */
+    static bool        m_benchmark;
+
+    /** File to write the benchmark results to. */
+    static std::string m_benchmark_file;
+
+    /** Results of an earlier run to compare with, can be empty. */
+    static std::string m_benchmark_baseline;
+
+    /** Relative slowdown compared with the baseline that is accepted. */
+    static float       m_benchmark_tolerance;
+
+    /** Set if a result is worse than the baseline plus tolerance. */
+    static bool        m_benchmark_regression;
+
+    /** Accumulated time in nanoseconds for each BenchmarkTimer. */
+    static uint64_t    m_benchmark_ns[BT_COUNT];
+
+    /** Real time at the start of the race, with high resolution. */
+    std::chrono::steady_clock::time_point m_benchmark_start;
+
+    /** Time in milliseconds used to load the track and karts. */
+    double       m_load_ms;
+
+    void writeBenchmark(double runtime);
+    void compareWithBaseline(double ticks_per_second, long peak_rss,
+                             const double *per_tick_us);
+
 protected:
     /** In laps based profiling: number of laps to run. Also
      *  used by DemoWorld. */
@@ -78,12 +161,19 @@ public:
     virtual              ~ProfileWorld();
     /** Returns identifier for this world. */
     virtual  std::string getInternalCode() const {return "PROFILE"; }
+    virtual  void        init();
     virtual  void        update(int ticks);
     virtual  bool        isRaceOver();
     virtual  void        enterRaceOverState();
 
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
+    static   void setBenchmark(const std::string &file,
+                               const std::string &baseline, float tolerance);
+    static   const char* getBenchmarkTimerName(BenchmarkTimer timer);
+    // ------------------------------------------------------------------------
+    /** Returns true if the benchmark results are worse than the baseline. */
+    static   bool hasBenchmarkRegression() { return m_benchmark_regression; }
     // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
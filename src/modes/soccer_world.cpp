@@ -1116,6 +1116,29 @@ float SoccerWorld::getBallDiameter() const
     return m_bgd->getDiameter();
 }   // getBallDiameter
 
+// ----------------------------------------------------------------------------
+/** Additionally to the interactions between karts, a kart close to the ball
+ *  interacts with it.
+ *  \param distance Distance up to which objects are considered to interact.
+ *  \param swept Distance a kart can move until the next physics step.
+ */
+bool SoccerWorld::hasPhysicsInteraction(float distance, float swept) const
+{
+    if (WorldWithRank::hasPhysicsInteraction(distance, swept))
+        return true;
+
+    const float ball_distance = distance + getBallDiameter();
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (m_karts[i]->isEliminated())
+            continue;
+        if ((m_karts[i]->getXYZ() - getBallPosition()).length2() <
+            ball_distance * ball_distance)
+            return true;
+    }
+    return false;
+}   // hasPhysicsInteraction
+
 // ----------------------------------------------------------------------------
 bool SoccerWorld::ballApproachingGoal(KartTeam team) const
 {
@@ -155,6 +155,9 @@ public:
     virtual const std::string& getIdent() const OVERRIDE;
 
     virtual void update(int ticks) OVERRIDE;
+    // ------------------------------------------------------------------------
+    virtual bool hasPhysicsInteraction(float distance,
+                                       float swept) const OVERRIDE;
 
     bool shouldDrawTimer() const OVERRIDE { return !isStartPhase(); }
     // ------------------------------------------------------------------------
@@ -35,6 +35,7 @@
 #include "io/file_manager.hpp"
 #include "input/device_manager.hpp"
 #include "input/keyboard_device.hpp"
+#include "items/item_manager.hpp"
 #include "items/projectile_manager.hpp"
 #include "karts/controller/battle_ai.hpp"
 #include "karts/ghost_kart.hpp"
@@ -52,6 +53,7 @@
 #include "karts/kart_rewinder.hpp"
 #include "main_loop.hpp"
 #include "modes/overworld.hpp"
+#include "modes/profile_world.hpp"
 #include "network/child_loop.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/network_config.hpp"
@@ -434,6 +436,7 @@ void World::reset(bool restart)
     if (m_process_type == PT_MAIN)
         irr_driver->reset();
     m_unfair_team = false;
+    updateKartIndex();
 }   // reset
 
 //-----------------------------------------------------------------------------
@@ -975,6 +978,7 @@ void World::updateWorld(int ticks)
 #ifdef DEBUG
     assert(m_magic_number == 0xB01D6543);
 #endif
+    ProfileWorld::BenchmarkScope benchmark_world(ProfileWorld::BT_WORLD);
 
 
     if (m_schedule_pause)
@@ -1158,7 +1162,10 @@ void World::update(int ticks)
     WorldStatus::update(ticks);
     PROFILER_POP_CPU_MARKER();
     PROFILER_PUSH_CPU_MARKER("World::update (RewindManager)", 0x20, 0x7F, 0x40);
-    RewindManager::get()->update(ticks);
+    {
+        ProfileWorld::BenchmarkScope bs(ProfileWorld::BT_REWIND);
+        RewindManager::get()->update(ticks);
+    }
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_PUSH_CPU_MARKER("World::update (Track object manager)", 0x20, 0x7F, 0x40);
@@ -1167,29 +1174,42 @@ void World::update(int ticks)
 
     PROFILER_PUSH_CPU_MARKER("World::update (Kart::upate)", 0x40, 0x7F, 0x00);
 
+    // The AI controllers query the kart positions of this snapshot instead
+    // of testing all karts.
+    updateKartIndex();
+
     // Update all the karts. This in turn will also update the controller,
     // which causes all AI steering commands set. So in the following 
     // physics update the new steering is taken into account.
     const int kart_amount = (int)m_karts.size();
-    for (int i = 0 ; i < kart_amount; ++i)
     {
-        SpareTireAI* sta =
-            dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
-        // Update all karts that are not eliminated
-        if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
-            m_karts[i]->update(ticks);
-        if (isStartPhase())
-            m_karts[i]->makeKartRest();
+        ProfileWorld::BenchmarkScope bs(ProfileWorld::BT_KARTS);
+        for (int i = 0 ; i < kart_amount; ++i)
+        {
+            SpareTireAI* sta =
+                dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
+            // Update all karts that are not eliminated
+            if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
+                m_karts[i]->update(ticks);
+            if (isStartPhase())
+                m_karts[i]->makeKartRest();
+        }
     }
     PROFILER_POP_CPU_MARKER();
     if(RaceManager::get()->isRecordingRace()) ReplayRecorder::get()->update(ticks);
 
     PROFILER_PUSH_CPU_MARKER("World::update (projectiles)", 0xa0, 0x7F, 0x00);
-    ProjectileManager::get()->update(ticks);
+    {
+        ProfileWorld::BenchmarkScope bs(ProfileWorld::BT_ITEMS);
+        ProjectileManager::get()->update(ticks);
+    }
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_PUSH_CPU_MARKER("World::update (physics)", 0xa0, 0x7F, 0x00);
-    Physics::get()->update(ticks);
+    {
+        ProfileWorld::BenchmarkScope bs(ProfileWorld::BT_PHYSICS);
+        Physics::get()->update(ticks);
+    }
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_POP_CPU_MARKER();
@@ -1221,6 +1241,61 @@ void World::updateTrack(int ticks)
     Track::getCurrentTrack()->update(ticks);
 }   // update Track
 
+// ----------------------------------------------------------------------------
+/** Rebuilds the spatial index of all karts. Called once per update before
+ *  the karts are updated, and after a reset.
+ */
+void World::updateKartIndex()
+{
+    m_kart_index.build(m_karts);
+}   // updateKartIndex
+
+// ----------------------------------------------------------------------------
+/** Returns true if a kart is close enough to another kart to interact with
+ *  it in the physics, if a kart might reach an item before the next physics
+ *  step, or if a projectile is moving on the track. This is used by a server
+ *  to decide if physics can be simulated at a reduced rate.
+ *  \param distance Distance up to which karts are considered to interact.
+ *  \param swept Distance a kart can move until the next physics step.
+ */
+bool World::hasPhysicsInteraction(float distance, float swept) const
+{
+    if (ProjectileManager::get()->hasActiveProjectiles())
+        return true;
+
+    // Items are collected in Kart::update, which uses the position of the
+    // last physics step. Items are collected up to about 1.1m away (twice
+    // that vertically), see Item::hitKart.
+    const ItemManager* im = Track::getCurrentTrack()->getItemManager();
+    const float item_distance = swept + 2.5f;
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (!m_karts[i]->isEliminated() &&
+            im->itemIsClose(m_karts[i]->getXYZ(), item_distance))
+            return true;
+    }
+
+    std::vector<unsigned int> near_karts;
+    const Vec3 range(distance, distance, distance);
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        const AbstractKart* kart = m_karts[i].get();
+        if (kart->isEliminated())
+            continue;
+        m_kart_index.getKartsInBox(kart->getXYZ() - range,
+                                   kart->getXYZ() + range, &near_karts);
+        for (unsigned int id : near_karts)
+        {
+            if (id == i || m_karts[id]->isEliminated())
+                continue;
+            if ((m_karts[id]->getXYZ() - kart->getXYZ()).length2() <
+                distance * distance)
+                return true;
+        }
+    }
+    return false;
+}   // hasPhysicsInteraction
+
 // ----------------------------------------------------------------------------
 Highscores* World::getHighscores() const
 {
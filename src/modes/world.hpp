@@ -33,6 +33,7 @@
 #include <stdexcept>
 
 #include "graphics/weather.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "modes/world_status.hpp"
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
@@ -113,6 +114,8 @@ protected:
 
     /** The list of all karts. */
     KartList                  m_karts;
+    /** Per-update snapshot of all kart positions, used by the AI. */
+    KartSpatialIndex          m_kart_index;
     RandomGenerator           m_random;
 
     AbstractKart* m_fastest_kart;
@@ -190,6 +193,7 @@ protected:
     virtual void  update(int ticks) OVERRIDE;
     virtual void  createRaceGUI();
             void  updateTrack(int ticks);
+    virtual void  updateKartIndex();
     // ------------------------------------------------------------------------
     /** Used for AI karts that are still racing when all player kart finished.
      *  Generally it should estimate the arrival time for those karts, but as
@@ -341,6 +345,13 @@ public:
     /** Returns all karts. */
     const KartList & getKarts() const { return m_karts; }
     // ------------------------------------------------------------------------
+    /** Returns the spatial index of all karts, which is rebuilt once per
+     *  update before the karts are updated. */
+    const KartSpatialIndex& getKartIndex() const { return m_kart_index; }
+    // ------------------------------------------------------------------------
+    virtual bool    hasPhysicsInteraction(float distance,
+                                          float swept) const;
+    // ------------------------------------------------------------------------
     /** Returns the number of currently active (i.e.non-elikminated) karts. */
     unsigned int    getCurrentNumKarts() const { return (int)m_karts.size() -
                                                          m_eliminated_karts; }
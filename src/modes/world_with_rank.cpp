@@ -104,7 +104,8 @@ void WorldWithRank::beginSetKartPositions()
 //-----------------------------------------------------------------------------
 /** Sets the position of a kart. This will be saved in this object to allow
  *  quick lookup of which kart is on a given position, but also in the
- *  kart objects.
+ *  kart objects. The kart (and its controller, which e.g. lets the
+ *  overtaking kart beep) is only informed if its position changed.
  *  \param kart_id The index of the kart to set the position for.
  *  \param position The position of the kart (1<=position<=num karts).
  *  \return false if this position was already set, i.e. an inconsistency in
@@ -115,7 +116,8 @@ bool WorldWithRank::setKartPosition(unsigned int kart_id,
                                     unsigned int position)
 {
     m_position_index[position-1] = kart_id;
-    m_karts[kart_id]->setPosition(position);
+    if (m_karts[kart_id]->getPosition() != (int)position)
+        m_karts[kart_id]->setPosition(position);
 #ifdef DEBUG
     assert(m_position_setting_initialised);
     if(m_position_used[position-1])
@@ -83,6 +83,7 @@ public:
                                   unsigned int position);
     void          endSetKartPositions();
     AbstractKart* getKartAtPosition(unsigned int p) const;
+    // ------------------------------------------------------------------------
     /** Returns the kart at which position (start from 1) to draw race icon
      *  \param p Position of the kart. */
     virtual AbstractKart* getKartAtDrawingPosition(unsigned int p) const
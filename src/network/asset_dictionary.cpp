@@ -0,0 +1,205 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/asset_dictionary.hpp"
+
+#include "network/network_string.hpp"
+#include "utils/string_utils.hpp"
+
+#include <algorithm>
+
+// ----------------------------------------------------------------------------
+/** Returns the number of assets in this set. */
+unsigned AssetBitset::count() const
+{
+    unsigned n = 0;
+    forEach([&n](unsigned) { n++; });
+    return n;
+}   // count
+
+// ----------------------------------------------------------------------------
+/** Returns how many assets are in both this set and other, without creating
+ *  the intersection.
+ */
+unsigned AssetBitset::countCommon(const AssetBitset& other) const
+{
+    unsigned n = 0;
+    const size_t size = std::min(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < size; i++)
+    {
+        // Clear the lowest set bit until none is left
+        for (uint64_t word = m_words[i] & other.m_words[i]; word != 0;
+             word &= word - 1)
+            n++;
+    }
+    return n;
+}   // countCommon
+
+// ----------------------------------------------------------------------------
+/** Returns true if no asset is in this set. */
+bool AssetBitset::empty() const
+{
+    for (uint64_t word : m_words)
+    {
+        if (word != 0)
+            return false;
+    }
+    return true;
+}   // empty
+
+// ----------------------------------------------------------------------------
+/** Adds the set as a byte count followed by the bytes of the bitset (least
+ *  significant bit first). Trailing zero bytes are not sent.
+ */
+void AssetBitset::encode(BareNetworkString* ns) const
+{
+    std::vector<uint8_t> bytes;
+    for (uint64_t word : m_words)
+    {
+        for (unsigned i = 0; i < 8; i++)
+            bytes.push_back((uint8_t)(word >> (i * 8)));
+    }
+    while (!bytes.empty() && bytes.back() == 0)
+        bytes.pop_back();
+    if (bytes.size() > 65535)
+        bytes.resize(65535);
+    ns->addUInt16((uint16_t)bytes.size());
+    for (uint8_t byte : bytes)
+        ns->addUInt8(byte);
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Reads a set written by encode(). */
+void AssetBitset::decode(const BareNetworkString& ns)
+{
+    m_words.clear();
+    const unsigned num_bytes = ns.getUInt16();
+    m_words.resize((num_bytes + 7) / 8, 0);
+    for (unsigned i = 0; i < num_bytes; i++)
+        m_words[i / 8] |= (uint64_t)ns.getUInt8() << ((i % 8) * 8);
+}   // decode
+
+// ============================================================================
+void AssetDictionary::clear()
+{
+    m_karts.clear();
+    m_tracks.clear();
+    m_kart_index.clear();
+    m_track_index.clear();
+    m_hash = 0;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Appends a kart to the table if it is not in it yet.
+ *  \return True if the kart was added.
+ */
+bool AssetDictionary::addKart(const std::string& ident)
+{
+    if (m_kart_index.find(ident) != m_kart_index.end() ||
+        m_karts.size() >= 65535)
+        return false;
+    m_kart_index[ident] = (unsigned)m_karts.size();
+    m_karts.push_back(ident);
+    const char type = 'k';
+    m_hash = StringUtils::fnv1a64(ident, m_hash == 0 ?
+        StringUtils::fnv1a64(&type, 1) : StringUtils::fnv1a64(&type, 1, m_hash));
+    return true;
+}   // addKart
+
+// ----------------------------------------------------------------------------
+/** Appends a track to the table if it is not in it yet.
+ *  \return True if the track was added.
+ */
+bool AssetDictionary::addTrack(const std::string& ident)
+{
+    if (m_track_index.find(ident) != m_track_index.end() ||
+        m_tracks.size() >= 65535)
+        return false;
+    m_track_index[ident] = (unsigned)m_tracks.size();
+    m_tracks.push_back(ident);
+    const char type = 't';
+    m_hash = StringUtils::fnv1a64(ident, m_hash == 0 ?
+        StringUtils::fnv1a64(&type, 1) : StringUtils::fnv1a64(&type, 1, m_hash));
+    return true;
+}   // addTrack
+
+// ----------------------------------------------------------------------------
+/** Returns the set of the given karts, ignoring karts not in the table. */
+AssetBitset AssetDictionary::getKarts(const std::set<std::string>& idents) const
+{
+    AssetBitset result;
+    for (const std::string& ident : idents)
+    {
+        int index = getKartIndex(ident);
+        if (index != -1)
+            result.set(index);
+    }
+    return result;
+}   // getKarts
+
+// ----------------------------------------------------------------------------
+/** Returns the set of the given tracks, ignoring tracks not in the table. */
+AssetBitset AssetDictionary::getTracks(const std::set<std::string>& idents)
+                                                                         const
+{
+    AssetBitset result;
+    for (const std::string& ident : idents)
+    {
+        int index = getTrackIndex(ident);
+        if (index != -1)
+            result.set(index);
+    }
+    return result;
+}   // getTracks
+
+// ----------------------------------------------------------------------------
+/** Adds the hash and all identifiers of this table to a network string. */
+void AssetDictionary::encode(BareNetworkString* ns) const
+{
+    ns->addUInt64(m_hash).addUInt16((uint16_t)m_karts.size())
+        .addUInt16((uint16_t)m_tracks.size());
+    for (const std::string& kart : m_karts)
+        ns->encodeString(kart);
+    for (const std::string& track : m_tracks)
+        ns->encodeString(track);
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Replaces this table with the one written by encode(). The hash was
+ *  already read from the network string, and is taken as sent, so that it
+ *  matches the version of the sender.
+ */
+void AssetDictionary::decode(const BareNetworkString& ns, uint64_t hash)
+{
+    clear();
+    const unsigned kart_num = ns.getUInt16();
+    const unsigned track_num = ns.getUInt16();
+    for (unsigned i = 0; i < kart_num; i++)
+    {
+        std::string kart;
+        ns.decodeString(&kart);
+        addKart(kart);
+    }
+    for (unsigned i = 0; i < track_num; i++)
+    {
+        std::string track;
+        ns.decodeString(&track);
+        addTrack(track);
+    }
+    m_hash = hash;
+}   // decode
@@ -0,0 +1,147 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ASSET_DICTIONARY_HPP
+#define HEADER_ASSET_DICTIONARY_HPP
+
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BareNetworkString;
+
+/**
+ * \brief A set of karts or tracks, stored as one bit per index of an
+ *  AssetDictionary. Intersections are done a word (64 assets) at a time.
+ * \ingroup network
+ */
+class AssetBitset
+{
+private:
+    std::vector<uint64_t> m_words;
+
+public:
+    // ------------------------------------------------------------------------
+    void set(unsigned index)
+    {
+        if (index / 64 >= m_words.size())
+            m_words.resize(index / 64 + 1, 0);
+        m_words[index / 64] |= (uint64_t)1 << (index % 64);
+    }   // set
+    // ------------------------------------------------------------------------
+    bool test(unsigned index) const
+    {
+        return index / 64 < m_words.size() &&
+               (m_words[index / 64] & ((uint64_t)1 << (index % 64))) != 0;
+    }   // test
+    // ------------------------------------------------------------------------
+    void clear()                                          { m_words.clear(); }
+    // ------------------------------------------------------------------------
+    /** Removes all assets which are not in other. */
+    void intersect(const AssetBitset& other)
+    {
+        if (m_words.size() > other.m_words.size())
+            m_words.resize(other.m_words.size());
+        for (unsigned i = 0; i < m_words.size(); i++)
+            m_words[i] &= other.m_words[i];
+    }   // intersect
+    // ------------------------------------------------------------------------
+    unsigned count() const;
+    unsigned countCommon(const AssetBitset& other) const;
+    bool     empty() const;
+    void     encode(BareNetworkString* ns) const;
+    void     decode(const BareNetworkString& ns);
+    // ------------------------------------------------------------------------
+    /** Calls f(index) for each asset in this set. */
+    template<typename F> void forEach(F f) const
+    {
+        for (unsigned i = 0; i < m_words.size(); i++)
+        {
+            uint64_t word = m_words[i];
+            for (unsigned bit = 0; word != 0; bit++, word >>= 1)
+            {
+                if (word & 1)
+                    f(i * 64 + bit);
+            }
+        }
+    }   // forEach
+};   // AssetBitset
+
+// ============================================================================
+/**
+ * \brief A table of kart and track identifiers, which allows sets of assets
+ *  to be stored and exchanged as AssetBitset. A server builds the table from
+ *  all its assets and sends it to clients which support it, so that later
+ *  asset updates are sent as bitsets instead of lists of identifiers.
+ *  Identifiers are only ever appended, so the index of an asset never
+ *  changes and bitsets stay valid. The hash identifies the version of the
+ *  table.
+ * \ingroup network
+ */
+class AssetDictionary
+{
+private:
+    std::vector<std::string> m_karts, m_tracks;
+
+    std::unordered_map<std::string, unsigned> m_kart_index, m_track_index;
+
+    uint64_t m_hash;
+
+    // ------------------------------------------------------------------------
+    static int getIndex(const std::unordered_map<std::string, unsigned>& map,
+                        const std::string& ident)
+    {
+        auto it = map.find(ident);
+        return it == map.end() ? -1 : (int)it->second;
+    }   // getIndex
+
+public:
+    AssetDictionary()                                          { clear(); }
+    void clear();
+    bool addKart(const std::string& ident);
+    bool addTrack(const std::string& ident);
+    AssetBitset getKarts(const std::set<std::string>& idents) const;
+    AssetBitset getTracks(const std::set<std::string>& idents) const;
+    void encode(BareNetworkString* ns) const;
+    void decode(const BareNetworkString& ns, uint64_t hash);
+    // ------------------------------------------------------------------------
+    /** Returns the index of a kart, or -1 if it is not in the table. */
+    int getKartIndex(const std::string& ident) const
+                                       { return getIndex(m_kart_index, ident); }
+    // ------------------------------------------------------------------------
+    /** Returns the index of a track, or -1 if it is not in the table. */
+    int getTrackIndex(const std::string& ident) const
+                                      { return getIndex(m_track_index, ident); }
+    // ------------------------------------------------------------------------
+    const std::string& getKart(unsigned index) const
+                                                    { return m_karts[index]; }
+    // ------------------------------------------------------------------------
+    const std::string& getTrack(unsigned index) const
+                                                   { return m_tracks[index]; }
+    // ------------------------------------------------------------------------
+    unsigned getNumKarts() const           { return (unsigned)m_karts.size(); }
+    // ------------------------------------------------------------------------
+    unsigned getNumTracks() const         { return (unsigned)m_tracks.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the hash of the table, 0 if it is empty. */
+    uint64_t getHash() const                                { return m_hash; }
+};   // AssetDictionary
+
+#endif
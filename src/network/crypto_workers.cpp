@@ -0,0 +1,197 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/crypto_workers.hpp"
+
+#include "network/crypto.hpp"
+#include "network/network_config.hpp"
+#include "network/network_string.hpp"
+#include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+
+// ----------------------------------------------------------------------------
+CryptoWorkers::CryptoWorkers(unsigned thread_count)
+{
+    m_stop.store(false);
+    m_process_type = STKProcess::getType();
+    for (unsigned i = 0; i < thread_count; i++)
+    {
+        m_workers.emplace_back(new Worker());
+        Worker* worker = m_workers.back().get();
+        worker->m_thread = std::thread(&CryptoWorkers::run, this, worker);
+    }
+}   // CryptoWorkers
+
+// ----------------------------------------------------------------------------
+/** Waits for all threads, after they ran the jobs already added. */
+CryptoWorkers::~CryptoWorkers()
+{
+    m_stop.store(true);
+    for (auto& worker : m_workers)
+    {
+        std::unique_lock<std::mutex> ul(worker->m_mutex);
+        worker->m_cv.notify_one();
+        ul.unlock();
+        worker->m_thread.join();
+    }
+}   // ~CryptoWorkers
+
+// ----------------------------------------------------------------------------
+void CryptoWorkers::run(Worker* worker)
+{
+    std::string thread_name = "CryptoWorker";
+    if (m_process_type == PT_CHILD)
+        thread_name += "_child";
+    VS::setThreadName(thread_name.c_str());
+
+    STKProcess::init(m_process_type);
+    while (true)
+    {
+        std::unique_lock<std::mutex> ul(worker->m_mutex);
+        worker->m_cv.wait(ul, [this, worker]
+            { return !worker->m_jobs.empty() || m_stop.load(); });
+        if (worker->m_jobs.empty())
+            return;
+        std::function<void()> job = std::move(worker->m_jobs.front());
+        worker->m_jobs.pop_front();
+        ul.unlock();
+        job();
+    }
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Runs a job in one of the threads.
+ *  \param host_id The peer the job is for, all jobs of a peer run in the
+ *         same thread in the order they were added.
+ */
+void CryptoWorkers::addJob(uint32_t host_id, std::function<void()> job)
+{
+    Worker* worker = m_workers[host_id % m_workers.size()].get();
+    std::lock_guard<std::mutex> lock(worker->m_mutex);
+    worker->m_jobs.push_back(std::move(job));
+    worker->m_cv.notify_one();
+}   // addJob
+
+// ----------------------------------------------------------------------------
+/** Measures how many game state sized packets one core encrypts and decrypts
+ *  per second, and how many are processed with different numbers of threads,
+ *  then logs the results.
+ *  \param packet_count Number of packets encrypted and decrypted in each
+ *         test.
+ */
+void CryptoWorkers::benchmark(unsigned packet_count)
+{
+    const unsigned PEERS = 64;
+    const unsigned PACKET_SIZE = 600;
+    packet_count = std::max(std::min(packet_count, 1000000u), PEERS);
+
+    std::mt19937 rng(0);
+    std::vector<std::unique_ptr<Crypto> > encrypt, decrypt;
+    for (unsigned i = 0; i < PEERS; i++)
+    {
+        std::vector<uint8_t> key, iv;
+        for (unsigned j = 0; j < 16; j++)
+            key.push_back((uint8_t)rng());
+        for (unsigned j = 0; j < 12; j++)
+            iv.push_back((uint8_t)rng());
+        encrypt.emplace_back(new Crypto(key, iv));
+        decrypt.emplace_back(new Crypto(key, iv));
+    }
+    BareNetworkString data(PACKET_SIZE);
+    for (unsigned i = 0; i < PACKET_SIZE; i++)
+        data.addUInt8((uint8_t)rng());
+
+    // The packets are encrypted as client and decrypted as server, as the
+    // counter is stored at different places of the IV
+    const bool is_server = NetworkConfig::get()->isServer();
+    std::vector<ENetPacket*> packets(packet_count, NULL);
+    auto encrypt_packet = [&](unsigned i)
+        {
+            ENetPacket* p = encrypt[i % PEERS]->encryptSend(data, false);
+            if (packets[i])
+                enet_packet_destroy(packets[i]);
+            packets[i] = p;
+        };
+    std::atomic<unsigned> failed(0);
+    auto decrypt_packet = [&](unsigned i)
+        {
+            try
+            {
+                delete decrypt[i % PEERS]->decryptRecieve(packets[i]);
+            }
+            catch (std::exception&)
+            {
+                failed++;
+            }
+        };
+    auto run = [&](std::function<void(unsigned)> f, bool server,
+                   unsigned threads)->double
+        {
+            NetworkConfig::get()->setIsServer(server);
+            auto start = std::chrono::steady_clock::now();
+            if (threads == 0)
+            {
+                for (unsigned i = 0; i < packet_count; i++)
+                    f(i);
+            }
+            else
+            {
+                CryptoWorkers workers(threads);
+                for (unsigned i = 0; i < packet_count; i++)
+                    workers.addJob(i % PEERS, [f, i]() { f(i); });
+            }
+            const double s = std::chrono::duration<double>
+                (std::chrono::steady_clock::now() - start).count();
+            return s > 0.0 ? packet_count / s : 0.0;
+        };
+
+    Log::info("CryptoWorkers", "%u packets of %u bytes for %u peers.",
+        packet_count, PACKET_SIZE, PEERS);
+    const double encrypt_serial = run(encrypt_packet, false, 0);
+    const double decrypt_serial = run(decrypt_packet, true, 0);
+    Log::info("CryptoWorkers", "Without threads: %.0f encrypted and %.0f "
+        "decrypted packets per second.", encrypt_serial, decrypt_serial);
+
+    const unsigned max_threads =
+        std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        const double encrypted = run(encrypt_packet, false, threads);
+        const double decrypted = run(decrypt_packet, true, threads);
+        Log::info("CryptoWorkers", "%u threads: %.0f encrypted and %.0f "
+            "decrypted packets per second (%.0f and %.0f per thread).",
+            threads, encrypted, decrypted, encrypted / threads,
+            decrypted / threads);
+    }
+    if (failed.load() != 0)
+    {
+        Log::error("CryptoWorkers", "%u packets failed to decrypt.",
+            failed.load());
+    }
+    NetworkConfig::get()->setIsServer(is_server);
+    for (ENetPacket* p : packets)
+    {
+        if (p)
+            enet_packet_destroy(p);
+    }
+}   // benchmark
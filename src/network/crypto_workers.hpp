@@ -0,0 +1,79 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CRYPTO_WORKERS_HPP
+#define HEADER_CRYPTO_WORKERS_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/stk_process.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A few threads which decrypt the packets received and encrypt the
+ *  packets sent by a server, so that the listening and game threads don't
+ *  do it for every peer, see the crypto-threads server option.
+ *  The jobs of a peer always run in one thread in the order they were
+ *  added, so the packets of a peer are not reordered.
+ * \ingroup network
+ */
+class CryptoWorkers : public NoCopy
+{
+private:
+    struct Worker
+    {
+        std::mutex m_mutex;
+
+        std::condition_variable m_cv;
+
+        std::deque<std::function<void()> > m_jobs;
+
+        std::thread m_thread;
+    };
+
+    std::vector<std::unique_ptr<Worker> > m_workers;
+
+    std::atomic_bool m_stop;
+
+    /** Process (main or child server) the threads belong to. */
+    ProcessType m_process_type;
+
+    // ------------------------------------------------------------------------
+    void run(Worker* worker);
+
+public:
+    CryptoWorkers(unsigned thread_count);
+    // ------------------------------------------------------------------------
+    ~CryptoWorkers();
+    // ------------------------------------------------------------------------
+    void addJob(uint32_t host_id, std::function<void()> job);
+    // ------------------------------------------------------------------------
+    static void benchmark(unsigned packet_count);
+    // ------------------------------------------------------------------------
+    unsigned getThreadCount() const      { return (unsigned)m_workers.size(); }
+};   // CryptoWorkers
+
+#endif
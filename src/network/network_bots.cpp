@@ -0,0 +1,468 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/network_bots.hpp"
+
+#include "config/stk_config.hpp"
+#include "input/input.hpp"
+#include "network/event.hpp"
+#include "network/network.hpp"
+#include "network/network_string.hpp"
+#include "network/peer_vote.hpp"
+#include "network/protocols/client_lobby.hpp"
+#include "network/protocols/game_protocol.hpp"
+#include "network/protocols/lobby_protocol.hpp"
+#include "network/server_config.hpp"
+#include "network/stk_peer.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+// ----------------------------------------------------------------------------
+/** Creates the bots and starts connecting them to the server.
+ *  \param server_address Address of the server.
+ *  \param count Number of bots to connect.
+ */
+NetworkBots::NetworkBots(const ENetAddress &server_address, unsigned count)
+{
+    m_server_address = server_address;
+    m_bots.resize(count);
+    for (Bot &bot : m_bots)
+        connect(bot);
+}   // NetworkBots
+
+// ----------------------------------------------------------------------------
+NetworkBots::~NetworkBots()
+{
+    for (Bot &bot : m_bots)
+    {
+        if (!bot.m_network)
+            continue;
+        if (bot.m_state != BS_DISCONNECTED)
+        {
+            enet_peer_disconnect_now(bot.m_peer, PDI_NORMAL);
+            enet_host_flush(bot.m_network->getENetHost());
+        }
+        delete bot.m_network;
+    }
+}   // ~NetworkBots
+
+// ----------------------------------------------------------------------------
+/** Creates the socket of a bot and connects it to the server.
+ */
+void NetworkBots::connect(Bot &bot)
+{
+    bot.m_peer             = NULL;
+    bot.m_state            = BS_DISCONNECTED;
+    bot.m_host_id          = std::numeric_limits<uint32_t>::max();
+    bot.m_kart_id          = -1;
+    bot.m_time_offset      = 0;
+    bot.m_start_time       = std::numeric_limits<uint64_t>::max();
+    bot.m_next_action_time = 0;
+    bot.m_num_actions      = 0;
+    bot.m_steer_l          = 0;
+    bot.m_steer_r          = 0;
+    bot.m_last_state_ticks = -1;
+    bot.m_last_state_time  = 0;
+    bot.m_num_states       = 0;
+    bot.m_state_jitter_sum = 0.0;
+    bot.m_state_jitter_max = 0.0;
+    bot.m_ping_sum         = 0;
+    bot.m_ping_max         = 0;
+    bot.m_num_pings        = 0;
+
+    // Any port
+    ENetAddress address = {};
+    bot.m_network = new Network(/*peer_count*/1,
+        /*channel_limit*/EVENT_CHANNEL_COUNT, /*max_in_bandwidth*/0,
+        /*max_out_bandwidth*/0, &address);
+    if (!bot.m_network->getENetHost())
+    {
+        Log::error("NetworkBots", "Failed to create a socket.");
+        return;
+    }
+    bot.m_peer = bot.m_network->connectTo(m_server_address);
+    if (bot.m_peer)
+        bot.m_state = BS_CONNECTING;
+}   // connect
+
+// ----------------------------------------------------------------------------
+/** Sends a packet to the server. All messages use the normal channel, which
+ *  is not encrypted since encryption is not supported by the bots.
+ */
+void NetworkBots::send(Bot &bot, const NetworkString &data, bool reliable)
+{
+    ENetPacket* packet = enet_packet_create(data.getData(),
+        data.getTotalSize(), reliable ? ENET_PACKET_FLAG_RELIABLE :
+        (ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT));
+    if (packet && enet_peer_send(bot.m_peer, EVENT_CHANNEL_NORMAL, packet) < 0)
+        enet_packet_destroy(packet);
+}   // send
+
+// ----------------------------------------------------------------------------
+/** Sends the connection request, which has the same content as the one sent
+ *  by ClientLobby for a LAN player without online account.
+ *  \param index Index of the bot, used in the player name.
+ */
+void NetworkBots::sendConnectionRequest(Bot &bot, unsigned index)
+{
+    NetworkString ns(PROTOCOL_LOBBY_ROOM);
+    ns.addUInt8(LobbyProtocol::LE_CONNECTION_REQUESTED)
+      .addUInt32(ServerConfig::m_server_version)
+      .encodeString(std::string("LoadBot"))
+      .addUInt16((uint16_t)stk_config->m_network_capabilities.size());
+    for (const std::string& cap : stk_config->m_network_capabilities)
+        ns.encodeString(cap);
+    ClientLobby::getKartsTracksNetworkString(&ns);
+    // One player, no online id and no encrypted data
+    ns.addUInt8(1).addUInt32(0).addUInt32(0);
+
+    ns.encodeString(std::string(ServerConfig::m_private_server_password))
+      .addUInt8(1)
+      .encodeString("Load bot " + StringUtils::toString(index + 1))
+      .addFloat(0.0f).addUInt8(HANDICAP_NONE);
+    send(bot, ns, /*reliable*/true);
+    bot.m_state = BS_REQUESTING;
+}   // sendConnectionRequest
+
+// ----------------------------------------------------------------------------
+/** Handles the ping packet which the server sends to all clients in the
+ *  lobby. It is used to synchronise the network timer with the server, the
+ *  same way as NetworkTimerSynchronizer does.
+ */
+void NetworkBots::handlePingPacket(Bot &bot, const ENetPacket *packet)
+{
+    BareNetworkString ping((char*)packet->data, (int)packet->dataLength);
+    // Skip the 255 'ping' header
+    ping.skip(5);
+    const uint64_t server_time = ping.getUInt64();
+    bot.m_time_offset = (int64_t)server_time +
+        (int64_t)(bot.m_peer->roundTripTime / 2) -
+        (int64_t)StkTime::getMonoTimeMs();
+}   // handlePingPacket
+
+// ----------------------------------------------------------------------------
+/** Returns the current world ticks of the server, estimated from the
+ *  synchronised network timer, or -1 if the race has not started yet.
+ */
+int NetworkBots::getServerTicks(const Bot &bot) const
+{
+    const int64_t server_time =
+        (int64_t)StkTime::getMonoTimeMs() + bot.m_time_offset;
+    if (bot.m_start_time == std::numeric_limits<uint64_t>::max() ||
+        server_time < (int64_t)bot.m_start_time)
+        return -1;
+    return stk_config->time2Ticks((server_time - bot.m_start_time) / 1000.0f);
+}   // getServerTicks
+
+// ----------------------------------------------------------------------------
+void NetworkBots::handlePacket(Bot &bot, const ENetPacket *packet)
+{
+    const unsigned char* data = packet->data;
+    if (packet->dataLength > 5 && data[0] == 255 && data[1] == 'p' &&
+        data[2] == 'i' && data[3] == 'n' && data[4] == 'g')
+    {
+        handlePingPacket(bot, packet);
+        return;
+    }
+
+    NetworkString ns(packet->data, (int)packet->dataLength);
+    if (ns.size() == 0)
+        return;
+    switch (ns.getProtocolType())
+    {
+    case PROTOCOL_LOBBY_ROOM:        handleLobbyMessage(bot, ns); break;
+    case PROTOCOL_CONTROLLER_EVENTS: handleGameMessage(bot, ns);  break;
+    default:                                                      break;
+    }
+}   // handlePacket
+
+// ----------------------------------------------------------------------------
+/** Handles the lobby messages which are needed to join a race. All other
+ *  lobby messages (e.g. player lists or chat) are ignored.
+ */
+void NetworkBots::handleLobbyMessage(Bot &bot, NetworkString &data)
+{
+    switch (data.getUInt8())
+    {
+    case LobbyProtocol::LE_CONNECTION_ACCEPTED:
+        bot.m_host_id = data.getUInt32();
+        bot.m_state = BS_LOBBY;
+        break;
+    case LobbyProtocol::LE_CONNECTION_REFUSED:
+        Log::warn("NetworkBots", "Bot refused by server with reason %d.",
+                  data.getUInt8());
+        enet_peer_disconnect(bot.m_peer, PDI_NORMAL);
+        break;
+    case LobbyProtocol::LE_LOAD_WORLD:
+    {
+        // Find the kart id of this bot, see ServerLobby::encodePlayers
+        data.getUInt32();
+        PeerVote vote(data);
+        data.getUInt8();
+        bot.m_kart_id = -1;
+        const unsigned player_count = data.getUInt8();
+        for (unsigned i = 0; i < player_count; i++)
+        {
+            std::string name, country_code, kart_name;
+            data.decodeString(&name);
+            const uint32_t host_id = data.getUInt32();
+            data.getFloat();
+            data.getUInt32();
+            data.getUInt8();
+            const uint8_t local_id = data.getUInt8();
+            data.getUInt8();
+            data.decodeString(&country_code);
+            data.decodeString(&kart_name);
+            if (host_id == bot.m_host_id && local_id == 0)
+                bot.m_kart_id = (int)i;
+        }
+        // The world is 'loaded' immediately
+        NetworkString ns(PROTOCOL_LOBBY_ROOM);
+        ns.addUInt8(LobbyProtocol::LE_CLIENT_LOADED_WORLD);
+        send(bot, ns, /*reliable*/true);
+        bot.m_state = BS_LOADED;
+        break;
+    }
+    case LobbyProtocol::LE_START_RACE:
+        bot.m_start_time       = data.getUInt64();
+        bot.m_next_action_time = 0;
+        bot.m_num_actions      = 0;
+        bot.m_steer_l          = 0;
+        bot.m_steer_r          = 0;
+        bot.m_last_state_ticks = -1;
+        bot.m_state            = BS_RACING;
+        break;
+    case LobbyProtocol::LE_RACE_FINISHED:
+    {
+        NetworkString ns(PROTOCOL_LOBBY_ROOM);
+        ns.setSynchronous(true);
+        ns.addUInt8(LobbyProtocol::LE_RACE_FINISHED_ACK);
+        send(bot, ns, /*reliable*/true);
+        bot.m_start_time = std::numeric_limits<uint64_t>::max();
+        bot.m_kart_id    = -1;
+        bot.m_state      = BS_LOBBY;
+        break;
+    }
+    case LobbyProtocol::LE_BACK_LOBBY:
+        bot.m_start_time = std::numeric_limits<uint64_t>::max();
+        bot.m_kart_id    = -1;
+        bot.m_state      = BS_LOBBY;
+        break;
+    default:
+        break;
+    }
+}   // handleLobbyMessage
+
+// ----------------------------------------------------------------------------
+/** Handles a state from the server: the time between two states is compared
+ *  with the ticks between them to measure how stable the server runs, and
+ *  the state is confirmed (so the server can discard older item events).
+ */
+void NetworkBots::handleGameMessage(Bot &bot, NetworkString &data)
+{
+    if (data.getUInt8() != GameProtocol::GP_STATE)
+        return;
+
+    const int ticks = data.getUInt32();
+    const uint64_t now = StkTime::getMonoTimeMs();
+    if (bot.m_last_state_ticks >= 0 && ticks > bot.m_last_state_ticks)
+    {
+        const double expected = 1000.0 *
+            stk_config->ticks2Time(ticks - bot.m_last_state_ticks);
+        const double jitter =
+            std::fabs(double(now - bot.m_last_state_time) - expected);
+        bot.m_state_jitter_sum += jitter;
+        bot.m_state_jitter_max = std::max(bot.m_state_jitter_max, jitter);
+        bot.m_num_states++;
+    }
+    if (ticks > bot.m_last_state_ticks)
+    {
+        bot.m_last_state_ticks = ticks;
+        bot.m_last_state_time  = now;
+    }
+
+    const uint32_t ping = bot.m_peer->roundTripTime;
+    bot.m_ping_sum += ping;
+    bot.m_ping_max = std::max(bot.m_ping_max, ping);
+    bot.m_num_pings++;
+
+    NetworkString ns(PROTOCOL_CONTROLLER_EVENTS);
+    ns.addUInt8(GameProtocol::GP_ITEM_CONFIRMATION).addUInt32(ticks);
+    send(bot, ns, /*reliable*/false);
+}   // handleGameMessage
+
+// ----------------------------------------------------------------------------
+/** Sends the next scripted controller action: the bot accelerates and then
+ *  keeps steering left and right.
+ */
+void NetworkBots::sendNextAction(Bot &bot)
+{
+    const int ticks = getServerTicks(bot);
+    if (ticks < 0 || bot.m_kart_id < 0)
+        return;
+
+    PlayerAction action = PA_ACCEL;
+    int value = Input::MAX_VALUE;
+    if (bot.m_num_actions > 0)
+    {
+        const unsigned step = (bot.m_num_actions - 1) % 4;
+        action = step < 2 ? PA_STEER_LEFT : PA_STEER_RIGHT;
+        value = step % 2 == 0 ? Input::MAX_VALUE : 0;
+    }
+    bot.m_num_actions++;
+
+    // Same encoding as GameProtocol::compressAction, the left and right
+    // steering values are the values before this action.
+    const uint8_t w = (uint8_t)(action & 63) | (bot.m_steer_l > 0 ? 64 : 0) |
+                      (bot.m_steer_r > 0 ? 128 : 0);
+    NetworkString ns(PROTOCOL_CONTROLLER_EVENTS);
+    ns.addUInt8(GameProtocol::GP_CONTROLLER_ACTION).addUInt8(1)
+      .addUInt32(ticks).addUInt8((uint8_t)bot.m_kart_id).addUInt8(w)
+      .addUInt16((uint16_t)value).addUInt16((uint16_t)std::abs(bot.m_steer_l))
+      .addUInt16((uint16_t)std::abs(bot.m_steer_r));
+    send(bot, ns, /*reliable*/true);
+
+    if (action == PA_STEER_LEFT)
+        bot.m_steer_l = value;
+    else if (action == PA_STEER_RIGHT)
+        bot.m_steer_r = -value;
+}   // sendNextAction
+
+// ----------------------------------------------------------------------------
+/** Prints the number of connected bots, the latency and the irregularity of
+ *  the states (difference between the time between two states and the time
+ *  the ticks between them should take).
+ *  \param final_report If true, the latency of each bot is printed as well.
+ */
+void NetworkBots::report(bool final_report)
+{
+    unsigned connected = 0, racing = 0, num_pings = 0, num_states = 0;
+    uint64_t ping_sum = 0;
+    uint32_t ping_max = 0;
+    double jitter_sum = 0.0, jitter_max = 0.0;
+    for (unsigned i = 0; i < m_bots.size(); i++)
+    {
+        const Bot &bot = m_bots[i];
+        if (bot.m_state != BS_DISCONNECTED && bot.m_state != BS_CONNECTING)
+            connected++;
+        if (bot.m_state == BS_RACING)
+            racing++;
+        num_pings  += bot.m_num_pings;
+        ping_sum   += bot.m_ping_sum;
+        ping_max    = std::max(ping_max, bot.m_ping_max);
+        num_states += bot.m_num_states;
+        jitter_sum += bot.m_state_jitter_sum;
+        jitter_max  = std::max(jitter_max, bot.m_state_jitter_max);
+        if (final_report)
+        {
+            Log::info("NetworkBots", "Bot %u: ping average %u max %u ms, "
+                "%u states, state jitter average %.1f max %.1f ms.", i + 1,
+                bot.m_num_pings ? unsigned(bot.m_ping_sum / bot.m_num_pings)
+                                : 0, bot.m_ping_max, bot.m_num_states,
+                bot.m_num_states ? bot.m_state_jitter_sum / bot.m_num_states
+                                 : 0.0, bot.m_state_jitter_max);
+        }
+    }
+    Log::info("NetworkBots", "%u of %u bots connected, %u racing. Ping "
+        "average %u max %u ms, state jitter average %.1f max %.1f ms.",
+        connected, (unsigned)m_bots.size(), racing,
+        num_pings ? unsigned(ping_sum / num_pings) : 0, ping_max,
+        num_states ? jitter_sum / num_states : 0.0, jitter_max);
+}   // report
+
+// ----------------------------------------------------------------------------
+/** Runs all bots.
+ *  \param duration Time in seconds after which the bots disconnect. If it
+ *         is 0, the bots run until all of them are disconnected.
+ */
+void NetworkBots::run(float duration)
+{
+    const uint64_t ACTION_INTERVAL = 250;
+    const uint64_t REPORT_INTERVAL = 10000;
+    const uint64_t start = StkTime::getMonoTimeMs();
+    const uint64_t end = duration > 0.0f ?
+        start + uint64_t(duration * 1000.0f) :
+        std::numeric_limits<uint64_t>::max();
+    uint64_t next_report = start + REPORT_INTERVAL;
+
+    while (StkTime::getMonoTimeMs() < end)
+    {
+        bool any_connected = false;
+        for (unsigned i = 0; i < m_bots.size(); i++)
+        {
+            Bot &bot = m_bots[i];
+            if (bot.m_state == BS_DISCONNECTED)
+                continue;
+            any_connected = true;
+
+            ENetEvent event;
+            while (bot.m_state != BS_DISCONNECTED &&
+                   enet_host_service(bot.m_network->getENetHost(),
+                                     &event, 0) > 0)
+            {
+                if (event.type == ENET_EVENT_TYPE_CONNECT)
+                {
+                    sendConnectionRequest(bot, i);
+                }
+                else if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+                {
+                    Log::info("NetworkBots", "Bot %u disconnected (%d).",
+                              i + 1, (int)event.data);
+                    bot.m_state = BS_DISCONNECTED;
+                }
+                else if (event.type == ENET_EVENT_TYPE_RECEIVE)
+                {
+                    try
+                    {
+                        handlePacket(bot, event.packet);
+                    }
+                    catch (std::exception& e)
+                    {
+                        Log::warn("NetworkBots", "Invalid packet: %s",
+                                  e.what());
+                    }
+                    enet_packet_destroy(event.packet);
+                }
+            }
+
+            const uint64_t now = StkTime::getMonoTimeMs();
+            if (bot.m_state == BS_RACING && now >= bot.m_next_action_time)
+            {
+                sendNextAction(bot);
+                bot.m_next_action_time = now + ACTION_INTERVAL;
+            }
+        }
+        if (!any_connected)
+            break;
+
+        if (StkTime::getMonoTimeMs() >= next_report)
+        {
+            report(/*final_report*/false);
+            next_report += REPORT_INTERVAL;
+        }
+        StkTime::sleep(1);
+    }
+    report(/*final_report*/true);
+}   // run
@@ -0,0 +1,112 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_NETWORK_BOTS_HPP
+#define HEADER_NETWORK_BOTS_HPP
+
+#include "utils/no_copy.hpp"
+
+#define WIN32_LEAN_AND_MEAN
+#include <enet/enet.h>
+
+#include <stdint.h>
+#include <vector>
+
+class Network;
+class NetworkString;
+
+/**
+ * \brief A load generator which connects many lightweight bots to a server.
+ *  Each bot only speaks the lobby and game protocol: it joins the lobby,
+ *  reports the world as loaded as soon as the server asks to load it, sends
+ *  scripted controller actions during a race and confirms the states it
+ *  receives. No world is loaded or simulated, so a hundred or more bots can
+ *  be run in one process to test the capacity of a server.
+ *  Periodically the latency of the connections and the regularity of the
+ *  states sent by the server (i.e. how stable the tick rate of the server
+ *  is) are reported.
+ *  Only unencrypted (i.e. LAN) servers are supported.
+ * \ingroup network
+ */
+class NetworkBots : public NoCopy
+{
+private:
+    /** State of one bot. */
+    enum BotState
+    {
+        BS_CONNECTING,
+        BS_REQUESTING,
+        BS_LOBBY,
+        BS_LOADED,
+        BS_RACING,
+        BS_DISCONNECTED
+    };
+
+    /** All data of one connection to the server. */
+    struct Bot
+    {
+        /** Each bot uses its own socket, like a separate client. */
+        Network *m_network;
+        ENetPeer *m_peer;
+        BotState m_state;
+        uint32_t m_host_id;
+        /** World id of the kart of this bot in the current race, or -1. */
+        int m_kart_id;
+        /** Network timer of the server minus the local time (in ms). */
+        int64_t m_time_offset;
+        /** Network timer of the server at which the race starts. */
+        uint64_t m_start_time;
+        uint64_t m_next_action_time;
+        unsigned m_num_actions;
+        /** Steering values before the next action, the same as in
+         *  PlayerController (the right value is negative). */
+        int m_steer_l, m_steer_r;
+        /** Ticks and arrival time of the last state received. */
+        int m_last_state_ticks;
+        uint64_t m_last_state_time;
+        /** Statistics since the bot connected. */
+        unsigned m_num_states;
+        double m_state_jitter_sum, m_state_jitter_max;
+        uint64_t m_ping_sum;
+        uint32_t m_ping_max;
+        unsigned m_num_pings;
+    };   // Bot
+
+    std::vector<Bot> m_bots;
+
+    /** Address of the server. */
+    ENetAddress m_server_address;
+
+    void connect(Bot &bot);
+    void sendConnectionRequest(Bot &bot, unsigned index);
+    void handlePacket(Bot &bot, const ENetPacket *packet);
+    void handleLobbyMessage(Bot &bot, NetworkString &data);
+    void handleGameMessage(Bot &bot, NetworkString &data);
+    void handlePingPacket(Bot &bot, const ENetPacket *packet);
+    void sendNextAction(Bot &bot);
+    void send(Bot &bot, const NetworkString &data, bool reliable);
+    int  getServerTicks(const Bot &bot) const;
+    void report(bool final_report);
+
+public:
+         NetworkBots(const ENetAddress &server_address, unsigned count);
+        ~NetworkBots();
+    void run(float duration);
+};   // NetworkBots
+
+#endif
@@ -194,6 +194,8 @@ bool ClientLobby::notifyEvent(Event* event)
         case LE_KART_INFO:             handleKartInfo(event);      break;
         case LE_START_RACE:            startGame(event);           break;
         case LE_REPORT_PLAYER:         reportSuccess(event);       break;
+        case LE_ASSET_DICTIONARY:  handleAssetDictionary(event);   break;
+        case LE_LIVE_JOIN_ITEMS:       liveJoinItems(event);       break;
         default:
             break;
     }   // switch
@@ -1240,6 +1242,23 @@ void ClientLobby::finishedLoadingWorld()
     delete ns;
 }   // finishedLoadingWorld
 
+//-----------------------------------------------------------------------------
+/** Stores a chunk of the item states sent by the server before the live join
+ *  ack, the items near the karts of this client come first.
+ */
+void ClientLobby::liveJoinItems(Event* event)
+{
+    if (!World::getWorld())
+        return;
+
+    const NetworkString& data = event->data();
+    NetworkItemManager* nim = dynamic_cast<NetworkItemManager*>
+        (Track::getCurrentTrack()->getItemManager());
+    assert(nim);
+    const unsigned count = data.getUInt16();
+    nim->restoreCompleteItemStates(data, count);
+}   // liveJoinItems
+
 //-----------------------------------------------------------------------------
 void ClientLobby::liveJoinAcknowledged(Event* event)
 {
@@ -1268,7 +1287,13 @@ void ClientLobby::liveJoinAcknowledged(Event* event)
     NetworkItemManager* nim = dynamic_cast<NetworkItemManager*>
         (Track::getCurrentTrack()->getItemManager());
     assert(nim);
-    nim->restoreCompleteState(data);
+    // With live_join_chunks the item states were sent before in
+    // LE_LIVE_JOIN_ITEMS
+    if (NetworkConfig::get()->getServerCapabilities().find("live_join_chunks")
+        != NetworkConfig::get()->getServerCapabilities().end())
+        nim->restoreCompleteStateHeader(data);
+    else
+        nim->restoreCompleteState(data);
     w->restoreCompleteState(data);
 
     if (RaceManager::get()->supportsLiveJoining() && data.size() > 0)
@@ -1802,11 +1827,52 @@ void ClientLobby::getKartsTracksNetworkString(BareNetworkString* ns)
 }   // getKartsTracksNetworkString
 
 // ----------------------------------------------------------------------------
+/** Sends the current karts and tracks to the server. If the server supports
+ *  it, only a bitset for its asset dictionary is sent.
+ */
 void ClientLobby::updateAssetsToServer()
 {
     NetworkString* ns = getNetworkString(1);
     ns->addUInt8(LE_ASSETS_UPDATE);
-    getKartsTracksNetworkString(ns);
+    const auto& caps = NetworkConfig::get()->getServerCapabilities();
+    if (caps.find("asset_dictionary") != caps.end())
+    {
+        // If the dictionary is outdated, the server will send a new one
+        AssetBitset karts, tracks;
+        for (const std::string& kart :
+             kart_properties_manager->getAllAvailableKarts())
+        {
+            int index = m_asset_dictionary.getKartIndex(kart);
+            if (index != -1)
+                karts.set(index);
+        }
+        for (const std::string& track :
+             track_manager->getAllTrackIdentifiers())
+        {
+            int index = m_asset_dictionary.getTrackIndex(track);
+            if (index != -1)
+                tracks.set(index);
+        }
+        ns->addUInt64(m_asset_dictionary.getHash());
+        karts.encode(ns);
+        tracks.encode(ns);
+    }
+    else
+        getKartsTracksNetworkString(ns);
     sendToServer(ns, /*reliable*/true);
     delete ns;
 }   // updateAssetsToServer
+
+// ----------------------------------------------------------------------------
+/** Receives the asset dictionary of the server.
+ */
+void ClientLobby::handleAssetDictionary(Event* event)
+{
+    if (!checkDataSize(event, 13)) return;
+    const NetworkString& data = event->data();
+    const bool request_update = data.getUInt8() == 1;
+    const uint64_t hash = data.getUInt64();
+    m_asset_dictionary.decode(data, hash);
+    if (request_update)
+        updateAssetsToServer();
+}   // handleAssetDictionary
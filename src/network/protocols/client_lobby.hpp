@@ -20,6 +20,7 @@
 #define CLIENT_LOBBY_HPP
 
 #include "input/input.hpp"
+#include "network/asset_dictionary.hpp"
 #include "network/protocols/lobby_protocol.hpp"
 #include "utils/cpp2011.hpp"
 
@@ -68,6 +69,7 @@ private:
     void updatePlayerList(Event* event);
     void handleChat(Event* event);
     void handleServerInfo(Event* event);
+    void handleAssetDictionary(Event* event);
     void reportSuccess(Event* event);
     void handleBadTeam();
     void handleBadConnection();
@@ -120,6 +122,9 @@ private:
     std::set<std::string> m_available_karts;
     std::set<std::string> m_available_tracks;
 
+    /** Karts and tracks table of the server, if it supports it. */
+    AssetDictionary m_asset_dictionary;
+
     void addAllPlayers(Event* event);
     void finalizeConnectionRequest(NetworkString* header,
                                    BareNetworkString* rest, bool encrypt);
@@ -133,14 +138,15 @@ private:
     irr::core::stringw m_total_players;
 
     void liveJoinAcknowledged(Event* event);
+    void liveJoinItems(Event* event);
     void handleKartInfo(Event* event);
     void finishLiveJoin();
     std::vector<std::shared_ptr<NetworkPlayerProfile> >
          decodePlayers(const BareNetworkString& data,
          std::shared_ptr<STKPeer> peer = nullptr,
          bool* is_spectator = NULL) const;
-    void getKartsTracksNetworkString(BareNetworkString* ns);
 public:
+    static void getKartsTracksNetworkString(BareNetworkString* ns);
              ClientLobby(std::shared_ptr<Server> s);
     virtual ~ClientLobby();
     void doneWithResults();
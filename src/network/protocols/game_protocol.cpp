@@ -31,6 +31,7 @@
 #include "network/protocol_manager.hpp"
 #include "network/rewind_info.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/server_metrics.hpp"
 #include "network/socket_address.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
@@ -333,6 +334,8 @@ void GameProtocol::finalizeState(std::vector<std::string>& cur_rewinder)
 void GameProtocol::sendState()
 {
     assert(NetworkConfig::get()->isServer());
+    if (ServerMetrics* metrics = ServerMetrics::get())
+        metrics->addStatePacket(m_data_to_send->getTotalSize());
     sendMessageToPeers(m_data_to_send, /*reliable*/false);
 }   // sendState
 
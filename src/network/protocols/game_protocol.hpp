@@ -39,11 +39,7 @@ class STKPeer;
 class GameProtocol : public Protocol
                    , public EventRewinder
 {
-private:
-    /* Used to check if deleting world is doing at the same the for
-     * asynchronous event update. */
-    mutable std::mutex m_world_deleting_mutex;
-
+public:
     /** The type of game events to be forwarded to the server. */
     enum { GP_CONTROLLER_ACTION,
            GP_STATE,
@@ -52,6 +48,11 @@ private:
            GP_ADJUST_TIME
     };
 
+private:
+    /* Used to check if deleting world is doing at the same the for
+     * asynchronous event update. */
+    mutable std::mutex m_world_deleting_mutex;
+
     /** A network string that collects all information from the server to be sent
      *  next. */
     NetworkString *m_data_to_send;
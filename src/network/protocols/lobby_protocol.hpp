@@ -81,6 +81,8 @@ public:
                          // (like abusive behaviour)
         LE_ASSETS_UPDATE, // Client tell server with updated assets
         LE_COMMAND, // Command
+        LE_ASSET_DICTIONARY, // Server tell client its karts / tracks table
+        LE_LIVE_JOIN_ITEMS, // Chunk of item states for live join
     };
 
     enum RejectReason : uint8_t
@@ -41,6 +41,7 @@
 #include "network/protocols/game_events_protocol.hpp"
 #include "network/race_event_manager.hpp"
 #include "network/server_config.hpp"
+#include "network/server_metrics.hpp"
 #include "network/socket_address.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_ipv6.hpp"
@@ -238,6 +239,7 @@ ServerLobby::~ServerLobby()
     }
     delete m_result_ns;
     delete m_items_complete_state;
+    clearLiveJoinTransfers();
     if (m_save_server_config)
         ServerConfig::writeServerConfigToDisk();
     delete m_default_vote;
@@ -275,6 +277,8 @@ void ServerLobby::initDatabase()
             int retry_count = ServerConfig::m_database_timeout / 100;
             if (retry < retry_count)
             {
+                if (ServerMetrics* metrics = ServerMetrics::get())
+                    metrics->addDatabaseBusyRetry();
                 sqlite3_sleep(100);
                 // Return non-zero to let caller retry again
                 return 1;
@@ -282,6 +286,17 @@ void ServerLobby::initDatabase()
             // Return zero to let caller return SQLITE_BUSY immediately
             return 0;
         }, NULL);
+    if (ServerConfig::m_metrics_port > 0)
+    {
+        // Count the time of each statement, x is the time in nanoseconds
+        sqlite3_trace_v2(m_db, SQLITE_TRACE_PROFILE,
+            [](unsigned type, void* data, void* p, void* x)
+            {
+                if (ServerMetrics* metrics = ServerMetrics::get())
+                    metrics->addDatabaseQuery(*(sqlite3_int64*)x / 1000);
+                return 0;
+            }, NULL);
+    }
     sqlite3_create_function(m_db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
         &insideIPv6CIDRSQL, NULL, NULL);
     sqlite3_create_function(m_db, "upperIPv6", 1, SQLITE_UTF8, NULL,
@@ -586,8 +601,37 @@ void ServerLobby::updateAddons()
         m_available_kts.first = m_official_kts.first;
     else
         m_available_kts.first = { all_k.begin(), all_k.end() };
+
+    // New assets are only appended, so the assets of peers stay valid
+    for (const std::string& kart : all_k)
+        m_asset_dictionary.addKart(kart);
+    for (const std::string& track : track_manager->getAllTrackIdentifiers())
+        m_asset_dictionary.addTrack(track);
+
+    m_official_kts_bits.first =
+        m_asset_dictionary.getKarts(m_official_kts.first);
+    m_official_kts_bits.second =
+        m_asset_dictionary.getTracks(m_official_kts.second);
+    m_addon_kts_bits.first = m_asset_dictionary.getKarts(m_addon_kts.first);
+    m_addon_kts_bits.second =
+        m_asset_dictionary.getTracks(m_addon_kts.second);
+    m_addon_arenas_bits = m_asset_dictionary.getTracks(m_addon_arenas);
+    m_addon_soccers_bits = m_asset_dictionary.getTracks(m_addon_soccers);
+    updateAvailableAssetBits();
 }   // updateAddons
 
+//-----------------------------------------------------------------------------
+/** Updates the bitsets of the available karts and tracks, must be called
+ *  after m_available_kts changed.
+ */
+void ServerLobby::updateAvailableAssetBits()
+{
+    m_available_kts_bits.first =
+        m_asset_dictionary.getKarts(m_available_kts.first);
+    m_available_kts_bits.second =
+        m_asset_dictionary.getTracks(m_available_kts.second);
+}   // updateAvailableAssetBits
+
 //-----------------------------------------------------------------------------
 /** Called whenever server is reset or game mode is changed.
  */
@@ -666,7 +710,7 @@ void ServerLobby::updateTracksForMode()
             assert(false);
             break;
     }
-
+    updateAvailableAssetBits();
 }   // updateTracksForMode
 
 //-----------------------------------------------------------------------------
@@ -894,8 +938,7 @@ bool ServerLobby::notifyEventAsynchronous(Event* event)
         case LE_CLIENT_BACK_LOBBY:
             clientSelectingAssetsWantsToBackLobby(event);         break;
         case LE_REPORT_PLAYER: writePlayerReport(event);          break;
-        case LE_ASSETS_UPDATE:
-            handleAssets(event->data(), event->getPeer());        break;
+        case LE_ASSETS_UPDATE: handleAssetsUpdate(event);         break;
         case LE_COMMAND:
             handleServerCommand(event, event->getPeerSP());       break;
         default:                                                  break;
@@ -1999,10 +2042,76 @@ void ServerLobby::finishedLoadingLiveJoinClient(Event* event)
     NetworkItemManager* nim = dynamic_cast<NetworkItemManager*>
         (Track::getCurrentTrack()->getItemManager());
     assert(nim);
-    nim->saveCompleteState(ns);
+    if (peer->getClientCapabilities().find("live_join_chunks") ==
+        peer->getClientCapabilities().end())
+    {
+        nim->saveCompleteState(ns);
+        nim->addLiveJoinPeer(peer);
+        sendLiveJoinAck(peer, ns, spectator);
+        return;
+    }
+
+    // Send the items in chunks over the next ticks instead of one large
+    // packet, the ones close to where the new karts enter first. The item
+    // events after now are kept for this peer, and the rest of the ack is
+    // written when it is sent.
+    nim->saveCompleteStateHeader(ns);
     nim->addLiveJoinPeer(peer);
 
-    w->saveCompleteState(ns, peer.get());
+    Vec3 xyz;
+    if (!spectator)
+    {
+        for (const int id : peer->getAvailableKartIDs())
+            xyz += w->getKart(id)->getStartingTransform().getOrigin();
+        xyz /= (float)peer->getAvailableKartIDs().size();
+    }
+    else
+    {
+        for (unsigned i = 0; i < w->getNumKarts(); i++)
+        {
+            if (!w->getKart(i)->isEliminated())
+            {
+                xyz = w->getKart(i)->getXYZ();
+                break;
+            }
+        }
+    }
+
+    LiveJoinTransfer transfer;
+    transfer.m_peer = peer;
+    transfer.m_next_chunk = 0;
+    transfer.m_ack = ns;
+    transfer.m_spectator = spectator;
+    const std::vector<unsigned> items = nim->getItemsByDistance(xyz);
+    BareNetworkString states;
+    unsigned count = 0;
+    for (unsigned i = 0; i < items.size(); i++)
+    {
+        nim->saveCompleteItemState(&states, items[i]);
+        count++;
+        if (states.getTotalSize() < LIVE_JOIN_CHUNK_SIZE &&
+            i != items.size() - 1)
+            continue;
+        NetworkString* chunk = getNetworkString(3 + states.getTotalSize());
+        chunk->setSynchronous(true);
+        chunk->addUInt8(LE_LIVE_JOIN_ITEMS).addUInt16((uint16_t)count);
+        *chunk += states;
+        transfer.m_chunks.push_back(chunk);
+        states = BareNetworkString();
+        count = 0;
+    }
+    m_live_join_transfers.push_back(transfer);
+}   // finishedLoadingLiveJoinClient
+
+//-----------------------------------------------------------------------------
+/** Completes the live join ack with the world state and players, and sends
+ *  it to the peer which can then enter the game.
+ *  \param ns The ack with the item state or its header, deleted here.
+ */
+void ServerLobby::sendLiveJoinAck(std::shared_ptr<STKPeer> peer,
+                                  NetworkString* ns, bool spectator)
+{
+    World::getWorld()->saveCompleteState(ns, peer.get());
     if (RaceManager::get()->supportsLiveJoining())
     {
         // Only needed in non-racing mode as no need players can added after
@@ -2020,7 +2129,63 @@ void ServerLobby::finishedLoadingLiveJoinClient(Event* event)
     delete ns;
     updatePlayerList();
     peer->updateLastActivity();
-}   // finishedLoadingLiveJoinClient
+}   // sendLiveJoinAck
+
+//-----------------------------------------------------------------------------
+/** Sends the next chunk of each live join transfer, and the ack once all
+ *  chunks of a transfer are sent. Chunks and ack are reliable packets in the
+ *  same channel, so the client receives them in order.
+ */
+void ServerLobby::updateLiveJoinTransfers(int ticks)
+{
+    if (m_live_join_transfers.empty())
+        return;
+    if (m_state.load() != RACING || !World::getWorld())
+    {
+        clearLiveJoinTransfers();
+        return;
+    }
+    for (auto it = m_live_join_transfers.begin();
+         it != m_live_join_transfers.end();)
+    {
+        std::shared_ptr<STKPeer> peer = it->m_peer.lock();
+        if (!peer || peer->isDisconnected())
+        {
+            for (NetworkString* chunk : it->m_chunks)
+                delete chunk;
+            delete it->m_ack;
+            it = m_live_join_transfers.erase(it);
+            continue;
+        }
+        for (int i = 0; i < ticks &&
+             it->m_next_chunk < it->m_chunks.size(); i++)
+        {
+            NetworkString* chunk = it->m_chunks[it->m_next_chunk];
+            peer->sendPacket(chunk, true/*reliable*/);
+            delete chunk;
+            it->m_chunks[it->m_next_chunk++] = NULL;
+        }
+        if (it->m_next_chunk < it->m_chunks.size())
+        {
+            it++;
+            continue;
+        }
+        sendLiveJoinAck(peer, it->m_ack, it->m_spectator);
+        it = m_live_join_transfers.erase(it);
+    }
+}   // updateLiveJoinTransfers
+
+//-----------------------------------------------------------------------------
+void ServerLobby::clearLiveJoinTransfers()
+{
+    for (LiveJoinTransfer& transfer : m_live_join_transfers)
+    {
+        for (NetworkString* chunk : transfer.m_chunks)
+            delete chunk;
+        delete transfer.m_ack;
+    }
+    m_live_join_transfers.clear();
+}   // clearLiveJoinTransfers
 
 //-----------------------------------------------------------------------------
 /** Simple finite state machine.  Once this
@@ -2029,6 +2194,7 @@ void ServerLobby::finishedLoadingLiveJoinClient(Event* event)
  */
 void ServerLobby::update(int ticks)
 {
+    updateLiveJoinTransfers(ticks);
     World* w = World::getWorld();
     bool world_started = m_state.load() >= WAIT_FOR_WORLD_LOADED &&
         m_state.load() <= RACING && m_server_has_loaded_world.load();
@@ -2436,7 +2602,8 @@ void ServerLobby::startSelection(const Event *event)
     }
 
     // Remove karts / tracks from server that are not supported on all clients
-    std::set<std::string> karts_erase, tracks_erase;
+    AssetBitset karts_available = m_available_kts_bits.first;
+    AssetBitset tracks_available = m_available_kts_bits.second;
     auto peers = STKHost::get()->getPeers();
     std::set<STKPeer*> always_spectate_peers;
     bool has_peer_plays_game = false;
@@ -2444,8 +2611,10 @@ void ServerLobby::startSelection(const Event *event)
     {
         if (!peer->isValidated() || peer->isWaitingForGame())
             continue;
-        peer->eraseServerKarts(m_available_kts.first, karts_erase);
-        peer->eraseServerTracks(m_available_kts.second, tracks_erase);
+        if (!peer->getAvailableKarts().empty())
+            karts_available.intersect(peer->getAvailableKarts());
+        if (!peer->getAvailableTracks().empty())
+            tracks_available.intersect(peer->getAvailableTracks());
         if (peer->alwaysSpectate())
             always_spectate_peers.insert(peer.get());
         else if (!peer->isAIPeer())
@@ -2503,13 +2672,23 @@ void ServerLobby::startSelection(const Event *event)
         }
     }
 
-    for (const std::string& kart_erase : karts_erase)
+    for (auto it = m_available_kts.first.begin();
+         it != m_available_kts.first.end();)
     {
-        m_available_kts.first.erase(kart_erase);
+        int index = m_asset_dictionary.getKartIndex(*it);
+        if (index == -1 || !karts_available.test(index))
+            it = m_available_kts.first.erase(it);
+        else
+            it++;
     }
-    for (const std::string& track_erase : tracks_erase)
+    for (auto it = m_available_kts.second.begin();
+         it != m_available_kts.second.end();)
     {
-        m_available_kts.second.erase(track_erase);
+        int index = m_asset_dictionary.getTrackIndex(*it);
+        if (index == -1 || !tracks_available.test(index))
+            it = m_available_kts.second.erase(it);
+        else
+            it++;
     }
 
     max_player = 0;
@@ -2551,6 +2730,7 @@ void ServerLobby::startSelection(const Event *event)
                 it++;
         }
     }
+    updateAvailableAssetBits();
 
     if (m_available_kts.second.empty())
     {
@@ -3359,59 +3539,115 @@ void ServerLobby::saveIPBanTable(const SocketAddress& addr)
 //-----------------------------------------------------------------------------
 bool ServerLobby::handleAssets(const NetworkString& ns, STKPeer* peer)
 {
-    std::set<std::string> client_karts, client_tracks;
+    // Update child process addons list first, so that new addons of the
+    // client hosting the server are in the asset dictionary
+    if (m_process_type == PT_CHILD &&
+        peer->getHostId() == m_client_server_host_id.load())
+        updateAddons();
+
+    // Only the karts and tracks the server has are of interest, which are
+    // all in the asset dictionary
+    AssetBitset client_karts, client_tracks;
     const unsigned kart_num = ns.getUInt16();
     const unsigned track_num = ns.getUInt16();
     for (unsigned i = 0; i < kart_num; i++)
     {
         std::string kart;
         ns.decodeString(&kart);
-        client_karts.insert(kart);
+        int index = m_asset_dictionary.getKartIndex(kart);
+        if (index != -1)
+            client_karts.set(index);
     }
     for (unsigned i = 0; i < track_num; i++)
     {
         std::string track;
         ns.decodeString(&track);
-        client_tracks.insert(track);
+        int index = m_asset_dictionary.getTrackIndex(track);
+        if (index != -1)
+            client_tracks.set(index);
     }
+    return handleAssets(client_karts, client_tracks, peer);
+}   // handleAssets
 
-    // Drop this player if he doesn't have at least 1 kart / track the same
-    // as server
-    float okt = 0.0f;
-    float ott = 0.0f;
-    for (auto& client_kart : client_karts)
-    {
-        if (m_official_kts.first.find(client_kart) !=
-            m_official_kts.first.end())
-            okt += 1.0f;
-    }
-    okt = okt / (float)m_official_kts.first.size();
-    for (auto& client_track : client_tracks)
+//-----------------------------------------------------------------------------
+/** Handles an asset update from a client. Clients which support the asset
+ *  dictionary send their assets as bitset for the dictionary they received,
+ *  other clients send the identifiers of all their karts and tracks.
+ */
+void ServerLobby::handleAssetsUpdate(Event* event)
+{
+    STKPeer* peer = event->getPeer();
+    const NetworkString& data = event->data();
+    if (!usesAssetDictionary(peer))
     {
-        if (m_official_kts.second.find(client_track) !=
-            m_official_kts.second.end())
-            ott += 1.0f;
+        handleAssets(data, peer);
+        return;
     }
-    ott = ott / (float)m_official_kts.second.size();
+    if (!checkDataSize(event, 8)) return;
 
-    std::set<std::string> karts_erase, tracks_erase;
-    for (const std::string& server_kart : m_available_kts.first)
-    {
-        if (client_karts.find(server_kart) == client_karts.end())
-        {
-            karts_erase.insert(server_kart);
-        }
-    }
-    for (const std::string& server_track : m_available_kts.second)
+    if (m_process_type == PT_CHILD &&
+        peer->getHostId() == m_client_server_host_id.load())
+        updateAddons();
+    const uint64_t hash = data.getUInt64();
+    if (hash != m_asset_dictionary.getHash())
     {
-        if (client_tracks.find(server_track) == client_tracks.end())
-        {
-            tracks_erase.insert(server_track);
-        }
+        // The dictionary of the client is outdated (or it has none yet),
+        // send it again and let the client update its assets with it
+        Log::info("ServerLobby", "Sending updated asset dictionary to %s.",
+            peer->getAddress().toString().c_str());
+        sendAssetDictionary(peer, true/*request_update*/);
+        return;
     }
+    AssetBitset client_karts, client_tracks;
+    client_karts.decode(data);
+    client_tracks.decode(data);
+    handleAssets(client_karts, client_tracks, peer);
+}   // handleAssetsUpdate
 
-    if (karts_erase.size() == m_available_kts.first.size() ||
-        tracks_erase.size() == m_available_kts.second.size() ||
+//-----------------------------------------------------------------------------
+/** Returns true if both server and client support the asset dictionary. */
+bool ServerLobby::usesAssetDictionary(const STKPeer* peer) const
+{
+    const auto& caps = peer->getClientCapabilities();
+    return caps.find("asset_dictionary") != caps.end() &&
+        stk_config->m_network_capabilities.find("asset_dictionary") !=
+        stk_config->m_network_capabilities.end();
+}   // usesAssetDictionary
+
+//-----------------------------------------------------------------------------
+/** Sends the asset dictionary of the server to a client which supports it.
+ *  \param request_update If true the client should send its assets again.
+ */
+void ServerLobby::sendAssetDictionary(STKPeer* peer,
+                                      bool request_update) const
+{
+    NetworkString* ns = getNetworkString();
+    ns->setSynchronous(true);
+    ns->addUInt8(LE_ASSET_DICTIONARY).addUInt8(request_update ? 1 : 0);
+    m_asset_dictionary.encode(ns);
+    peer->sendPacket(ns, true/*reliable*/);
+    delete ns;
+}   // sendAssetDictionary
+
+//-----------------------------------------------------------------------------
+/** Checks if a client has enough karts and tracks of the server, and saves
+ *  them in the peer.
+ *  \param client_karts, client_tracks The karts and tracks of the client,
+ *         as indices of the asset dictionary.
+ *  \return False if the client was refused.
+ */
+bool ServerLobby::handleAssets(AssetBitset& client_karts,
+                               AssetBitset& client_tracks, STKPeer* peer)
+{
+    // Drop this player if he doesn't have at least 1 kart / track the same
+    // as server
+    float okt = (float)client_karts.countCommon(m_official_kts_bits.first);
+    okt = okt / (float)m_official_kts.first.size();
+    float ott = (float)client_tracks.countCommon(m_official_kts_bits.second);
+    ott = ott / (float)m_official_kts.second.size();
+
+    if (client_karts.countCommon(m_available_kts_bits.first) == 0 ||
+        client_tracks.countCommon(m_available_kts_bits.second) == 0 ||
         okt < ServerConfig::m_official_karts_threshold ||
         ott < ServerConfig::m_official_tracks_threshold)
     {
@@ -3428,31 +3664,10 @@ bool ServerLobby::handleAssets(const NetworkString& ns, STKPeer* peer)
     }
 
     std::array<int, AS_TOTAL> addons_scores = {{ -1, -1, -1, -1 }};
-    size_t addon_kart = 0;
-    size_t addon_track = 0;
-    size_t addon_arena = 0;
-    size_t addon_soccer = 0;
-
-    for (auto& kart : m_addon_kts.first)
-    {
-        if (client_karts.find(kart) != client_karts.end())
-            addon_kart++;
-    }
-    for (auto& track : m_addon_kts.second)
-    {
-        if (client_tracks.find(track) != client_tracks.end())
-            addon_track++;
-    }
-    for (auto& arena : m_addon_arenas)
-    {
-        if (client_tracks.find(arena) != client_tracks.end())
-            addon_arena++;
-    }
-    for (auto& soccer : m_addon_soccers)
-    {
-        if (client_tracks.find(soccer) != client_tracks.end())
-            addon_soccer++;
-    }
+    size_t addon_kart = client_karts.countCommon(m_addon_kts_bits.first);
+    size_t addon_track = client_tracks.countCommon(m_addon_kts_bits.second);
+    size_t addon_arena = client_tracks.countCommon(m_addon_arenas_bits);
+    size_t addon_soccer = client_tracks.countCommon(m_addon_soccers_bits);
 
     if (!m_addon_kts.first.empty())
     {
@@ -3483,8 +3698,8 @@ bool ServerLobby::handleAssets(const NetworkString& ns, STKPeer* peer)
     if (m_process_type == PT_CHILD &&
         peer->getHostId() == m_client_server_host_id.load())
     {
-        // Update child process addons list too so player can choose later
-        updateAddons();
+        // Update child process tracks list too so player can choose later,
+        // the addons were already updated when the assets were received
         updateTracksForMode();
     }
     return true;
@@ -3831,6 +4046,9 @@ void ServerLobby::handleUnencryptedConnection(std::shared_ptr<STKPeer> peer,
             getRankingForPlayer(peer->getPlayerProfiles()[0]);
         }
     }
+    // So that the client can send later asset updates as bitsets
+    if (usesAssetDictionary(peer.get()))
+        sendAssetDictionary(peer.get(), false/*request_update*/);
 
 #ifdef ENABLE_SQLITE3
     if (m_server_stats_table.empty() || peer->isAIPeer())
@@ -5107,18 +5325,10 @@ void ServerLobby::handleServerConfiguration(Event* event)
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
     {
-        auto assets = peer->getClientAssets();
-        if (!peer->isValidated() || assets.second.empty())
+        const AssetBitset& tracks = peer->getAvailableTracks();
+        if (!peer->isValidated() || tracks.empty())
             continue;
-        std::set<std::string> tracks_erase;
-        for (const std::string& server_track : m_available_kts.second)
-        {
-            if (assets.second.find(server_track) == assets.second.end())
-            {
-                tracks_erase.insert(server_track);
-            }
-        }
-        if (tracks_erase.size() == m_available_kts.second.size())
+        if (tracks.countCommon(m_available_kts_bits.second) == 0)
         {
             NetworkString *message = getNetworkString(2);
             message->setSynchronous(true);
@@ -5665,27 +5875,12 @@ void ServerLobby::handleServerCommand(Event* event,
         else
         {
             std::string addon_id_test = Addon::createAddonId(addon_id);
-            bool found = false;
-            const auto& kt = player_peer->getClientAssets();
-            for (auto& kart : kt.first)
-            {
-                if (kart == addon_id_test)
-                {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                for (auto& track : kt.second)
-                {
-                    if (track == addon_id_test)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-            }
+            // Only addons the server has are known
+            const int kart = m_asset_dictionary.getKartIndex(addon_id_test);
+            const int track = m_asset_dictionary.getTrackIndex(addon_id_test);
+            bool found =
+                (kart != -1 && player_peer->getAvailableKarts().test(kart)) ||
+                (track != -1 && player_peer->getAvailableTracks().test(track));
             if (found)
             {
                 chat->encodeString16(StringUtils::utf8ToWide
@@ -19,6 +19,7 @@
 #ifndef SERVER_LOBBY_HPP
 #define SERVER_LOBBY_HPP
 
+#include "network/asset_dictionary.hpp"
 #include "network/protocols/lobby_protocol.hpp"
 #include "utils/cpp2011.hpp"
 #include "utils/time.hpp"
@@ -78,6 +79,23 @@ private:
         std::string m_country_code;
         bool m_tried = false;
     };
+    /** Items of the complete state are sent to a live joining client in
+     *  chunks of about this many bytes, at most one chunk per tick. */
+    static const unsigned LIVE_JOIN_CHUNK_SIZE = 1000;
+
+    /** The complete state being sent to a live joining client which
+     *  supports the live_join_chunks capability. */
+    struct LiveJoinTransfer
+    {
+        std::weak_ptr<STKPeer> m_peer;
+        /** Item states, sorted by distance to the karts of the peer. */
+        std::vector<NetworkString*> m_chunks;
+        unsigned m_next_chunk;
+        /** The live join ack, completed with the world state and sent after
+         *  all chunks. */
+        NetworkString* m_ack;
+        bool m_spectator;
+    };
     bool m_player_reports_table_exists;
 
 #ifdef ENABLE_SQLITE3
@@ -155,6 +173,18 @@ private:
      *  with data in server first. */
     std::pair<std::set<std::string>, std::set<std::string> > m_available_kts;
 
+    /** All karts and tracks of the server, used to store the assets of each
+     *  peer as bitset. */
+    AssetDictionary m_asset_dictionary;
+
+    /** The official, addon and available karts and tracks above as bitsets
+     *  of the asset dictionary, to count how many of them a client has.
+     *  Updated whenever the sets change. */
+    std::pair<AssetBitset, AssetBitset> m_official_kts_bits,
+        m_addon_kts_bits, m_available_kts_bits;
+
+    AssetBitset m_addon_arenas_bits, m_addon_soccers_bits;
+
     /** Keeps track of the server state. */
     std::atomic_bool m_server_has_loaded_world;
 
@@ -221,6 +251,10 @@ private:
     /* Used to make sure clients are having same item list at start */
     BareNetworkString* m_items_complete_state;
 
+    /** Complete states being sent to live joining clients, only used in
+     *  the main thread. */
+    std::vector<LiveJoinTransfer> m_live_join_transfers;
+
     std::atomic<uint32_t> m_server_id_online;
 
     std::atomic<uint32_t> m_client_server_host_id;
@@ -263,6 +297,10 @@ private:
     void registerServer();
     void finishedLoadingWorldClient(Event *event);
     void finishedLoadingLiveJoinClient(Event *event);
+    void sendLiveJoinAck(std::shared_ptr<STKPeer> peer, NetworkString* ns,
+                         bool spectator);
+    void updateLiveJoinTransfers(int ticks);
+    void clearLiveJoinTransfers();
     void kickHost(Event* event);
     void changeTeam(Event* event);
     void handleChat(Event* event);
@@ -355,6 +393,12 @@ private:
     std::vector<std::shared_ptr<NetworkPlayerProfile> > getLivePlayers() const;
     void setPlayerKarts(const NetworkString& ns, STKPeer* peer) const;
     bool handleAssets(const NetworkString& ns, STKPeer* peer);
+    bool handleAssets(AssetBitset& client_karts, AssetBitset& client_tracks,
+                      STKPeer* peer);
+    void handleAssetsUpdate(Event* event);
+    bool usesAssetDictionary(const STKPeer* peer) const;
+    void sendAssetDictionary(STKPeer* peer, bool request_update) const;
+    void updateAvailableAssetBits();
     void handleServerCommand(Event* event, std::shared_ptr<STKPeer> peer);
     void liveJoinRequest(Event* event);
     void rejectLiveJoin(STKPeer* peer, BackLobbyReason blr);
@@ -26,6 +26,7 @@
 #include "network/rewinder.hpp"
 #include "network/rewind_info.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/server_metrics.hpp"
 
 #include <algorithm>
 
@@ -256,6 +257,8 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
             // Server received an event in the past. Adjust this event
             // to be executed 'now' - at least we get a bit closer to the
             // client state.
+            if (ServerMetrics* metrics = ServerMetrics::get())
+                metrics->addLateEvent(world_ticks - (*i)->getTicks());
             (*i)->setTicks(world_ticks);
         }
 
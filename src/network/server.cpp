@@ -200,6 +200,42 @@ Server::Server(unsigned server_id, const core::stringw &name, int max_players,
     m_current_track = current_track;
 }   // server(server_id, ...)
 
+// ----------------------------------------------------------------------------
+/** Copies a server. The ServersManager hands out copies of the servers it
+ *  caches, because connecting to a server changes its addresses and IPv6
+ *  flag, which must not be kept for the next connection.
+ *  \param other The server to copy.
+ */
+Server::Server(const Server& other)
+      : m_name(other.m_name),
+        m_lower_case_name(other.m_lower_case_name),
+        m_server_owner_lower_case_name(other.m_server_owner_lower_case_name),
+        m_lower_case_player_names(other.m_lower_case_player_names),
+        m_server_id(other.m_server_id),
+        m_server_owner(other.m_server_owner),
+        m_max_players(other.m_max_players),
+        m_current_players(other.m_current_players),
+        m_private_port(other.m_private_port),
+        m_server_mode(other.m_server_mode),
+        m_difficulty(other.m_difficulty),
+        m_password_protected(other.m_password_protected),
+        m_server_owner_name(other.m_server_owner_name),
+        m_distance(other.m_distance),
+        m_official(other.m_official),
+        m_supports_encrytion(other.m_supports_encrytion),
+        m_game_started(other.m_game_started),
+        m_ipv6_connection(other.m_ipv6_connection),
+        m_reconnect_when_quit_lobby(other.m_reconnect_when_quit_lobby),
+        m_players(other.m_players),
+        m_current_track(other.m_current_track),
+        m_country_code(other.m_country_code)
+{
+    if (other.m_ipv6_address)
+        m_ipv6_address.reset(new SocketAddress(*other.m_ipv6_address));
+    if (other.m_address)
+        m_address.reset(new SocketAddress(*other.m_address));
+}   // Server(const Server&)
+
 // ----------------------------------------------------------------------------
 Server::~Server()
 {
@@ -119,6 +119,8 @@ public:
                 bool password_protected, bool game_started,
                 const std::string& current_track = "");
     // ------------------------------------------------------------------------
+    Server(const Server& other);
+    // ------------------------------------------------------------------------
     virtual ~Server();
     // ------------------------------------------------------------------------
     /** Returns IPv4 address and port of this server. */
@@ -310,6 +310,20 @@ void loadServerLobbyFromConfig()
     }
     NetworkConfig::get()->setStateFrequency(m_state_frequency);
 
+    if (m_reduced_physics_rate < 1 || m_reduced_physics_rate > 8)
+    {
+        Log::warn("ServerConfig", "Invalid %d reduced physics rate, use "
+            "default value.", (int)m_reduced_physics_rate);
+        m_reduced_physics_rate.revertToDefaults();
+    }
+
+    if (m_physics_threads < 1 || m_physics_threads > 8)
+    {
+        Log::warn("ServerConfig", "Invalid %d physics threads, use "
+            "default value.", (int)m_physics_threads);
+        m_physics_threads.revertToDefaults();
+    }
+
     if (m_player_reports_expired_days < 0.0f)
         m_player_reports_expired_days.revertToDefaults();
     if (m_server_difficulty > RaceManager::DIFFICULTY_LAST)
@@ -99,6 +99,19 @@ namespace ServerConfig
         "set random-server-port to '1' in user config. STK will automatically "
         "switch to a random port if the port you specify fails to be bound."));
 
+    SERVER_CFG_PREFIX IntServerConfigParam m_metrics_port
+        SERVER_CFG_DEFAULT(IntServerConfigParam(0, "metrics-port",
+        "If not 0, the server serves statistics (tick time, bandwidth, ping "
+        "and packet loss of each player, late events, database queries, lobby "
+        "state and number of players) in the Prometheus text format on this "
+        "port of localhost, at http://127.0.0.1:port/metrics."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_crypto_threads
+        SERVER_CFG_DEFAULT(IntServerConfigParam(0, "crypto-threads",
+        "Number of threads which decrypt the packets received from and "
+        "encrypt the packets sent to players with an encrypted connection, "
+        "0 to do it in the network and game threads."));
+
     SERVER_CFG_PREFIX IntServerConfigParam m_server_mode
         SERVER_CFG_DEFAULT(IntServerConfigParam(3, "server-mode",
         "Game mode in server, 0 is normal race (grand prix), "
@@ -344,6 +357,24 @@ namespace ServerConfig
         "more rewind, which clients with slow device may have problem playing "
         "this server, use the default value is recommended."));
 
+    SERVER_CFG_PREFIX IntServerConfigParam m_reduced_physics_rate
+        SERVER_CFG_DEFAULT(IntServerConfigParam(1,
+        "reduced-physics-rate",
+        "If larger than 1, the server simulates physics only once every this "
+        "many ticks (with a larger time step) while no kart is close to "
+        "another kart, an item, a projectile, the soccer ball or any "
+        "geometry in its way. This reduces the CPU usage of servers with "
+        "little interaction between karts, but clients will need to correct "
+        "their karts more often. Maximum is 8, 1 disables it."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_physics_threads
+        SERVER_CFG_DEFAULT(IntServerConfigParam(1,
+        "physics-threads",
+        "Number of threads used by the server to solve the physics of "
+        "separate groups of objects (for example karts which do not touch "
+        "each other) in parallel. The result is the same as with 1 thread, "
+        "which disables it. Maximum is 8."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_sql_management
         SERVER_CFG_DEFAULT(BoolServerConfigParam(false,
         "sql-management",
@@ -0,0 +1,358 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/server_metrics.hpp"
+
+#include "network/protocols/server_lobby.hpp"
+#include "network/stk_host.hpp"
+#include "utils/log.hpp"
+#include "utils/vs.hpp"
+
+#include <sstream>
+#include <string.h>
+
+#ifdef WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+typedef SOCKET MetricsSocket;
+#  define closeMetricsSocket closesocket
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/select.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+typedef int MetricsSocket;
+#  define INVALID_SOCKET -1
+#  define closeMetricsSocket close
+#endif
+
+const double ServerMetrics::TICK_BUCKETS[] =
+    { 0.001, 0.002, 0.004, 0.006, 0.008, 0.010, 0.015, 0.020, 0.050, 0.100,
+      0.250 };
+
+/** Names of the ServerLobby::ServerState values for stk_lobby_state. */
+static const char* g_lobby_states[] =
+{
+    "set_public_address", "register_self_address", "waiting_for_start_game",
+    "selecting", "load_world", "wait_for_world_loaded",
+    "wait_for_race_started", "racing", "wait_for_race_stopped",
+    "result_display", "error_leave", "exiting"
+};
+static_assert(sizeof(g_lobby_states) / sizeof(g_lobby_states[0]) ==
+              ServerLobby::EXITING + 1, "Missing lobby state name");
+
+// ----------------------------------------------------------------------------
+/** Waits until the socket can be read from, at most timeout_ms.
+ *  \return True if it can be read.
+ */
+static bool waitForSocket(MetricsSocket s, int timeout_ms)
+{
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(s, &rfds);
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    return select((int)s + 1, &rfds, NULL, NULL, &timeout) > 0;
+}   // waitForSocket
+
+// ============================================================================
+/** Creates the metrics and starts the thread serving them.
+ *  \param port Localhost TCP port to listen on.
+ *  \param tick_budget_us Longest time one tick may take, longer ticks are
+ *         counted as overruns.
+ */
+ServerMetrics::ServerMetrics(uint16_t port, uint64_t tick_budget_us)
+             : m_tick_budget_us(tick_budget_us), m_port(port)
+{
+    for (auto& bucket : m_tick_buckets)
+        bucket.store(0);
+    m_tick_time_us.store(0);
+    m_tick_overruns.store(0);
+    m_late_events.store(0);
+    m_late_event_ticks.store(0);
+    m_state_packets.store(0);
+    m_state_bytes.store(0);
+    m_db_queries.store(0);
+    m_db_query_time_us.store(0);
+    m_db_busy_retries.store(0);
+    m_upload_speed.store(0);
+    m_download_speed.store(0);
+    m_lobby_state.store(0);
+    m_players_in_game.store(0);
+    m_players_waiting.store(0);
+    m_total_players.store(0);
+    m_stop.store(false);
+    m_thread = std::thread(&ServerMetrics::serve, this);
+}   // ServerMetrics
+
+// ----------------------------------------------------------------------------
+ServerMetrics::~ServerMetrics()
+{
+    m_stop.store(true);
+    if (m_thread.joinable())
+        m_thread.join();
+}   // ~ServerMetrics
+
+// ----------------------------------------------------------------------------
+/** Returns the metrics of the server running in this thread, or NULL if
+ *  there is no server or metrics are disabled.
+ */
+ServerMetrics* ServerMetrics::get()
+{
+    if (!STKHost::existHost())
+        return NULL;
+    return STKHost::get()->getMetrics();
+}   // get
+
+// ----------------------------------------------------------------------------
+/** Adds the time one tick of the game took. */
+void ServerMetrics::addTick(uint64_t time_us)
+{
+    unsigned bucket = 0;
+    while (bucket < NUM_TICK_BUCKETS &&
+           (double)time_us > TICK_BUCKETS[bucket] * 1000000.0)
+        bucket++;
+    m_tick_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_tick_time_us.fetch_add(time_us, std::memory_order_relaxed);
+    if (time_us > m_tick_budget_us)
+        m_tick_overruns.fetch_add(1, std::memory_order_relaxed);
+}   // addTick
+
+// ----------------------------------------------------------------------------
+/** Replaces the statistics of all peers. */
+void ServerMetrics::setPeers(std::vector<PeerStats>& peers)
+{
+    std::lock_guard<std::mutex> lock(m_peers_mutex);
+    std::swap(m_peers, peers);
+}   // setPeers
+
+// ----------------------------------------------------------------------------
+/** Returns all metrics in the Prometheus text format. */
+std::string ServerMetrics::getText()
+{
+    std::ostringstream out;
+    // Counters in seconds would be rounded with the default 6 digits
+    out.precision(15);
+    auto add_metric = [&out](const char* name, const char* type,
+                             const char* help)
+        {
+            out << "# HELP " << name << " " << help << "\n"
+                << "# TYPE " << name << " " << type << "\n";
+        };
+
+    add_metric("stk_tick_duration_seconds", "histogram",
+        "Time taken to update one game tick.");
+    uint64_t cumulative = 0;
+    for (unsigned i = 0; i < NUM_TICK_BUCKETS; i++)
+    {
+        cumulative += m_tick_buckets[i].load(std::memory_order_relaxed);
+        out << "stk_tick_duration_seconds_bucket{le=\"" << TICK_BUCKETS[i]
+            << "\"} " << cumulative << "\n";
+    }
+    cumulative +=
+        m_tick_buckets[NUM_TICK_BUCKETS].load(std::memory_order_relaxed);
+    out << "stk_tick_duration_seconds_bucket{le=\"+Inf\"} " << cumulative
+        << "\n"
+        << "stk_tick_duration_seconds_sum "
+        << m_tick_time_us.load(std::memory_order_relaxed) / 1000000.0 << "\n"
+        << "stk_tick_duration_seconds_count " << cumulative << "\n";
+
+    add_metric("stk_tick_overruns_total", "counter",
+        "Ticks which took longer than the duration of a tick.");
+    out << "stk_tick_overruns_total "
+        << m_tick_overruns.load(std::memory_order_relaxed) << "\n";
+
+    add_metric("stk_late_events_total", "counter",
+        "Events of players received after their tick, which are moved to "
+        "the current tick since a server never rewinds.");
+    out << "stk_late_events_total "
+        << m_late_events.load(std::memory_order_relaxed) << "\n";
+    add_metric("stk_late_event_ticks_total", "counter",
+        "Ticks by which late events were moved forward.");
+    out << "stk_late_event_ticks_total "
+        << m_late_event_ticks.load(std::memory_order_relaxed) << "\n";
+
+    add_metric("stk_state_packets_total", "counter",
+        "State packets sent to the clients.");
+    out << "stk_state_packets_total "
+        << m_state_packets.load(std::memory_order_relaxed) << "\n";
+    add_metric("stk_state_bytes_total", "counter",
+        "Size of the state packets, counted once for all clients.");
+    out << "stk_state_bytes_total "
+        << m_state_bytes.load(std::memory_order_relaxed) << "\n";
+
+    add_metric("stk_upload_bytes_per_second", "gauge",
+        "Bytes sent in the last second.");
+    out << "stk_upload_bytes_per_second "
+        << m_upload_speed.load(std::memory_order_relaxed) << "\n";
+    add_metric("stk_download_bytes_per_second", "gauge",
+        "Bytes received in the last second.");
+    out << "stk_download_bytes_per_second "
+        << m_download_speed.load(std::memory_order_relaxed) << "\n";
+
+    add_metric("stk_db_queries_total", "counter",
+        "Database statements run.");
+    out << "stk_db_queries_total "
+        << m_db_queries.load(std::memory_order_relaxed) << "\n";
+    add_metric("stk_db_query_seconds_total", "counter",
+        "Time taken by database statements.");
+    out << "stk_db_query_seconds_total "
+        << m_db_query_time_us.load(std::memory_order_relaxed) / 1000000.0
+        << "\n";
+    add_metric("stk_db_busy_retries_total", "counter",
+        "Waits for a database locked by another connection.");
+    out << "stk_db_busy_retries_total "
+        << m_db_busy_retries.load(std::memory_order_relaxed) << "\n";
+
+    add_metric("stk_lobby_state", "gauge",
+        "1 for the current state of the lobby.");
+    const unsigned state = m_lobby_state.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i <= ServerLobby::EXITING; i++)
+    {
+        out << "stk_lobby_state{state=\"" << g_lobby_states[i] << "\"} "
+            << (i == state ? 1 : 0) << "\n";
+    }
+
+    add_metric("stk_players", "gauge", "Number of players.");
+    out << "stk_players{type=\"in_game\"} "
+        << m_players_in_game.load(std::memory_order_relaxed) << "\n"
+        << "stk_players{type=\"waiting\"} "
+        << m_players_waiting.load(std::memory_order_relaxed) << "\n"
+        << "stk_players{type=\"total\"} "
+        << m_total_players.load(std::memory_order_relaxed) << "\n";
+
+    std::vector<PeerStats> peers;
+    {
+        std::lock_guard<std::mutex> lock(m_peers_mutex);
+        peers = m_peers;
+    }
+    add_metric("stk_peers", "gauge", "Number of connected peers.");
+    out << "stk_peers " << peers.size() << "\n";
+    add_metric("stk_peer_rtt_seconds", "gauge",
+        "Round trip time of each peer.");
+    for (const PeerStats& p : peers)
+    {
+        out << "stk_peer_rtt_seconds{host_id=\"" << p.m_host_id << "\"} "
+            << p.m_rtt / 1000.0 << "\n";
+    }
+    add_metric("stk_peer_rtt_variance_seconds", "gauge",
+        "Variance of the round trip time of each peer.");
+    for (const PeerStats& p : peers)
+    {
+        out << "stk_peer_rtt_variance_seconds{host_id=\"" << p.m_host_id
+            << "\"} " << p.m_rtt_variance / 1000.0 << "\n";
+    }
+    add_metric("stk_peer_packet_loss_ratio", "gauge",
+        "Ratio of packets lost of each peer.");
+    for (const PeerStats& p : peers)
+    {
+        out << "stk_peer_packet_loss_ratio{host_id=\"" << p.m_host_id
+            << "\"} " << p.m_packet_loss << "\n";
+    }
+    return out.str();
+}   // getText
+
+// ----------------------------------------------------------------------------
+/** Thread which accepts HTTP connections on localhost and answers each
+ *  request with the metrics. Only one connection is handled at a time,
+ *  which is enough for a metrics collector.
+ */
+void ServerMetrics::serve()
+{
+    VS::setThreadName("ServerMetrics");
+    MetricsSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET)
+    {
+        Log::error("ServerMetrics", "Can't create socket.");
+        return;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse,
+        sizeof(reuse));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(m_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listener, 4) != 0)
+    {
+        Log::error("ServerMetrics", "Can't listen on port %d.", m_port);
+        closeMetricsSocket(listener);
+        return;
+    }
+    Log::info("ServerMetrics", "Serving metrics on 127.0.0.1:%d/metrics.",
+        m_port);
+
+    while (!m_stop.load())
+    {
+        if (!waitForSocket(listener, 250))
+            continue;
+        MetricsSocket client = accept(listener, NULL, NULL);
+        if (client == INVALID_SOCKET)
+            continue;
+
+        // Read the request header, only the request line is used
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos &&
+               request.size() < 8192 && waitForSocket(client, 1000))
+        {
+            int len = recv(client, buffer, sizeof(buffer), 0);
+            if (len <= 0)
+                break;
+            request.append(buffer, len);
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.compare(0, 13, "GET /metrics ") == 0 ||
+            request.compare(0, 6, "GET / ") == 0)
+            body = getText();
+        else
+        {
+            status = "404 Not Found";
+            body = "Not found\n";
+        }
+        std::ostringstream response;
+        response << "HTTP/1.1 " << status << "\r\n"
+            << "Content-Type: text/plain; version=0.0.4\r\n"
+            << "Content-Length: " << body.size() << "\r\n"
+            << "Connection: close\r\n\r\n" << body;
+        const std::string data = response.str();
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+#ifdef MSG_NOSIGNAL
+            // Don't get killed by SIGPIPE if the collector disconnected
+            const int flags = MSG_NOSIGNAL;
+#else
+            const int flags = 0;
+#endif
+            int len = send(client, data.c_str() + sent,
+                (int)(data.size() - sent), flags);
+            if (len <= 0)
+                break;
+            sent += len;
+        }
+        closeMetricsSocket(client);
+    }
+    closeMetricsSocket(listener);
+}   // serve
@@ -0,0 +1,149 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SERVER_METRICS_HPP
+#define HEADER_SERVER_METRICS_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Collects statistics of a server and serves them over HTTP on a
+ *  localhost port in the Prometheus text format, see the metrics-port
+ *  server option.
+ *  The game, lobby and listening threads only update atomic counters, or
+ *  (once per second) copy the state of the peers into a list protected by
+ *  a mutex of this class. The thread serving the requests only reads these,
+ *  so it never waits for a lock of the game.
+ * \ingroup network
+ */
+class ServerMetrics : public NoCopy
+{
+public:
+    /** Connection statistics of one peer. */
+    struct PeerStats
+    {
+        uint32_t m_host_id;
+        /** Round trip time and its variance in milliseconds. */
+        uint32_t m_rtt, m_rtt_variance;
+        /** Lost packets, between 0 and 1. */
+        float m_packet_loss;
+    };
+
+private:
+    /** Upper bounds of the tick duration histogram in seconds. */
+    static const double TICK_BUCKETS[];
+
+    static const unsigned NUM_TICK_BUCKETS = 11;
+
+    /** Number of ticks in each bucket (not cumulative), the last one is for
+     *  ticks longer than all bounds. */
+    std::atomic<uint64_t> m_tick_buckets[NUM_TICK_BUCKETS + 1];
+
+    std::atomic<uint64_t> m_tick_time_us, m_tick_overruns;
+
+    std::atomic<uint64_t> m_late_events, m_late_event_ticks;
+
+    std::atomic<uint64_t> m_state_packets, m_state_bytes;
+
+    std::atomic<uint64_t> m_db_queries, m_db_query_time_us, m_db_busy_retries;
+
+    std::atomic<uint32_t> m_upload_speed, m_download_speed;
+
+    std::atomic<uint32_t> m_lobby_state;
+
+    std::atomic<uint32_t> m_players_in_game, m_players_waiting,
+                          m_total_players;
+
+    /** Protects \ref m_peers. */
+    std::mutex m_peers_mutex;
+
+    std::vector<PeerStats> m_peers;
+
+    /** Longest time a tick may take in microseconds. */
+    const uint64_t m_tick_budget_us;
+
+    const uint16_t m_port;
+
+    std::atomic_bool m_stop;
+
+    std::thread m_thread;
+
+    // ------------------------------------------------------------------------
+    void serve();
+    // ------------------------------------------------------------------------
+    std::string getText();
+
+public:
+    ServerMetrics(uint16_t port, uint64_t tick_budget_us);
+    // ------------------------------------------------------------------------
+    ~ServerMetrics();
+    // ------------------------------------------------------------------------
+    static ServerMetrics* get();
+    // ------------------------------------------------------------------------
+    void addTick(uint64_t time_us);
+    // ------------------------------------------------------------------------
+    void setPeers(std::vector<PeerStats>& peers);
+    // ------------------------------------------------------------------------
+    /** Counts an event of a client which arrived after its tick and is
+     *  moved forward by this many ticks, since a server never rewinds. */
+    void addLateEvent(int ticks)
+    {
+        m_late_events.fetch_add(1, std::memory_order_relaxed);
+        m_late_event_ticks.fetch_add(ticks, std::memory_order_relaxed);
+    }   // addLateEvent
+    // ------------------------------------------------------------------------
+    void addStatePacket(unsigned bytes)
+    {
+        m_state_packets.fetch_add(1, std::memory_order_relaxed);
+        m_state_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }   // addStatePacket
+    // ------------------------------------------------------------------------
+    void addDatabaseQuery(uint64_t time_us)
+    {
+        m_db_queries.fetch_add(1, std::memory_order_relaxed);
+        m_db_query_time_us.fetch_add(time_us, std::memory_order_relaxed);
+    }   // addDatabaseQuery
+    // ------------------------------------------------------------------------
+    void addDatabaseBusyRetry()
+                 { m_db_busy_retries.fetch_add(1, std::memory_order_relaxed); }
+    // ------------------------------------------------------------------------
+    void setSpeed(uint32_t upload, uint32_t download)
+    {
+        m_upload_speed.store(upload, std::memory_order_relaxed);
+        m_download_speed.store(download, std::memory_order_relaxed);
+    }   // setSpeed
+    // ------------------------------------------------------------------------
+    void setLobbyState(unsigned state)
+                    { m_lobby_state.store(state, std::memory_order_relaxed); }
+    // ------------------------------------------------------------------------
+    void setPlayers(uint32_t in_game, uint32_t waiting, uint32_t total)
+    {
+        m_players_in_game.store(in_game, std::memory_order_relaxed);
+        m_players_waiting.store(waiting, std::memory_order_relaxed);
+        m_total_players.store(total, std::memory_order_relaxed);
+    }   // setPlayers
+};   // ServerMetrics
+
+#endif
@@ -69,6 +69,8 @@ void ServersManager::deallocate()
 // ----------------------------------------------------------------------------
 ServersManager::ServersManager()
 {
+    m_wan_revision = 0;
+    m_next_lan_server_id = 0;
 }   // ServersManager
 
 // ----------------------------------------------------------------------------
@@ -76,11 +78,94 @@ ServersManager::~ServersManager()
 {
 }   // ~ServersManager
 
+// ----------------------------------------------------------------------------
+/** Updates the cached WAN servers with a get-all reply of the stk server,
+ *  and adds the servers which can be used to a list. If the root node has a
+ *  revision attribute, it is sent in the next request, and the stk server
+ *  can reply with only the changes since then: delta="yes", the base
+ *  revision, a server node for each new or changed server and a
+ *  <removed id=".."/> node for each server gone.
+ *  \param servers_xml The servers node of the reply.
+ *  \param result The list the servers are added to, which are copies of
+ *         the cached servers.
+ *  \return False if the reply is a delta to a list which is not cached.
+ */
+bool ServersManager::updateWanServers(const XMLNode* servers_xml,
+                                   std::vector<std::shared_ptr<Server> >* result)
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    uint64_t revision = 0;
+    uint64_t base = 0;
+    bool delta = false;
+    servers_xml->get("revision", &revision);
+    servers_xml->get("delta", &delta);
+    servers_xml->get("base", &base);
+    // The same delta can be received twice if two requests were sent with
+    // the same revision
+    const bool applied = delta && revision != 0 && revision == m_wan_revision;
+    if (delta && !applied && (m_wan_revision == 0 || base != m_wan_revision))
+        return false;
+
+    if (!delta)
+        m_wan_servers.clear();
+    for (unsigned int i = 0; !applied && i < servers_xml->getNumNodes(); i++)
+    {
+        const XMLNode* s = servers_xml->getNode(i);
+        assert(s);
+        if (s->getName() == "removed")
+        {
+            uint32_t id = 0;
+            s->get("id", &id);
+            m_wan_servers.erase(id);
+            continue;
+        }
+        const XMLNode* si = s->getNode("server-info");
+        assert(si);
+        int version = 0;
+        uint32_t id = 0;
+        si->get("version", &version);
+        si->get("id", &id);
+        assert(version != 0);
+        if (version < stk_config->m_max_server_version ||
+            version > stk_config->m_max_server_version)
+        {
+            Log::verbose("ServersManager", "Skipping a server");
+            m_wan_servers.erase(id);
+            continue;
+        }
+        m_wan_servers[id] = std::make_shared<Server>(*s);
+    }
+    m_wan_revision = revision;
+
+    for (auto& server : m_wan_servers)
+    {
+        if (server.second->getAddress().isUnset() &&
+            NetworkConfig::get()->getIPType() == NetworkConfig::IP_V4)
+        {
+            Log::verbose("ServersManager", "Skipping an IPv6 only server");
+            continue;
+        }
+        result->push_back(std::make_shared<Server>(*server.second));
+    }
+    return true;
+}   // updateWanServers
+
+// ----------------------------------------------------------------------------
+/** Removes the cached WAN servers, so that the next refresh downloads all
+ *  servers. */
+void ServersManager::clearWanServers()
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    m_wan_servers.clear();
+    m_wan_revision = 0;
+}   // clearWanServers
+
 // ----------------------------------------------------------------------------
 /** Returns a WAN update-list-of-servers request. It queries the
- *  STK server for an up-to-date list of servers.
+ *  STK server for an up-to-date list of servers, or the changes since the
+ *  last refresh.
  */
-std::shared_ptr<ServerList> ServersManager::getWANRefreshRequest() const
+std::shared_ptr<ServerList> ServersManager::getWANRefreshRequest()
 {
     // ========================================================================
     /** A small local class that triggers an update of the ServersManager
@@ -115,38 +200,35 @@ std::shared_ptr<ServerList> ServersManager::getWANRefreshRequest() const
             if (!server_list)
                 return;
 
-            if (!isSuccess())
+            const XMLNode* servers_xml =
+                isSuccess() ? getXMLData()->getNode("servers") : NULL;
+            if (!servers_xml)
             {
                 Log::error("ServersManager", "Could not refresh server list");
                 server_list->m_list_updated = true;
                 return;
             }
 
-            const XMLNode *servers_xml = getXMLData()->getNode("servers");
-            for (unsigned int i = 0; i < servers_xml->getNumNodes(); i++)
+            ServersManager* sm = ServersManager::get();
+            if (!sm->updateWanServers(servers_xml, &server_list->m_servers))
             {
-                const XMLNode* s = servers_xml->getNode(i);
-                assert(s);
-                const XMLNode* si = s->getNode("server-info");
-                assert(si);
-                int version = 0;
-                si->get("version", &version);
-                assert(version != 0);
-                if (version < stk_config->m_max_server_version ||
-                    version > stk_config->m_max_server_version)
+                // The changes are for a different list than the cached one,
+                // download all servers instead
+                Log::warn("ServersManager",
+                    "Server list changes don't match, refreshing all.");
+                sm->clearWanServers();
+                auto request = std::make_shared<Online::XMLRequest>();
+                request->setApiURL(Online::API::SERVER_PATH, "get-all");
+                request->executeNow();
+                servers_xml = request->isSuccess() ?
+                    request->getXMLData()->getNode("servers") : NULL;
+                if (!servers_xml ||
+                    !sm->updateWanServers(servers_xml,
+                    &server_list->m_servers))
                 {
-                    Log::verbose("ServersManager", "Skipping a server");
-                    continue;
+                    Log::error("ServersManager",
+                        "Could not refresh server list");
                 }
-                std::shared_ptr<Server> ser = std::make_shared<Server>(*s);
-                if (ser->getAddress().isUnset() &&
-                    NetworkConfig::get()->getIPType() == NetworkConfig::IP_V4)
-                {
-                    Log::verbose("ServersManager",
-                        "Skipping an IPv6 only server");
-                    continue;
-                }
-                server_list->m_servers.emplace_back(ser);
             }
             server_list->m_list_updated = true;
         }   // afterOperation
@@ -157,6 +239,10 @@ std::shared_ptr<ServerList> ServersManager::getWANRefreshRequest() const
     auto server_list = std::make_shared<ServerList>();
     auto request = std::make_shared<WANRefreshRequest>(server_list);
     request->setApiURL(Online::API::SERVER_PATH, "get-all");
+    std::unique_lock<std::mutex> ul(m_cache_mutex);
+    if (m_wan_revision != 0)
+        request->addParameter("revision", m_wan_revision);
+    ul.unlock();
     Online::RequestManager::get()->addRequest(request);
     return server_list;
 }   // getWANRefreshRequest
@@ -166,7 +252,7 @@ std::shared_ptr<ServerList> ServersManager::getWANRefreshRequest() const
  *  to find LAN servers, and waits for a certain amount of time fr 
  *  answers.
  */
-std::shared_ptr<ServerList> ServersManager::getLANRefreshRequest() const
+std::shared_ptr<ServerList> ServersManager::getLANRefreshRequest()
 {
     /** A simple class that uses LAN broadcasts to find local servers.
      *  It is based on XML request, but actually does not use any of the
@@ -239,13 +325,13 @@ std::shared_ptr<ServerList> ServersManager::getLANRefreshRequest() const
             // any local servers.
             uint64_t start_time = StkTime::getMonoTimeMs();
             const uint64_t DURATION = 1000;
-            int cur_server_id = 0;
             // Use a map with the server name as key to automatically remove
             // duplicated answers from a server (since we potentially do
             // multiple broadcasts). We can not use the sender ip address,
             // because e.g. a local client would answer as 127.0.0.1 and
             // 192.168.**.
-            std::map<irr::core::stringw, std::shared_ptr<Server> > servers_now;
+            std::map<irr::core::stringw,
+                std::pair<std::string, SocketAddress> > replies;
             while (StkTime::getMonoTimeMs() - start_time < DURATION)
             {
                 SocketAddress sender;
@@ -263,41 +349,17 @@ std::shared_ptr<ServerList> ServersManager::getLANRefreshRequest() const
                     irr::core::stringw name;
                     // bytes_read is the number of bytes read
                     s.decodeStringW(&name);
-                    uint8_t max_players = s.getUInt8();
-                    uint8_t players     = s.getUInt8();
-                    uint16_t port       = s.getUInt16();
-                    uint8_t difficulty  = s.getUInt8();
-                    uint8_t mode        = s.getUInt8();
-                    sender.setPort(port);
-                    uint8_t password    = s.getUInt8();
-                    uint8_t game_started = s.getUInt8();
-                    std::string current_track;
-                    try
-                    {
-                        s.decodeString(&current_track);
-                    }
-                    catch (std::exception& e)
-                    {
-                        (void)e;
-                    }
-                    auto server = std::make_shared<Server>(cur_server_id++,
-                        name, max_players, players, difficulty, mode,
-                        SocketAddress(sender.getIP(), sender.getPort()),
-                        password == 1, game_started == 1, current_track);
-                    if (sender.isIPv6())
-                    {
-                        server->setIPV6Address(sender);
-                        server->setIPV6Connection(true);
-                    }
-                    servers_now.insert(std::make_pair(name, server));
-                    //all_servers.[name] = servers_now.back();
+                    // The rest of the reply is only read if the server
+                    // is new or changed
+                    replies.insert(std::make_pair(name, std::make_pair(
+                        std::string(buffer, len), sender)));
                 }   // if received_data
             }    // while still waiting
             setIPv6Socket(0);
             delete broadcast;
             m_success = true;
-            for (auto& i : servers_now)
-                server_list->m_servers.emplace_back(i.second);
+            ServersManager::get()->updateLanServers(replies,
+                &server_list->m_servers);
             server_list->m_list_updated = true;
         }   // operation
         // --------------------------------------------------------------------
@@ -315,6 +377,76 @@ std::shared_ptr<ServerList> ServersManager::getLANRefreshRequest() const
 
 }   // getLANRefreshRequest
 
+// ----------------------------------------------------------------------------
+/** Adds the servers which replied to a LAN discovery to a list. A server
+ *  which sent the same reply from the same address as in the last refresh
+ *  is copied from the cache, only new or changed replies are read.
+ *  \param replies The reply and address of each server by name.
+ *  \param result The list the servers are added to, which are copies of
+ *         the cached servers.
+ */
+void ServersManager::updateLanServers(const std::map<irr::core::stringw,
+                              std::pair<std::string, SocketAddress> >& replies,
+                              std::vector<std::shared_ptr<Server> >* result)
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    std::map<irr::core::stringw, LanServer> lan_servers;
+    for (auto& reply : replies)
+    {
+        const SocketAddress& sender = reply.second.second;
+        LanServer& lan_server = lan_servers[reply.first];
+        lan_server.m_reply = reply.second.first;
+        lan_server.m_sender = sender.toString();
+        auto it = m_lan_servers.find(reply.first);
+        if (it != m_lan_servers.end() &&
+            it->second.m_reply == lan_server.m_reply &&
+            it->second.m_sender == lan_server.m_sender)
+        {
+            lan_server.m_server = it->second.m_server;
+            result->push_back(std::make_shared<Server>(*lan_server.m_server));
+            continue;
+        }
+
+        BareNetworkString s(lan_server.m_reply.data(),
+            (int)lan_server.m_reply.size());
+        // Version and name were checked in the LAN refresh request
+        s.getUInt32();
+        irr::core::stringw name;
+        s.decodeStringW(&name);
+        uint8_t max_players = s.getUInt8();
+        uint8_t players     = s.getUInt8();
+        uint16_t port       = s.getUInt16();
+        uint8_t difficulty  = s.getUInt8();
+        uint8_t mode        = s.getUInt8();
+        uint8_t password    = s.getUInt8();
+        uint8_t game_started = s.getUInt8();
+        std::string current_track;
+        try
+        {
+            s.decodeString(&current_track);
+        }
+        catch (std::exception& e)
+        {
+            (void)e;
+        }
+        auto server = std::make_shared<Server>(m_next_lan_server_id++,
+            name, max_players, players, difficulty, mode,
+            SocketAddress(sender.getIP(), port),
+            password == 1, game_started == 1, current_track);
+        if (sender.isIPv6())
+        {
+            SocketAddress ipv6_sender = sender;
+            ipv6_sender.setPort(port);
+            server->setIPV6Address(ipv6_sender);
+            server->setIPV6Connection(true);
+        }
+        lan_server.m_server = server;
+        result->push_back(std::make_shared<Server>(*server));
+    }
+    // Servers which didn't reply this time are forgotten
+    std::swap(m_lan_servers, lan_servers);
+}   // updateLanServers
+
 // ----------------------------------------------------------------------------
 /** Sets a list of default broadcast addresses which is used in case no valid
  *  broadcast address is found. This list includes default private network
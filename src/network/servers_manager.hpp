@@ -24,6 +24,7 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -50,16 +51,48 @@ private:
     /** List of broadcast addresses to use. */
     std::vector<SocketAddress> m_broadcast_address;
 
+    /** A server found by LAN discovery, with the reply it sent. */
+    struct LanServer
+    {
+        std::string m_reply;
+        std::string m_sender;
+        std::shared_ptr<Server> m_server;
+    };
+
+    /** Protects the cached WAN and LAN servers, which are updated by the
+     *  request thread and read when creating refresh requests. */
+    std::mutex m_cache_mutex;
+
+    /** The WAN servers of the last refresh by server id. Later refreshes
+     *  only download the changes since \ref m_wan_revision, unchanged
+     *  servers are not read again. Server lists only get copies, since
+     *  connecting to a server changes it. */
+    std::map<uint32_t, std::shared_ptr<Server> > m_wan_servers;
+
+    /** Revision of the cached WAN server list given by the stk server, 0 if
+     *  there is no cached list or the stk server doesn't support deltas. */
+    uint64_t m_wan_revision;
+
+    /** The LAN servers of the last refreshes by name. */
+    std::map<irr::core::stringw, LanServer> m_lan_servers;
+
+    /** Server id for the next LAN server found. */
+    unsigned m_next_lan_server_id;
+
     // ------------------------------------------------------------------------
      ServersManager();
     // ------------------------------------------------------------------------
     ~ServersManager();
     // ------------------------------------------------------------------------
-    void setWanServers(bool success, const XMLNode* input);
+    bool updateWanServers(const XMLNode* servers_xml,
+                          std::vector<std::shared_ptr<Server> >* result);
+    // ------------------------------------------------------------------------
+    void clearWanServers();
+    // ------------------------------------------------------------------------
+    void updateLanServers(const std::map<irr::core::stringw,
+                          std::pair<std::string, SocketAddress> >& replies,
+                          std::vector<std::shared_ptr<Server> >* result);
     // ------------------------------------------------------------------------
-    void setLanServers(const std::map<irr::core::stringw, 
-                                      std::shared_ptr<Server> >& servers);
-                                      
     std::vector<SocketAddress> getDefaultBroadcastAddresses();
     void addAllBroadcastAddresses(const SocketAddress &a, int len,
                                   std::vector<SocketAddress>* result);
@@ -72,9 +105,9 @@ public:
     // ------------------------------------------------------------------------
     std::vector<SocketAddress> getBroadcastAddresses(bool ipv6);
     // ------------------------------------------------------------------------
-    std::shared_ptr<ServerList> getWANRefreshRequest() const;
+    std::shared_ptr<ServerList> getWANRefreshRequest();
     // ------------------------------------------------------------------------
-    std::shared_ptr<ServerList> getLANRefreshRequest() const;
+    std::shared_ptr<ServerList> getLANRefreshRequest();
 
 };   // class ServersManager
 #endif // HEADER_SERVERS_MANAGER_HPP
@@ -21,6 +21,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
+#include "network/crypto_workers.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
 #include "network/network.hpp"
@@ -33,10 +34,12 @@
 #include "network/protocols/server_lobby.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/server_config.hpp"
+#include "network/server_metrics.hpp"
 #include "network/child_loop.hpp"
 #include "network/stk_ipv6.hpp"
 #include "network/stk_peer.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 #include "utils/vs.hpp"
@@ -303,7 +306,21 @@ STKHost::STKHost(bool server)
                               "ENet server host.");
     }
     if (server)
+    {
         Log::info("STKHost", "Server port is %d", getPrivatePort());
+        if (ServerConfig::m_metrics_port > 0 &&
+            ServerConfig::m_metrics_port < 65536)
+        {
+            m_metrics.reset(new ServerMetrics(
+                (uint16_t)ServerConfig::m_metrics_port,
+                (uint64_t)(stk_config->ticks2Time(1) * 1000000.0f)));
+        }
+        if (ServerConfig::m_crypto_threads > 0)
+        {
+            m_crypto_workers.reset(new CryptoWorkers(
+                std::min((unsigned)ServerConfig::m_crypto_threads, 16u)));
+        }
+    }
 }   // STKHost
 
 // ----------------------------------------------------------------------------
@@ -361,6 +378,8 @@ STKHost::~STKHost()
     disconnectAllPeers(true/*timeout_waiting*/);
     Network::closeLog();
     stopListening();
+    // Packets encrypted after this are dropped below
+    m_crypto_workers.reset();
 
     // Drop all unsent packets
     for (auto& p : m_enet_cmd)
@@ -760,6 +779,37 @@ void STKHost::setErrorMessage(const irr::core::stringw &message)
     m_error_message = message;
 }   // setErrorMessage
 
+// ----------------------------------------------------------------------------
+/** Copies the connection statistics of the peers, the speed, lobby state and
+ *  number of players into \ref m_metrics. Called once per second by the
+ *  listening thread.
+ */
+void STKHost::updateMetrics()
+{
+    m_metrics->setSpeed(m_upload_speed.load(), m_download_speed.load());
+    m_metrics->setPlayers(m_players_in_game.load(), m_players_waiting.load(),
+        m_total_players.load());
+    if (auto sl = LobbyProtocol::get<ServerLobby>())
+        m_metrics->setLobbyState(sl->getCurrentState());
+
+    std::vector<ServerMetrics::PeerStats> peers;
+    std::unique_lock<std::mutex> lock(m_peers_mutex);
+    for (auto& p : m_peers)
+    {
+        if (p.second->isAIPeer())
+            continue;
+        ServerMetrics::PeerStats stats;
+        stats.m_host_id = p.second->getHostId();
+        stats.m_rtt = p.first->roundTripTime;
+        stats.m_rtt_variance = p.first->roundTripTimeVariance;
+        stats.m_packet_loss =
+            (float)p.first->packetLoss / ENET_PEER_PACKET_LOSS_SCALE;
+        peers.push_back(stats);
+    }
+    lock.unlock();
+    m_metrics->setPeers(peers);
+}   // updateMetrics
+
 // ----------------------------------------------------------------------------
 /** \brief Starts the listening of events from ENet.
  *  Starts a thread for receiveData that updates it as often as possible.
@@ -844,6 +894,8 @@ void STKHost::mainLoop(ProcessType pt)
                 getNetwork()->getENetHost()->totalReceivedData);
             getNetwork()->getENetHost()->totalSentData = 0;
             getNetwork()->getENetHost()->totalReceivedData = 0;
+            if (m_metrics)
+                updateMetrics();
         }
 
         auto sl = LobbyProtocol::get<ServerLobby>();
@@ -1181,6 +1233,30 @@ void STKHost::mainLoop(ProcessType pt)
                     enet_packet_destroy(event.packet);
                     continue;
                 }
+                if (m_crypto_workers && peer->getCrypto() &&
+                    (event.channelID == EVENT_CHANNEL_NORMAL ||
+                    event.channelID == EVENT_CHANNEL_DATA_TRANSFER))
+                {
+                    // Decrypt in the thread of this peer, which keeps the
+                    // order of its messages in the encrypted channels
+                    m_crypto_workers->addJob(peer->getHostId(),
+                        [event, peer]() mutable
+                        {
+                            Event* stk_event = NULL;
+                            try
+                            {
+                                stk_event = new Event(&event, peer);
+                            }
+                            catch (std::exception& e)
+                            {
+                                Log::warn("STKHost", "%s", e.what());
+                                enet_packet_destroy(event.packet);
+                                return;
+                            }
+                            propagateEvent(stk_event);
+                        });
+                    continue;
+                }
                 try
                 {
                     stk_event = new Event(&event, peer);
@@ -1197,26 +1273,15 @@ void STKHost::mainLoop(ProcessType pt)
                 enet_packet_destroy(event.packet);
                 continue;
             }
-            if (stk_event->getType() == EVENT_TYPE_MESSAGE)
+            else if (m_crypto_workers &&
+                stk_event->getType() == EVENT_TYPE_DISCONNECTED)
             {
-                Network::logPacket(stk_event->data(), true);
-#ifdef DEBUG_MESSAGE_CONTENT
-                Log::verbose("NetworkManager",
-                             "Message, Sender : %s time %f message:",
-                             stk_event->getPeer()->getAddress()
-                             .toString(/*show port*/false).c_str(),
-                             StkTime::getRealTime());
-                Log::verbose("NetworkManager", "%s",
-                             stk_event->data().getLogMessage().c_str());
-#endif
-            }   // if message event
-
-            // notify for the event now.
-            auto pm = ProtocolManager::lock();
-            if (pm && !pm->isExiting())
-                pm->propagateEvent(stk_event);
-            else
-                delete stk_event;
+                // Disconnection after the messages still being decrypted
+                m_crypto_workers->addJob(stk_event->getPeer()->getHostId(),
+                    [stk_event]() { propagateEvent(stk_event); });
+                continue;
+            }
+            propagateEvent(stk_event);
         }   // while enet_host_service
     }   // while m_exit_timeout.load() > StkTime::getMonoTimeMs()
     delete direct_socket;
@@ -1332,6 +1397,36 @@ std::shared_ptr<STKPeer> STKHost::getServerPeerForClient() const
     return m_peers.begin()->second;
 }   // getServerPeerForClient
 
+//-----------------------------------------------------------------------------
+/** Passes an event received by the listening thread (or a thread of
+ *  \ref m_crypto_workers) to the protocol manager.
+ */
+void STKHost::propagateEvent(Event* stk_event)
+{
+    if (stk_event->getType() == EVENT_TYPE_MESSAGE)
+    {
+        Network::logPacket(stk_event->data(), true);
+#ifdef DEBUG_MESSAGE_CONTENT
+        Log::verbose("NetworkManager",
+                     "Message, Sender : %s time %f message:",
+                     stk_event->getPeer()->getAddress()
+                     .toString(/*show port*/false).c_str(),
+                     StkTime::getRealTime());
+        Log::verbose("NetworkManager", "%s",
+                     stk_event->data().getLogMessage().c_str());
+#endif
+    }   // if message event
+
+    // notify for the event now.
+    PROFILER_PUSH_CPU_MARKER("STKHost: propagate event", 0, 128, 255);
+    auto pm = ProtocolManager::lock();
+    if (pm && !pm->isExiting())
+        pm->propagateEvent(stk_event);
+    else
+        delete stk_event;
+    PROFILER_POP_CPU_MARKER();
+}   // propagateEvent
+
 //-----------------------------------------------------------------------------
 /** Sends data to all validated peers currently in server
  *  \param data Data to sent.
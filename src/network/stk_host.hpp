@@ -48,6 +48,8 @@
 #include <vector>
 
 class BareNetworkString;
+class CryptoWorkers;
+class Event;
 class GameSetup;
 class LobbyProtocol;
 class Network;
@@ -56,6 +58,7 @@ class NetworkString;
 class NetworkTimerSynchronizer;
 class Server;
 class ServerLobby;
+class ServerMetrics;
 class ChildLoop;
 class SocketAddress;
 class STKPeer;
@@ -157,6 +160,13 @@ private:
 
     std::unique_ptr<NetworkTimerSynchronizer> m_nts;
 
+    /** Statistics served to a metrics collector, NULL if disabled. */
+    std::unique_ptr<ServerMetrics> m_metrics;
+
+    /** Threads which encrypt and decrypt the packets of peers in server,
+     *  NULL if disabled. */
+    std::unique_ptr<CryptoWorkers> m_crypto_workers;
+
     // ------------------------------------------------------------------------
     STKHost(bool server);
     // ------------------------------------------------------------------------
@@ -170,6 +180,10 @@ private:
     // ------------------------------------------------------------------------
     void mainLoop(ProcessType pt);
     // ------------------------------------------------------------------------
+    void updateMetrics();
+    // ------------------------------------------------------------------------
+    static void propagateEvent(Event* stk_event);
+    // ------------------------------------------------------------------------
     void getIPFromStun(int socket, const std::string& stun_address,
                        short family, SocketAddress* result);
 public:
@@ -396,6 +410,10 @@ public:
     static BareNetworkString getStunRequest(uint8_t* stun_tansaction_id);
     // ------------------------------------------------------------------------
     ChildLoop* getChildLoop() const { return m_client_loop; }
+    // ------------------------------------------------------------------------
+    ServerMetrics* getMetrics() const                { return m_metrics.get(); }
+    // ------------------------------------------------------------------------
+    CryptoWorkers* getCryptoWorkers() const   { return m_crypto_workers.get(); }
 };   // class STKHost
 
 #endif // STK_HOST_HPP
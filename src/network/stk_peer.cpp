@@ -20,6 +20,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "network/crypto.hpp"
+#include "network/crypto_workers.hpp"
 #include "network/event.hpp"
 #include "network/network.hpp"
 #include "network/network_config.hpp"
@@ -67,8 +68,7 @@ void STKPeer::disconnect()
     if (m_disconnected.load())
         return;
     m_disconnected.store(true);
-    m_host->addEnetCommand(m_enet_peer, NULL, PDI_NORMAL, ECT_DISCONNECT,
-        m_address);
+    addEnetCommand(PDI_NORMAL, ECT_DISCONNECT);
 }   // disconnect
 
 //-----------------------------------------------------------------------------
@@ -79,8 +79,7 @@ void STKPeer::kick()
     if (m_disconnected.load())
         return;
     m_disconnected.store(true);
-    m_host->addEnetCommand(m_enet_peer, NULL, PDI_KICK, ECT_DISCONNECT,
-        m_address);
+    addEnetCommand(PDI_KICK, ECT_DISCONNECT);
 }   // kick
 
 //-----------------------------------------------------------------------------
@@ -91,9 +90,29 @@ void STKPeer::reset()
     if (m_disconnected.load())
         return;
     m_disconnected.store(true);
-    m_host->addEnetCommand(m_enet_peer, NULL, 0, ECT_RESET, m_address);
+    addEnetCommand(0, ECT_RESET);
 }   // reset
 
+//-----------------------------------------------------------------------------
+/** Adds a disconnect or reset command for this peer, after the packets
+ *  which are still being encrypted if the server uses crypto threads.
+ */
+void STKPeer::addEnetCommand(uint32_t i, ENetCommandType ect)
+{
+    CryptoWorkers* cw = m_host->getCryptoWorkers();
+    if (cw && m_crypto)
+    {
+        std::shared_ptr<STKPeer> peer = shared_from_this();
+        cw->addJob(m_host_id, [peer, i, ect]()
+            {
+                peer->m_host->addEnetCommand(peer->m_enet_peer, NULL, i, ect,
+                    peer->m_address);
+            });
+        return;
+    }
+    m_host->addEnetCommand(m_enet_peer, NULL, i, ect, m_address);
+}   // addEnetCommand
+
 //-----------------------------------------------------------------------------
 /** Sends a packet to this host.
  *  \param data The data to send.
@@ -106,7 +125,23 @@ void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
         return;
 
     ENetPacket* packet = NULL;
-    if (m_crypto && encrypted)
+    CryptoWorkers* cw = m_host->getCryptoWorkers();
+    if (m_crypto && encrypted && cw)
+    {
+        // Encrypt a copy in the thread of this peer, which keeps the order
+        // of its packets
+        std::shared_ptr<STKPeer> peer = shared_from_this();
+        BareNetworkString copy(data->getData(), data->getTotalSize());
+        cw->addJob(m_host_id, [peer, copy, reliable]() mutable
+            {
+                ENetPacket* packet =
+                    peer->m_crypto->encryptSend(copy, reliable);
+                if (packet)
+                    peer->queueSendPacket(packet, EVENT_CHANNEL_NORMAL);
+            });
+        return;
+    }
+    else if (m_crypto && encrypted)
     {
         packet = m_crypto->encryptSend(*data, reliable);
     }
@@ -121,18 +156,25 @@ void STKPeer::sendPacket(NetworkString *data, bool reliable, bool encrypted)
 
     if (packet)
     {
-        if (Network::m_connection_debug)
-        {
-            Log::verbose("STKPeer", "sending packet of size %d to %s at %lf",
-                packet->dataLength, getAddress().toString().c_str(),
-                StkTime::getRealTime());
-        }
-        m_host->addEnetCommand(m_enet_peer, packet,
-                encrypted ? EVENT_CHANNEL_NORMAL : EVENT_CHANNEL_UNENCRYPTED,
-                ECT_SEND_PACKET, m_address);
+        queueSendPacket(packet,
+            encrypted ? EVENT_CHANNEL_NORMAL : EVENT_CHANNEL_UNENCRYPTED);
     }
 }   // sendPacket
 
+//-----------------------------------------------------------------------------
+/** Gives a packet to the listening thread which sends it. */
+void STKPeer::queueSendPacket(ENetPacket* packet, uint32_t channel)
+{
+    if (Network::m_connection_debug)
+    {
+        Log::verbose("STKPeer", "sending packet of size %d to %s at %lf",
+            packet->dataLength, getAddress().toString().c_str(),
+            StkTime::getRealTime());
+    }
+    m_host->addEnetCommand(m_enet_peer, packet, channel, ECT_SEND_PACKET,
+        m_address);
+}   // queueSendPacket
+
 //-----------------------------------------------------------------------------
 /** Returns if the peer is connected or not.
  */
@@ -23,6 +23,7 @@
 #ifndef STK_PEER_HPP
 #define STK_PEER_HPP
 
+#include "network/asset_dictionary.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/time.hpp"
 #include "utils/types.hpp"
@@ -44,6 +45,8 @@ class NetworkString;
 class STKHost;
 class SocketAddress;
 
+enum ENetCommandType : unsigned int;
+
 enum PeerDisconnectInfo : unsigned int
 {
     PDI_TIMEOUT = 0, //!< Timeout disconnected (default in enet).
@@ -72,7 +75,7 @@ enum AlwaysSpectateMode : uint8_t
  *  \brief Represents a peer.
  *  This class is used to interface the ENetPeer structure.
  */
-class STKPeer : public NoCopy
+class STKPeer : public NoCopy, public std::enable_shared_from_this<STKPeer>
 {
 protected:
     /** Pointer to the corresponding ENet peer data structure. */
@@ -112,7 +115,9 @@ protected:
     int m_consecutive_messages;
 
     /** Available karts and tracks from this peer */
-    std::pair<std::set<std::string>, std::set<std::string> > m_available_kts;
+    /** Karts and tracks of the client which the server has, as indices
+     *  of the asset dictionary of the server. */
+    AssetBitset m_available_karts, m_available_tracks;
 
     std::unique_ptr<Crypto> m_crypto;
 
@@ -131,6 +136,11 @@ protected:
     std::set<std::string> m_client_capabilities;
 
     std::array<int, AS_TOTAL> m_addons_scores;
+
+    // ------------------------------------------------------------------------
+    void addEnetCommand(uint32_t i, ENetCommandType ect);
+    // ------------------------------------------------------------------------
+    void queueSendPacket(ENetPacket* packet, uint32_t channel);
 public:
     STKPeer(ENetPeer *enet_peer, STKHost* host, uint32_t host_id);
     // ------------------------------------------------------------------------
@@ -171,42 +181,16 @@ public:
     float getConnectedTime() const
        { return float(StkTime::getMonoTimeMs() - m_connected_time) / 1000.0f; }
     // ------------------------------------------------------------------------
-    void setAvailableKartsTracks(std::set<std::string>& k,
-                                 std::set<std::string>& t)
-              { m_available_kts = std::make_pair(std::move(k), std::move(t)); }
-    // ------------------------------------------------------------------------
-    void eraseServerKarts(const std::set<std::string>& server_karts,
-                          std::set<std::string>& karts_erase) const
+    void setAvailableKartsTracks(AssetBitset& k, AssetBitset& t)
     {
-        if (m_available_kts.first.empty())
-            return;
-        for (const std::string& server_kart : server_karts)
-        {
-            if (m_available_kts.first.find(server_kart) ==
-                m_available_kts.first.end())
-            {
-                karts_erase.insert(server_kart);
-            }
-        }
+        m_available_karts = std::move(k);
+        m_available_tracks = std::move(t);
     }
     // ------------------------------------------------------------------------
-    void eraseServerTracks(const std::set<std::string>& server_tracks,
-                           std::set<std::string>& tracks_erase) const
-    {
-        if (m_available_kts.second.empty())
-            return;
-        for (const std::string& server_track : server_tracks)
-        {
-            if (m_available_kts.second.find(server_track) ==
-                m_available_kts.second.end())
-            {
-                tracks_erase.insert(server_track);
-            }
-        }
-    }
+    const AssetBitset& getAvailableKarts() const { return m_available_karts; }
     // ------------------------------------------------------------------------
-    std::pair<std::set<std::string>, std::set<std::string> >
-                            getClientAssets() const { return m_available_kts; }
+    const AssetBitset& getAvailableTracks() const
+                                                { return m_available_tracks; }
     // ------------------------------------------------------------------------
     void setPingInterval(uint32_t interval)
                             { enet_peer_ping_interval(m_enet_peer, interval); }
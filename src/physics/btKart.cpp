@@ -33,7 +33,7 @@
 #define ROLLING_INFLUENCE_FIX
 
 // ============================================================================
-btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
+btKart::btKart(btRigidBody* chassis, btKartRaycaster* raycaster,
                Kart *kart)
       : m_vehicleRaycaster(raycaster), m_fixed_body(0, 0, 0)
 {
@@ -223,31 +223,93 @@ void btKart::updateAllWheelTransformsWS()
 
     m_num_wheels_on_ground       = 0;
     m_visual_wheels_touch_ground = true;
+
+    // The rays of all wheels are cast as one batch.
+    m_ray_wheel.resize(0);
+    for (int i=0;i<m_wheelInfo.size();i++)
+        m_ray_wheel.push_back(i);
+    castWheelRays(1.0f);
+
+    m_ray_wheel.resize(0);
     for (int i=0;i<m_wheelInfo.size();i++)
     {
-        rayCast( i);
         if(m_wheelInfo[i].m_raycastInfo.m_isInContact)
             m_num_wheels_on_ground++;
         else
-        {
-            // If the original raycast did not hit the ground,
-            // try a little bit (5%) closer to the centre of the chassis.
-            // Some tracks have very minor gaps that would otherwise
-            // trigger odd physical behaviour.
-            rayCast(i, 0.95f);
-            if (m_wheelInfo[i].m_raycastInfo.m_isInContact)
-                m_num_wheels_on_ground++;
-        }
+            m_ray_wheel.push_back(i);
+    }
+
+    // If the original raycast did not hit the ground,
+    // try a little bit (5%) closer to the centre of the chassis.
+    // Some tracks have very minor gaps that would otherwise
+    // trigger odd physical behaviour.
+    if (m_ray_wheel.size() == 0)
+        return;
+    castWheelRays(0.95f);
+    for (int j=0;j<m_ray_wheel.size();j++)
+    {
+        if (m_wheelInfo[m_ray_wheel[j]].m_raycastInfo.m_isInContact)
+            m_num_wheels_on_ground++;
     }
 }   // updateAllWheelTransformsWS
 
 // ----------------------------------------------------------------------------
-/**
+/** Casts the rays of all wheels in m_ray_wheel as one batch, and updates
+ *  the contact information of these wheels.
+ *  \param fraction Scales the connection point of the wheels towards the
+ *         chassis centre.
  */
-btScalar btKart::rayCast(unsigned int index, float fraction)
+void btKart::castWheelRays(float fraction)
+{
+    const int num_rays = m_ray_wheel.size();
+    m_ray_from.resize(num_rays);
+    m_ray_to.resize(num_rays);
+    m_ray_results.resize(num_rays);
+    m_ray_objects.resize(num_rays);
+    for (int j = 0; j < num_rays; j++)
+        getWheelRay(m_ray_wheel[j], fraction, &m_ray_from[j], &m_ray_to[j]);
+
+    btAssert(m_vehicleRaycaster);
+    // The chassis itself is ignored, see rayCast() below.
+    m_vehicleRaycaster->castRays(num_rays, &m_ray_from[0], &m_ray_to[0],
+                                 &m_ray_results[0], &m_ray_objects[0],
+                                 m_chassisBody);
+    for (int j = 0; j < num_rays; j++)
+        setWheelContact(m_ray_wheel[j], m_ray_objects[j], m_ray_results[j]);
+}   // castWheelRays
+
+// ----------------------------------------------------------------------------
+/** Computes the ray used to find the contact point of a wheel.
+ *  \param index Index of the wheel.
+ *  \param fraction Scales the connection point of the wheel towards the
+ *         chassis centre.
+ *  \param source, target On return the start and end point of the ray.
+ */
+void btKart::getWheelRay(unsigned int index, float fraction,
+                         btVector3 *source, btVector3 *target)
 {
     btWheelInfo &wheel = m_wheelInfo[index];
+    updateWheelTransformsWS(wheel, getChassisWorldTransform(), false, fraction);
 
+    btScalar max_susp_len = wheel.getSuspensionRestLength()
+                          + wheel.m_maxSuspensionTravel;
+
+    // Do a slightly longer raycast to see if the kart might soon hit the 
+    // ground and some 'cushioning' is needed to avoid that the chassis
+    // hits the ground.
+    btScalar raylen = max_susp_len + 0.5f;
+
+    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
+    *source = wheel.m_raycastInfo.m_hardPointWS;
+    wheel.m_raycastInfo.m_contactPointWS = *source + rayvector;
+    *target = wheel.m_raycastInfo.m_contactPointWS;
+}   // getWheelRay
+
+// ----------------------------------------------------------------------------
+/**
+ */
+btScalar btKart::rayCast(unsigned int index, float fraction)
+{
     // Work around a bullet problem: when using a convex hull the raycast
     // would sometimes hit the chassis (which does not happen when using a
     // box shape). Therefore set the collision mask in the chassis body so
@@ -260,20 +322,8 @@ btScalar btKart::rayCast(unsigned int index, float fraction)
         m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
     }
 
-    updateWheelTransformsWS(wheel, getChassisWorldTransform(), false, fraction);
-
-    btScalar max_susp_len = wheel.getSuspensionRestLength()
-                          + wheel.m_maxSuspensionTravel;
-
-    // Do a slightly longer raycast to see if the kart might soon hit the 
-    // ground and some 'cushioning' is needed to avoid that the chassis
-    // hits the ground.
-    btScalar raylen = max_susp_len + 0.5f;
-
-    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-    const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+    btVector3 source, target;
+    getWheelRay(index, fraction, &source, &target);
 
     btVehicleRaycaster::btVehicleRaycasterResult rayResults;
 
@@ -281,6 +331,31 @@ btScalar btKart::rayCast(unsigned int index, float fraction)
 
     void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
 
+    if(m_chassisBody->getBroadphaseHandle())
+    {
+        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
+            = old_group;
+    }
+
+    return setWheelContact(index, object, rayResults);
+}   // rayCast
+
+// ----------------------------------------------------------------------------
+/** Updates the contact information of a wheel from the result of its
+ *  ray cast.
+ *  \param index Index of the wheel.
+ *  \param object The object hit by the ray, or NULL.
+ *  \param rayResults The result of the ray cast.
+ *  \return The suspension length, or -1 if the wheel is not in contact.
+ */
+btScalar btKart::setWheelContact(unsigned int index, void *object,
+               const btVehicleRaycaster::btVehicleRaycasterResult &rayResults)
+{
+    btWheelInfo &wheel = m_wheelInfo[index];
+    btScalar max_susp_len = wheel.getSuspensionRestLength()
+                          + wheel.m_maxSuspensionTravel;
+    btScalar raylen = max_susp_len + 0.5f;
+
     wheel.m_raycastInfo.m_groundObject = 0;
 
     btScalar depth =  raylen * rayResults.m_distFraction;
@@ -347,15 +422,9 @@ btScalar btKart::rayCast(unsigned int index, float fraction)
         wheel.m_clippedInvContactDotSuspension = btScalar(1.0);
     }
 
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
-            = old_group;
-    }
-
     return depth;
 
-}   // rayCast
+}   // setWheelContact
 
 // ----------------------------------------------------------------------------
 /** Returns the contact point of a visual wheel.
@@ -369,13 +438,10 @@ void btKart::getVisualContactPoint(const btTransform& chassis_trans,
 
     m_visual_wheels_touch_ground = true;
 
-    short int old_group = 0;
-    if (m_chassisBody->getBroadphaseHandle())
-    {
-        old_group = m_chassisBody->getBroadphaseHandle()
-                  ->m_collisionFilterGroup;
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
-    }
+    // Both rear wheel rays are cast as one batch, ignoring the chassis.
+    btVector3 source[2], target[2];
+    btVehicleRaycaster::btVehicleRaycasterResult ray_results[2];
+    void* objects[2];
     for (int index = 2; index <= 3; index++)
     {
         // Map index 0-1 to wheel 2-3 (which are the rear wheels)
@@ -391,20 +457,15 @@ void btKart::getVisualContactPoint(const btTransform& chassis_trans,
         btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
         btVector3 pos = m_kart->getKartModel()->getWheelGraphicsPosition(index);
         pos.setZ(pos.getZ()*0.9f);
-        btVector3 source = chassis_trans(pos);
-        btVector3 target = source + rayvector;
-        btVehicleRaycaster::btVehicleRaycasterResult rayResults;
-
-        void* object = m_vehicleRaycaster->castRay(source, target, rayResults);
-        if(index == 2) *left  = rayResults.m_hitPointInWorld;
-        else           *right = rayResults.m_hitPointInWorld;
-        m_visual_wheels_touch_ground &= (object != NULL);
+        source[index - 2] = chassis_trans(pos);
+        target[index - 2] = source[index - 2] + rayvector;
     }   // for index in [2,3]
 
-    if (m_chassisBody->getBroadphaseHandle())
-    {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = old_group;
-    }
+    m_vehicleRaycaster->castRays(2, source, target, ray_results, objects,
+                                 m_chassisBody);
+    *left  = ray_results[0].m_hitPointInWorld;
+    *right = ray_results[1].m_hitPointInWorld;
+    m_visual_wheels_touch_ground = objects[0] != NULL && objects[1] != NULL;
 }   // getVisualContactPoint
 
 // ----------------------------------------------------------------------------
@@ -69,7 +69,7 @@ private:
     btScalar calcRollingFriction(btWheelContactPoint& contactPoint);
 
     btScalar            m_damping;
-    btVehicleRaycaster *m_vehicleRaycaster;
+    btKartRaycaster    *m_vehicleRaycaster;
 
     /** Sliding (skidding) will only be permited when this is true. Also check
      *  the friction parameter in the wheels since friction directly affects
@@ -124,8 +124,22 @@ private:
 
     btAlignedObjectArray<btWheelInfo> m_wheelInfo;
 
+    /** Wheel index, start and end point, and result of each ray of the
+     *  current ray batch. Members to avoid allocations each physics step. */
+    btAlignedObjectArray<int>       m_ray_wheel;
+    btAlignedObjectArray<btVector3> m_ray_from;
+    btAlignedObjectArray<btVector3> m_ray_to;
+    btAlignedObjectArray<btVehicleRaycaster::btVehicleRaycasterResult>
+                                    m_ray_results;
+    btAlignedObjectArray<void*>     m_ray_objects;
+
     void     defaultInit();
     btScalar rayCast(btWheelInfo& wheel, const btVector3& ray);
+    void     getWheelRay(unsigned int index, float fraction,
+                         btVector3 *source, btVector3 *target);
+    btScalar setWheelContact(unsigned int index, void *object,
+                const btVehicleRaycaster::btVehicleRaycasterResult &result);
+    void     castWheelRays(float fraction);
     void     updateWheelTransformsWS(btWheelInfo& wheel,
                                      btTransform chassis_trans,
                                      bool interpolatedTransform=true,
@@ -140,7 +154,7 @@ public:
      *         (this is used to get access to the kart properties).
      */
                        btKart(btRigidBody* chassis,
-                              btVehicleRaycaster* raycaster,
+                              btKartRaycaster* raycaster,
                               Kart *kart);
      virtual          ~btKart();
     void               reset();
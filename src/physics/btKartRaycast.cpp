@@ -19,57 +19,84 @@
 #include "physics/triangle_mesh.hpp"
 #include "tracks/track.hpp"
 
-void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
-                               btVehicleRaycasterResult& result)
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "LinearMath/btAabbUtil2.h"
+
+// ============================================================================
+class btKartRaycaster::ClosestWithNormal
+                         : public btCollisionWorld::ClosestRayResultCallback
 {
-    // ========================================================================
-    class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
+private:
+    int m_triangle_index;
+public:
+    /** Constructor, initialises the triangle index. */
+    ClosestWithNormal(const btVector3 &from,
+                      const btVector3 &to)
+                      : btCollisionWorld::ClosestRayResultCallback(from,to)
     {
-    private:
-        int m_triangle_index;
-    public:
-        /** Constructor, initialises the triangle index. */
-        ClosestWithNormal(const btVector3 &from,
-                          const btVector3 &to)
-                          : btCollisionWorld::ClosestRayResultCallback(from,to)
-        {
-            m_triangle_index = -1;
-        }   // CloestWithNormal
-        // --------------------------------------------------------------------
-        /** Stores the index of the triangle hit. */
-        virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
-                                         bool normalInWorldSpace)
-        {
-            // We don't always get a triangle index, sometimes (e.g. ray hits
-            // other kart) we get shapePart=-1, or no localShapeInfo at all
-            if(rayResult.m_localShapeInfo &&
-                rayResult.m_localShapeInfo->m_shapePart>-1)
-                m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
-            return
-                btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
-                normalInWorldSpace);
-        }
-        // --------------------------------------------------------------------
-        /** Returns the index of the triangle which was hit, or -1 if
-         *  no triangle was hit. */
-        int getTriangleIndex() const { return m_triangle_index; }
+        m_triangle_index = -1;
+    }   // CloestWithNormal
+    // ------------------------------------------------------------------------
+    /** Stores the index of the triangle hit. */
+    virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
+                                     bool normalInWorldSpace)
+    {
+        // We don't always get a triangle index, sometimes (e.g. ray hits
+        // other kart) we get shapePart=-1, or no localShapeInfo at all
+        if(rayResult.m_localShapeInfo &&
+            rayResult.m_localShapeInfo->m_shapePart>-1)
+            m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
+        return
+            btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
+            normalInWorldSpace);
+    }
+    // ------------------------------------------------------------------------
+    /** Returns the index of the triangle which was hit, or -1 if
+     *  no triangle was hit. */
+    int getTriangleIndex() const { return m_triangle_index; }
 
-    };   // CloestWithNormal
-    // ========================================================================
+};   // CloestWithNormal
 
-    ClosestWithNormal rayCallback(from,to);
+namespace
+{
+// ============================================================================
+/** Collects all collision objects whose broadphase volume overlaps the
+ *  bounding box of a batch of rays. */
+class CandidateCollector : public btBroadphaseAabbCallback
+{
+public:
+    btAlignedObjectArray<btCollisionObject*> *m_objects;
+    const btCollisionObject                  *m_ignore;
+    // ------------------------------------------------------------------------
+    virtual bool process(const btBroadphaseProxy* proxy)
+    {
+        btCollisionObject *object =
+            (btCollisionObject*)proxy->m_clientObject;
+        if (object != m_ignore)
+            m_objects->push_back(object);
+        return true;
+    }
+};   // CandidateCollector
 
-    m_dynamicsWorld->rayTest(from, to, rayCallback);
+}   // anonymous namespace
 
-    if (rayCallback.hasHit())
+// ----------------------------------------------------------------------------
+/** Converts the closest hit of a ray into a vehicle raycaster result.
+ *  \return The rigid body hit, or NULL if nothing (that has contact
+ *          response) was hit.
+ */
+void* btKartRaycaster::setResult(const ClosestWithNormal &ray_callback,
+                                 btVehicleRaycasterResult& result) const
+{
+    if (ray_callback.hasHit())
     {
-        btRigidBody* body = btRigidBody::upcast(rayCallback.m_collisionObject);
+        btRigidBody* body = btRigidBody::upcast(ray_callback.m_collisionObject);
         if (body && body->hasContactResponse())
         {
-            result.m_hitPointInWorld = rayCallback.m_hitPointWorld;
-            result.m_hitNormalInWorld = rayCallback.m_hitNormalWorld;
+            result.m_hitPointInWorld = ray_callback.m_hitPointWorld;
+            result.m_hitNormalInWorld = ray_callback.m_hitNormalWorld;
             result.m_hitNormalInWorld.normalize();
-            result.m_distFraction = rayCallback.m_closestHitFraction;
+            result.m_distFraction = ray_callback.m_closestHitFraction;
             result.m_triangle_index = -1;
             // FIXME: this code assumes atm that the object the kart is
             // driving on is the main track (and not e.g. a physical object).
@@ -82,16 +109,16 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
             TriangleMesh::RigidBodyTriangleMesh *rbtm =
                 dynamic_cast<TriangleMesh::RigidBodyTriangleMesh*>(body);
             if(m_smooth_normals &&
-                rayCallback.getTriangleIndex()>-1 &&
+                ray_callback.getTriangleIndex()>-1 &&
                 rbtm != NULL                         )
             {
 #undef DEBUG_NORMALS
 #ifdef DEBUG_NORMALS
                 btVector3 n=result.m_hitNormalInWorld;
 #endif
-                result.m_triangle_index = rayCallback.getTriangleIndex();
+                result.m_triangle_index = ray_callback.getTriangleIndex();
                 result.m_hitNormalInWorld =
-                    rbtm->m_triangle_mesh->getInterpolatedNormal(rayCallback.getTriangleIndex(),
+                    rbtm->m_triangle_mesh->getInterpolatedNormal(ray_callback.getTriangleIndex(),
                                              result.m_hitPointInWorld);
 #ifdef DEBUG_NORMALS
                 printf("old %f %f %f new %f %f %f\n",
@@ -105,5 +132,100 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
         }
     }
     return 0;
-}
+}   // setResult
+
+// ----------------------------------------------------------------------------
+void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
+                               btVehicleRaycasterResult& result)
+{
+    ClosestWithNormal rayCallback(from,to);
+
+    m_dynamicsWorld->rayTest(from, to, rayCallback);
+
+    return setResult(rayCallback, result);
+}   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts a batch of rays, e.g. all wheel rays of a kart. Instead of one
+ *  broadphase ray query per ray, the broadphase is queried once with the
+ *  bounding box of all rays. Then each ray is only tested against the
+ *  candidates whose current bounding box it intersects, before the exact
+ *  (and expensive) test against the collision shape is done.
+ *  \param num_rays Number of rays.
+ *  \param from, to Start and end point of each ray.
+ *  \param results The result for each ray.
+ *  \param objects The rigid body hit by each ray, or NULL.
+ *  \param ignore A collision object that should not be hit (e.g. the
+ *         chassis of the kart casting the rays).
+ */
+void btKartRaycaster::castRays(int num_rays, const btVector3 *from,
+                               const btVector3 *to,
+                               btVehicleRaycasterResult *results,
+                               void **objects,
+                               const btCollisionObject *ignore)
+{
+    if (num_rays <= 0) return;
+
+    btVector3 aabb_min = from[0], aabb_max = from[0];
+    for (int i = 0; i < num_rays; i++)
+    {
+        aabb_min.setMin(from[i]);
+        aabb_min.setMin(to[i]);
+        aabb_max.setMax(from[i]);
+        aabb_max.setMax(to[i]);
+    }
+
+    m_candidates.resize(0);
+    CandidateCollector collector;
+    collector.m_objects = &m_candidates;
+    collector.m_ignore  = ignore;
+    m_dynamicsWorld->getBroadphase()->aabbTest(aabb_min, aabb_max, collector);
 
+    // The broadphase volume of moving objects is only updated once per
+    // physics step, so use the current bounding box for the ray tests.
+    const int num_candidates = m_candidates.size();
+    m_candidate_bounds.resize(num_candidates * 2);
+    for (int j = 0; j < num_candidates; j++)
+    {
+        const btCollisionObject *object = m_candidates[j];
+        object->getCollisionShape()->getAabb(object->getWorldTransform(),
+                                             m_candidate_bounds[2 * j],
+                                             m_candidate_bounds[2 * j + 1]);
+    }
+
+    for (int i = 0; i < num_rays; i++)
+    {
+        results[i] = btVehicleRaycasterResult();
+        ClosestWithNormal ray_callback(from[i], to[i]);
+        btTransform from_trans, to_trans;
+        from_trans.setIdentity();
+        from_trans.setOrigin(from[i]);
+        to_trans.setIdentity();
+        to_trans.setOrigin(to[i]);
+
+        btVector3 dir = to[i] - from[i];
+        btVector3 inv_dir(dir.getX() == 0 ? BT_LARGE_FLOAT : 1.0f / dir.getX(),
+                          dir.getY() == 0 ? BT_LARGE_FLOAT : 1.0f / dir.getY(),
+                          dir.getZ() == 0 ? BT_LARGE_FLOAT : 1.0f / dir.getZ());
+        unsigned int signs[3] = { inv_dir.getX() < 0.0f,
+                                  inv_dir.getY() < 0.0f,
+                                  inv_dir.getZ() < 0.0f };
+
+        for (int j = 0; j < num_candidates; j++)
+        {
+            btCollisionObject *object = m_candidates[j];
+            if (!ray_callback.needsCollision(object->getBroadphaseHandle()))
+                continue;
+            btScalar t_min = 1.0f;
+            if (!btRayAabb2(from[i], inv_dir, signs,
+                            &m_candidate_bounds[2 * j], t_min, 0.0f,
+                            ray_callback.m_closestHitFraction))
+                continue;
+            btCollisionWorld::rayTestSingle(from_trans, to_trans, object,
+                                            object->getCollisionShape(),
+                                            object->getWorldTransform(),
+                                            ray_callback);
+        }
+        objects[i] = setResult(ray_callback, results[i]);
+    }
+}   // castRays
@@ -20,13 +20,25 @@ class btDynamicsWorld;
 #include "BulletDynamics/Dynamics/btActionInterface.h"
 
 
+class btCollisionObject;
+
 class btKartRaycaster : public btVehicleRaycaster
 {
 private:
+    class ClosestWithNormal;
+
     btDynamicsWorld*    m_dynamicsWorld;
     /** True if the normals should be smoothed. Not all tracks support this,
     *  so this flag is set depending on track when constructing this object. */
     bool                m_smooth_normals;
+
+    /** Candidate objects of the current ray batch, and their bounding boxes
+     *  (min and max for each object). Members to avoid allocations. */
+    btAlignedObjectArray<btCollisionObject*> m_candidates;
+    btAlignedObjectArray<btVector3>          m_candidate_bounds;
+
+    void* setResult(const ClosestWithNormal &ray_callback,
+                    btVehicleRaycasterResult& result) const;
 public:
     btKartRaycaster(btDynamicsWorld* world, bool smooth_normals=false)
         :m_dynamicsWorld(world), m_smooth_normals(smooth_normals)
@@ -35,6 +47,10 @@ public:
 
     virtual void* castRay(const btVector3& from,const btVector3& to,
                           btVehicleRaycasterResult& result);
+    void          castRays(int num_rays, const btVector3 *from,
+                           const btVector3 *to,
+                           btVehicleRaycasterResult *results, void **objects,
+                           const btCollisionObject *ignore);
 
 };
 
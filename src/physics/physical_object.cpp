@@ -634,7 +634,11 @@ void PhysicalObject::update(float dt)
     if (!m_is_dynamic) return;
 
     // Round values in network for better synchronization
-    if (NetworkConfig::get()->roundValuesNow())
+    const bool round_values = NetworkConfig::get()->roundValuesNow();
+    // A sleeping body has not moved since its last update
+    if (!m_body->isActive() && !round_values) return;
+
+    if (round_values)
         CompressNetworkBody::compress(m_body, m_motion_state);
 
     m_current_transform = m_body->getWorldTransform();
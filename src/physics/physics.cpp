@@ -32,6 +32,8 @@
 #include "modes/soccer_world.hpp"
 #include "modes/world.hpp"
 #include "network/network_config.hpp"
+#include "network/rewind_manager.hpp"
+#include "network/server_config.hpp"
 #include "karts/explosion_animation.hpp"
 #include "physics/btKart.hpp"
 #include "physics/irr_debug_drawer.hpp"
@@ -44,9 +46,18 @@
 #include "tracks/track_object.hpp"
 #include "utils/profiler.hpp"
 #include "utils/stk_process.hpp"
+#include "utils/string_utils.hpp"
+
+#include <stdio.h>
 
 //=============================================================================
 Physics* g_physics[PT_COUNT];
+
+const float Physics::INTERACTION_DISTANCE = 10.0f;
+int         Physics::m_num_threads          = 0;
+std::string Physics::m_hash_file;
+std::string Physics::m_hash_baseline;
+bool        Physics::m_hash_mismatch        = false;
 // ----------------------------------------------------------------------------
 Physics* Physics::get()
 {
@@ -77,6 +88,10 @@ Physics::Physics() : btSequentialImpulseConstraintSolver()
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
     m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
+    m_reduced_rate        = 1;
+    m_pending_ticks       = 0;
+    m_num_steps           = 0;
+    m_num_ticks           = 0;
 }   // Physics
 
 //-----------------------------------------------------------------------------
@@ -93,6 +108,17 @@ void Physics::init(const Vec3 &world_min, const Vec3 &world_max)
                                                  this,
                                                  m_collision_conf);
     m_karts_to_delete.clear();
+    if (m_num_threads > 0)
+        m_dynamics_world->setNumThreads(m_num_threads);
+    else if (NetworkConfig::get()->isServer())
+        m_dynamics_world->setNumThreads(ServerConfig::m_physics_threads);
+    m_reduced_rate  = NetworkConfig::get()->isServer()
+                    ? ServerConfig::m_reduced_physics_rate : 1;
+    m_pending_ticks = 0;
+    m_num_steps     = 0;
+    m_num_ticks     = 0;
+    m_step_hashes.clear();
+    loadBaselineHashes();
     m_dynamics_world->setGravity(
         btVector3(0.0f,
                   -Track::getCurrentTrack()->getGravity(),
@@ -115,6 +141,30 @@ void Physics::init(const Vec3 &world_min, const Vec3 &world_max)
 //-----------------------------------------------------------------------------
 Physics::~Physics()
 {
+    if (m_reduced_rate > 1 && m_num_ticks > 0)
+    {
+        Log::info("Physics", "Simulated %d physics steps for %d ticks "
+                  "(%.1f%%).", m_num_steps, m_num_ticks,
+                  100.0f * m_num_steps / m_num_ticks);
+    }
+    if (!m_hash_file.empty() && !m_step_hashes.empty())
+    {
+        FILE *f = fopen(m_hash_file.c_str(), "w");
+        if (f)
+        {
+            for (auto &step : m_step_hashes)
+            {
+                fprintf(f, "%d %016llx\n", step.first,
+                        (unsigned long long)step.second);
+            }
+            fclose(f);
+        }
+        else
+        {
+            Log::error("Physics", "Can't write physics hashes to '%s'.",
+                       m_hash_file.c_str());
+        }
+    }
     delete m_debug_drawer;
     delete m_dynamics_world;
     delete m_axis_sweep;
@@ -189,18 +239,45 @@ void Physics::update(int ticks)
 
     // Since the world update (which calls physics update) is called at the
     // fixed frequency necessary for the physics update, we need to do exactly
-    // one physic step only.
+    // one physic step only. A server with a reduced physics rate skips
+    // ticks while no karts interact, and then simulates all skipped ticks
+    // with one larger step. All ticks are simulated before the next state
+    // is saved and sent to the clients.
+    m_num_ticks += ticks;
+    m_pending_ticks += ticks;
+    World* world = World::getWorld();
+    if (m_reduced_rate > 1 && world->isRacePhase() &&
+        m_pending_ticks < m_reduced_rate &&
+        !RewindManager::get()->shouldSaveState(world->getTicksSinceStart() + 1))
+    {
+        const float swept = world->getKartIndex().getMaxSpeed() *
+                            stk_config->ticks2Time(m_reduced_rate);
+        const float distance = INTERACTION_DISTANCE + 2.0f * swept;
+        if (!world->hasPhysicsInteraction(distance, swept) &&
+            !hasGeometryOnPath(swept))
+        {
+            m_physics_loop_active = false;
+            PROFILER_POP_CPU_MARKER();
+            return;
+        }
+    }
+    const float step = stk_config->ticks2Time(m_pending_ticks);
+    m_pending_ticks = 0;
+    m_num_steps++;
+
     double start;
     if(UserConfigParams::m_physics_debug) start = StkTime::getRealTime();
 
-    m_dynamics_world->stepSimulation(stk_config->ticks2Time(1), 1,
-                                     stk_config->ticks2Time(1)      );
+    m_dynamics_world->stepSimulation(step, 1, step);
     if (UserConfigParams::m_physics_debug)
     {
-        Log::verbose("Physics", "At %d physics duration %12.8f",
+        Log::verbose("Physics", "At %d physics duration %12.8f hash %016llx",
                      World::getWorld()->getTicksSinceStart(),
-                     StkTime::getRealTime() - start);
+                     StkTime::getRealTime() - start,
+                     (unsigned long long)getStateHash());
     }
+    if (!m_hash_file.empty() || !m_baseline_hashes.empty())
+        checkStepHash(getStateHash());
 
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
@@ -420,6 +497,67 @@ void Physics::update(int ticks)
     PROFILER_POP_CPU_MARKER();
 }   // update
 
+// ============================================================================
+namespace
+{
+/** A closest ray result which ignores one collision object, used to test the
+ *  path of a kart without hitting the kart itself. */
+class ClosestIgnoring : public btCollisionWorld::ClosestRayResultCallback
+{
+private:
+    const btCollisionObject *m_ignore;
+public:
+    ClosestIgnoring(const btVector3 &from, const btVector3 &to,
+                    const btCollisionObject *ignore)
+        : btCollisionWorld::ClosestRayResultCallback(from, to)
+    {
+        m_ignore = ignore;
+    }   // ClosestIgnoring
+    // ------------------------------------------------------------------------
+    virtual bool needsCollision(btBroadphaseProxy *proxy) const
+    {
+        if (proxy->m_clientObject == m_ignore)
+            return false;
+        return btCollisionWorld::ClosestRayResultCallback::
+               needsCollision(proxy);
+    }   // needsCollision
+};   // ClosestIgnoring
+
+}   // anonymous namespace
+
+//-----------------------------------------------------------------------------
+/** Returns true if there is any geometry (track, track objects or other
+ *  karts) on the path a kart can take until the next physics step. A larger
+ *  physics step could let the kart tunnel through thin geometry, so physics
+ *  is simulated every tick then. A kart on a flat surface does not hit it
+ *  with this test, since the ray starts at the center of the kart and
+ *  follows its velocity.
+ *  \param swept Distance a kart can move until the next physics step.
+ */
+bool Physics::hasGeometryOnPath(float swept) const
+{
+    World *world = World::getWorld();
+    for (unsigned int i = 0; i < world->getNumKarts(); i++)
+    {
+        const AbstractKart *kart = world->getKart(i);
+        if (kart->isEliminated())
+            continue;
+        // A kart which hardly moves could start to move in any direction,
+        // so use its forward direction then.
+        btVector3 direction = kart->getVelocity();
+        if (direction.length2() < 1.0f)
+            direction = kart->getTrans().getBasis().getColumn(2);
+        const btVector3 from = kart->getXYZ();
+        const btVector3 to = from + direction.normalized() *
+                             (swept + 0.5f * kart->getKartLength() + 1.0f);
+        ClosestIgnoring ray_callback(from, to, kart->getBody());
+        m_dynamics_world->rayTest(from, to, ray_callback);
+        if (ray_callback.hasHit())
+            return true;
+    }
+    return false;
+}   // hasGeometryOnPath
+
 //-----------------------------------------------------------------------------
 /** Handles the special case of two karts colliding with each other, which
  *  means that bombs must be passed on. If both karts have a bomb, they'll
@@ -556,208 +694,369 @@ void Physics::KartKartCollision(AbstractKart *kart_a,
 }   // KartKartCollision
 
 //-----------------------------------------------------------------------------
-/** This function is called at each internal bullet timestep. It is used
- *  here to do the collision handling: using the contact manifolds after a
- *  physics time step might miss some collisions (when more than one internal
- *  time step was done, and the collision is added and removed). So this
- *  function stores all collisions in a list, which is then handled after the
- *  actual physics timestep. This list only stores a collision if it's not
- *  already in the list, so a collisions which is reported more than once is
- *  nevertheless only handled once.
- *  The list of collision
+/** Returns a hash of the transform and velocity of all rigid bodies.
+ */
+uint64_t Physics::getStateHash() const
+{
+    const btCollisionObjectArray &all_objs =
+        m_dynamics_world->getCollisionObjectArray();
+    const int num_objs = all_objs.size();
+    uint64_t hash = StringUtils::fnv1a64(&num_objs, sizeof(num_objs));
+    for (int i = 0; i < num_objs; i++)
+    {
+        const btRigidBody* body = btRigidBody::upcast(all_objs[i]);
+        if (!body || body->isStaticObject())
+            continue;
+        // Only use x, y and z, the 4th component of a vector is undefined
+        const btTransform &t = body->getWorldTransform();
+        const btVector3 *v[6] = { &t.getBasis()[0], &t.getBasis()[1],
+                                  &t.getBasis()[2], &t.getOrigin(),
+                                  &body->getLinearVelocity(),
+                                  &body->getAngularVelocity() };
+        for (const btVector3* vec : v)
+            hash = StringUtils::fnv1a64(vec->m_floats, 3 * sizeof(btScalar),
+                                        hash);
+    }
+    return hash;
+}   // getStateHash
+
+//-----------------------------------------------------------------------------
+/** Sets the files used to compare the physics of two runs of the same
+ *  replay (e.g. --history or a profile race with the same --seed), for
+ *  example with a different number of physics threads, which must give
+ *  bit-identical results.
+ *  \param file File to which the tick and state hash of each physics step
+ *         are written at the end of the race, or empty.
+ *  \param baseline A file written by an earlier run. Each step is compared
+ *         with it, and the first difference is reported. Can be empty.
+ */
+void Physics::setHashFiles(const std::string &file,
+                           const std::string &baseline)
+{
+    m_hash_file     = file;
+    m_hash_baseline = baseline;
+    m_hash_mismatch = false;
+}   // setHashFiles
+
+//-----------------------------------------------------------------------------
+/** Loads the hashes of the baseline file, if one is set.
+ */
+void Physics::loadBaselineHashes()
+{
+    m_baseline_hashes.clear();
+    if (m_hash_baseline.empty())
+        return;
+    FILE *f = fopen(m_hash_baseline.c_str(), "r");
+    if (!f)
+    {
+        Log::error("Physics", "Can't read physics hashes from '%s'.",
+                   m_hash_baseline.c_str());
+        m_hash_mismatch = true;
+        return;
+    }
+    int ticks;
+    unsigned long long hash;
+    while (fscanf(f, "%d %llx", &ticks, &hash) == 2)
+        m_baseline_hashes.emplace_back(ticks, (uint64_t)hash);
+    fclose(f);
+    Log::info("Physics", "Comparing physics with %d steps of '%s'.",
+              (int)m_baseline_hashes.size(), m_hash_baseline.c_str());
+}   // loadBaselineHashes
+
+//-----------------------------------------------------------------------------
+/** Stores the state hash of the current physics step, and compares it with
+ *  the same step of the baseline. Only the first difference is reported,
+ *  since all later steps will be different, too.
+ *  \param hash The state hash after the step.
+ */
+void Physics::checkStepHash(uint64_t hash)
+{
+    const int ticks = World::getWorld()->getTicksSinceStart();
+    const unsigned step = (unsigned)m_step_hashes.size();
+    m_step_hashes.emplace_back(ticks, hash);
+    if (m_baseline_hashes.empty() || m_hash_mismatch)
+        return;
+    if (step >= m_baseline_hashes.size())
+    {
+        Log::error("Physics", "Step %u at %d is not in the baseline.",
+                   step, ticks);
+        m_hash_mismatch = true;
+    }
+    else if (m_baseline_hashes[step] != m_step_hashes[step])
+    {
+        Log::error("Physics", "Step %u at %d has hash %016llx, baseline "
+                   "has %016llx at %d.", step, ticks,
+                   (unsigned long long)hash,
+                   (unsigned long long)m_baseline_hashes[step].second,
+                   m_baseline_hashes[step].first);
+        m_hash_mismatch = true;
+    }
+}   // checkStepHash
+
+//-----------------------------------------------------------------------------
+/** This function is called after the constraints of each internal bullet
+ *  timestep are solved. It is used here to do the collision handling: using
+ *  the contact manifolds after a physics time step might miss some
+ *  collisions (when more than one internal time step was done, and the
+ *  collision is added and removed). So this function stores all collisions
+ *  in a list, which is then handled after the actual physics timestep. This
+ *  list only stores a collision if it's not already in the list, so a
+ *  collisions which is reported more than once is nevertheless only handled
+ *  once.
+ *  The manifolds are inspected in parallel if the physics uses threads, but
+ *  the resulting events are always handled in the order of the manifolds.
  *  Parameters: see bullet documentation for details.
  */
-btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
-                             btPersistentManifold** manifold,int numManifolds,
-                             btTypedConstraint** constraints,
-                             int numConstraints,
-                             const btContactSolverInfo& info,
-                             btIDebugDraw* debugDrawer,
-                             btStackAlloc* stackAlloc,
-                             btDispatcher* dispatcher)
+void Physics::allSolved(const btContactSolverInfo& info,
+                        btIDebugDraw* debug_drawer, btStackAlloc* stack_alloc)
 {
-    btScalar returnValue=
-        btSequentialImpulseConstraintSolver::solveGroup(bodies, numBodies,
-                                                        manifold, numManifolds,
-                                                        constraints,
-                                                        numConstraints, info,
-                                                        debugDrawer,
-                                                        stackAlloc,
-                                                        dispatcher);
-    int currentNumManifolds = m_dispatcher->getNumManifolds();
+    btSequentialImpulseConstraintSolver::allSolved(info, debug_drawer,
+                                                   stack_alloc);
+    const unsigned num_manifolds = m_dispatcher->getNumManifolds();
+    // Only use more than one job if each thread gets enough manifolds to
+    // make up for the synchronisation
+    const unsigned MIN_MANIFOLDS_PER_JOB = 16;
+    unsigned num_jobs = std::min(m_dynamics_world->getNumThreads(),
+                                 num_manifolds / MIN_MANIFOLDS_PER_JOB);
+    num_jobs = std::max(num_jobs, 1u);
+    if (m_manifold_events.size() < num_jobs)
+        m_manifold_events.resize(num_jobs);
+
+    m_dynamics_world->runParallel(num_jobs,
+        [this, num_jobs, num_manifolds](unsigned job, unsigned thread)
+        {
+            std::vector<ManifoldEvent>& events = m_manifold_events[job];
+            events.clear();
+            const unsigned end = (job + 1) * num_manifolds / num_jobs;
+            for (unsigned i = job * num_manifolds / num_jobs; i < end; i++)
+            {
+                inspectManifold(
+                    m_dispatcher->getManifoldByIndexInternal(i), &events);
+            }
+        });
+
     // We can't explode a rocket in a loop, since a rocket might collide with
     // more than one object, and/or more than once with each object (if there
     // is more than one collision point). So keep a list of rockets that will
     // be exploded after the collisions
-    for(int i=0; i<currentNumManifolds; i++)
+    for (unsigned job = 0; job < num_jobs; job++)
     {
-        btPersistentManifold* contact_manifold =
-            m_dynamics_world->getDispatcher()->getManifoldByIndexInternal(i);
+        for (const ManifoldEvent& e : m_manifold_events[job])
+        {
+            switch (e.m_type)
+            {
+            case ManifoldEvent::ME_COLLISION:
+                m_all_collisions.push_back(e.m_up[0], e.m_contact_point[0],
+                                           e.m_up[1], e.m_contact_point[1]);
+                break;
+            case ManifoldEvent::ME_KART_CRASH:
+                e.m_up[0]->getPointerKart()->crashed(e.m_material,
+                                                     e.m_normal);
+                break;
+            case ManifoldEvent::ME_OBJECT_HIT:
+                e.m_up[0]->getPointerPhysicalObject()->hit(e.m_material,
+                                                           e.m_normal);
+                break;
+            }
+        }
+    }
+}   // allSolved
 
-        const btCollisionObject* objA =
-            static_cast<const btCollisionObject*>(contact_manifold->getBody0());
-        const btCollisionObject* objB =
-            static_cast<const btCollisionObject*>(contact_manifold->getBody1());
+//-----------------------------------------------------------------------------
+/** Determines which collision events a contact manifold causes. This
+ *  function must not modify any object, since it is called from several
+ *  threads.
+ *  \param contact_manifold The manifold to inspect.
+ *  \param events The events are appended to this vector.
+ */
+void Physics::inspectManifold(const btPersistentManifold *contact_manifold,
+                              std::vector<ManifoldEvent> *events) const
+{
+    const btCollisionObject* objA =
+        static_cast<const btCollisionObject*>(contact_manifold->getBody0());
+    const btCollisionObject* objB =
+        static_cast<const btCollisionObject*>(contact_manifold->getBody1());
 
-        unsigned int num_contacts = contact_manifold->getNumContacts();
-        if(!num_contacts) continue;   // no real collision
+    unsigned int num_contacts = contact_manifold->getNumContacts();
+    if(!num_contacts) return;   // no real collision
 
-        const UserPointer *upA = (UserPointer*)(objA->getUserPointer());
-        const UserPointer *upB = (UserPointer*)(objB->getUserPointer());
+    const UserPointer *upA = (UserPointer*)(objA->getUserPointer());
+    const UserPointer *upB = (UserPointer*)(objB->getUserPointer());
 
-        if(!upA || !upB) continue;
+    if(!upA || !upB) return;
 
-        // 1) object A is a track
-        // =======================
-        if(upA->is(UserPointer::UP_TRACK))
+    auto add_collision = [events](const UserPointer *a,
+                                  const btVector3 &contact_point_a,
+                                  const UserPointer *b,
+                                  const btVector3 &contact_point_b)
+    {
+        ManifoldEvent e;
+        e.m_type             = ManifoldEvent::ME_COLLISION;
+        e.m_up[0]            = a;
+        e.m_up[1]            = b;
+        e.m_contact_point[0] = contact_point_a;
+        e.m_contact_point[1] = contact_point_b;
+        e.m_material         = NULL;
+        events->push_back(e);
+    };
+    auto add_hit = [events](ManifoldEvent::EventType type,
+                            const UserPointer *up, const Material *m,
+                            const btVector3 &normal)
+    {
+        ManifoldEvent e;
+        e.m_type     = type;
+        e.m_up[0]    = up;
+        e.m_up[1]    = NULL;
+        e.m_material = m;
+        e.m_normal   = normal;
+        events->push_back(e);
+    };
+
+    // 1) object A is a track
+    // =======================
+    if(upA->is(UserPointer::UP_TRACK))
+    {
+        if(upB->is(UserPointer::UP_FLYABLE))   // 1.1 projectile hits track
+            add_collision(
+                upB, contact_manifold->getContactPoint(0).m_localPointB,
+                upA, contact_manifold->getContactPoint(0).m_localPointA);
+        else if(upB->is(UserPointer::UP_KART))
+        {
+            int n = contact_manifold->getContactPoint(0).m_index0;
+            const Material *m
+                = n>=0 ? upA->getPointerTriangleMesh()->getMaterial(n)
+                       : NULL;
+            // I assume that the normal needs to be flipped in this case,
+            // but  I can't verify this since it appears that bullet
+            // always has the kart as object A, not B.
+            const btVector3 &normal = -contact_manifold->getContactPoint(0)
+                                                        .m_normalWorldOnB;
+            add_hit(ManifoldEvent::ME_KART_CRASH, upB, m, normal);
+        }
+        else if(upB->is(UserPointer::UP_PHYSICAL_OBJECT))
         {
-            if(upB->is(UserPointer::UP_FLYABLE))   // 1.1 projectile hits track
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
-            else if(upB->is(UserPointer::UP_KART))
+            std::vector<int> used;
+            for(int i=0; i< contact_manifold->getNumContacts(); i++)
             {
-                AbstractKart *kart=upB->getPointerKart();
-                int n = contact_manifold->getContactPoint(0).m_index0;
+                int n = contact_manifold->getContactPoint(i).m_index0;
+                // Make sure to call the callback function only once
+                // per triangle.
+                if(std::find(used.begin(), used.end(), n)!=used.end())
+                    continue;
+                used.push_back(n);
                 const Material *m
-                    = n>=0 ? upA->getPointerTriangleMesh()->getMaterial(n)
-                           : NULL;
-                // I assume that the normal needs to be flipped in this case,
-                // but  I can't verify this since it appears that bullet
-                // always has the kart as object A, not B.
-                const btVector3 &normal = -contact_manifold->getContactPoint(0)
-                                                            .m_normalWorldOnB;
-                kart->crashed(m, normal);
-            }
-            else if(upB->is(UserPointer::UP_PHYSICAL_OBJECT))
-            {
-                std::vector<int> used;
-                for(int i=0; i< contact_manifold->getNumContacts(); i++)
-                {
-                    int n = contact_manifold->getContactPoint(i).m_index0;
-                    // Make sure to call the callback function only once
-                    // per triangle.
-                    if(std::find(used.begin(), used.end(), n)!=used.end())
-                        continue;
-                    used.push_back(n);
-                    const Material *m
-                        = n >= 0 ? upB->getPointerTriangleMesh()->getMaterial(n)
-                        : NULL;
-                    const btVector3 &normal = contact_manifold->getContactPoint(i)
-                        .m_normalWorldOnB;
-                    upA->getPointerPhysicalObject()->hit(m, normal);
-                }   // for i in getNumContacts()
-            }   // upB is physical object
-        }   // upA is track
-        // 2) object a is a kart
-        // =====================
-        else if(upA->is(UserPointer::UP_KART))
+                    = n >= 0 ? upB->getPointerTriangleMesh()->getMaterial(n)
+                    : NULL;
+                const btVector3 &normal = contact_manifold->getContactPoint(i)
+                    .m_normalWorldOnB;
+                add_hit(ManifoldEvent::ME_OBJECT_HIT, upA, m, normal);
+            }   // for i in getNumContacts()
+        }   // upB is physical object
+    }   // upA is track
+    // 2) object a is a kart
+    // =====================
+    else if(upA->is(UserPointer::UP_KART))
+    {
+        if(upB->is(UserPointer::UP_TRACK))
         {
-            if(upB->is(UserPointer::UP_TRACK))
+            int n = contact_manifold->getContactPoint(0).m_index1;
+            const Material *m
+                = n>=0 ? upB->getPointerTriangleMesh()->getMaterial(n)
+                       : NULL;
+            const btVector3 &normal = contact_manifold->getContactPoint(0)
+                                                       .m_normalWorldOnB;
+            add_hit(ManifoldEvent::ME_KART_CRASH, upA, m, normal); // Kart hit track
+        }
+        else if(upB->is(UserPointer::UP_FLYABLE))
+            // 2.1 projectile hits kart
+            add_collision(
+                upB, contact_manifold->getContactPoint(0).m_localPointB,
+                upA, contact_manifold->getContactPoint(0).m_localPointA);
+        else if(upB->is(UserPointer::UP_KART))
+            // 2.2 kart hits kart
+            add_collision(
+                upA, contact_manifold->getContactPoint(0).m_localPointA,
+                upB, contact_manifold->getContactPoint(0).m_localPointB);
+        else if(upB->is(UserPointer::UP_PHYSICAL_OBJECT))
+        {
+            // 2.3 kart hits physical object
+            add_collision(
+                upB, contact_manifold->getContactPoint(0).m_localPointB,
+                upA, contact_manifold->getContactPoint(0).m_localPointA);
+            // If the object is a statical object (e.g. a door in
+            // overworld) add a push back to avoid that karts get stuck
+            if (objB->isStaticObject())
             {
-                AbstractKart *kart = upA->getPointerKart();
-                int n = contact_manifold->getContactPoint(0).m_index1;
-                const Material *m
-                    = n>=0 ? upB->getPointerTriangleMesh()->getMaterial(n)
-                           : NULL;
                 const btVector3 &normal = contact_manifold->getContactPoint(0)
-                                                           .m_normalWorldOnB;
-                kart->crashed(m, normal);   // Kart hit track
-            }
-            else if(upB->is(UserPointer::UP_FLYABLE))
-                // 2.1 projectile hits kart
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
-            else if(upB->is(UserPointer::UP_KART))
-                // 2.2 kart hits kart
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
-            else if(upB->is(UserPointer::UP_PHYSICAL_OBJECT))
-            {
-                // 2.3 kart hits physical object
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
-                // If the object is a statical object (e.g. a door in
-                // overworld) add a push back to avoid that karts get stuck
-                if (objB->isStaticObject())
-                {
-                    AbstractKart *kart = upA->getPointerKart();
-                    const btVector3 &normal = contact_manifold->getContactPoint(0)
-                        .m_normalWorldOnB;
-                    kart->crashed((Material*)NULL, normal);
-                }   // isStatiObject
-            }
-            else if(upB->is(UserPointer::UP_ANIMATION))
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
+                    .m_normalWorldOnB;
+                add_hit(ManifoldEvent::ME_KART_CRASH, upA, NULL, normal);
+            }   // isStatiObject
         }
-        // 3) object is a projectile
-        // =========================
-        else if(upA->is(UserPointer::UP_FLYABLE))
+        else if(upB->is(UserPointer::UP_ANIMATION))
+            add_collision(
+                upB, contact_manifold->getContactPoint(0).m_localPointB,
+                upA, contact_manifold->getContactPoint(0).m_localPointA);
+    }
+    // 3) object is a projectile
+    // =========================
+    else if(upA->is(UserPointer::UP_FLYABLE))
+    {
+        // 3.1) projectile hits track
+        // 3.2) projectile hits projectile
+        // 3.3) projectile hits physical object
+        // 3.4) projectile hits kart
+        if(upB->is(UserPointer::UP_TRACK          ) ||
+           upB->is(UserPointer::UP_FLYABLE        ) ||
+           upB->is(UserPointer::UP_PHYSICAL_OBJECT) ||
+           upB->is(UserPointer::UP_KART           )   )
         {
-            // 3.1) projectile hits track
-            // 3.2) projectile hits projectile
-            // 3.3) projectile hits physical object
-            // 3.4) projectile hits kart
-            if(upB->is(UserPointer::UP_TRACK          ) ||
-               upB->is(UserPointer::UP_FLYABLE        ) ||
-               upB->is(UserPointer::UP_PHYSICAL_OBJECT) ||
-               upB->is(UserPointer::UP_KART           )   )
-            {
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
-            }
+            add_collision(
+                upA, contact_manifold->getContactPoint(0).m_localPointA,
+                upB, contact_manifold->getContactPoint(0).m_localPointB);
         }
-        // Object is a physical object
-        // ===========================
-        else if(upA->is(UserPointer::UP_PHYSICAL_OBJECT))
+    }
+    // Object is a physical object
+    // ===========================
+    else if(upA->is(UserPointer::UP_PHYSICAL_OBJECT))
+    {
+        if(upB->is(UserPointer::UP_FLYABLE))
+            add_collision(
+                upB, contact_manifold->getContactPoint(0).m_localPointB,
+                upA, contact_manifold->getContactPoint(0).m_localPointA);
+        else if(upB->is(UserPointer::UP_KART))
+            add_collision(
+                upA, contact_manifold->getContactPoint(0).m_localPointA,
+                upB, contact_manifold->getContactPoint(0).m_localPointB);
+        else if(upB->is(UserPointer::UP_TRACK))
         {
-            if(upB->is(UserPointer::UP_FLYABLE))
-                m_all_collisions.push_back(
-                    upB, contact_manifold->getContactPoint(0).m_localPointB,
-                    upA, contact_manifold->getContactPoint(0).m_localPointA);
-            else if(upB->is(UserPointer::UP_KART))
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
-            else if(upB->is(UserPointer::UP_TRACK))
+            std::vector<int> used;
+            for(int i=0; i< contact_manifold->getNumContacts(); i++)
             {
-                std::vector<int> used;
-                for(int i=0; i< contact_manifold->getNumContacts(); i++)
-                {
-                    int n = contact_manifold->getContactPoint(i).m_index1;
-                    // Make sure to call the callback function only once
-                    // per triangle.
-                    if(std::find(used.begin(), used.end(), n)!=used.end())
-                        continue;
-                    used.push_back(n);
-                    const Material *m
-                        = n >= 0 ? upB->getPointerTriangleMesh()->getMaterial(n)
-                        : NULL;
-                    const btVector3 &normal = contact_manifold->getContactPoint(i)
-                                             .m_normalWorldOnB;
-                    upA->getPointerPhysicalObject()->hit(m, normal);
-                }   // for i in getNumContacts()
-            }   // upB is track
-        }   // upA is physical object
-        else if (upA->is(UserPointer::UP_ANIMATION))
-        {
-            if(upB->is(UserPointer::UP_KART))
-                m_all_collisions.push_back(
-                    upA, contact_manifold->getContactPoint(0).m_localPointA,
-                    upB, contact_manifold->getContactPoint(0).m_localPointB);
-        }
-        else
-            assert("Unknown user pointer");           // 4) Should never happen
-    }   // for i<numManifolds
-
-    return returnValue;
-}   // solveGroup
+                int n = contact_manifold->getContactPoint(i).m_index1;
+                // Make sure to call the callback function only once
+                // per triangle.
+                if(std::find(used.begin(), used.end(), n)!=used.end())
+                    continue;
+                used.push_back(n);
+                const Material *m
+                    = n >= 0 ? upB->getPointerTriangleMesh()->getMaterial(n)
+                    : NULL;
+                const btVector3 &normal = contact_manifold->getContactPoint(i)
+                                         .m_normalWorldOnB;
+                add_hit(ManifoldEvent::ME_OBJECT_HIT, upA, m, normal);
+            }   // for i in getNumContacts()
+        }   // upB is track
+    }   // upA is physical object
+    else if (upA->is(UserPointer::UP_ANIMATION))
+    {
+        if(upB->is(UserPointer::UP_KART))
+            add_collision(
+                upA, contact_manifold->getContactPoint(0).m_localPointA,
+                upB, contact_manifold->getContactPoint(0).m_localPointB);
+    }
+    else
+        assert("Unknown user pointer");           // 4) Should never happen
+}   // inspectManifold
 
 // ----------------------------------------------------------------------------
 /** A debug draw function to show the track and all karts.
@@ -25,6 +25,8 @@
   */
 
 #include <set>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 #include "btBulletDynamicsCommon.h"
@@ -34,6 +36,7 @@
 #include "physics/user_pointer.hpp"
 
 class AbstractKart;
+class Material;
 class STKDynamicsWorld;
 class Vec3;
 
@@ -123,6 +126,22 @@ private:
         }
     };  // CollisionList
     // ========================================================================
+    /** The result of inspecting one contact manifold: either a collision to
+     *  be stored in m_all_collisions, or a kart or physical object hitting
+     *  the track. Manifolds are inspected in parallel, and the events are
+     *  then handled in the order of the manifolds. */
+    struct ManifoldEvent
+    {
+        enum EventType { ME_COLLISION, ME_KART_CRASH, ME_OBJECT_HIT };
+        EventType          m_type;
+        const UserPointer *m_up[2];
+        btVector3          m_contact_point[2];
+        const Material    *m_material;
+        btVector3          m_normal;
+    };   // ManifoldEvent
+
+    /** The events of each range of manifolds handled by one job. */
+    std::vector<std::vector<ManifoldEvent> > m_manifold_events;
 
     /** This flag is set while bullets time step processing is taking
     *  place. It is used to avoid altering data structures that might
@@ -147,8 +166,50 @@ private:
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** Distance (in addition to the distance karts can move until the next
+     *  physics step) up to which objects are considered to interact. */
+    static const float INTERACTION_DISTANCE;
+
+    /** On a server, physics is only simulated once every this many ticks
+     *  while there is no interaction between karts (see
+     *  World::hasPhysicsInteraction() and hasGeometryOnPath()). 1 means
+     *  every tick. */
+    int                              m_reduced_rate;
+
+    /** Number of ticks which still have to be simulated. */
+    int                              m_pending_ticks;
+
+    /** Number of physics steps and of ticks since init, used to report
+     *  the effect of the reduced rate. */
+    int                              m_num_steps, m_num_ticks;
+
+    /** Number of threads set with --physics-threads, 0 to use the
+     *  physics-threads server option. */
+    static int                       m_num_threads;
+
+    /** File to which the state hash of each physics step is written
+     *  (--physics-hashes), or empty. */
+    static std::string               m_hash_file;
+
+    /** Hash file of an earlier run to compare the hashes of this run with
+     *  (--physics-hashes-baseline), or empty. */
+    static std::string               m_hash_baseline;
+
+    /** True if a hash was different from the baseline. */
+    static bool                      m_hash_mismatch;
+
+    /** The tick and state hash of each physics step of this run, and of
+     *  the baseline. */
+    std::vector<std::pair<int, uint64_t> > m_step_hashes, m_baseline_hashes;
+
              Physics();
     virtual ~Physics();
+    void  loadBaselineHashes();
+    void  checkStepHash(uint64_t hash);
+    bool  hasGeometryOnPath(float swept) const;
+    void  inspectManifold(const btPersistentManifold *contact_manifold,
+                          std::vector<ManifoldEvent> *events) const;
+    uint64_t getStateHash() const;
 
 public:
     // ----------------------------------------------------------------------------------------
@@ -158,6 +219,17 @@ public:
     // ----------------------------------------------------------------------------------------
     static void destroy();
     // ----------------------------------------------------------------------------------------
+    /** Sets the number of threads to solve the physics with, which is
+     *  also used if this is not a server. */
+    static void setNumThreads(int num_threads) { m_num_threads = num_threads; }
+    // ----------------------------------------------------------------------------------------
+    static void setHashFiles(const std::string &file,
+                             const std::string &baseline);
+    // ----------------------------------------------------------------------------------------
+    /** Returns true if the state of a physics step was different from the
+     *  baseline of --physics-hashes-baseline. */
+    static bool hasHashMismatch() { return m_hash_mismatch; }
+    // ----------------------------------------------------------------------------------------
     void  init             (const Vec3 &min_world, const Vec3 &max_world);
     void  addKart          (const AbstractKart *k);
     void  addBody          (btRigidBody* b) {m_dynamics_world->addRigidBody(b);}
@@ -176,12 +248,9 @@ public:
     /** Returns true if the debug drawer is enabled. */
     bool  isDebug() const     {return m_debug_drawer->debugEnabled(); }
     IrrDebugDrawer* getDebugDrawer() { return m_debug_drawer; }
-    virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies,
-                                btPersistentManifold** manifold,int numManifolds,
-                                btTypedConstraint** constraints,int numConstraints,
-                                const btContactSolverInfo& info,
-                                btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc,
-                                btDispatcher* dispatcher);
+    virtual void allSolved(const btContactSolverInfo& info,
+                           btIDebugDraw* debug_drawer,
+                           btStackAlloc* stack_alloc);
 };
 
 #endif // HEADER_PHYSICS_HPP
@@ -0,0 +1,106 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "physics/physics_threads.hpp"
+
+#include "utils/stk_process.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
+
+// ----------------------------------------------------------------------------
+/** Starts the threads.
+ *  \param num_threads Number of threads including the calling thread.
+ */
+PhysicsThreads::PhysicsThreads(unsigned num_threads)
+{
+    m_job          = NULL;
+    m_job_count    = 0;
+    m_busy_threads = 0;
+    m_generation   = 0;
+    m_quit         = false;
+    // The worker threads need the process type of the world they simulate
+    const ProcessType type = STKProcess::getType();
+    for (unsigned i = 1; i < num_threads; i++)
+    {
+        m_threads.emplace_back([this, i, type]()->void
+        {
+            VS::setThreadName((StringUtils::toString(i) + "Physics")
+                .c_str());
+            STKProcess::init(type);
+            unsigned generation = 0;
+            while (true)
+            {
+                std::unique_lock<std::mutex> ul(m_mutex);
+                m_start_cv.wait(ul, [this, &generation]
+                    {
+                        return m_quit || m_generation != generation;
+                    });
+                if (m_quit)
+                    return;
+                generation = m_generation;
+                ul.unlock();
+                runJobs(i);
+                ul.lock();
+                if (--m_busy_threads == 0)
+                    m_done_cv.notify_one();
+            }
+        });
+    }
+}   // PhysicsThreads
+
+// ----------------------------------------------------------------------------
+PhysicsThreads::~PhysicsThreads()
+{
+    std::unique_lock<std::mutex> ul(m_mutex);
+    m_quit = true;
+    m_start_cv.notify_all();
+    ul.unlock();
+    for (std::thread& t : m_threads)
+        t.join();
+}   // ~PhysicsThreads
+
+// ----------------------------------------------------------------------------
+void PhysicsThreads::runJobs(unsigned thread_index)
+{
+    for (unsigned i = thread_index; i < m_job_count; i += getNumThreads())
+        (*m_job)(i, thread_index);
+}   // runJobs
+
+// ----------------------------------------------------------------------------
+/** Calls job(i, thread) for all i in [0, job_count) and returns when all
+ *  jobs are done.
+ */
+void PhysicsThreads::run(unsigned job_count,
+                         const std::function<void(unsigned, unsigned)>& job)
+{
+    m_job = &job;
+    m_job_count = job_count;
+    if (m_threads.empty() || job_count < 2)
+    {
+        runJobs(0);
+        return;
+    }
+    std::unique_lock<std::mutex> ul(m_mutex);
+    m_busy_threads = (unsigned)m_threads.size();
+    m_generation++;
+    m_start_cv.notify_all();
+    ul.unlock();
+    runJobs(0);
+    ul.lock();
+    m_done_cv.wait(ul, [this] { return m_busy_threads == 0; });
+}   // run
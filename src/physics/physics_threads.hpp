@@ -0,0 +1,68 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_PHYSICS_THREADS_HPP
+#define HEADER_PHYSICS_THREADS_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A small pool of threads which runs the jobs of one physics step
+ *  together with the calling thread.
+ *  The jobs are assigned statically: thread t (the calling thread being
+ *  thread 0) runs the jobs t, t+n, t+2n, ... where n is the number of
+ *  threads. So each job always runs on the same thread, which allows jobs
+ *  to use per-thread data (e.g. a constraint solver) without locking.
+ * \ingroup physics
+ */
+class PhysicsThreads : public NoCopy
+{
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+
+    std::condition_variable m_start_cv, m_done_cv;
+
+    /** The job function of the current run, called with job index and
+     *  thread index. */
+    const std::function<void(unsigned, unsigned)>* m_job;
+
+    unsigned m_job_count, m_busy_threads, m_generation;
+
+    bool m_quit;
+
+    void runJobs(unsigned thread_index);
+
+public:
+             PhysicsThreads(unsigned num_threads);
+            ~PhysicsThreads();
+    void     run(unsigned job_count,
+                 const std::function<void(unsigned, unsigned)>& job);
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads including the calling thread. */
+    unsigned getNumThreads() const { return (unsigned)m_threads.size() + 1; }
+};   // PhysicsThreads
+
+#endif
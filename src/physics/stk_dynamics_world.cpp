@@ -0,0 +1,250 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2020 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "physics/stk_dynamics_world.hpp"
+
+#include "physics/physics_threads.hpp"
+
+#include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+
+// ----------------------------------------------------------------------------
+/** Returns the island of a constraint, same as in btDiscreteDynamicsWorld. */
+static int getConstraintIslandId(const btTypedConstraint* c)
+{
+    const btCollisionObject& obj0 = c->getRigidBodyA();
+    const btCollisionObject& obj1 = c->getRigidBodyB();
+    return obj0.getIslandTag() >= 0 ? obj0.getIslandTag()
+                                    : obj1.getIslandTag();
+}   // getConstraintIslandId
+
+// ============================================================================
+/** Sorts constraints by island, same as in btDiscreteDynamicsWorld. */
+class SortConstraintOnIsland
+{
+public:
+    bool operator()(const btTypedConstraint* lhs,
+                    const btTypedConstraint* rhs) const
+    {
+        return getConstraintIslandId(lhs) < getConstraintIslandId(rhs);
+    }
+};   // SortConstraintOnIsland
+
+// ============================================================================
+/** Copies the bodies, manifolds and constraints of each island reported by
+ *  the island manager into the world, so that the islands can be solved
+ *  later in parallel. */
+class IslandCollector : public btSimulationIslandManager::IslandCallback
+{
+private:
+    STKDynamicsWorld *m_world;
+    const btAlignedObjectArray<btTypedConstraint*> &m_constraints;
+public:
+    IslandCollector(STKDynamicsWorld *world,
+                    const btAlignedObjectArray<btTypedConstraint*> &c)
+        : m_world(world), m_constraints(c)
+    {
+    }
+    // ------------------------------------------------------------------------
+    virtual void ProcessIsland(btCollisionObject** bodies, int num_bodies,
+                               btPersistentManifold** manifolds,
+                               int num_manifolds, int island_id)
+    {
+        STKDynamicsWorld::Island island;
+        island.m_first_body       = (int)m_world->m_island_bodies.size();
+        island.m_num_bodies       = num_bodies;
+        island.m_first_manifold   = (int)m_world->m_island_manifolds.size();
+        island.m_num_manifolds    = num_manifolds;
+        island.m_first_constraint = (int)m_world->m_island_constraints.size();
+        m_world->m_island_bodies.insert(m_world->m_island_bodies.end(),
+                                        bodies, bodies + num_bodies);
+        m_world->m_island_manifolds.insert(m_world->m_island_manifolds.end(),
+                                           manifolds,
+                                           manifolds + num_manifolds);
+        // A negative island id means that islands are not split, and
+        // everything is solved together
+        for (int i = 0; i < m_constraints.size(); i++)
+        {
+            if (island_id < 0 ||
+                getConstraintIslandId(m_constraints[i]) == island_id)
+                m_world->m_island_constraints.push_back(m_constraints[i]);
+        }
+        island.m_num_constraints = (int)m_world->m_island_constraints.size()
+                                 - island.m_first_constraint;
+        m_world->m_islands.push_back(island);
+    }   // ProcessIsland
+};   // IslandCollector
+
+// ============================================================================
+STKDynamicsWorld::~STKDynamicsWorld()
+{
+    setNumThreads(1);
+}   // ~STKDynamicsWorld
+
+// ----------------------------------------------------------------------------
+/** Sets the number of threads used to solve the constraints and for
+ *  runParallel(). 1 means that bullet's default solving is used.
+ */
+void STKDynamicsWorld::setNumThreads(unsigned num_threads)
+{
+    delete m_threads;
+    m_threads = NULL;
+    for (btSequentialImpulseConstraintSolver* solver : m_thread_solvers)
+        delete solver;
+    m_thread_solvers.clear();
+    if (num_threads < 2)
+        return;
+
+    m_threads = new PhysicsThreads(num_threads);
+    for (unsigned i = 1; i < num_threads; i++)
+        m_thread_solvers.push_back(new btSequentialImpulseConstraintSolver());
+}   // setNumThreads
+
+// ----------------------------------------------------------------------------
+/** Runs job(i, thread) for all i in [0, job_count) on the physics threads,
+ *  see PhysicsThreads::run(). Without threads all jobs are run by the
+ *  calling thread.
+ */
+void STKDynamicsWorld::runParallel(unsigned job_count,
+                           const std::function<void(unsigned, unsigned)>& job)
+{
+    if (m_threads)
+    {
+        m_threads->run(job_count, job);
+        return;
+    }
+    for (unsigned i = 0; i < job_count; i++)
+        job(i, 0);
+}   // runParallel
+
+// ----------------------------------------------------------------------------
+/** Solves the constraints. If threads are used, the islands are first
+ *  collected, and then each island is solved on its own by the solver of
+ *  the thread it is assigned to. Since islands do not share any dynamic
+ *  body, the result of each island does not depend on the other islands,
+ *  the order in which they are solved or the number of threads.
+ *  Bullet's random constraint order uses a seed shared by all islands, so
+ *  in this case the default (serial) solving is used.
+ */
+void STKDynamicsWorld::solveConstraints(btContactSolverInfo &solver_info)
+{
+    if (!m_threads || (solver_info.m_solverMode & SOLVER_RANDMIZE_ORDER))
+    {
+        btDiscreteDynamicsWorld::solveConstraints(solver_info);
+        return;
+    }
+
+    btAlignedObjectArray<btTypedConstraint*> sorted_constraints;
+    sorted_constraints.resize(m_constraints.size());
+    for (int i = 0; i < m_constraints.size(); i++)
+        sorted_constraints[i] = m_constraints[i];
+    sorted_constraints.quickSort(SortConstraintOnIsland());
+
+    m_islands.clear();
+    m_island_bodies.clear();
+    m_island_manifolds.clear();
+    m_island_constraints.clear();
+    IslandCollector collector(this, sorted_constraints);
+    m_constraintSolver->prepareSolve(getNumCollisionObjects(),
+                                     m_dispatcher1->getNumManifolds());
+    m_islandManager->buildAndProcessIslands(m_dispatcher1, this, &collector);
+
+    // Bullet adds islands to a batch until the batch has more than
+    // m_minimumSolverBatchSize manifolds and constraints, then solves the
+    // whole batch at once. The bodies of an island without contacts are
+    // written back (which, with split impulse, integrates their transform)
+    // only if their batch is solved, i.e. not if they are in a last batch
+    // without work, or if batching is disabled.
+    const int batch_size = solver_info.m_minimumSolverBatchSize;
+    unsigned batch_start = 0;
+    int batch_work = 0;
+    for (unsigned i = 0; i < m_islands.size(); i++)
+    {
+        m_islands[i].m_write_back = false;
+        if (batch_size <= 1)
+            continue;
+        batch_work += m_islands[i].m_num_manifolds
+                    + m_islands[i].m_num_constraints;
+        if (batch_work > batch_size || i + 1 == m_islands.size())
+        {
+            for (unsigned j = batch_start; j <= i; j++)
+                m_islands[j].m_write_back = batch_work > 0;
+            batch_start = i + 1;
+            batch_work = 0;
+        }
+    }
+
+    runParallel((unsigned)m_islands.size(),
+        [this, &solver_info](unsigned island, unsigned thread)
+        {
+            solveIsland(m_islands[island], thread == 0 ? m_constraintSolver
+                                           : m_thread_solvers[thread - 1],
+                        solver_info);
+        });
+
+    m_constraintSolver->allSolved(solver_info, m_debugDrawer, m_stackAlloc);
+}   // solveConstraints
+
+// ----------------------------------------------------------------------------
+/** Solves one island.
+ *  \param island The island to solve.
+ *  \param solver The solver to use, which must not be used by another
+ *         thread at the same time.
+ *  \param info The solver settings.
+ */
+void STKDynamicsWorld::solveIsland(const Island &island,
+                                   btConstraintSolver *solver,
+                                   const btContactSolverInfo &info)
+{
+    btCollisionObject** bodies = &m_island_bodies[island.m_first_body];
+    if (island.m_num_manifolds + island.m_num_constraints == 0)
+    {
+        // Bullet solves an island without contacts only as part of a
+        // batch with other islands, which writes back the bodies with no
+        // change in velocity. Do the same here, so the result is the same
+        // as without threads.
+        if (!island.m_write_back)
+            return;
+        for (int i = 0; i < island.m_num_bodies; i++)
+        {
+            btRigidBody* body = btRigidBody::upcast(bodies[i]);
+            if (!body)
+                continue;
+            body->internalGetDeltaLinearVelocity().setZero();
+            body->internalGetDeltaAngularVelocity().setZero();
+            if (info.m_splitImpulse)
+            {
+                body->internalGetPushVelocity().setZero();
+                body->internalGetTurnVelocity().setZero();
+                body->internalWritebackVelocity(info.m_timeStep);
+            }
+            else
+                body->internalWritebackVelocity();
+        }
+        return;
+    }
+
+    btPersistentManifold** manifolds = island.m_num_manifolds > 0 ?
+        &m_island_manifolds[island.m_first_manifold] : NULL;
+    btTypedConstraint** constraints = island.m_num_constraints > 0 ?
+        &m_island_constraints[island.m_first_constraint] : NULL;
+    solver->solveGroup(bodies, island.m_num_bodies,
+                       manifolds, island.m_num_manifolds,
+                       constraints, island.m_num_constraints,
+                       info, /*debug_drawer*/NULL, m_stackAlloc,
+                       m_dispatcher1);
+}   // solveIsland
@@ -21,12 +21,54 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include <functional>
+#include <vector>
+
+class PhysicsThreads;
+
 /** A thin wrapper around bullet's btDiscreteDynamicsWorld. Used to
  *  be able to query and set the 'left over' time from a previous
  *  time step, which is needed for more precise rewind/replays.
+ *  Optionally the simulation islands are solved in parallel, see
+ *  solveConstraints().
  */
 class STKDynamicsWorld : public btDiscreteDynamicsWorld
 {
+private:
+    /** Threads used to solve the islands in parallel, or NULL. */
+    PhysicsThreads *m_threads;
+
+    /** One solver for each additional thread (the first thread uses the
+     *  solver of the world). */
+    std::vector<btSequentialImpulseConstraintSolver*> m_thread_solvers;
+
+    /** The bodies, manifolds and constraints of all islands to be solved
+     *  in this step. Each island is a range in these arrays. */
+    std::vector<btCollisionObject*>    m_island_bodies;
+    std::vector<btPersistentManifold*> m_island_manifolds;
+    std::vector<btTypedConstraint*>    m_island_constraints;
+
+    /** Start index of each island in m_island_bodies, m_island_manifolds
+     *  and m_island_constraints. */
+    struct Island
+    {
+        int m_first_body, m_num_bodies;
+        int m_first_manifold, m_num_manifolds;
+        int m_first_constraint, m_num_constraints;
+        /** If the bodies of an island without manifolds and constraints
+         *  are written back, see solveConstraints(). */
+        bool m_write_back;
+    };
+    std::vector<Island> m_islands;
+
+    friend class IslandCollector;
+
+    void solveIsland(const Island &island, btConstraintSolver *solver,
+                     const btContactSolverInfo &info);
+
+protected:
+    virtual void solveConstraints(btContactSolverInfo &solver_info);
+
 public:
     /** The standard constructor which just created a btDiscreteDynamicsWorld. */
     STKDynamicsWorld(btDispatcher*             dispatcher,
@@ -38,8 +80,17 @@ public:
                                              constraintSolver,
                                              collisionConfiguration)
     {
+        m_threads = NULL;
     }
-
+    virtual ~STKDynamicsWorld();
+    void setNumThreads(unsigned num_threads);
+    void runParallel(unsigned job_count,
+                     const std::function<void(unsigned, unsigned)>& job);
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads used (1 if not solving in parallel). */
+    unsigned getNumThreads() const
+                       { return (unsigned)m_thread_solvers.size() + 1; }
+    // ------------------------------------------------------------------------
     /** Resets m_localTime to 0. This allows more precise replay of
      *  physics, which is important for replaying histories. */
     void resetLocalTime() { m_localTime = 0; }
@@ -52,4 +103,3 @@ public:
 };   // STKDynamicsWorld
 #endif
 /* EOF */
-
@@ -45,6 +45,7 @@ extern "C"
 #include "utils/string_utils.hpp"
 #include "utils/profiler.hpp"
 
+#include <cstdio>
 
 using namespace Scripting;
 
@@ -86,6 +87,9 @@ namespace Scripting
     {
         // Release the engine
         m_pending_timeouts.clearAndDeleteAll();
+        for (asIScriptContext* ctx : m_context_pool)
+            ctx->Release();
+        m_context_pool.clear();
         m_engine->DiscardModule(MODULE_ID_MAIN_SCRIPT_FILE);
         m_engine->Release();
     }
@@ -188,7 +192,7 @@ namespace Scripting
             return;
         }
 
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = acquireContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "evalScript: Failed to create the context.");
@@ -200,7 +204,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "evalScript: Failed to prepare the context.");
-            ctx->Release();
+            releaseContext(ctx);
             return;
         }
 
@@ -223,7 +227,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        releaseContext(ctx);
         func->Release();
     }
 
@@ -231,7 +235,7 @@ namespace Scripting
 
     void ScriptEngine::runDelegate(asIScriptFunction* delegate)
     {
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = acquireContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "runMethod: Failed to create the context.");
@@ -243,7 +247,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "runMethod: Failed to prepare the context.");
-            ctx->Release();
+            releaseContext(ctx);
             return;
         }
 
@@ -268,7 +272,7 @@ namespace Scripting
             }
         }
 
-        ctx->Release();
+        releaseContext(ctx);
     }
 
     //-----------------------------------------------------------------------------
@@ -325,7 +329,8 @@ namespace Scripting
     /** runs the specified script
     *  \param string scriptName = name of script to run
     */
-    void ScriptEngine::runFunction(bool warn_if_not_found, std::string function_name)
+    void ScriptEngine::runFunction(bool warn_if_not_found,
+                                   const std::string& function_name)
     {
         std::function<void(asIScriptContext*)> callback;
         std::function<void(asIScriptContext*)> get_return_value;
@@ -334,7 +339,8 @@ namespace Scripting
 
     //-----------------------------------------------------------------------------
 
-    void ScriptEngine::runFunction(bool warn_if_not_found, std::string function_name,
+    void ScriptEngine::runFunction(bool warn_if_not_found,
+        const std::string& function_name,
         std::function<void(asIScriptContext*)> callback)
     {
         std::function<void(asIScriptContext*)> get_return_value;
@@ -346,7 +352,8 @@ namespace Scripting
     /** runs the specified script
     *  \param string scriptName = name of script to run
     */
-    void ScriptEngine::runFunction(bool warn_if_not_found, std::string function_name,
+    void ScriptEngine::runFunction(bool warn_if_not_found,
+        const std::string& function_name,
         std::function<void(asIScriptContext*)> callback,
         std::function<void(asIScriptContext*)> get_return_value)
     {
@@ -407,7 +414,7 @@ namespace Scripting
         }
 
         // Create a context that will execute the script.
-        asIScriptContext *ctx = m_engine->CreateContext();
+        asIScriptContext *ctx = acquireContext();
         if (ctx == NULL)
         {
             Log::error("Scripting", "Failed to create the context.");
@@ -424,7 +431,7 @@ namespace Scripting
         if (r < 0)
         {
             Log::error("Scripting", "Failed to prepare the context.");
-            ctx->Release();
+            releaseContext(ctx);
             //m_engine->Release();
             return;
         }
@@ -472,10 +479,35 @@ namespace Scripting
                 get_return_value(ctx);
         }
 
-        // We must release the contexts when no longer using them
-        ctx->Release();
+        // Return the context to the pool, so that it can be reused
+        releaseContext(ctx);
     }
 
+    //-----------------------------------------------------------------------------
+    /** Returns a context to execute a script function. A context from the
+     *  pool of unused contexts is used if possible, since creating a new
+     *  context for each call is expensive. Since a script function can
+     *  call another script function, more than one context can be in use.
+     */
+    asIScriptContext* ScriptEngine::acquireContext()
+    {
+        if (m_context_pool.empty())
+            return m_engine->CreateContext();
+
+        asIScriptContext* ctx = m_context_pool.back();
+        m_context_pool.pop_back();
+        return ctx;
+    }   // acquireContext
+
+    //-----------------------------------------------------------------------------
+    /** Returns a context that was acquired with acquireContext() to the pool.
+     */
+    void ScriptEngine::releaseContext(asIScriptContext* ctx)
+    {
+        ctx->Unprepare();
+        m_context_pool.push_back(ctx);
+    }   // releaseContext
+
     //-----------------------------------------------------------------------------
 
     void ScriptEngine::cleanupCache()
@@ -522,8 +554,6 @@ namespace Scripting
 
     bool ScriptEngine::loadScript(std::string script_path, bool clear_previous)
     {
-        int r;
-
         std::string script = getScript(script_path);
         if (script.size() == 0)
         {
@@ -531,20 +561,13 @@ namespace Scripting
             return false;
         }
 
-        // Add the script sections that will be compiled into executable code.
-        // If we want to combine more than one file into the same script, then 
-        // we can call AddScriptSection() several times for the same module and
-        // the script engine will treat them all as if they were one. The script
-        // section name, will allow us to localize any errors in the script code.
-        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE,
-            clear_previous ? asGM_ALWAYS_CREATE : asGM_CREATE_IF_NOT_EXISTS);
-        r = mod->AddScriptSection("script", &script[0], script.size());
-        if (r < 0)
-        {
-            Log::error("Scripting", "AddScriptSection() failed");
-            return false;
-        }
-    
+        // Store the script sections that will be compiled into executable
+        // code. All sections are compiled (or loaded from the byte code
+        // cache) as one module in compileLoadedScripts(), so that the cache
+        // can be looked up with the content of all scripts.
+        if (clear_previous)
+            m_script_sections.clear();
+        m_script_sections.push_back(script);
         return true;
     }
 
@@ -553,7 +576,53 @@ namespace Scripting
     bool ScriptEngine::compileLoadedScripts()
     {
         int r;
-        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_CREATE_IF_NOT_EXISTS);
+        asIScriptModule *mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+
+        // Try to load the compiled byte code of the scripts from the cache.
+        // The key contains the (preprocessed) scripts, and the versions of
+        // STK and AngelScript, since the byte code depends on the registered
+        // application interface.
+        std::string cache_file;
+        if (!m_script_sections.empty())
+        {
+            uint64_t key = StringUtils::fnv1a64(STK_VERSION);
+            const int as_version = ANGELSCRIPT_VERSION;
+            key = StringUtils::fnv1a64(&as_version, sizeof(as_version), key);
+            const int pointer_size = sizeof(void*);
+            key = StringUtils::fnv1a64(&pointer_size, sizeof(pointer_size), key);
+            for (const std::string& section : m_script_sections)
+            {
+                const uint64_t size = section.size();
+                key = StringUtils::fnv1a64(&size, sizeof(size), key);
+                key = StringUtils::fnv1a64(section, key);
+            }
+            char name[32];
+            snprintf(name, 32, "%016llx.asbc", (unsigned long long)key);
+            cache_file = file_manager->getCachedScriptsDir() + name;
+            if (loadByteCode(mod, cache_file))
+            {
+                m_script_sections.clear();
+                return true;
+            }
+            // A failed load can leave a partial module behind
+            mod = m_engine->GetModule(MODULE_ID_MAIN_SCRIPT_FILE, asGM_ALWAYS_CREATE);
+        }
+
+        // If we want to combine more than one file into the same script, then 
+        // we can call AddScriptSection() several times for the same module and
+        // the script engine will treat them all as if they were one. The script
+        // section name, will allow us to localize any errors in the script code.
+        for (const std::string& section : m_script_sections)
+        {
+            r = mod->AddScriptSection("script", section.c_str(), section.size());
+            if (r < 0)
+            {
+                Log::error("Scripting", "AddScriptSection() failed");
+                m_script_sections.clear();
+                return false;
+            }
+        }
+        m_script_sections.clear();
 
         // Compile the script. If there are any compiler messages they will
         // be written to the message stream that we set right after creating the 
@@ -566,20 +635,110 @@ namespace Scripting
             return false;
         }
 
-        // The engine doesn't keep a copy of the script sections after Build() has
-        // returned. So if the script needs to be recompiled, then all the script
-        // sections must be added again.
-
         // If we want to have several scripts executing at different times but 
         // that have no direct relation with each other, then we can compile them
         // into separate script modules. Each module uses their own namespace and 
         // scope, so function names, and global variables will not conflict with
         // each other.
 
+        if (!cache_file.empty())
+            saveByteCode(mod, cache_file);
         return true;
     }
 
     //-----------------------------------------------------------------------------
+#if ANGELSCRIPT_VERSION >= 23100
+    /** A binary stream to save and load compiled scripts from a file. */
+    class ByteCodeStream : public asIBinaryStream
+    {
+    private:
+        FILE* m_file;
+    public:
+        ByteCodeStream(FILE* file) : m_file(file) {}
+        // ------------------------------------------------------------------------
+        virtual int Read(void* ptr, asUINT size)
+        {
+            if (size == 0)
+                return 0;
+            return fread(ptr, size, 1, m_file) == 1 ? 0 : -1;
+        }
+        // ------------------------------------------------------------------------
+        virtual int Write(const void* ptr, asUINT size)
+        {
+            if (size == 0)
+                return 0;
+            return fwrite(ptr, size, 1, m_file) == 1 ? 0 : -1;
+        }
+    };   // ByteCodeStream
+#endif
+
+    //-----------------------------------------------------------------------------
+    /** Loads the compiled scripts from the byte code cache.
+     *  \param mod The (empty) module to load the byte code into.
+     *  \param path Path of the cached byte code.
+     *  \return True if the byte code was loaded successfully.
+     */
+    bool ScriptEngine::loadByteCode(asIScriptModule* mod, const std::string& path)
+    {
+#if ANGELSCRIPT_VERSION >= 23100
+        FILE* file = FileUtils::fopenU8Path(path, "rb");
+        if (!file)
+            return false;
+
+        ByteCodeStream stream(file);
+        int r = mod->LoadByteCode(&stream);
+        fclose(file);
+        if (r < 0)
+        {
+            Log::warn("Scripting", "Can not load cached byte code '%s' (%d), "
+                      "compiling the scripts.", path.c_str(), r);
+            // Remove the invalid file, so it can be replaced
+            file_manager->removeFile(path);
+            return false;
+        }
+        Log::debug("Scripting", "Loaded cached byte code '%s'.", path.c_str());
+        return true;
+#else
+        return false;
+#endif
+    }   // loadByteCode
+
+    //-----------------------------------------------------------------------------
+    /** Saves the compiled scripts in the byte code cache. The byte code is
+     *  written to a temporary file first, so that another STK process never
+     *  reads a partially written file.
+     *  \param mod The compiled module.
+     *  \param path Path of the cached byte code.
+     */
+    void ScriptEngine::saveByteCode(asIScriptModule* mod, const std::string& path)
+    {
+#if ANGELSCRIPT_VERSION >= 23100
+        const std::string tmp_path = path + ".tmp";
+        FILE* file = FileUtils::fopenU8Path(tmp_path, "wb");
+        if (!file)
+        {
+            Log::warn("Scripting", "Can not write byte code cache '%s'.",
+                      tmp_path.c_str());
+            return;
+        }
+
+        ByteCodeStream stream(file);
+        // Keep the debug information, so that errors in the script show
+        // the right line numbers.
+        int r = mod->SaveByteCode(&stream, false);
+        bool ok = fclose(file) == 0 && r >= 0;
+        if (ok)
+            ok = FileUtils::renameU8Path(tmp_path, path) == 0;
+        if (!ok)
+        {
+            Log::warn("Scripting", "Can not write byte code cache '%s'.",
+                      path.c_str());
+            file_manager->removeFile(tmp_path);
+        }
+#endif
+    }   // saveByteCode
+
+    //-----------------------------------------------------------------------------
 
     PendingTimeout::PendingTimeout(double time, asIScriptFunction* callback_delegate) 
     {
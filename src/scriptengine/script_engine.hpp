@@ -26,8 +26,9 @@
 
 #include <angelscript.h>
 #include <functional>
-#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 class TrackObjectPresentation;
 
@@ -67,10 +68,13 @@ namespace Scripting
     public:
 
 
-        void runFunction(bool warn_if_not_found, std::string function_name);
-        void runFunction(bool warn_if_not_found, std::string function_name,
+        void runFunction(bool warn_if_not_found,
+            const std::string& function_name);
+        void runFunction(bool warn_if_not_found,
+            const std::string& function_name,
             std::function<void(asIScriptContext*)> callback);
-        void runFunction(bool warn_if_not_found, std::string function_name,
+        void runFunction(bool warn_if_not_found,
+            const std::string& function_name,
             std::function<void(asIScriptContext*)> callback,
             std::function<void(asIScriptContext*)> get_return_value);
         void runDelegate(asIScriptFunction* delegate_fn);
@@ -88,10 +92,27 @@ namespace Scripting
 
     private:
         asIScriptEngine *m_engine;
-        std::map<std::string, asIScriptFunction*> m_functions_cache;
+
+        /** Maps a function declaration (including the parameters) to the
+         *  script function, or NULL if the function does not exist. */
+        std::unordered_map<std::string, asIScriptFunction*> m_functions_cache;
+
+        /** Contexts which are currently not used. Contexts are reused
+         *  instead of creating a new context for each function call. */
+        std::vector<asIScriptContext*> m_context_pool;
+
+        /** The preprocessed scripts loaded since the last build. They are
+         *  compiled (or loaded from the byte code cache) together in
+         *  compileLoadedScripts(). */
+        std::vector<std::string> m_script_sections;
+
         PtrVector<PendingTimeout> m_pending_timeouts;
 
         void configureEngine(asIScriptEngine *engine);
+        asIScriptContext* acquireContext();
+        void releaseContext(asIScriptContext* ctx);
+        bool loadByteCode(asIScriptModule* mod, const std::string& path);
+        void saveByteCode(asIScriptModule* mod, const std::string& path);
     };   // class ScriptEngine
 
 }
@@ -47,6 +47,7 @@ class AddonsPackRequest : public HTTPRequest
 {
 private:
     bool m_extraction_error;
+    std::atomic<float> m_extraction_progress;
     virtual void afterOperation()
     {
         Online::HTTPRequest::afterOperation();
@@ -60,13 +61,15 @@ private:
         file_manager->removeDirectory(tmp_extract);
         file_manager->checkAndCreateDirectory(tmp_extract);
         m_extraction_error =
-            !extract_zip(getFileName(), tmp_extract, true/*recursive*/);
+            !extract_zip(getFileName(), tmp_extract, true/*recursive*/,
+                         [this](float f) { m_extraction_progress.store(f); });
     }
 public:
     AddonsPackRequest(const std::string& url)
     : HTTPRequest(StringUtils::getBasename(url), /*priority*/5)
     {
         m_extraction_error = true;
+        m_extraction_progress.store(0.0f);
         if (url.find("https://") != std::string::npos ||
             url.find("http://") != std::string::npos)
         {
@@ -88,6 +91,9 @@ public:
             file_manager->getAddonsFile("tmp_extract"));
     }
     bool hadError() const { return hadDownloadError() || m_extraction_error; }
+    /** Returns the fraction of the downloaded pack that was extracted. */
+    float getExtractionProgress() const
+                                      { return m_extraction_progress.load(); }
 };   // DownloadAssetsRequest
 
 // ----------------------------------------------------------------------------
@@ -175,8 +181,9 @@ void AddonsPack::onUpdate(float delta)
         }
 
         float progress = m_download_request->getProgress();
-        // Last 1% for unzipping
-        m_progress->setValue(progress * 99.0f);
+        // Last 10% for unzipping
+        m_progress->setValue(progress * 90.0f +
+            m_download_request->getExtractionProgress() * 10.0f);
         if (progress < 0)
         {
             // Avoid displaying '-100%' in case of an error.
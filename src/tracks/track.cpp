@@ -59,6 +59,7 @@
 #include "main_loop.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/easter_egg_hunt.hpp"
+#include "modes/profile_world.hpp"
 #include "network/network_config.hpp"
 #include "network/protocols/game_protocol.hpp"
 #include "network/protocols/server_lobby.hpp"
@@ -1637,7 +1638,10 @@ void Track::update(int ticks)
     }
     float dt = stk_config->ticks2Time(ticks);
     m_check_manager->update(dt);
-    m_item_manager->update(ticks);
+    {
+        ProfileWorld::BenchmarkScope bs(ProfileWorld::BT_ITEMS);
+        m_item_manager->update(ticks);
+    }
 
     // TODO: enable onUpdate scripts if we ever find a compelling use for them
     //Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
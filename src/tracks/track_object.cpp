@@ -555,6 +555,19 @@ void TrackObject::update(float dt)
     if (m_animator) m_animator->updateWithWorldTicks(true/*has_physics*/);
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Returns true if update() has anything to do: running scripts of a library
+ *  node, checking a dynamic physical object, or moving a physical object
+ *  with its animation.
+ */
+bool TrackObject::needsUpdate() const
+{
+    if (m_presentation && m_presentation->needsUpdate())
+        return true;
+    if (m_physical_object && m_physical_object->isDynamic())
+        return true;
+    return m_animator && m_physical_object;
+}   // needsUpdate
 
 // ----------------------------------------------------------------------------
 /** This reset all physical object moved by 3d animation back to current ticks
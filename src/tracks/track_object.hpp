@@ -119,6 +119,7 @@ public:
     virtual void update(float dt);
     virtual void updateGraphics(float dt);
     virtual void resetAfterRewind();
+    bool         needsUpdate() const;
     void move(const core::vector3df& xyz, const core::vector3df& hpr,
               const core::vector3df& scale, bool updateRigidBody,
               bool isAbsoluteCoord);
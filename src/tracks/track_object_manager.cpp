@@ -23,17 +23,35 @@
 #include "config/stk_config.hpp"
 #include "graphics/lod_node.hpp"
 #include "graphics/material_manager.hpp"
+#include "guiengine/engine.hpp"
 #include "io/xml_node.hpp"
+#include "items/projectile_manager.hpp"
+#include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
 #include "network/network_config.hpp"
 #include "physics/physical_object.hpp"
 #include "tracks/track_object.hpp"
+#include "tracks/track_object_presentation.hpp"
 #include "utils/log.hpp"
+#include "utils/stk_process.hpp"
 
 #include <IMeshSceneNode.h>
 #include <ISceneManager.h>
 
+/** How often (in time steps) each animated object checks if it can become
+ *  dormant or needs to wake up. The checks of different objects are spread
+ *  over these time steps. */
+static const int DORMANCY_CHECK_TICKS = 15;
+
+/** Distance in addition to the distance a kart can drive between two checks
+ *  within which an animated object is woken up. */
+static const float DORMANCY_WAKE_DISTANCE = 20.0f;
+
+// ----------------------------------------------------------------------------
 TrackObjectManager::TrackObjectManager()
 {
+    m_update_list_dirty   = true;
+    m_animated_list_dirty = true;
 }   // TrackObjectManager
 
 // ----------------------------------------------------------------------------
@@ -53,6 +71,7 @@ void TrackObjectManager::add(const XMLNode &xml_node, scene::ISceneNode* parent,
     {
         TrackObject *obj = new TrackObject(xml_node, parent, model_def_loader, parent_library);
         m_all_objects.push_back(obj);
+        m_update_list_dirty = m_animated_list_dirty = true;
         if(obj->isDriveable())
             m_driveable_objects.push_back(obj);
     }
@@ -100,6 +119,7 @@ void TrackObjectManager::init()
             moveable_objects++;
         }
     }
+    m_update_list_dirty = m_animated_list_dirty = true;
 }   // init
 
 // ----------------------------------------------------------------------------
@@ -112,6 +132,10 @@ void TrackObjectManager::reset()
         curr->reset();
         curr->resetEnabled();
     }
+    // Library nodes need to run their reset script again
+    m_update_list_dirty = true;
+    for (AnimatedObject &ao : m_animated_objects)
+        ao.m_dormant = false;
 }   // reset
 
 // ----------------------------------------------------------------------------
@@ -188,13 +212,146 @@ void TrackObjectManager::updateGraphics(float dt)
  */
 void TrackObjectManager::update(float dt)
 {
-    TrackObject* curr;
-    for_in (curr, m_all_objects)
+    if (m_animated_list_dirty)
+        buildAnimatedList();
+    if (m_update_list_dirty)
+        buildUpdateList();
+
+    for (TrackObject* curr : m_updated_objects)
     {
         curr->update(dt);
+        // E.g. a library node which has run its scripts
+        if (!curr->needsUpdate())
+            m_update_list_dirty = true;
+    }
+
+    const int ticks = World::getWorld()->getTicksSinceStart();
+    for (unsigned int i = 0; i < m_animated_objects.size(); i++)
+    {
+        AnimatedObject &ao = m_animated_objects[i];
+        if ((ticks + i) % DORMANCY_CHECK_TICKS == 0)
+        {
+            const bool close = isAnythingClose(ao);
+            if (ao.m_dormant && close)
+            {
+                // Move the object to the current position of its animation
+                // without giving it the velocity of the jump
+                ao.m_object->resetAfterRewind();
+                ao.m_dormant = false;
+            }
+            else if (!ao.m_dormant && !close)
+                ao.m_dormant = true;
+        }
+        if (!ao.m_dormant)
+            ao.m_object->update(dt);
     }
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Collects the animated objects which can become dormant. Since a dormant
+ *  object is not moved, this is only done if nothing is rendered (i.e. on a
+ *  server or in the physics-only child process), and only for animations
+ *  which repeat themselves, so that the space they can be in is known.
+ *  Driveable objects are never dormant, since raycasts use their position.
+ */
+void TrackObjectManager::buildAnimatedList()
+{
+    m_animated_list_dirty = false;
+    m_update_list_dirty   = true;
+    m_animated_objects.clear();
+    if (!GUIEngine::isNoGraphics() && STKProcess::getType() != PT_CHILD)
+        return;
+
+    for (TrackObject* curr : m_all_objects)
+    {
+        ThreeDAnimation* animator = curr->getAnimator();
+        const PhysicalObject* po = curr->getPhysicalObject();
+        const TrackObjectPresentation* presentation =
+            curr->getPresentation<TrackObjectPresentation>();
+        if (!animator || !po || po->isDynamic() || curr->isDriveable() ||
+            (presentation && presentation->needsUpdate()))
+            continue;
+        // The swept box would not contain the movement of a parent
+        if (curr->getParentLibrary() &&
+            curr->getParentLibrary()->hasAnimatorRecursively())
+            continue;
+
+        AnimatedObject ao;
+        ao.m_object  = curr;
+        ao.m_dormant = false;
+        if (animator->getSweptAabb(&ao.m_min, &ao.m_max))
+            m_animated_objects.push_back(ao);
+    }
+}   // buildAnimatedList
+
+// ----------------------------------------------------------------------------
+/** Collects the objects which need to be updated each time step, and all
+ *  dynamic objects. Both lists keep the order of m_all_objects.
+ */
+void TrackObjectManager::buildUpdateList()
+{
+    m_update_list_dirty = false;
+    m_updated_objects.clear();
+    m_dynamic_objects.clear();
+    // m_animated_objects is in the same order as m_all_objects
+    unsigned int next_animated = 0;
+    for (TrackObject* curr : m_all_objects)
+    {
+        if (curr->getPhysicalObject() &&
+            curr->getPhysicalObject()->isDynamic())
+            m_dynamic_objects.push_back(curr);
+        if (next_animated < m_animated_objects.size() &&
+            m_animated_objects[next_animated].m_object == curr)
+        {
+            next_animated++;
+            continue;
+        }
+        if (curr->needsUpdate())
+            m_updated_objects.push_back(curr);
+    }
+}   // buildUpdateList
+
+// ----------------------------------------------------------------------------
+/** Returns true if a kart, a projectile or a dynamic physical object is
+ *  close enough to the swept box of an animated object that it might touch
+ *  the object before the next check.
+ *  \param ao The animated object to test.
+ */
+bool TrackObjectManager::isAnythingClose(const AnimatedObject &ao) const
+{
+    World* world = World::getWorld();
+    const KartSpatialIndex& index = world->getKartIndex();
+    // The index is built after this update, so it is one time step old
+    const float margin = DORMANCY_WAKE_DISTANCE + index.getMaxSpeed() *
+        stk_config->ticks2Time(DORMANCY_CHECK_TICKS + 1);
+    const Vec3 min = ao.m_min - Vec3(margin, margin, margin);
+    const Vec3 max = ao.m_max + Vec3(margin, margin, margin);
+    auto inside = [&min, &max](const Vec3& xyz)
+    {
+        return xyz.getX() >= min.getX() && xyz.getX() <= max.getX() &&
+               xyz.getY() >= min.getY() && xyz.getY() <= max.getY() &&
+               xyz.getZ() >= min.getZ() && xyz.getZ() <= max.getZ();
+    };
+
+    std::vector<unsigned int> karts;
+    index.getKartsInBox(min, max, &karts);
+    for (unsigned int id : karts)
+    {
+        if (id < world->getNumKarts() && inside(world->getKart(id)->getXYZ()))
+            return true;
+    }
+    if (ProjectileManager::get()->projectileInBox(min, max))
+        return true;
+    for (const TrackObject* curr : m_dynamic_objects)
+    {
+        if (curr->isEnabled() &&
+            inside(curr->getPhysicalObject()->getBody()
+                   ->getWorldTransform().getOrigin()))
+            return true;
+    }
+    return false;
+}   // isAnythingClose
+
 // ----------------------------------------------------------------------------
 void TrackObjectManager::resetAfterRewind()
 {
@@ -271,7 +428,8 @@ bool TrackObjectManager::castRay(const btVector3 &from,
 void TrackObjectManager::insertObject(TrackObject* object)
 {
     m_all_objects.push_back(object);
-}
+    m_update_list_dirty = m_animated_list_dirty = true;
+}   // insertObject
 
 // ----------------------------------------------------------------------------
 /** Removes the object from the scene graph, bullet, and the list of
@@ -281,5 +439,6 @@ void TrackObjectManager::insertObject(TrackObject* object)
 void TrackObjectManager::removeObject(TrackObject* obj)
 {
     m_all_objects.remove(obj);
+    m_update_list_dirty = m_animated_list_dirty = true;
     delete obj;
 }   // removeObject
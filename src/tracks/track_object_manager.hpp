@@ -22,9 +22,9 @@
 #include "physics/physical_object.hpp"
 #include "tracks/track_object.hpp"
 #include "utils/ptr_vector.hpp"
+#include "utils/vec3.hpp"
 
 class Track;
-class Vec3;
 class XMLNode;
 class LODNode;
 
@@ -51,6 +51,36 @@ protected:
     /** A second list which holds all objects that karts can drive on. */
     PtrVector<TrackObject, REF> m_driveable_objects;
 
+    /** An animated object which can become dormant, i.e. is not updated
+     *  while nothing is close to the box it sweeps during its animation. */
+    struct AnimatedObject
+    {
+        TrackObject *m_object;
+        /** The box containing the object at any time of its animation. */
+        Vec3 m_min, m_max;
+        bool m_dormant;
+    };
+    std::vector<AnimatedObject> m_animated_objects;
+
+    /** The objects which need to be updated each time step (see
+     *  TrackObject::needsUpdate()), except the ones in m_animated_objects.
+     *  Most track objects are static and never need an update. */
+    std::vector<TrackObject*> m_updated_objects;
+
+    /** All dynamic physical objects, which can wake up animated objects. */
+    std::vector<TrackObject*> m_dynamic_objects;
+
+    /** True if m_updated_objects needs to be rebuilt. */
+    bool m_update_list_dirty;
+
+    /** True if m_animated_objects needs to be rebuilt, which is more
+     *  expensive since the swept box of each animation is computed. */
+    bool m_animated_list_dirty;
+
+    void buildAnimatedList();
+    void buildUpdateList();
+    bool isAnythingClose(const AnimatedObject &ao) const;
+
 public:
          TrackObjectManager();
         ~TrackObjectManager();
@@ -327,7 +327,17 @@ void TrackObjectPresentationLibraryNode::update(float dt)
                 });
         }
     }
-}
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Returns true if the onStart or onReset script function still needs to be
+ *  executed. */
+bool TrackObjectPresentationLibraryNode::needsUpdate() const
+{
+    // Child process currently has no scripting engine
+    return STKProcess::getType() != PT_CHILD &&
+           (!m_start_executed || !m_reset_executed);
+}   // needsUpdate
 
 // ----------------------------------------------------------------------------
 TrackObjectPresentationLibraryNode::~TrackObjectPresentationLibraryNode()
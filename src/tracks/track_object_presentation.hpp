@@ -91,6 +91,8 @@ public:
     }
     virtual void updateGraphics(float dt) {}
     virtual void update(float dt) {}
+    /** Returns true if update() has anything to do at the moment. */
+    virtual bool needsUpdate() const { return false; }
     virtual void move(const core::vector3df& xyz, const core::vector3df& hpr,
         const core::vector3df& scale, bool isAbsoluteCoord) {}
 
@@ -201,6 +203,7 @@ public:
         ModelDefinitionLoader& model_def_loader);
     virtual ~TrackObjectPresentationLibraryNode();
     virtual void update(float dt) OVERRIDE;
+    virtual bool needsUpdate() const OVERRIDE;
     virtual void reset() OVERRIDE
     {
         m_reset_executed = false;
@@ -27,6 +27,7 @@
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
 #include "utils/file_utils.hpp"
+#include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/tls.hpp"
 #include "utils/vs.hpp"
@@ -98,72 +99,137 @@ Profiler::~Profiler()
 {
 }   // ~Profiler
 
+/** Id of the calling thread, -1 if it has none yet, and NOT_RECORDED if
+ *  there were too many threads. */
 thread_local int g_thread_id = -1;
-const int MAX_THREADS = 10;
+const int NOT_RECORDED = -2;
+/** Maximum number of threads with markers. The markers of further threads
+ *  are not recorded. */
+const int MAX_THREADS = 64;
+/** Number of completed events kept per thread for the trace export. */
+const size_t TRACE_EVENTS_PER_THREAD = 32768;
 //-----------------------------------------------------------------------------
 /** It is split from the constructor so that it can be avoided allocating
  *  unnecessary memory when the profiler is never used (for example in no
  *  graphics). */
 void Profiler::init()
 {
-    m_all_threads_data.resize(MAX_THREADS);
+    // Can be called twice if a trace was requested on the command line
+    if (!m_all_threads_data.empty())
+        return;
+    for (int i = 0; i < MAX_THREADS; i++)
+        m_all_threads_data.emplace_back(new ThreadData());
+    m_all_threads_data[0]->m_name = "main";
 
     // Add this thread to the thread mapping
     g_thread_id = 0;
     m_gpu_times.resize(Q_LAST * m_max_frames);
+    m_frame_start.resize(m_max_frames, m_time_last_sync);
 }   // init
 
 //-----------------------------------------------------------------------------
 /** Returns a unique index for a thread. If the calling thread is not yet in
- *  the mapping, it will assign a new unique id to this thread. */
+ *  the mapping, it will assign a new unique id to this thread.
+ *  \return The id, or NOT_RECORDED if there are too many threads.
+ */
 int Profiler::getThreadID()
 {
     if (g_thread_id == -1)
     {
-        if (m_threads_used >= MAX_THREADS)
+        const int id = m_threads_used.fetch_add(1);
+        if (id >= MAX_THREADS)
         {
-            g_thread_id = MAX_THREADS - 1;
+            if (id == MAX_THREADS)
+            {
+                Log::warn("Profiler", "More than %d threads, markers of "
+                          "further threads are not recorded.", MAX_THREADS);
+            }
+            g_thread_id = NOT_RECORDED;
             return g_thread_id;
         }
-        g_thread_id = m_threads_used.fetch_add(1);
+        g_thread_id = id;
+        std::string &name = m_all_threads_data[g_thread_id]->m_name;
+#if defined(__linux__) && defined(__GLIBC__)
+        // Use the name set with VS::setThreadName if available
+        char thread_name[32];
+        if (pthread_getname_np(pthread_self(), thread_name,
+                               sizeof(thread_name)) == 0)
+            name = thread_name;
+#endif
+        if (name.empty())
+            name = "thread " + StringUtils::toString(g_thread_id);
     }
     return g_thread_id;
 }   // getThreadID
 
 //-----------------------------------------------------------------------------
-/// Push a new marker that starts now
+/** Returns the number of threads which have markers. */
+int Profiler::getNumThreads() const
+{
+    return std::min(m_threads_used.load(), MAX_THREADS);
+}   // getNumThreads
+
+//-----------------------------------------------------------------------------
+/** Returns the id of the marker with the given name, interning the name
+ *  if it was not used before. The PROFILER_PUSH_CPU_MARKER macro calls this
+ *  only once for each place it is used.
+ *  \param name Name of the marker.
+ *  \param colour Colour used to draw the marker (only used the first time
+ *         this name is interned).
+ */
+int Profiler::getMarkerID(const char* name, const video::SColor& colour)
+{
+    std::lock_guard<std::mutex> lock(m_marker_lock);
+    std::map<std::string, int>::iterator i = m_marker_ids.find(name);
+    if (i != m_marker_ids.end())
+        return i->second;
+    int id = (int)m_marker_names.size();
+    m_marker_names.push_back(name);
+    m_marker_colours.push_back(colour);
+    m_marker_ids[name] = id;
+    return id;
+}   // getMarkerID
+
+//-----------------------------------------------------------------------------
+/** Returns the name of a marker id. */
+std::string Profiler::getMarkerName(int id) const
+{
+    std::lock_guard<std::mutex> lock(m_marker_lock);
+    return m_marker_names[id];
+}   // getMarkerName
+
+//-----------------------------------------------------------------------------
+/// Push a new marker that starts now, looking up the marker id by name
 void Profiler::pushCPUMarker(const char* name, const video::SColor& colour)
 {
     // Don't do anything when disabled or frozen
     if (!UserConfigParams::m_profiler_enabled ||
          m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE )
         return;
+    pushCPUMarker(getMarkerID(name, colour));
+}   // pushCPUMarker(const char*)
 
-    // We need to look before getting the thread id (since this might
-    // be a new thread which changes the structure).
-    m_lock.lock();
-    int thread_id = getThreadID();
+//-----------------------------------------------------------------------------
+/// Push a new marker that starts now
+void Profiler::pushCPUMarker(int id)
+{
+    // Don't do anything when disabled or frozen
+    if (!UserConfigParams::m_profiler_enabled ||
+         m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE )
+        return;
 
-    ThreadData &td = m_all_threads_data[thread_id];
-    AllEventData::iterator i = td.m_all_event_data.find(name);
-    double  start = getTimeMilliseconds() - m_time_last_sync;
-    if (i != td.m_all_event_data.end())
-    {
-        i->second.setStart(m_current_frame, start, (int)td.m_event_stack.size());
-    }
-    else
-    {
-        EventData ed(colour, m_max_frames);
-        ed.setStart(m_current_frame, start, (int)td.m_event_stack.size());
-        td.m_all_event_data[name] = ed;
-        // Ordered headings is used to determine the order in which the
-        // bar graph is drawn. Outer profiling events will be added first,
-        // so they will be drawn first, which gives the proper nested
-        // displayed of events.
-        td.m_ordered_headings.push_back(name);
-    }
-    td.m_event_stack.push_back(name);
-    m_lock.unlock();
+    // Only data of this thread is changed, so no lock is needed
+    int thread_id = getThreadID();
+    if (thread_id == NOT_RECORDED)
+        return;
+    ThreadData &td = *m_all_threads_data[thread_id];
+    if (!td.m_trace_events)
+        td.m_trace_events.reset(new RingEvent[TRACE_EVENTS_PER_THREAD]);
+
+    StackEntry entry;
+    entry.m_id    = id;
+    entry.m_start = getTimeMilliseconds();
+    td.m_event_stack.push_back(entry);
 }   // pushCPUMarker
 
 //-----------------------------------------------------------------------------
@@ -176,28 +242,135 @@ void Profiler::popCPUMarker()
         return;
     double now = getTimeMilliseconds();
 
-    m_lock.lock();
     int thread_id = getThreadID();
-    ThreadData &td = m_all_threads_data[thread_id];
+    if (thread_id == NOT_RECORDED)
+        return;
+    ThreadData &td = *m_all_threads_data[thread_id];
 
     // When the profiler gets enabled (which happens in the middle of the
     // main loop), there can be some pops without matching pushes (for one
     // frame) - ignore those events.
     if (td.m_event_stack.size() == 0)
-    {
-        m_lock.unlock();
         return;
-    }
-
-    assert(td.m_event_stack.size() > 0);
 
-    const std::string &name = td.m_event_stack.back();
-    td.m_all_event_data[name].setEnd(m_current_frame, now - m_time_last_sync);
+    const StackEntry &entry = td.m_event_stack.back();
+    const size_t count = td.m_trace_count.load(std::memory_order_relaxed);
+    // This overwrites the oldest event in the ring. The fence makes sure
+    // that a thread which reads a part of the new event also sees the
+    // count stored with the last event, see copyTraceEvents().
+    std::atomic_thread_fence(std::memory_order_release);
+    RingEvent &te = td.m_trace_events[count % TRACE_EVENTS_PER_THREAD];
+    te.m_id.store(entry.m_id, std::memory_order_relaxed);
+    te.m_layer.store((int)td.m_event_stack.size() - 1,
+                     std::memory_order_relaxed);
+    te.m_start.store(entry.m_start, std::memory_order_relaxed);
+    te.m_end.store(now, std::memory_order_relaxed);
+    // Publish the event to the threads reading the ring
+    td.m_trace_count.store(count + 1, std::memory_order_release);
 
     td.m_event_stack.pop_back();
-    m_lock.unlock();
 }   // popCPUMarker
 
+//-----------------------------------------------------------------------------
+/** Copies the completed events of a thread which are still in its ring,
+ *  while the thread may add new events.
+ *  \param td The data of the thread.
+ *  \param first Number of the first event to copy. Older events which are
+ *         no longer in the ring are skipped.
+ *  \param events The events are appended to this vector.
+ *  \return Number of the event after the last event copied.
+ */
+size_t Profiler::copyTraceEvents(const ThreadData &td, size_t first,
+                                 std::vector<TraceEvent> *events) const
+{
+    const size_t count = td.m_trace_count.load(std::memory_order_acquire);
+    if (count <= first)
+        return count;
+    if (count - first > TRACE_EVENTS_PER_THREAD)
+        first = count - TRACE_EVENTS_PER_THREAD;
+    const size_t old_size = events->size();
+    for (size_t n = first; n < count; n++)
+    {
+        const RingEvent &re = td.m_trace_events[n % TRACE_EVENTS_PER_THREAD];
+        TraceEvent te;
+        te.m_id    = re.m_id.load(std::memory_order_relaxed);
+        te.m_layer = re.m_layer.load(std::memory_order_relaxed);
+        te.m_start = re.m_start.load(std::memory_order_relaxed);
+        te.m_end   = re.m_end.load(std::memory_order_relaxed);
+        events->push_back(te);
+    }
+
+    // The thread might have overwritten the oldest events while they were
+    // copied, remove those
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const size_t count_now = td.m_trace_count.load(std::memory_order_relaxed);
+    if (count_now >= first + TRACE_EVENTS_PER_THREAD)
+    {
+        const size_t overwritten =
+            std::min(count_now - TRACE_EVENTS_PER_THREAD - first + 1,
+                     count - first);
+        events->erase(events->begin() + old_size,
+                      events->begin() + old_size + overwritten);
+    }
+    return count;
+}   // copyTraceEvents
+
+//-----------------------------------------------------------------------------
+/** Adds the time of a completed event to the frames it ran in. Must be
+ *  called with m_lock.
+ *  \param td The data of the thread which recorded the event.
+ *  \param te The event.
+ *  \param now End of the current frame.
+ */
+void Profiler::addEventToFrames(ThreadData *td, const TraceEvent &te,
+                                double now)
+{
+    if (te.m_id >= (int)td->m_all_event_data.size())
+        td->m_all_event_data.resize(te.m_id + 1);
+    EventData &ed = td->m_all_event_data[te.m_id];
+    if (!ed.isUsed())
+    {
+        video::SColor colour;
+        {
+            std::lock_guard<std::mutex> lock(m_marker_lock);
+            colour = m_marker_colours[te.m_id];
+        }
+        ed = EventData(colour, m_max_frames, te.m_layer);
+        // Ordered headings is used to determine the order in which the
+        // bar graph is drawn. Outer profiling events are added first,
+        // so they will be drawn first, which gives the proper nested
+        // displayed of events.
+        std::vector<int> &headings = td->m_ordered_headings;
+        std::vector<int>::iterator i = headings.begin();
+        while (i != headings.end() &&
+               td->m_all_event_data[*i].getLayer() <= te.m_layer)
+            i++;
+        headings.insert(i, te.m_id);
+    }
+
+    // An event which runs while frames are synchronised is split into one
+    // part for each frame, starting with the current frame.
+    int frame = m_current_frame;
+    double frame_end = now;
+    for (int n = 0; n < m_max_frames - 1; n++)
+    {
+        const double frame_start = m_frame_start[frame];
+        const double start = std::max(te.m_start, frame_start);
+        const double end   = std::min(te.m_end, frame_end);
+        if (start <= end)
+        {
+            Marker &marker = ed.getMarker(frame);
+            marker.setStart(start - frame_start, te.m_layer);
+            marker.setEnd(end - frame_start);
+        }
+        if (te.m_start >= frame_start ||
+            (frame == 0 && !m_has_wrapped_around))
+            break;
+        frame_end = frame_start;
+        frame = frame == 0 ? m_max_frames - 1 : frame - 1;
+    }
+}   // addEventToFrames
+
 //-----------------------------------------------------------------------------
 /** Switches the profiler either on or off.
  */
@@ -230,6 +403,21 @@ void Profiler::synchronizeFrame()
     double now = getTimeMilliseconds();
 
     m_lock.lock();
+    // First add the events completed by all threads since the last sync to
+    // the frames they ran in. Events which are still in progress (e.g. in a
+    // separate thread) are added when they are completed.
+    std::vector<TraceEvent> events;
+    const int num_threads = getNumThreads();
+    for (int i = 0; i < num_threads; i++)
+    {
+        ThreadData &td = *m_all_threads_data[i];
+        events.clear();
+        td.m_events_in_frames = copyTraceEvents(td, td.m_events_in_frames,
+                                                &events);
+        for (const TraceEvent &te : events)
+            addEventToFrames(&td, te, now);
+    }   // for i in threads
+
     // Set index to next frame
     int next_frame = m_current_frame+1;
     if (next_frame >= m_max_frames)
@@ -238,37 +426,21 @@ void Profiler::synchronizeFrame()
         m_has_wrapped_around = true;
     }
 
-    // First finish all markers that are currently in progress, and add
-    // a new start marker for the next frame. So e.g. if a thread is busy in
-    // one event while the main thread syncs the frame, this event will get
-    // split into two parts in two consecutive frames
-    for (int i = 0; i < m_threads_used; i++)
-    {
-        ThreadData &td = m_all_threads_data[i];
-        for(unsigned int j=0; j<td.m_event_stack.size(); j++)
-        {
-            EventData &ed = td.m_all_event_data[td.m_event_stack[j]];
-            ed.setEnd(m_current_frame, now-m_time_last_sync);
-            ed.setStart(next_frame, 0, j);
-        }   // for j in event stack
-    }   // for i in threads
-
     if (m_has_wrapped_around)
     {
         // The new entries for the circular buffer need to be cleared
         // to make sure the new values are not accumulated on top of
         // the data from a previous frame.
-        for (int i = 0; i < m_threads_used; i++)
+        for (int i = 0; i < num_threads; i++)
         {
-            ThreadData &td = m_all_threads_data[i];
-            AllEventData &aed = td.m_all_event_data;
-            AllEventData::iterator k;
-            for (k = aed.begin(); k != aed.end(); ++k)
-                k->second.getMarker(next_frame).clear();
+            ThreadData &td = *m_all_threads_data[i];
+            for (int id : td.m_ordered_headings)
+                td.m_all_event_data[id].getMarker(next_frame).clear();
         }
     }   // is has wrapped around
 
     m_current_frame = next_frame;
+    m_frame_start[m_current_frame] = now;
 
     // Remember the date of last synchronization
     m_time_between_sync = now - m_time_last_sync;
@@ -320,14 +492,13 @@ void Profiler::draw()
     // threads might have 'unfinished' events, or multiple identical events
     // in this frame (i.e. start time would be incorrect).
     int thread_id = getThreadID();
-    AllEventData &aed = m_all_threads_data[thread_id].m_all_event_data;
-    AllEventData::iterator j;
-    for (j = aed.begin(); j != aed.end(); ++j)
+    const ThreadData &main_td = *m_all_threads_data[thread_id];
+    for (int id : main_td.m_ordered_headings)
     {
-        const Marker &marker = j->second.getMarker(indx);
+        const Marker &marker = main_td.m_all_event_data[id].getMarker(indx);
         start = std::min(start, marker.getStart());
         end = std::max(end, marker.getEnd());
-    }   // for j in events
+    }   // for id in events
 
 
     const double duration = end - start;
@@ -336,10 +507,12 @@ void Profiler::draw()
     // Get the mouse pos
     core::vector2di mouse_pos = GUIEngine::EventHandler::get()->getMousePos();
 
-    std::stack<AllEventData::iterator> hovered_markers;
-    for (int i = 0; i < m_threads_used; i++)
+    // Stores thread id and marker id of all hovered markers
+    std::stack<std::pair<int, int> > hovered_markers;
+    const int num_threads = getNumThreads();
+    for (int i = 0; i < num_threads; i++)
     {
-        ThreadData &td = m_all_threads_data[i];
+        ThreadData &td = *m_all_threads_data[i];
         AllEventData &aed = td.m_all_event_data;
 
         // Thread 1 has 'proper' start and end events (assuming that each
@@ -349,8 +522,9 @@ void Profiler::draw()
         double start_xpos = 0;
         for(int k=0; k<(int)td.m_ordered_headings.size(); k++)
         {
-            AllEventData::iterator j = aed.find(td.m_ordered_headings[k]);
-            const Marker &marker = j->second.getMarker(indx);
+            const int id = td.m_ordered_headings[k];
+            const EventData &ed = aed[id];
+            const Marker &marker = ed.getMarker(indx);
             if (i == thread_id)
                 start_xpos = factor*marker.getStart();
             core::rect<s32> pos((s32)(x_offset + start_xpos),
@@ -365,11 +539,11 @@ void Profiler::draw()
             pos.UpperLeftCorner.Y  += 2 * (int)marker.getLayer();
             pos.LowerRightCorner.Y -= 2 * (int)marker.getLayer();
 
-            GL32_draw2DRectangle(j->second.getColour(), pos);
+            GL32_draw2DRectangle(ed.getColour(), pos);
             // If the mouse cursor is over the marker, get its information
             if (pos.isPointInside(mouse_pos))
             {
-                hovered_markers.push(j);
+                hovered_markers.push(std::make_pair(i, id));
             }
 
         }   // for j in AllEventdata
@@ -379,7 +553,7 @@ void Profiler::draw()
     // GPU profiler
     QueryPerf hovered_gpu_marker = Q_LAST;
     long hovered_gpu_marker_elapsed = 0;
-    int gpu_y = int(y_offset + m_threads_used*line_height + line_height/2);
+    int gpu_y = int(y_offset + num_threads*line_height + line_height/2);
     float total = 0;
     for (unsigned i = 0; i < Q_LAST; i++)
     {
@@ -430,7 +604,7 @@ void Profiler::draw()
     {
         s32 x_sync = (s32)(x_offset + factor*m_time_between_sync);
         s32 y_up_sync = (s32)(MARGIN_Y*screen_size.Height);
-        s32 y_down_sync = (s32)( (MARGIN_Y + (2+m_threads_used)*LINE_HEIGHT)
+        s32 y_down_sync = (s32)( (MARGIN_Y + (2+num_threads)*LINE_HEIGHT)
                                 * screen_size.Height                         );
 
         GL32_draw2DRectangle(video::SColor(0xFF, 0x00, 0x00, 0x00),
@@ -445,11 +619,12 @@ void Profiler::draw()
         core::stringw text;
         while(!hovered_markers.empty())
         {
-            AllEventData::iterator j = hovered_markers.top();
-            const Marker &marker = j->second.getMarker(indx);
+            const std::pair<int, int> &hovered = hovered_markers.top();
+            const Marker &marker = m_all_threads_data[hovered.first]
+                ->m_all_event_data[hovered.second].getMarker(indx);
             std::ostringstream oss;
             oss.precision(4);
-            oss << j->first << " [" << (marker.getDuration()) << " ms / ";
+            oss << getMarkerName(hovered.second) << " [" << (marker.getDuration()) << " ms / ";
             oss.precision(3);
             oss << marker.getDuration()*100.0 / duration << "%]" << std::endl;
             text += oss.str().c_str();
@@ -535,14 +710,15 @@ void Profiler::writeToFile()
     std::string base_name =
                file_manager->getUserConfigFile(file_manager->getStdoutName());
     // First CPU data
-    for (int thread_id = 0; thread_id < m_threads_used; thread_id++)
+    for (int thread_id = 0; thread_id < getNumThreads(); thread_id++)
     {
         std::ofstream f(FileUtils::getPortableWritingPath(
             base_name + ".profile-cpu-" + StringUtils::toString(thread_id)));
-        ThreadData &td = m_all_threads_data[thread_id];
+        ThreadData &td = *m_all_threads_data[thread_id];
         f << "#  ";
         for (unsigned int i = 0; i < td.m_ordered_headings.size(); i++)
-            f << "\"" << td.m_ordered_headings[i] << "(" << i+1 <<")\"   ";
+            f << "\"" << getMarkerName(td.m_ordered_headings[i])
+              << "(" << i+1 <<")\"   ";
         f << std::endl;
         int start = m_has_wrapped_around ? m_current_frame + 1 : 0;
         if (start > m_max_frames) start -= m_max_frames;
@@ -582,4 +758,91 @@ void Profiler::writeToFile()
     f_gpu.close();
     m_lock.unlock();
 
+    writeToChromeTrace(base_name + ".profile-trace.json");
 }   // writeFile
+
+//-----------------------------------------------------------------------------
+/** Writes the most recent events of all threads in the Chrome trace event
+ *  format, which can be loaded into chrome://tracing or Perfetto. Unlike
+ *  writeToFile this does not need any graphics, so it can be used for
+ *  servers, too.
+ *  \param filename Name of the file to write.
+ */
+void Profiler::writeToChromeTrace(const std::string &filename)
+{
+    if (m_all_threads_data.empty())
+        return;
+
+    std::ofstream f(FileUtils::getPortableWritingPath(filename));
+    if (!f.is_open())
+    {
+        Log::error("Profiler", "Can't open '%s' for writing.",
+                   filename.c_str());
+        return;
+    }
+
+    // Take a copy of the names, so that escaping is only done once
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_marker_lock);
+        names.reserve(m_marker_names.size());
+        for (const std::string &name : m_marker_names)
+        {
+            std::string escaped;
+            for (char c : name)
+            {
+                if (c == '"' || c == '\\')
+                    escaped += '\\';
+                if ((unsigned char)c >= 0x20)
+                    escaped += c;
+            }
+            names.push_back(escaped);
+        }
+    }
+
+    // Copy the events first, the threads can continue to add events
+    const int num_threads = getNumThreads();
+    std::vector<std::vector<TraceEvent> > events(num_threads);
+    for (int i = 0; i < num_threads; i++)
+        copyTraceEvents(*m_all_threads_data[i], 0, &events[i]);
+
+    // Use the oldest recorded event as time origin
+    double origin = -1.0;
+    for (int i = 0; i < num_threads; i++)
+    {
+        for (const TraceEvent &te : events[i])
+        {
+            if (origin < 0.0 || te.m_start < origin)
+                origin = te.m_start;
+        }
+    }
+
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char buffer[256];
+    for (int i = 0; i < num_threads; i++)
+    {
+        // The name of a thread is only set once it recorded an event
+        if (events[i].empty())
+            continue;
+        f << (first ? "\n" : ",\n");
+        first = false;
+        f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+          << ",\"args\":{\"name\":\"" << m_all_threads_data[i]->m_name
+          << "\"}}";
+
+        for (const TraceEvent &te : events[i])
+        {
+            // Times are in microseconds
+            snprintf(buffer, sizeof(buffer),
+                     ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.1f,"
+                     "\"dur\":%.1f,\"name\":\"", i,
+                     (te.m_start - origin) * 1000.0,
+                     (te.m_end - te.m_start) * 1000.0);
+            f << buffer << names[te.m_id] << "\"}";
+        }
+    }   // for i < num_threads
+    f << "\n]}\n";
+    f.close();
+    Log::info("Profiler", "Wrote trace to '%s'.", filename.c_str());
+}   // writeToChromeTrace
@@ -27,6 +27,8 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <stack>
 #include <streambuf>
@@ -69,7 +71,20 @@ double getTimeMilliseconds();
 #define ENABLE_PROFILER
 
 #ifdef ENABLE_PROFILER
-    #define PROFILER_PUSH_CPU_MARKER(name, r, g, b) \
+    /** Pushes a marker with a constant name. The name is interned only once
+     *  per call site, so pushing the marker does not need any string
+     *  handling. The name must be a string literal. */
+    #define PROFILER_PUSH_CPU_MARKER(name, r, g, b)                          \
+        do                                                                   \
+        {                                                                    \
+            static const int profiler_marker_id =                            \
+                profiler.getMarkerID("" name, video::SColor(0xFF, r, g, b)); \
+            profiler.pushCPUMarker(profiler_marker_id);                      \
+        } while (0)
+
+    /** Pushes a marker with a name computed at runtime, which needs to be
+     *  looked up each time. */
+    #define PROFILER_PUSH_DYNAMIC_CPU_MARKER(name, r, g, b) \
         profiler.pushCPUMarker(name, video::SColor(0xFF, r, g, b))
 
     #define PROFILER_POP_CPU_MARKER()  \
@@ -82,6 +97,7 @@ double getTimeMilliseconds();
         profiler.draw()
 #else
     #define PROFILER_PUSH_CPU_MARKER(name, r, g, b)
+    #define PROFILER_PUSH_DYNAMIC_CPU_MARKER(name, r, g, b)
     #define PROFILER_POP_CPU_MARKER()
     #define PROFILER_SYNC_FRAME()
     #define PROFILER_DRAW()
@@ -170,14 +186,22 @@ private:
         /** Vector of all buffered markers. */
         std::vector<Marker> m_all_markers;
 
+        /** Nesting depth of the event when it was first recorded, used to
+         *  draw outer events first. */
+        int m_layer;
+
     public:
-        EventData() {}
-        EventData(video::SColor colour, int max_size)
+        EventData() { m_layer = 0; }
+        EventData(video::SColor colour, int max_size, int layer)
         {
             m_all_markers.resize(max_size);
             m_colour = colour;
+            m_layer  = layer;
         }   // EventData
         // --------------------------------------------------------------------
+        /** Returns if this event was used in a thread at all. */
+        bool isUsed() const { return !m_all_markers.empty(); }
+        // --------------------------------------------------------------------
         /** Records the start of an event for a given frame. */
         void setStart(size_t frame, double start, int layer)
         {
@@ -198,45 +222,105 @@ private:
         /** Returns the colour for this event. */
         video::SColor getColour() const { return m_colour;  }
         // --------------------------------------------------------------------
+        /** Returns the nesting depth when the event was first recorded. */
+        int getLayer() const { return m_layer; }
     };   // EventData
 
     // ========================================================================
-    /** The mapping of event names to the corresponding EventData. */
-    typedef std::map<std::string, EventData> AllEventData;
+    /** The event data of one thread, indexed by marker id. */
+    typedef std::vector<EventData> AllEventData;
+    // ========================================================================
+    /** An entry in the stack of currently active events of a thread. */
+    struct StackEntry
+    {
+        /** Id of the marker. */
+        int    m_id;
+        /** Absolute start time, used for the trace events. */
+        double m_start;
+    };   // StackEntry
+    // ========================================================================
+    /** A completed event, as copied from a trace ring. */
+    struct TraceEvent
+    {
+        int    m_id;
+        int    m_layer;
+        double m_start;
+        double m_end;
+    };   // TraceEvent
+    // ========================================================================
+    /** A completed event in the per-thread trace ring. The thread overwrites
+     *  the oldest events while other threads might read them, so all values
+     *  are atomic (only relaxed stores and loads are used). */
+    struct RingEvent
+    {
+        std::atomic<int>    m_id;
+        std::atomic<int>    m_layer;
+        std::atomic<double> m_start;
+        std::atomic<double> m_end;
+    };   // RingEvent
     // ========================================================================
+    /** The markers of one thread. Pushing and popping markers only changes
+     *  the event stack and the trace ring of the calling thread, without any
+     *  lock. The frame data is built from the trace ring by the thread which
+     *  synchronises the frames, see synchronizeFrame().
+     */
     struct ThreadData
     {
-        /** Stack of events to detect nesting. */
-        std::vector< std::string > m_event_stack;
+        /** Stack of events to detect nesting. Only used by the thread. */
+        std::vector<StackEntry> m_event_stack;
+
+        /** Ring of the most recent completed events, preallocated when the
+         *  thread pushes its first marker. */
+        std::unique_ptr<RingEvent[]> m_trace_events;
+
+        /** Total number of events written to m_trace_events. It is stored
+         *  (with release order) after an event is written, so other threads
+         *  can read all events before it. */
+        std::atomic<size_t> m_trace_count;
+
+        /** Name of the thread, used in the trace export. Set before the
+         *  first event is stored. */
+        std::string m_name;
 
-        /** This stores the event names in the order in which they occur.
-        *  This means that 'outer' events occur here before any child
-        *  events. This list is then used to determine the order in which the
-        *  bar graphs are drawn, which results in the proper nesting of events.*/
-        std::vector<std::string> m_ordered_headings;
+        /** Number of events of the ring already added to the frame data. */
+        size_t m_events_in_frames;
 
+        /** This stores the event ids ordered by nesting depth, so that
+         *  'outer' events occur here before any child events. This list is
+         *  then used to determine the order in which the bar graphs are
+         *  drawn, which results in the proper nesting of events. */
+        std::vector<int> m_ordered_headings;
+
+        /** The time of the events in each frame, indexed by marker id. */
         AllEventData m_all_event_data;
+
+        ThreadData() : m_trace_count(0), m_events_in_frames(0) {}
     };   // class ThreadData
 
     // ========================================================================
 
     /** Data structure containing all currently buffered markers. The index
-     *  is the thread id. */
-    std::vector< ThreadData> m_all_threads_data;
+     *  is the thread id. All entries are created in init(), so that threads
+     *  can add their markers while others read them. */
+    std::vector<std::unique_ptr<ThreadData> > m_all_threads_data;
 
     /** Buffer for the GPU times (in ms). */
     std::vector<int> m_gpu_times;
 
-    /** Counts the threads used. */
+    /** Counts the threads used, which can be more than the threads which
+     *  have an entry in m_all_threads_data. */
     std::atomic<int> m_threads_used;
 
     /** Index of the current frame in the buffer. */
     int m_current_frame;
 
-    /** We don't need the bool, but easiest way to get a lock for the whole
-     *  instance (since we need to avoid that a synch is done which changes
-     *  the current frame while another threaded uses this variable, or
-     *  while a new thread is added. */
+    /** Start time of each frame in the buffer. */
+    std::vector<double> m_frame_start;
+
+    /** We don't need the bool, but easiest way to get a lock for the frame
+     *  data (since we need to avoid that a synch is done which changes
+     *  the current frame while the data is drawn or written). Markers don't
+     *  use it. */
     Synchronised<bool> m_lock;
 
     /** True if the circular buffer has wrapped around. */
@@ -253,10 +337,20 @@ private:
     /** Time between now and last sync, used to scale the GUI bar. */
     double m_time_between_sync;
 
-    /** List of all event names. This list is sorted to make sure
-     *  if the circular buffer is dumped more than once the order
-     *  of events remains the same. */
-    std::vector<std::string> m_all_event_names;
+    /** The names of all interned markers, indexed by marker id. */
+    std::vector<std::string> m_marker_names;
+
+    /** The colours of all interned markers, indexed by marker id. */
+    std::vector<video::SColor> m_marker_colours;
+
+    /** Maps marker names to marker ids. */
+    std::map<std::string, int> m_marker_ids;
+
+    /** Protects the interned markers. */
+    mutable std::mutex m_marker_lock;
+
+    /** If not empty, a trace is written to this file on exit. */
+    std::string m_trace_file;
 
     // Handling freeze/unfreeze by clicking on the display
     enum FreezeState
@@ -271,12 +365,20 @@ private:
 
 private:
     int  getThreadID();
+    int  getNumThreads() const;
+    size_t copyTraceEvents(const ThreadData &td, size_t first,
+                           std::vector<TraceEvent> *events) const;
+    void addEventToFrames(ThreadData *td, const TraceEvent &te, double now);
     void drawBackground();
+    std::string getMarkerName(int id) const;
 
 public:
              Profiler();
     virtual ~Profiler();
     void     init();
+    int      getMarkerID(const char* name,
+                         const video::SColor& color=video::SColor());
+    void     pushCPUMarker(int id);
     void     pushCPUMarker(const char* name="N/A",
                            const video::SColor& color=video::SColor());
     void     popCPUMarker();
@@ -285,6 +387,22 @@ public:
     void     draw();
     void     onClick(const core::vector2di& mouse_pos);
     void     writeToFile();
+    void     writeToChromeTrace(const std::string &filename);
+
+    // ------------------------------------------------------------------------
+    /** Sets the file the trace of all threads is written to on exit (see
+     *  writeTraceOnExit()). */
+    void setTraceFile(const std::string &filename)
+    {
+        m_trace_file = filename;
+    }   // setTraceFile
+    // ------------------------------------------------------------------------
+    /** Writes the trace if a trace file was set. */
+    void writeTraceOnExit()
+    {
+        if (!m_trace_file.empty())
+            writeToChromeTrace(m_trace_file);
+    }   // writeTraceOnExit
 
     // ------------------------------------------------------------------------
     bool isFrozen() const { return m_freeze_state == FROZEN; }
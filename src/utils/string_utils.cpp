@@ -1360,6 +1360,10 @@ namespace StringUtils
         assert(versionToInt("1-beta8"         ) ==  10000018);
         assert(versionToInt("1-rc9"           ) ==  10000029);
         assert(versionToInt("1.0-rc1"         ) ==  10000021);   // same as 1-rc1
+
+        assert(fnv1a64(""  ) == 0xcbf29ce484222325ULL);
+        assert(fnv1a64("a" ) == 0xaf63dc4c8601ec8cULL);
+        assert(fnv1a64("ab") == fnv1a64("b", fnv1a64("a")));
     }   // unitTesting
     // ------------------------------------------------------------------------
     std::pair<std::string, std::string> extractVersionOS(
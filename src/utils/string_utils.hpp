@@ -304,6 +304,25 @@ namespace StringUtils
     std::pair<std::string, std::string> extractVersionOS(
                                                 const std::string& user_agent);
     // ------------------------------------------------------------------------
+    /** 64-bit FNV-1a hash of a block of memory. The result of a previous call
+     *  can be passed as seed to hash data which is split into several parts.
+     */
+    inline uint64_t fnv1a64(const void* data, size_t size,
+                            uint64_t seed = 0xcbf29ce484222325ULL)
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            seed ^= p[i];
+            seed *= 0x100000001b3ULL;
+        }
+        return seed;
+    }   // fnv1a64
+    // ------------------------------------------------------------------------
+    inline uint64_t fnv1a64(const std::string& s,
+                            uint64_t seed = 0xcbf29ce484222325ULL)
+                                { return fnv1a64(s.c_str(), s.size(), seed); }
+    // ------------------------------------------------------------------------
     /* Get line from istream with taking into account for its line ending. */
     inline std::istream& safeGetline(std::istream& is, std::string& t)
     {
@@ -0,0 +1,50 @@
+#!/bin/bash
+#
+# Runs a fixed set of headless AI races (profile mode) and writes the
+# per-subsystem timings of each race to an XML file. If a baseline directory
+# is given, each result is compared with the file of the same name in it,
+# and the script exits with 1 if any result is worse.
+# The timings are exclusive: "world" is the time of the world update without
+# the other timings, and "karts" doesn't include "ai", so they add up to the
+# total update time.
+#
+# Usage: run_benchmark.sh path/to/supertuxkart output_dir [baseline_dir]
+# Environment: KARTS (default 8), LAPS (default 3), SEED (default 1234),
+#              TOLERANCE in percent (default 10).
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 path/to/supertuxkart output_dir [baseline_dir]"
+    exit 2
+fi
+
+stk=$1
+out=$2
+baseline=$3
+karts=${KARTS:-8}
+laps=${LAPS:-3}
+seed=${SEED:-1234}
+tolerance=${TOLERANCE:-10}
+
+mkdir -p $out
+status=0
+
+# mode 0 is a normal race (with items), mode 1 time trial (without items)
+for mode in 0 1; do
+    for track in lighthouse zengarden cocoa_temple; do
+        name=$track-mode$mode-$karts
+        echo "Benchmarking $name"
+        args="--log=0 --no-graphics --no-sound --seed=$seed --mode=$mode
+              --track=$track --numkarts=$karts --difficulty=3
+              --profile-laps=$laps --benchmark=$out/$name.xml
+              --benchmark-tolerance=$tolerance"
+        if [ -n "$baseline" ]; then
+            args="$args --benchmark-baseline=$baseline/$name.xml"
+        fi
+        $stk $args > $out/$name.log 2>&1 || status=1
+    done
+done
+
+if [ $status -ne 0 ]; then
+    echo "Benchmark regression (or error), see the logs in $out."
+fi
+exit $status